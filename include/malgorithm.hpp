@@ -1,13 +1,104 @@
 #pragma once
 
+#include "mfunctional.hpp"
 #include "miterator.hpp"
+#include "msimd.hpp"
+#include "mspan.hpp"
 #include "mtype_traits.hpp"
 #include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
-namespace mstl {
-// find the first occurence of the value;
+// Fast paths. When both ranges are contiguous (see miterator.hpp) and the
+// elements are plain bytes as far as the operation can tell, copy, fill,
+// find and equal hand the whole range to memmove, memset, memchr and
+// memcmp. libc has vectorized versions of those that beat any element
+// loop. find and count over wider integers and floats use the kernels in
+// msimd.hpp. Everything else, and anything evaluated at compile time,
+// takes the loop.
+namespace mstl::algorithm_UTILL {
+
+// the element type an iterator refers to, cv and all.
+template <typename Iter>
+using element__ =
+    typename mstl::remove_reference<decltype(*mstl::declval<Iter &>())>::type;
+
+// &*it, it must be dereferenceable.
+template <typename Iter> auto *address__(Iter it) noexcept {
+  if constexpr (mstl::is_pointer<Iter>::value) {
+    return it;
+  } else {
+    return mstl::addressof(*it);
+  }
+}
+
+// copying In to Out is a memmove: the same trivially copyable type on
+// both sides.
+template <typename In, typename Out, typename = void>
+struct is_memmovable__ : mstl::false_type {};
+template <typename In, typename Out>
+struct is_memmovable__<In, Out, mstl::void_t<element__<In>, element__<Out>>>
+    : mstl::integral_constant<
+          bool,
+          mstl::is_contiguous_iterator<In>::value &&
+              mstl::is_contiguous_iterator<Out>::value &&
+              mstl::is_same<typename mstl::remove_cv<element__<In>>::type,
+                            element__<Out>>::value &&
+              mstl::is_trivially_copyable<element__<Out>>::value> {};
+
+// filling Iter with T is a memset when the bytes of the value repeat.
+template <typename Iter, typename T, typename = void>
+struct is_memsettable__ : mstl::false_type {};
+template <typename Iter, typename T>
+struct is_memsettable__<Iter, T, mstl::void_t<element__<Iter>>>
+    : mstl::integral_constant<
+          bool, mstl::is_contiguous_iterator<Iter>::value &&
+                    mstl::is_scalar<element__<Iter>>::value &&
+                    !mstl::is_const<element__<Iter>>::value &&
+                    mstl::is_scalar<T>::value> {};
+
+// comparing two ranges of Iter is a memcmp: the type has no padding and
+// equal values have equal bytes. Not true for floats, 0.0 == -0.0.
+template <typename Iter1, typename Iter2, typename = void>
+struct is_memcmpable__ : mstl::false_type {};
+template <typename Iter1, typename Iter2>
+struct is_memcmpable__<Iter1, Iter2,
+                       mstl::void_t<element__<Iter1>, element__<Iter2>>> {
+  using type__ = typename mstl::remove_cv<element__<Iter1>>::type;
+  static constexpr bool value =
+      mstl::is_contiguous_iterator<Iter1>::value &&
+      mstl::is_contiguous_iterator<Iter2>::value &&
+      mstl::is_same<type__,
+                    typename mstl::remove_cv<element__<Iter2>>::type>::value &&
+      (mstl::is_integral<type__>::value || mstl::is_enum<type__>::value ||
+       mstl::is_pointer<type__>::value);
+};
+
+// finding T in bytes is a memchr.
+template <typename Iter, typename T, typename = void>
+struct is_memchrable__ : mstl::false_type {};
+template <typename Iter, typename T>
+struct is_memchrable__<Iter, T, mstl::void_t<element__<Iter>>>
+    : mstl::integral_constant<
+          bool, mstl::is_contiguous_iterator<Iter>::value &&
+                    mstl::is_integral<element__<Iter>>::value &&
+                    sizeof(element__<Iter>) == 1 &&
+                    mstl::is_integral<T>::value> {};
+
+// v == value in the type the comparison converts both to, spelled out so
+// mixed signs don't warn. With v the value cast to the element type, false
+// means no element can compare equal to value.
+template <typename E, typename T>
+constexpr bool same_value__(E v, const T &value) noexcept {
+  using C = decltype(true ? E() : T());
+  return static_cast<C>(v) == static_cast<C>(value);
+}
+
+// the plain loops behind find and count.
 template <typename InputIter, typename T>
-constexpr InputIter find(InputIter first, InputIter last, const T &value) {
+constexpr InputIter find_loop__(InputIter first, InputIter last,
+                                const T &value) {
   for (; first != last; ++first) {
     if (*first == value) {
       return first;
@@ -16,7 +107,96 @@ constexpr InputIter find(InputIter first, InputIter last, const T &value) {
   return last;
 }
 
-template <typename InputIter, typename T, typename UnaryPredicate>
+template <typename InputIter, typename T>
+constexpr typename mstl::iterator_traits<InputIter>::difference_type
+count_loop__(InputIter first, InputIter last, const T &value) {
+  typename mstl::iterator_traits<InputIter>::difference_type ret = 0;
+  for (; first != last; ++first) {
+    if (*first == value) {
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+// memmove n elements from first to d_first, returns the end of the copy.
+template <typename In, typename Out>
+Out move_bytes__(In first, ptrdiff_t n, Out d_first) noexcept {
+  if (n > 0) {
+    memmove(static_cast<void *>(address__(d_first)),
+            static_cast<const void *>(address__(first)),
+            size_t(n) * sizeof(element__<Out>));
+  }
+  return d_first + n;
+}
+
+// memset n elements to value if its bytes allow, false if they don't.
+template <typename Iter, typename T>
+bool set_bytes__(Iter first, ptrdiff_t n, const T &value) noexcept {
+  using E = element__<Iter>;
+  E v = static_cast<E>(value);
+  int byte;
+  if constexpr (sizeof(E) == 1) {
+    unsigned char c;
+    memcpy(&c, &v, 1);
+    byte = c;
+  } else {
+    if (!memory_UTIL::is_zero_bytes__(v)) {
+      return false;
+    }
+    byte = 0;
+  }
+  if (n > 0) {
+    memset(static_cast<void *>(address__(first)), byte, size_t(n) * sizeof(E));
+  }
+  return true;
+}
+
+} // namespace mstl::algorithm_UTILL
+
+namespace mstl {
+// find the first occurence of the value;
+template <typename InputIter, typename T>
+constexpr InputIter find(InputIter first, InputIter last, const T &value) {
+  if constexpr (algorithm_UTILL::is_memchrable__<InputIter, T>::value) {
+    using E = typename mstl::remove_cv<
+        algorithm_UTILL::element__<InputIter>>::type;
+    // a value the element type can't hold never compares equal, one it
+    // can compares the same as v.
+    E v = static_cast<E>(value);
+    if (!algorithm_UTILL::same_value__(v, value)) {
+      return last;
+    }
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last - first;
+      if (n <= 0) {
+        return last;
+      }
+      const E *p = algorithm_UTILL::address__(first);
+      const void *hit = memchr(p, static_cast<unsigned char>(v), size_t(n));
+      return hit ? first + (static_cast<const E *>(hit) - p) : last;
+    }
+    return algorithm_UTILL::find_loop__(first, last, v);
+  } else if constexpr (simd_UTILL::is_searchable__<InputIter, T>::value) {
+    using E = typename simd_UTILL::contiguous_element__<InputIter>::type;
+    E v = static_cast<E>(value);
+    if (!algorithm_UTILL::same_value__(v, value)) {
+      return last;
+    }
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last - first;
+      if (n >= ptrdiff_t(simd_UTILL::min_size__)) {
+        const E *p = algorithm_UTILL::address__(first);
+        return first + ptrdiff_t(simd_UTILL::find__(p, size_t(n), v));
+      }
+    }
+    return algorithm_UTILL::find_loop__(first, last, v);
+  } else {
+    return algorithm_UTILL::find_loop__(first, last, value);
+  }
+}
+
+template <typename InputIter, typename UnaryPredicate>
 constexpr InputIter find_if(InputIter first, InputIter last,
                             UnaryPredicate pred) {
   for (; first != last; ++first) {
@@ -27,7 +207,7 @@ constexpr InputIter find_if(InputIter first, InputIter last,
   return last;
 }
 
-template <typename InputIter, typename T, typename UnaryPredicate>
+template <typename InputIter, typename UnaryPredicate>
 constexpr InputIter find_if_not(InputIter first, InputIter last,
                                 UnaryPredicate pred) {
   for (; first != last; ++first) {
@@ -74,14 +254,29 @@ namespace mstl {
 template <typename InputIter, typename T>
 constexpr typename mstl::iterator_traits<InputIter>::difference_type
 count(InputIter first, InputIter last, const T &value) {
-  typename mstl::iterator_traits<InputIter>::difference_type ret = 0;
-  for (; first != last; ++first) {
-    ++ret;
+  using difference_type =
+      typename mstl::iterator_traits<InputIter>::difference_type;
+  if constexpr (simd_UTILL::is_searchable__<InputIter, T>::value) {
+    // see find.
+    using E = typename simd_UTILL::contiguous_element__<InputIter>::type;
+    E v = static_cast<E>(value);
+    if (!algorithm_UTILL::same_value__(v, value)) {
+      return 0;
+    }
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last - first;
+      if (n >= ptrdiff_t(simd_UTILL::min_size__)) {
+        const E *p = algorithm_UTILL::address__(first);
+        return difference_type(simd_UTILL::count__(p, size_t(n), v));
+      }
+    }
+    return algorithm_UTILL::count_loop__(first, last, v);
+  } else {
+    return algorithm_UTILL::count_loop__(first, last, value);
   }
-  return ret;
 }
 
-template <typename InputIter, typename T, typename UnaryPredicate>
+template <typename InputIter, typename UnaryPredicate>
 constexpr typename mstl::iterator_traits<InputIter>::difference_type
 count_if(InputIter first, InputIter last, UnaryPredicate pred) {
   typename mstl::iterator_traits<InputIter>::difference_type ret = 0;
@@ -204,6 +399,11 @@ namespace mstl {
 // operator=  implies *first needs to be copyable.
 template <typename InputIt, typename OutputIt>
 constexpr OutputIt copy(InputIt first, InputIt last, OutputIt d_first) {
+  if constexpr (algorithm_UTILL::is_memmovable__<InputIt, OutputIt>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      return algorithm_UTILL::move_bytes__(first, last - first, d_first);
+    }
+  }
   while (first != last) {
     *d_first++ = *first++;
   }
@@ -223,6 +423,12 @@ constexpr OutputIt copy_if(InputIt first, InputIt last, OutputIt d_first,
 
 template <typename InputIt, typename Size, typename OutputIt>
 constexpr OutputIt copy_n(InputIt first, Size count, OutputIt d_first) {
+  if constexpr (algorithm_UTILL::is_memmovable__<InputIt, OutputIt>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      return algorithm_UTILL::move_bytes__(
+          first, count > 0 ? ptrdiff_t(count) : 0, d_first);
+    }
+  }
   if (count > 0) {
     for (Size n = 0; n < count; ++n) {
       *d_first++ = *first++;
@@ -234,18 +440,60 @@ constexpr OutputIt copy_n(InputIt first, Size count, OutputIt d_first) {
 // copy from the last to the first.
 template <typename BiIter1, typename BiIter2>
 constexpr BiIter2 copy_backward(BiIter1 first1, BiIter1 last1, BiIter2 last2) {
+  if constexpr (algorithm_UTILL::is_memmovable__<BiIter1, BiIter2>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last1 - first1;
+      algorithm_UTILL::move_bytes__(first1, n, last2 - n);
+      return last2 - n;
+    }
+  }
   while (first1 != last1) {
     *(--last2) = *(--last1);
   }
   return last2;
 }
 
+// same as copy, but the elements are moved out of the source range.
+template <typename InputIt, typename OutputIt>
+constexpr OutputIt move(InputIt first, InputIt last, OutputIt d_first) {
+  if constexpr (algorithm_UTILL::is_memmovable__<InputIt, OutputIt>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      return algorithm_UTILL::move_bytes__(first, last - first, d_first);
+    }
+  }
+  while (first != last) {
+    *d_first++ = mstl::move(*first++);
+  }
+  return d_first;
+}
+
+template <typename BiIter1, typename BiIter2>
+constexpr BiIter2 move_backward(BiIter1 first1, BiIter1 last1, BiIter2 last2) {
+  if constexpr (algorithm_UTILL::is_memmovable__<BiIter1, BiIter2>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last1 - first1;
+      algorithm_UTILL::move_bytes__(first1, n, last2 - n);
+      return last2 - n;
+    }
+  }
+  while (first1 != last1) {
+    *(--last2) = mstl::move(*(--last1));
+  }
+  return last2;
+}
+
 } // namespace mstl
 
 namespace mstl {
 
 template <typename ForwardIt, typename T>
 constexpr void fill(ForwardIt first, ForwardIt last, const T &value) {
+  if constexpr (algorithm_UTILL::is_memsettable__<ForwardIt, T>::value) {
+    if (!mstl::is_constant_evaluated() &&
+        algorithm_UTILL::set_bytes__(first, last - first, value)) {
+      return;
+    }
+  }
   for (; first != last; ++first) {
     *first = value;
   }
@@ -253,6 +501,13 @@ constexpr void fill(ForwardIt first, ForwardIt last, const T &value) {
 
 template <typename OutputIt, typename Size, typename T>
 constexpr OutputIt fill_n(OutputIt first, Size count, const T &value) {
+  if constexpr (algorithm_UTILL::is_memsettable__<OutputIt, T>::value) {
+    ptrdiff_t n = count > 0 ? ptrdiff_t(count) : 0;
+    if (!mstl::is_constant_evaluated() &&
+        algorithm_UTILL::set_bytes__(first, n, value)) {
+      return first + n;
+    }
+  }
   for (Size i = 0; i < count; ++i) {
     *first++ = value;
   }
@@ -285,4 +540,1144 @@ ForwardIt2 swap_ranges(ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2) {
   return first2;
 }
 
+// rotate [first, last) so middle becomes the first element. Returns where
+// first ends up. Swaps the front block into place one element at a time,
+// then rotates whatever is left of the back block.
+template <typename ForwardIt>
+ForwardIt rotate(ForwardIt first, ForwardIt middle, ForwardIt last) {
+  if (first == middle) {
+    return last;
+  }
+  if (middle == last) {
+    return first;
+  }
+  ForwardIt write = first;
+  ForwardIt next_read = first;
+  for (ForwardIt read = middle; read != last; ++write, ++read) {
+    if (write == next_read) {
+      next_read = read;
+    }
+    mstl::iter_swap(write, read);
+  }
+  mstl::rotate(write, next_read, last);
+  return write;
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+template <typename InputIt1, typename InputIt2>
+constexpr bool equal(InputIt1 first1, InputIt1 last1, InputIt2 first2) {
+  if constexpr (algorithm_UTILL::is_memcmpable__<InputIt1, InputIt2>::value) {
+    if (!mstl::is_constant_evaluated()) {
+      ptrdiff_t n = last1 - first1;
+      return n <= 0 ||
+             memcmp(algorithm_UTILL::address__(first1),
+                    algorithm_UTILL::address__(first2),
+                    size_t(n) * sizeof(*algorithm_UTILL::address__(first1))) ==
+                 0;
+    }
+  }
+  for (; first1 != last1; ++first1, ++first2) {
+    if (!(*first1 == *first2)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// dictionary order. A proper prefix is less than the whole sequence.
+template <typename InputIt1, typename InputIt2>
+constexpr bool lexicographical_compare(InputIt1 first1, InputIt1 last1,
+                                       InputIt2 first2, InputIt2 last2) {
+  for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+    if (*first1 < *first2) {
+      return true;
+    }
+    if (*first2 < *first1) {
+      return false;
+    }
+  }
+  return first1 == last1 && first2 != last2;
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+// Binary search over a sorted range. lower_bound is the first element not
+// less than value, upper_bound the first one greater than it.
+// The loop halves a length rather than moving two iterators, so a step is
+// one comparison and one conditional add.
+template <typename ForwardIt, typename T, typename Compare>
+constexpr ForwardIt lower_bound(ForwardIt first, ForwardIt last,
+                                const T &value, Compare comp) {
+  auto n = mstl::distance(first, last);
+  while (n > 0) {
+    auto half = n / 2;
+    ForwardIt mid = first;
+    mstl::advance(mid, half);
+    if (comp(*mid, value)) {
+      first = ++mid;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return first;
+}
+
+template <typename ForwardIt, typename T>
+constexpr ForwardIt lower_bound(ForwardIt first, ForwardIt last,
+                                const T &value) {
+  return mstl::lower_bound(first, last, value,
+                           [](const auto &a, const auto &b) { return a < b; });
+}
+
+template <typename ForwardIt, typename T, typename Compare>
+constexpr ForwardIt upper_bound(ForwardIt first, ForwardIt last,
+                                const T &value, Compare comp) {
+  auto n = mstl::distance(first, last);
+  while (n > 0) {
+    auto half = n / 2;
+    ForwardIt mid = first;
+    mstl::advance(mid, half);
+    if (!comp(value, *mid)) {
+      first = ++mid;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return first;
+}
+
+template <typename ForwardIt, typename T>
+constexpr ForwardIt upper_bound(ForwardIt first, ForwardIt last,
+                                const T &value) {
+  return mstl::upper_bound(first, last, value,
+                           [](const auto &a, const auto &b) { return a < b; });
+}
+
+template <typename ForwardIt, typename T, typename Compare>
+constexpr mstl::pair<ForwardIt, ForwardIt>
+equal_range(ForwardIt first, ForwardIt last, const T &value, Compare comp) {
+  return mstl::pair<ForwardIt, ForwardIt>(
+      mstl::lower_bound(first, last, value, comp),
+      mstl::upper_bound(first, last, value, comp));
+}
+
+template <typename ForwardIt, typename T>
+constexpr mstl::pair<ForwardIt, ForwardIt>
+equal_range(ForwardIt first, ForwardIt last, const T &value) {
+  return mstl::pair<ForwardIt, ForwardIt>(
+      mstl::lower_bound(first, last, value),
+      mstl::upper_bound(first, last, value));
+}
+
+template <typename ForwardIt, typename T, typename Compare>
+constexpr bool binary_search(ForwardIt first, ForwardIt last, const T &value,
+                             Compare comp) {
+  first = mstl::lower_bound(first, last, value, comp);
+  return first != last && !comp(value, *first);
+}
+
+template <typename ForwardIt, typename T>
+constexpr bool binary_search(ForwardIt first, ForwardIt last,
+                             const T &value) {
+  first = mstl::lower_bound(first, last, value);
+  return first != last && !(value < *first);
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+template <typename ForwardIt, typename Compare>
+constexpr ForwardIt is_sorted_until(ForwardIt first, ForwardIt last,
+                                    Compare comp) {
+  if (first == last) {
+    return last;
+  }
+  for (ForwardIt next = first; ++next != last; first = next) {
+    if (comp(*next, *first)) {
+      return next;
+    }
+  }
+  return last;
+}
+
+template <typename ForwardIt>
+constexpr ForwardIt is_sorted_until(ForwardIt first, ForwardIt last) {
+  return mstl::is_sorted_until(first, last, mstl::less<>());
+}
+
+template <typename ForwardIt, typename Compare>
+constexpr bool is_sorted(ForwardIt first, ForwardIt last, Compare comp) {
+  return mstl::is_sorted_until(first, last, comp) == last;
+}
+
+template <typename ForwardIt>
+constexpr bool is_sorted(ForwardIt first, ForwardIt last) {
+  return mstl::is_sorted_until(first, last) == last;
+}
+
+} // namespace mstl
+
+// Sorting.
+//
+// sort is pattern-defeating quicksort (Peters, "Pattern-defeating
+// Quicksort", 2021):
+//   - median of 3 pivots, or ninther (median of 3 medians) above 128;
+//   - insertion sort below 24 elements;
+//   - a partition that finds nothing to swap tries a short insertion sort
+//     on both sides, which finishes sorted and nearly sorted input in O(n);
+//   - many equal elements are split off with a partition to the left that
+//     never recurses into them again;
+//   - a bad split shuffles a few elements to break the pattern, and after
+//     log n bad splits it falls back to heapsort, so O(n log n) always.
+//
+// With a cheap comparison (arithmetic keys under less) the partition is
+// the block partition of Edelkamp and Weiss: it compares a block of 64
+// elements at a time and only writes down the offsets of the ones on the
+// wrong side, with no branch depending on the comparison. On random keys
+// a branchy partition mispredicts about half the time, and a
+// misprediction costs more than the comparison does.
+//
+// stable_sort is a top down merge sort with insertion sorted leaves. It
+// skips merges of runs that are already in order, rotates runs that are
+// in reverse order, and merges through a buffer of n / 2 elements. With
+// a smaller buffer (or none) the merges split the runs and rotate,
+// O(n log^2 n) instead of O(n log n), and no allocation at all. The buffer
+// comes from an allocator (an arena, say) or from the caller.
+namespace mstl::algorithm_UTILL {
+
+constexpr ptrdiff_t insertion_sort_threshold__ = 24;
+constexpr ptrdiff_t ninther_threshold__ = 128;
+constexpr ptrdiff_t partial_insertion_sort_limit__ = 8;
+constexpr ptrdiff_t stable_leaf__ = 32;
+constexpr size_t block_size__ = 64;
+constexpr size_t cache_line__ = 64;
+
+template <typename Iter>
+using iter_value_t__ = typename mstl::iterator_traits<Iter>::value_type;
+
+// comparisons that are a single instruction, worth the block partition.
+template <typename T, typename Compare>
+struct is_cheap_compare__
+    : mstl::integral_constant<
+          bool, (mstl::is_arithmetic<T>::value ||
+                 mstl::is_pointer<T>::value) &&
+                    (mstl::is_same<Compare, mstl::less<>>::value ||
+                     mstl::is_same<Compare, mstl::less<T>>::value)> {};
+
+inline int log2__(ptrdiff_t n) noexcept {
+  int r = 0;
+  while (n >>= 1) {
+    ++r;
+  }
+  return r;
+}
+
+template <typename Iter, typename Compare>
+void sort2__(Iter a, Iter b, Compare &comp) {
+  if (comp(*b, *a)) {
+    mstl::iter_swap(a, b);
+  }
+}
+
+template <typename Iter, typename Compare>
+void sort3__(Iter a, Iter b, Iter c, Compare &comp) {
+  sort2__(a, b, comp);
+  sort2__(b, c, comp);
+  sort2__(a, b, comp);
+}
+
+// Stable. With Guarded false it relies on an element before first that is
+// not greater than anything in the range, and skips the bounds check.
+template <bool Guarded, typename Iter, typename Compare>
+void insertion_sort__(Iter first, Iter last, Compare &comp) {
+  if (first == last) {
+    return;
+  }
+  for (Iter cur = first + 1; cur != last; ++cur) {
+    Iter sift = cur;
+    Iter prev = cur - 1;
+    if (comp(*sift, *prev)) {
+      iter_value_t__<Iter> tmp = mstl::move(*sift);
+      do {
+        *sift-- = mstl::move(*prev);
+      } while ((!Guarded || sift != first) && comp(tmp, *--prev));
+      *sift = mstl::move(tmp);
+    }
+  }
+}
+
+// insertion sort that gives up after moving a few elements, true if it
+// got to the end.
+template <typename Iter, typename Compare>
+bool partial_insertion_sort__(Iter first, Iter last, Compare &comp) {
+  if (first == last) {
+    return true;
+  }
+  ptrdiff_t moved = 0;
+  for (Iter cur = first + 1; cur != last; ++cur) {
+    Iter sift = cur;
+    Iter prev = cur - 1;
+    if (comp(*sift, *prev)) {
+      iter_value_t__<Iter> tmp = mstl::move(*sift);
+      do {
+        *sift-- = mstl::move(*prev);
+      } while (sift != first && comp(tmp, *--prev));
+      *sift = mstl::move(tmp);
+      moved += cur - sift;
+      if (moved > partial_insertion_sort_limit__) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*
+ * heapsort, the fallback of sort and the core of partial_sort
+ */
+template <typename Iter, typename T, typename Compare>
+void sift_down__(Iter first, ptrdiff_t hole, ptrdiff_t len, T &&value,
+                 Compare &comp) {
+  for (ptrdiff_t child; (child = 2 * hole + 1) < len; hole = child) {
+    if (child + 1 < len && comp(first[child], first[child + 1])) {
+      ++child;
+    }
+    if (!comp(value, first[child])) {
+      break;
+    }
+    first[hole] = mstl::move(first[child]);
+  }
+  first[hole] = mstl::move(value);
+}
+
+template <typename Iter, typename Compare>
+void make_heap__(Iter first, Iter last, Compare &comp) {
+  ptrdiff_t len = last - first;
+  for (ptrdiff_t i = len / 2; i-- > 0;) {
+    iter_value_t__<Iter> v = mstl::move(first[i]);
+    sift_down__(first, i, len, mstl::move(v), comp);
+  }
+}
+
+template <typename Iter, typename Compare>
+void sort_heap__(Iter first, Iter last, Compare &comp) {
+  for (ptrdiff_t len = last - first; len > 1; --len) {
+    iter_value_t__<Iter> v = mstl::move(first[len - 1]);
+    first[len - 1] = mstl::move(first[0]);
+    sift_down__(first, 0, len - 1, mstl::move(v), comp);
+  }
+}
+
+/*
+ * partitions, the pivot is *first
+ */
+
+// Elements equal to the pivot go left. Only called when the element
+// before the range equals the pivot, then everything equal to it is in
+// its final place and the left side needs no more sorting.
+template <typename Iter, typename Compare>
+Iter partition_left__(Iter begin, Iter end, Compare &comp) {
+  iter_value_t__<Iter> pivot = mstl::move(*begin);
+  Iter first = begin;
+  Iter last = end;
+  while (comp(pivot, *--last)) {
+  }
+  if (last + 1 == end) {
+    while (first < last && !comp(pivot, *++first)) {
+    }
+  } else {
+    while (!comp(pivot, *++first)) {
+    }
+  }
+  while (first < last) {
+    mstl::iter_swap(first, last);
+    while (comp(pivot, *--last)) {
+    }
+    while (!comp(pivot, *++first)) {
+    }
+  }
+  *begin = mstl::move(*last);
+  *last = mstl::move(pivot);
+  return last;
+}
+
+// Elements equal to the pivot go right. Returns where the pivot ended up,
+// and whether nothing had to be swapped.
+template <typename Iter, typename Compare>
+mstl::pair<Iter, bool> partition_right__(Iter begin, Iter end, Compare &comp) {
+  iter_value_t__<Iter> pivot = mstl::move(*begin);
+  Iter first = begin;
+  Iter last = end;
+  // the median of 3 put something not less than the pivot at the end, so
+  // the first scan needs no bounds check.
+  while (comp(*++first, pivot)) {
+  }
+  if (first - 1 == begin) {
+    while (first < last && !comp(*--last, pivot)) {
+    }
+  } else {
+    while (!comp(*--last, pivot)) {
+    }
+  }
+  bool already_partitioned = first >= last;
+  while (first < last) {
+    mstl::iter_swap(first, last);
+    while (comp(*++first, pivot)) {
+    }
+    while (!comp(*--last, pivot)) {
+    }
+  }
+  Iter pivot_pos = first - 1;
+  *begin = mstl::move(*pivot_pos);
+  *pivot_pos = mstl::move(pivot);
+  return {pivot_pos, already_partitioned};
+}
+
+// Swap the elements at offsets_l from first with those at offsets_r back
+// from last. With use_swaps false it moves them around in one cycle, one
+// move per element instead of three.
+template <typename Iter>
+void swap_offsets__(Iter first, Iter last, const unsigned char *offsets_l,
+                    const unsigned char *offsets_r, size_t num,
+                    bool use_swaps) {
+  if (use_swaps) {
+    // keeps descending input O(n), the cycle would rotate it instead.
+    for (size_t i = 0; i < num; ++i) {
+      mstl::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+    }
+  } else if (num > 0) {
+    Iter l = first + offsets_l[0];
+    Iter r = last - offsets_r[0];
+    iter_value_t__<Iter> tmp = mstl::move(*l);
+    *l = mstl::move(*r);
+    for (size_t i = 1; i < num; ++i) {
+      l = first + offsets_l[i];
+      *r = mstl::move(*l);
+      r = last - offsets_r[i];
+      *l = mstl::move(*r);
+    }
+    *r = mstl::move(tmp);
+  }
+}
+
+// partition_right__ with the block partition.
+template <typename Iter, typename Compare>
+mstl::pair<Iter, bool> partition_right_branchless__(Iter begin, Iter end,
+                                                    Compare &comp) {
+  iter_value_t__<Iter> pivot = mstl::move(*begin);
+  Iter first = begin;
+  Iter last = end;
+  while (comp(*++first, pivot)) {
+  }
+  if (first - 1 == begin) {
+    while (first < last && !comp(*--last, pivot)) {
+    }
+  } else {
+    while (!comp(*--last, pivot)) {
+    }
+  }
+  bool already_partitioned = first >= last;
+  if (!already_partitioned) {
+    mstl::iter_swap(first, last);
+    ++first;
+
+    // offsets of the elements on the wrong side, one block per side.
+    alignas(cache_line__) unsigned char offsets_l[block_size__];
+    alignas(cache_line__) unsigned char offsets_r[block_size__];
+    Iter offsets_l_base = first;
+    Iter offsets_r_base = last;
+    size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+    while (first < last) {
+      // refill whichever block is empty, from what's left in between.
+      size_t num_unknown = size_t(last - first);
+      size_t left_split =
+          num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+      size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+      // the offset is always written, the count only moves if the element
+      // is on the wrong side.
+      if (left_split >= block_size__) {
+        for (size_t i = 0; i < block_size__;) {
+          for (int k = 0; k < 8; ++k) {
+            offsets_l[num_l] = static_cast<unsigned char>(i++);
+            num_l += !comp(*first, pivot);
+            ++first;
+          }
+        }
+      } else {
+        for (size_t i = 0; i < left_split;) {
+          offsets_l[num_l] = static_cast<unsigned char>(i++);
+          num_l += !comp(*first, pivot);
+          ++first;
+        }
+      }
+
+      if (right_split >= block_size__) {
+        for (size_t i = 0; i < block_size__;) {
+          for (int k = 0; k < 8; ++k) {
+            offsets_r[num_r] = static_cast<unsigned char>(++i);
+            num_r += comp(*--last, pivot);
+          }
+        }
+      } else {
+        for (size_t i = 0; i < right_split;) {
+          offsets_r[num_r] = static_cast<unsigned char>(++i);
+          num_r += comp(*--last, pivot);
+        }
+      }
+
+      size_t num = num_l < num_r ? num_l : num_r;
+      swap_offsets__(offsets_l_base, offsets_r_base, offsets_l + start_l,
+                     offsets_r + start_r, num, num_l == num_r);
+      num_l -= num;
+      num_r -= num;
+      start_l += num;
+      start_r += num;
+      if (num_l == 0) {
+        start_l = 0;
+        offsets_l_base = first;
+      }
+      if (num_r == 0) {
+        start_r = 0;
+        offsets_r_base = last;
+      }
+    }
+
+    // one block still has leftovers, they all go to the far end.
+    if (num_l != 0) {
+      while (num_l--) {
+        mstl::iter_swap(offsets_l_base + offsets_l[start_l + num_l], --last);
+      }
+      first = last;
+    }
+    if (num_r != 0) {
+      while (num_r--) {
+        mstl::iter_swap(offsets_r_base - offsets_r[start_r + num_r], first);
+        ++first;
+      }
+      last = first;
+    }
+  }
+  Iter pivot_pos = first - 1;
+  *begin = mstl::move(*pivot_pos);
+  *pivot_pos = mstl::move(pivot);
+  return {pivot_pos, already_partitioned};
+}
+
+template <bool Branchless, typename Iter, typename Compare>
+void pdqsort__(Iter begin, Iter end, Compare &comp, int bad_allowed,
+               bool leftmost) {
+  for (;;) {
+    ptrdiff_t size = end - begin;
+    if (size < insertion_sort_threshold__) {
+      if (leftmost) {
+        insertion_sort__<true>(begin, end, comp);
+      } else {
+        insertion_sort__<false>(begin, end, comp);
+      }
+      return;
+    }
+
+    // pivot to *begin.
+    ptrdiff_t s2 = size / 2;
+    if (size > ninther_threshold__) {
+      sort3__(begin, begin + s2, end - 1, comp);
+      sort3__(begin + 1, begin + (s2 - 1), end - 2, comp);
+      sort3__(begin + 2, begin + (s2 + 1), end - 3, comp);
+      sort3__(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+      mstl::iter_swap(begin, begin + s2);
+    } else {
+      sort3__(begin + s2, begin, end - 1, comp);
+    }
+
+    // the element before us is the pivot of a partition above, and not
+    // less than our pivot: it's equal, and so is everything that would go
+    // left.
+    if (!leftmost && !comp(*(begin - 1), *begin)) {
+      begin = partition_left__(begin, end, comp) + 1;
+      continue;
+    }
+
+    mstl::pair<Iter, bool> part =
+        Branchless ? partition_right_branchless__(begin, end, comp)
+                   : partition_right__(begin, end, comp);
+    Iter pivot_pos = part.first;
+
+    ptrdiff_t l_size = pivot_pos - begin;
+    ptrdiff_t r_size = end - (pivot_pos + 1);
+    bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+    if (highly_unbalanced) {
+      if (--bad_allowed == 0) {
+        make_heap__(begin, end, comp);
+        sort_heap__(begin, end, comp);
+        return;
+      }
+      // swap a few elements around to break up whatever pattern did this.
+      if (l_size >= insertion_sort_threshold__) {
+        mstl::iter_swap(begin, begin + l_size / 4);
+        mstl::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+        if (l_size > ninther_threshold__) {
+          mstl::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+          mstl::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+          mstl::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+          mstl::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+        }
+      }
+      if (r_size >= insertion_sort_threshold__) {
+        mstl::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+        mstl::iter_swap(end - 1, end - r_size / 4);
+        if (r_size > ninther_threshold__) {
+          mstl::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+          mstl::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+          mstl::iter_swap(end - 2, end - (1 + r_size / 4));
+          mstl::iter_swap(end - 3, end - (2 + r_size / 4));
+        }
+      }
+    } else if (part.second &&
+               partial_insertion_sort__(begin, pivot_pos, comp) &&
+               partial_insertion_sort__(pivot_pos + 1, end, comp)) {
+      // nothing was out of place, and both sides were almost sorted.
+      return;
+    }
+
+    // recurse into the left side, loop on the right.
+    pdqsort__<Branchless>(begin, pivot_pos, comp, bad_allowed, leftmost);
+    begin = pivot_pos + 1;
+    leftmost = false;
+  }
+}
+
+/*
+ * stable merge sort
+ */
+
+// Merge the sorted runs [first, mid) and [mid, last). buf holds buf_len
+// live objects to move elements through.
+template <typename Iter, typename T, typename Compare>
+void merge_adaptive__(Iter first, Iter mid, Iter last, ptrdiff_t len1,
+                      ptrdiff_t len2, T *buf, ptrdiff_t buf_len,
+                      Compare &comp) {
+  if (len1 == 0 || len2 == 0) {
+    return;
+  }
+  if (len1 + len2 == 2) {
+    if (comp(*mid, *first)) {
+      mstl::iter_swap(first, mid);
+    }
+    return;
+  }
+  if (len1 <= len2 && len1 <= buf_len) {
+    // left run out, merge forward.
+    T *a = buf;
+    T *a_end = mstl::move(first, mid, buf);
+    Iter b = mid;
+    Iter out = first;
+    while (a != a_end && b != last) {
+      if (comp(*b, *a)) {
+        *out++ = mstl::move(*b++);
+      } else {
+        *out++ = mstl::move(*a++);
+      }
+    }
+    mstl::move(a, a_end, out);
+  } else if (len2 <= buf_len) {
+    // right run out, merge backward.
+    T *b_end = mstl::move(mid, last, buf);
+    Iter a = mid;
+    Iter out = last;
+    while (a != first && b_end != buf) {
+      if (comp(*(b_end - 1), *(a - 1))) {
+        *--out = mstl::move(*--a);
+      } else {
+        *--out = mstl::move(*--b_end);
+      }
+    }
+    mstl::move_backward(buf, b_end, out);
+  } else {
+    // No room. Cut the longer run in half, find where its middle element
+    // goes in the other run, and rotate the two middle pieces past each
+    // other. That leaves two smaller merges.
+    Iter cut1, cut2;
+    ptrdiff_t len11, len22;
+    if (len1 > len2) {
+      len11 = len1 / 2;
+      cut1 = first + len11;
+      cut2 = mstl::lower_bound(mid, last, *cut1, comp);
+      len22 = cut2 - mid;
+    } else {
+      len22 = len2 / 2;
+      cut2 = mid + len22;
+      cut1 = mstl::upper_bound(first, mid, *cut2, comp);
+      len11 = cut1 - first;
+    }
+    Iter new_mid = mstl::rotate(cut1, mid, cut2);
+    merge_adaptive__(first, cut1, new_mid, len11, len22, buf, buf_len, comp);
+    merge_adaptive__(new_mid, cut2, last, len1 - len11, len2 - len22, buf,
+                     buf_len, comp);
+  }
+}
+
+template <typename Iter, typename T, typename Compare>
+void merge_sort__(Iter first, Iter last, T *buf, ptrdiff_t buf_len,
+                  Compare &comp) {
+  ptrdiff_t len = last - first;
+  if (len <= stable_leaf__) {
+    insertion_sort__<true>(first, last, comp);
+    return;
+  }
+  Iter mid = first + len / 2;
+  merge_sort__(first, mid, buf, buf_len, comp);
+  merge_sort__(mid, last, buf, buf_len, comp);
+  if (!comp(*mid, *(mid - 1))) {
+    return; // already in order.
+  }
+  if (comp(*(last - 1), *first)) {
+    // everything on the right goes before everything on the left.
+    mstl::rotate(first, mid, last);
+    return;
+  }
+  merge_adaptive__(first, mid, last, len / 2, len - len / 2, buf, buf_len,
+                   comp);
+}
+
+// Scratch space for stable_sort, as many elements as the allocator gives
+// up to the size asked for, maybe none.
+//
+// The objects in it must be alive to be assigned to. They are built by
+// moving *seed down the buffer and back at the end, so T only needs to be
+// move constructible. Trivial types are left alone.
+template <typename T, typename Alloc> class temporary_buffer__ {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+  static constexpr bool trivial__ =
+      mstl::is_trivially_copyable<T>::value &&
+      mstl::is_trivially_default_constructible<T>::value;
+
+  Alloc alloc_;
+  T *data_ = nullptr;
+  ptrdiff_t size_ = 0;
+  ptrdiff_t capacity_ = 0;
+
+public:
+  template <typename Iter>
+  temporary_buffer__(Iter seed, ptrdiff_t want, const Alloc &a) : alloc_(a) {
+    // an allocation failure only costs speed, try smaller.
+    while (want > 0 && data_ == nullptr) {
+      try {
+        data_ = alloc_traits__::allocate(alloc_, size_t(want));
+      } catch (...) {
+        want /= 2;
+      }
+    }
+    if (data_ == nullptr) {
+      return;
+    }
+    capacity_ = want;
+    if constexpr (trivial__) {
+      size_ = want;
+    } else {
+      mstl::construct_at(data_, mstl::move(*seed));
+      size_ = 1;
+      try {
+        for (; size_ < want; ++size_) {
+          mstl::construct_at(data_ + size_, mstl::move(data_[size_ - 1]));
+        }
+      } catch (...) {
+        *seed = mstl::move(data_[size_ - 1]);
+        release__();
+        throw;
+      }
+      *seed = mstl::move(data_[size_ - 1]);
+    }
+  }
+
+  temporary_buffer__(const temporary_buffer__ &) = delete;
+  temporary_buffer__ &operator=(const temporary_buffer__ &) = delete;
+
+  ~temporary_buffer__() { release__(); }
+
+  T *data() const noexcept { return data_; }
+  ptrdiff_t size() const noexcept { return size_; }
+
+private:
+  void release__() noexcept {
+    if (data_ != nullptr) {
+      if constexpr (!trivial__) {
+        mstl::destroy(data_, data_ + size_);
+      }
+      alloc_traits__::deallocate(alloc_, data_, size_t(capacity_));
+      data_ = nullptr;
+    }
+  }
+};
+
+template <typename Alloc, typename = void>
+struct is_allocator__ : mstl::false_type {};
+template <typename Alloc>
+struct is_allocator__<Alloc, mstl::void_t<decltype(mstl::declval<Alloc &>()
+                                                       .allocate(size_t()))>>
+    : mstl::true_type {};
+
+} // namespace mstl::algorithm_UTILL
+
+namespace mstl {
+
+// Sort [first, last), not stable. O(n log n) worst case, O(n) on input
+// that's already sorted, reversed, or all one value.
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare comp) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  constexpr bool branchless =
+      algorithm_UTILL::is_cheap_compare__<T, Compare>::value;
+  if (last - first > 1) {
+    algorithm_UTILL::pdqsort__<branchless>(
+        first, last, comp, algorithm_UTILL::log2__(last - first), true);
+  }
+}
+
+template <typename RandomIt> void sort(RandomIt first, RandomIt last) {
+  mstl::sort(first, last, mstl::less<>());
+}
+
+// Sort so that [first, middle) holds the smallest elements in order, the
+// rest are left in no particular order. O(n log m), m = middle - first.
+template <typename RandomIt, typename Compare>
+void partial_sort(RandomIt first, RandomIt middle, RandomIt last,
+                  Compare comp) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  if (first == middle) {
+    return;
+  }
+  algorithm_UTILL::make_heap__(first, middle, comp);
+  ptrdiff_t len = middle - first;
+  for (RandomIt i = middle; i != last; ++i) {
+    if (comp(*i, *first)) {
+      T v = mstl::move(*i);
+      *i = mstl::move(*first);
+      algorithm_UTILL::sift_down__(first, 0, len, mstl::move(v), comp);
+    }
+  }
+  algorithm_UTILL::sort_heap__(first, middle, comp);
+}
+
+template <typename RandomIt>
+void partial_sort(RandomIt first, RandomIt middle, RandomIt last) {
+  mstl::partial_sort(first, middle, last, mstl::less<>());
+}
+
+// Stable sort, equal elements keep their order. The scratch buffer is n / 2
+// elements from alloc, which is where an arena allocator pays off for a
+// pipeline sorting batch after batch.
+template <typename RandomIt, typename Compare, typename Alloc,
+          typename = mstl::enable_if_t<
+              algorithm_UTILL::is_allocator__<Alloc>::value>>
+void stable_sort(RandomIt first, RandomIt last, Compare comp,
+                 const Alloc &alloc) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  using buffer_alloc = typename mstl::allocator_traits<
+      Alloc>::template rebind_alloc<T>;
+  ptrdiff_t len = last - first;
+  if (len <= algorithm_UTILL::stable_leaf__) {
+    algorithm_UTILL::insertion_sort__<true>(first, last, comp);
+    return;
+  }
+  algorithm_UTILL::temporary_buffer__<T, buffer_alloc> buf(
+      first, (len + 1) / 2, buffer_alloc(alloc));
+  algorithm_UTILL::merge_sort__(first, last, buf.data(), buf.size(), comp);
+}
+
+// Stable sort through the caller's buffer, any size, no allocation. The
+// elements of buffer are assigned to and left moved from. n / 2 elements
+// is enough for the O(n log n) bound.
+template <typename RandomIt, typename Compare>
+void stable_sort(
+    RandomIt first, RandomIt last, Compare comp,
+    mstl::span<typename mstl::iterator_traits<RandomIt>::value_type> buffer) {
+  algorithm_UTILL::merge_sort__(first, last, buffer.data(),
+                                ptrdiff_t(buffer.size()), comp);
+}
+
+template <typename RandomIt, typename Compare>
+void stable_sort(RandomIt first, RandomIt last, Compare comp) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  mstl::stable_sort(first, last, comp, mstl::allocator<T>());
+}
+
+template <typename RandomIt> void stable_sort(RandomIt first, RandomIt last) {
+  mstl::stable_sort(first, last, mstl::less<>());
+}
+
+} // namespace mstl
+
+// Radix sort.
+//
+// radix_sort(first, last, key) sorts by key(element), stably, without
+// comparing keys. A numeric key is mapped to an unsigned integer with the
+// same order (signed: flip the sign bit; float and double: flip every bit
+// of a negative, just the sign bit of a positive), then sorted LSD first,
+// one digit per pass through a buffer of n elements:
+//   8 bit keys:      one  8 bit pass
+//   16 bit keys:     two  8 bit passes, or one 16 bit pass for n >= 2^16
+//   32 and 64 bit:   11 bit passes, 3 and 6 of them
+// 11 bits keep a histogram at 2048 counters, 16KB, in L1. All histograms
+// are counted in one read of the keys up front, and a pass whose digit is
+// the same for every key is skipped, so keys that only use their low
+// bytes (timestamps from one day, small ids) cost fewer passes.
+//
+// A key with data() and size(), like a string, is sorted MSD first: one
+// byte per level, into 256 buckets plus one for keys that ended, then each
+// bucket on its own. Small buckets finish with an insertion sort.
+//
+// note: with float keys -0.0 sorts before 0.0, and NaNs go to the ends by
+// their sign. Without room for the buffer it falls back to stable_sort.
+namespace mstl::algorithm_UTILL {
+
+constexpr ptrdiff_t radix_small__ = 256;
+constexpr ptrdiff_t msd_small__ = 32;
+
+template <size_t N> struct uint_of_size__;
+template <> struct uint_of_size__<1> { using type = uint8_t; };
+template <> struct uint_of_size__<2> { using type = uint16_t; };
+template <> struct uint_of_size__<4> { using type = uint32_t; };
+template <> struct uint_of_size__<8> { using type = uint64_t; };
+
+// an unsigned integer that orders the same as k.
+template <typename K> auto radix_bits__(K k) noexcept {
+  if constexpr (mstl::is_same<K, bool>::value) {
+    return uint8_t(k);
+  } else if constexpr (mstl::is_enum<K>::value) {
+    return radix_bits__(
+        static_cast<typename mstl::underlying_type<K>::type>(k));
+  } else if constexpr (mstl::is_floating_point<K>::value) {
+    static_assert(sizeof(K) == 4 || sizeof(K) == 8,
+                  "radix_sort handles float and double keys");
+    using U = typename uint_of_size__<sizeof(K)>::type;
+    constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+    U u;
+    memcpy(&u, &k, sizeof(U));
+    return (u & sign) ? U(~u) : U(u | sign);
+  } else {
+    static_assert(mstl::is_integral<K>::value,
+                  "radix_sort needs an integer, enum, float or string key");
+    using U = typename mstl::make_unsigned<K>::type;
+    if constexpr (mstl::is_signed<K>::value) {
+      return U(U(k) ^ (U(1) << (sizeof(U) * 8 - 1)));
+    } else {
+      return U(k);
+    }
+  }
+}
+
+template <typename K, typename = void>
+struct is_string_key__ : mstl::false_type {};
+template <typename K>
+struct is_string_key__<K, mstl::void_t<decltype(mstl::declval<K &>().data()),
+                                       decltype(mstl::declval<K &>().size())>>
+    : mstl::integral_constant<
+          bool, sizeof(*mstl::declval<K &>().data()) == 1> {};
+
+// zeroed counters, on the heap: 6 histograms of 2048 are too much stack.
+class counters__ {
+  size_t *data_;
+  size_t size_;
+
+public:
+  explicit counters__(size_t n)
+      : data_(mstl::allocator<size_t>().allocate(n)), size_(n) {
+    memset(data_, 0, n * sizeof(size_t));
+  }
+  counters__(const counters__ &) = delete;
+  counters__ &operator=(const counters__ &) = delete;
+  ~counters__() { mstl::allocator<size_t>().deallocate(data_, size_); }
+
+  size_t *data() const noexcept { return data_; }
+};
+
+// move [first, last) to out, each element to the next slot of its digit.
+template <unsigned Digit, typename Src, typename Dst, typename Key>
+void scatter__(Src first, Src last, Dst out, size_t *offsets, unsigned shift,
+               Key &key) {
+  constexpr size_t mask = (size_t(1) << Digit) - 1;
+  for (; first != last; ++first) {
+    size_t d = size_t(radix_bits__(key(*first)) >> shift) & mask;
+    out[ptrdiff_t(offsets[d]++)] = mstl::move(*first);
+  }
+}
+
+template <unsigned Digit, typename Iter, typename T, typename Key>
+void lsd_sort__(Iter first, Iter last, T *buf, Key &key) {
+  using U = decltype(radix_bits__(key(*first)));
+  constexpr unsigned bits = sizeof(U) * 8;
+  constexpr unsigned passes = (bits + Digit - 1) / Digit;
+  constexpr size_t buckets = size_t(1) << Digit;
+  constexpr size_t mask = buckets - 1;
+  size_t n = size_t(last - first);
+
+  counters__ counts(passes * buckets);
+  size_t *c = counts.data();
+  for (Iter it = first; it != last; ++it) {
+    U k = radix_bits__(key(*it));
+    for (unsigned p = 0; p < passes; ++p) {
+      ++c[p * buckets + (size_t(k >> (p * Digit)) & mask)];
+    }
+  }
+
+  bool in_buf = false;
+  U k0 = radix_bits__(key(*first));
+  for (unsigned p = 0; p < passes; ++p) {
+    unsigned shift = p * Digit;
+    size_t *offsets = c + p * buckets;
+    if (offsets[size_t(k0 >> shift) & mask] == n) {
+      continue; // every key has the same digit here.
+    }
+    size_t sum = 0;
+    for (size_t b = 0; b < buckets; ++b) {
+      size_t count = offsets[b];
+      offsets[b] = sum;
+      sum += count;
+    }
+    if (in_buf) {
+      scatter__<Digit>(buf, buf + n, first, offsets, shift, key);
+    } else {
+      scatter__<Digit>(first, last, buf, offsets, shift, key);
+    }
+    in_buf = !in_buf;
+  }
+  if (in_buf) {
+    mstl::move(buf, buf + n, first);
+  }
+}
+
+// byte depth of a string key, 0 once it has ended.
+template <typename K> size_t key_byte__(const K &k, size_t depth) noexcept {
+  if (depth >= size_t(k.size())) {
+    return 0;
+  }
+  return 1 + size_t(static_cast<unsigned char>(k.data()[depth]));
+}
+
+// compare two keys that share their first depth bytes.
+template <typename K1, typename K2>
+bool key_less__(const K1 &a, const K2 &b, size_t depth) noexcept {
+  size_t la = size_t(a.size()), lb = size_t(b.size());
+  size_t len = (la < lb ? la : lb) - depth;
+  if (len != 0) {
+    int c = memcmp(a.data() + depth, b.data() + depth, len);
+    if (c != 0) {
+      return c < 0;
+    }
+  }
+  return la < lb;
+}
+
+template <typename Iter, typename T, typename Key>
+void msd_sort__(Iter first, Iter last, T *buf, size_t depth, Key &key) {
+  for (;;) {
+    ptrdiff_t n = last - first;
+    if (n < msd_small__) {
+      auto less = [&](const T &a, const T &b) {
+        return key_less__(key(a), key(b), depth);
+      };
+      insertion_sort__<true>(first, last, less);
+      return;
+    }
+    size_t counts[257] = {};
+    for (Iter it = first; it != last; ++it) {
+      ++counts[key_byte__(key(*it), depth)];
+    }
+    size_t b0 = key_byte__(key(*first), depth);
+    if (counts[b0] == size_t(n)) {
+      if (b0 == 0) {
+        return; // all keys ended, they're equal.
+      }
+      ++depth; // a common prefix, nothing to move.
+      continue;
+    }
+    size_t offsets[257];
+    size_t sum = 0;
+    for (size_t b = 0; b < 257; ++b) {
+      offsets[b] = sum;
+      sum += counts[b];
+    }
+    for (Iter it = first; it != last; ++it) {
+      buf[offsets[key_byte__(key(*it), depth)]++] = mstl::move(*it);
+    }
+    mstl::move(buf, buf + n, first);
+    // offsets[b] is the end of bucket b now, bucket 0 is done.
+    for (size_t b = 1; b < 257; ++b) {
+      if (counts[b] > 1) {
+        Iter end = first + ptrdiff_t(offsets[b]);
+        msd_sort__(end - ptrdiff_t(counts[b]), end, buf, depth + 1, key);
+      }
+    }
+    return;
+  }
+}
+
+} // namespace mstl::algorithm_UTILL
+
+namespace mstl {
+
+template <typename RandomIt, typename KeyFn>
+void radix_sort(RandomIt first, RandomIt last, KeyFn key) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  using K = typename mstl::remove_cvref<decltype(key(*first))>::type;
+  ptrdiff_t n = last - first;
+  if (n < 2) {
+    return;
+  }
+
+  if constexpr (algorithm_UTILL::is_string_key__<K>::value) {
+    algorithm_UTILL::temporary_buffer__<T, mstl::allocator<T>> buf(
+        first, n, mstl::allocator<T>());
+    if (buf.size() < n) {
+      mstl::stable_sort(first, last, [&](const T &a, const T &b) {
+        return algorithm_UTILL::key_less__(key(a), key(b), 0);
+      });
+      return;
+    }
+    algorithm_UTILL::msd_sort__(first, last, buf.data(), 0, key);
+  } else {
+    auto less = [&](const T &a, const T &b) {
+      return algorithm_UTILL::radix_bits__(key(a)) <
+             algorithm_UTILL::radix_bits__(key(b));
+    };
+    if (n < algorithm_UTILL::radix_small__) {
+      mstl::stable_sort(first, last, less);
+      return;
+    }
+    algorithm_UTILL::temporary_buffer__<T, mstl::allocator<T>> buf(
+        first, n, mstl::allocator<T>());
+    if (buf.size() < n) {
+      mstl::stable_sort(first, last, less);
+      return;
+    }
+    constexpr size_t key_size = sizeof(algorithm_UTILL::radix_bits__(K()));
+    if constexpr (key_size <= 2) {
+      if (key_size == 2 && n >= ptrdiff_t(1) << 16) {
+        algorithm_UTILL::lsd_sort__<16>(first, last, buf.data(), key);
+      } else {
+        algorithm_UTILL::lsd_sort__<8>(first, last, buf.data(), key);
+      }
+    } else {
+      algorithm_UTILL::lsd_sort__<11>(first, last, buf.data(), key);
+    }
+  }
+}
+
+// elements that are their own key: integers, enums, floats, strings.
+template <typename RandomIt> void radix_sort(RandomIt first, RandomIt last) {
+  using T = typename mstl::iterator_traits<RandomIt>::value_type;
+  mstl::radix_sort(first, last, [](const T &v) -> const T & { return v; });
+}
+
 } // namespace mstl
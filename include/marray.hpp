@@ -36,7 +36,7 @@ template <typename T, size_t N> struct array {
                     "cannot fill zero sized array of const T");
     } else {
 
-      mstl::fill_n(data(), data() + N, u);
+      mstl::fill_n(data(), N, u);
     }
   }
 
@@ -90,9 +90,14 @@ template <typename T, size_t N> struct array {
 
   constexpr bool empty() const noexcept { return N == 0; }
 
+  // n is a runtime value, bounds are only checked by at().
   constexpr reference operator[](size_type n) noexcept {
     static_assert(N > 0, "cannot access a zero size array");
-    static_assert(n < N, "mstl::array<T, N> index out of bound");
+    return elements_[n];
+  }
+
+  constexpr const_reference operator[](size_type n) const noexcept {
+    static_assert(N > 0, "cannot access a zero size array");
     return elements_[n];
   }
 
@@ -104,7 +109,7 @@ template <typename T, size_t N> struct array {
     return elements_[n];
   }
 
-  constexpr reference at(size_type n) const {
+  constexpr const_reference at(size_type n) const {
     static_assert(N > 0, "cannot call array<T, 0>::at");
     if (n >= N) {
       throw mstl::exception();
@@ -117,7 +122,7 @@ template <typename T, size_t N> struct array {
     return (*this)[0];
   }
 
-  constexpr reference front() const noexcept {
+  constexpr const_reference front() const noexcept {
     static_assert(N > 0, " cannot call array<T, 0>::front");
     return (*this)[0];
   }
@@ -127,7 +132,7 @@ template <typename T, size_t N> struct array {
     return (*this)[N - 1];
   }
 
-  constexpr reference back() const noexcept {
+  constexpr const_reference back() const noexcept {
     static_assert(N > 0, " cannot call array<T, 0>::back");
     return (*this)[N - 1];
   }
@@ -0,0 +1,819 @@
+#pragma once
+#include "mcpu.hpp"
+#include "mexception.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "mvector.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MSTL_X86_DISPATCH__
+#include <immintrin.h>
+#endif
+
+// Bit sets, 64 bits to a word.
+//
+// bitset<N> is a fixed array of words, basic_bit_vector grows like a
+// vector. Both work a word at a time, never a bit at a time: combining two
+// sets is one instruction per 64 bits (per 256 with AVX2), counting is one
+// POPCNT per word, and scanning skips empty words and finds the first bit
+// of the others with one count trailing zeros.
+//
+// rank_select indexes a set for rank (how many ones before a position) and
+// select (where the k-th one is) in constant time, for 25% extra memory
+// (up to 12.5% more where the set is very sparse, or very full).
+//
+// Bits past the end of the last word are kept zero, so whole words can be
+// counted and compared.
+namespace mstl::bits_UTILL {
+
+constexpr size_t words_for__(size_t bits) noexcept { return (bits + 63) / 64; }
+
+// the valid bits of the last word.
+constexpr uint64_t tail_mask__(size_t bits) noexcept {
+  return bits % 64 ? (uint64_t(1) << (bits % 64)) - 1 : ~uint64_t(0);
+}
+
+constexpr unsigned popcount64__(uint64_t x) noexcept {
+  return unsigned(__builtin_popcountll(x));
+}
+
+/*
+ * popcount
+ */
+inline size_t popcount_portable__(const uint64_t *w, size_t n) noexcept {
+  size_t r = 0;
+  for (size_t i = 0; i < n; ++i) {
+    r += popcount64__(w[i]);
+  }
+  return r;
+}
+
+#ifdef MSTL_X86_DISPATCH__
+// the same loop, but the builtin becomes the POPCNT instruction instead
+// of a call into libgcc.
+__attribute__((target("popcnt"))) inline size_t
+popcount_popcnt__(const uint64_t *w, size_t n) noexcept {
+  size_t r = 0;
+  for (size_t i = 0; i < n; ++i) {
+    r += size_t(__builtin_popcountll(w[i]));
+  }
+  return r;
+}
+
+// Mula's nibble lookup: vpshufb counts the bits of 32 nibbles at once
+// from a 16 entry table, vpsadbw sums the bytes into four 64 bit lanes.
+// About twice as fast as scalar POPCNT on long arrays.
+__attribute__((target("avx2,popcnt"))) inline size_t
+popcount_avx2__(const uint64_t *w, size_t n) noexcept {
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                         2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  size_t body = n & ~size_t(3);
+  for (size_t i = 0; i < body; i += 4) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + i));
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(
+        table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    acc = _mm256_add_epi64(
+        acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  size_t r = size_t(_mm256_extract_epi64(acc, 0)) +
+             size_t(_mm256_extract_epi64(acc, 1)) +
+             size_t(_mm256_extract_epi64(acc, 2)) +
+             size_t(_mm256_extract_epi64(acc, 3));
+  for (size_t i = body; i < n; ++i) {
+    r += size_t(__builtin_popcountll(w[i]));
+  }
+  return r;
+}
+#endif
+
+inline size_t popcount__(const uint64_t *w, size_t n) noexcept {
+#ifdef MSTL_X86_DISPATCH__
+  const cpu_UTILL::features__ &f = cpu_UTILL::cpu_features__();
+  if (n >= 16 && f.avx2 && f.popcnt) {
+    return popcount_avx2__(w, n);
+  }
+  if (f.popcnt) {
+    return popcount_popcnt__(w, n);
+  }
+#endif
+  return popcount_portable__(w, n);
+}
+
+/*
+ * dst = dst op src, word by word
+ */
+enum class op__ { and_, or_, xor_, and_not_ };
+
+template <op__ Op> constexpr uint64_t apply__(uint64_t a, uint64_t b) noexcept {
+  if constexpr (Op == op__::and_) {
+    return a & b;
+  } else if constexpr (Op == op__::or_) {
+    return a | b;
+  } else if constexpr (Op == op__::xor_) {
+    return a ^ b;
+  } else {
+    return a & ~b;
+  }
+}
+
+template <op__ Op>
+void combine_portable__(uint64_t *dst, const uint64_t *src, size_t n) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = apply__<Op>(dst[i], src[i]);
+  }
+}
+
+#ifdef MSTL_X86_DISPATCH__
+template <op__ Op>
+__attribute__((target("avx2"))) void
+combine_avx2__(uint64_t *dst, const uint64_t *src, size_t n) noexcept {
+  size_t body = n & ~size_t(3);
+  for (size_t i = 0; i < body; i += 4) {
+    auto *d = reinterpret_cast<__m256i *>(dst + i);
+    __m256i a = _mm256_loadu_si256(d);
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    if constexpr (Op == op__::and_) {
+      a = _mm256_and_si256(a, b);
+    } else if constexpr (Op == op__::or_) {
+      a = _mm256_or_si256(a, b);
+    } else if constexpr (Op == op__::xor_) {
+      a = _mm256_xor_si256(a, b);
+    } else {
+      a = _mm256_andnot_si256(b, a); // (~b) & a
+    }
+    _mm256_storeu_si256(d, a);
+  }
+  for (size_t i = body; i < n; ++i) {
+    dst[i] = apply__<Op>(dst[i], src[i]);
+  }
+}
+#endif
+
+template <op__ Op>
+void combine__(uint64_t *dst, const uint64_t *src, size_t n) noexcept {
+#ifdef MSTL_X86_DISPATCH__
+  if (n >= 8 && cpu_UTILL::cpu_features__().avx2) {
+    combine_avx2__<Op>(dst, src, n);
+    return;
+  }
+#endif
+  combine_portable__<Op>(dst, src, n);
+}
+
+/*
+ * scanning
+ */
+
+// the first set bit at or after pos, bits if there is none.
+inline size_t find_from__(const uint64_t *w, size_t bits,
+                          size_t pos) noexcept {
+  if (pos >= bits) {
+    return bits;
+  }
+  size_t i = pos / 64;
+  size_t n = words_for__(bits);
+  uint64_t word = w[i] & (~uint64_t(0) << (pos % 64));
+  while (word == 0) {
+    if (++i == n) {
+      return bits;
+    }
+    word = w[i];
+  }
+  return i * 64 + size_t(__builtin_ctzll(word));
+}
+
+// position of the k-th set bit of w, k < popcount(w).
+inline unsigned select_in_word__(uint64_t w, unsigned k) noexcept {
+#ifdef __BMI2__
+  return unsigned(__builtin_ctzll(_pdep_u64(uint64_t(1) << k, w)));
+#else
+  // byte i of s = ones in bytes 0..i, find the byte, then clear the bits
+  // before the one we want.
+  uint64_t s = w - ((w >> 1) & 0x5555555555555555);
+  s = (s & 0x3333333333333333) + ((s >> 2) & 0x3333333333333333);
+  s = ((s + (s >> 4)) & 0x0f0f0f0f0f0f0f0f) * 0x0101010101010101;
+  unsigned byte = 0, before = 0;
+  for (; byte < 7; ++byte) {
+    unsigned c = unsigned(s >> (8 * byte)) & 0xff;
+    if (c > k) {
+      break;
+    }
+    before = c;
+  }
+  uint64_t b = (w >> (8 * byte)) & 0xff;
+  for (k -= before; k > 0; --k) {
+    b &= b - 1;
+  }
+  return 8 * byte + unsigned(__builtin_ctzll(b));
+#endif
+}
+
+// the bit proxy returned by operator[].
+class reference__ {
+  uint64_t *word_;
+  uint64_t mask_;
+
+public:
+  reference__(uint64_t *word, size_t bit) noexcept
+      : word_(word), mask_(uint64_t(1) << bit) {}
+
+  reference__(const reference__ &) = default;
+
+  reference__ &operator=(bool value) noexcept {
+    *word_ = value ? (*word_ | mask_) : (*word_ & ~mask_);
+    return *this;
+  }
+  reference__ &operator=(const reference__ &other) noexcept {
+    return *this = bool(other);
+  }
+
+  operator bool() const noexcept { return (*word_ & mask_) != 0; }
+  bool operator~() const noexcept { return (*word_ & mask_) == 0; }
+
+  reference__ &flip() noexcept {
+    *word_ ^= mask_;
+    return *this;
+  }
+};
+
+} // namespace mstl::bits_UTILL
+
+namespace mstl {
+
+template <size_t N> class bitset {
+  static constexpr size_t words__ =
+      bits_UTILL::words_for__(N) ? bits_UTILL::words_for__(N) : 1;
+
+  uint64_t w_[words__] = {};
+
+public:
+  using reference = bits_UTILL::reference__;
+
+  constexpr bitset() noexcept = default;
+
+  constexpr bitset(unsigned long long value) noexcept {
+    w_[0] = N >= 64 ? uint64_t(value) : uint64_t(value) & tail__();
+  }
+
+  static constexpr size_t size() noexcept { return N; }
+
+  // the words, least significant bits first.
+  const uint64_t *data() const noexcept { return w_; }
+  uint64_t *data() noexcept { return w_; }
+  static constexpr size_t num_words() noexcept { return words__; }
+
+  /*
+   * element access
+   */
+  constexpr bool operator[](size_t pos) const noexcept {
+    return (w_[pos / 64] >> (pos % 64)) & 1;
+  }
+  reference operator[](size_t pos) noexcept {
+    return reference(w_ + pos / 64, pos % 64);
+  }
+
+  bool test(size_t pos) const {
+    if (pos >= N) {
+      throw mstl::exception();
+    }
+    return (*this)[pos];
+  }
+
+  size_t count() const noexcept { return bits_UTILL::popcount__(w_, words__); }
+
+  bool any() const noexcept {
+    for (uint64_t w : w_) {
+      if (w) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool none() const noexcept { return !any(); }
+  bool all() const noexcept { return count() == N; }
+
+  // the first set bit, or size() if there is none.
+  size_t find_first() const noexcept {
+    return bits_UTILL::find_from__(w_, N, 0);
+  }
+
+  // the first set bit after prev, or size(). So all set bits are
+  //
+  //   for (size_t i = b.find_first(); i < b.size(); i = b.find_next(i))
+  size_t find_next(size_t prev) const noexcept {
+    return bits_UTILL::find_from__(w_, N, prev + 1);
+  }
+
+  /*
+   * modifiers
+   */
+  bitset &set() noexcept {
+    for (uint64_t &w : w_) {
+      w = ~uint64_t(0);
+    }
+    w_[words__ - 1] &= tail__();
+    return *this;
+  }
+
+  bitset &set(size_t pos, bool value = true) {
+    if (pos >= N) {
+      throw mstl::exception();
+    }
+    (*this)[pos] = value;
+    return *this;
+  }
+
+  bitset &reset() noexcept {
+    for (uint64_t &w : w_) {
+      w = 0;
+    }
+    return *this;
+  }
+
+  bitset &reset(size_t pos) { return set(pos, false); }
+
+  bitset &flip() noexcept {
+    for (uint64_t &w : w_) {
+      w = ~w;
+    }
+    w_[words__ - 1] &= tail__();
+    return *this;
+  }
+
+  bitset &flip(size_t pos) {
+    if (pos >= N) {
+      throw mstl::exception();
+    }
+    (*this)[pos].flip();
+    return *this;
+  }
+
+  bitset &operator&=(const bitset &other) noexcept {
+    bits_UTILL::combine__<bits_UTILL::op__::and_>(w_, other.w_, words__);
+    return *this;
+  }
+  bitset &operator|=(const bitset &other) noexcept {
+    bits_UTILL::combine__<bits_UTILL::op__::or_>(w_, other.w_, words__);
+    return *this;
+  }
+  bitset &operator^=(const bitset &other) noexcept {
+    bits_UTILL::combine__<bits_UTILL::op__::xor_>(w_, other.w_, words__);
+    return *this;
+  }
+  // *this &= ~other, without building ~other.
+  bitset &and_not(const bitset &other) noexcept {
+    bits_UTILL::combine__<bits_UTILL::op__::and_not_>(w_, other.w_, words__);
+    return *this;
+  }
+
+  bitset operator~() const noexcept { return bitset(*this).flip(); }
+
+  bitset &operator<<=(size_t n) noexcept {
+    if (n >= N) {
+      return reset();
+    }
+    size_t ws = n / 64, bs = n % 64;
+    for (size_t i = words__; i-- > 0;) {
+      uint64_t w = i >= ws ? w_[i - ws] << bs : 0;
+      if (bs != 0 && i > ws) {
+        w |= w_[i - ws - 1] >> (64 - bs);
+      }
+      w_[i] = w;
+    }
+    w_[words__ - 1] &= tail__();
+    return *this;
+  }
+
+  bitset &operator>>=(size_t n) noexcept {
+    if (n >= N) {
+      return reset();
+    }
+    size_t ws = n / 64, bs = n % 64;
+    for (size_t i = 0; i < words__; ++i) {
+      uint64_t w = i + ws < words__ ? w_[i + ws] >> bs : 0;
+      if (bs != 0 && i + ws + 1 < words__) {
+        w |= w_[i + ws + 1] << (64 - bs);
+      }
+      w_[i] = w;
+    }
+    return *this;
+  }
+
+  bitset operator<<(size_t n) const noexcept { return bitset(*this) <<= n; }
+  bitset operator>>(size_t n) const noexcept { return bitset(*this) >>= n; }
+
+  friend bitset operator&(const bitset &x, const bitset &y) noexcept {
+    return bitset(x) &= y;
+  }
+  friend bitset operator|(const bitset &x, const bitset &y) noexcept {
+    return bitset(x) |= y;
+  }
+  friend bitset operator^(const bitset &x, const bitset &y) noexcept {
+    return bitset(x) ^= y;
+  }
+
+  friend bool operator==(const bitset &x, const bitset &y) noexcept {
+    for (size_t i = 0; i < words__; ++i) {
+      if (x.w_[i] != y.w_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  friend bool operator!=(const bitset &x, const bitset &y) noexcept {
+    return !(x == y);
+  }
+
+private:
+  static constexpr uint64_t tail__() noexcept {
+    return N == 0 ? 0 : bits_UTILL::tail_mask__(N);
+  }
+};
+
+// Growable bit set. Binary operations need both sides to have the same
+// size, and throw otherwise.
+template <typename Alloc = mstl::allocator<uint64_t>> class basic_bit_vector {
+  mstl::vector<uint64_t, Alloc> w_;
+  size_t size_ = 0;
+
+public:
+  using size_type = size_t;
+  using allocator_type = Alloc;
+  using reference = bits_UTILL::reference__;
+
+  basic_bit_vector() = default;
+  explicit basic_bit_vector(const Alloc &a) : w_(a) {}
+
+  explicit basic_bit_vector(size_t n, bool value = false,
+                            const Alloc &a = Alloc())
+      : w_(bits_UTILL::words_for__(n), value ? ~uint64_t(0) : 0, a),
+        size_(n) {
+    clear_tail__();
+  }
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  size_t capacity() const noexcept { return w_.capacity() * 64; }
+
+  const uint64_t *data() const noexcept { return w_.data(); }
+  uint64_t *data() noexcept { return w_.data(); }
+  size_t num_words() const noexcept { return w_.size(); }
+
+  allocator_type get_allocator() const { return w_.get_allocator(); }
+
+  /*
+   * element access
+   */
+  bool operator[](size_t pos) const noexcept {
+    return (w_[pos / 64] >> (pos % 64)) & 1;
+  }
+  reference operator[](size_t pos) noexcept {
+    return reference(w_.data() + pos / 64, pos % 64);
+  }
+
+  bool test(size_t pos) const {
+    if (pos >= size_) {
+      throw mstl::exception();
+    }
+    return (*this)[pos];
+  }
+
+  size_t count() const noexcept {
+    return bits_UTILL::popcount__(w_.data(), w_.size());
+  }
+
+  bool any() const noexcept {
+    return bits_UTILL::find_from__(w_.data(), size_, 0) != size_;
+  }
+  bool none() const noexcept { return !any(); }
+  bool all() const noexcept { return count() == size_; }
+
+  // see bitset::find_next.
+  size_t find_first() const noexcept {
+    return bits_UTILL::find_from__(w_.data(), size_, 0);
+  }
+  size_t find_next(size_t prev) const noexcept {
+    return bits_UTILL::find_from__(w_.data(), size_, prev + 1);
+  }
+
+  /*
+   * modifiers
+   */
+  void reserve(size_t bits) { w_.reserve(bits_UTILL::words_for__(bits)); }
+
+  void resize(size_t n, bool value = false) {
+    if (value && n > size_) {
+      // fill the rest of the old last word before adding new ones.
+      if (size_ % 64 != 0) {
+        w_.back() |= ~bits_UTILL::tail_mask__(size_);
+      }
+      w_.resize(bits_UTILL::words_for__(n), ~uint64_t(0));
+    } else {
+      w_.resize(bits_UTILL::words_for__(n), 0);
+    }
+    size_ = n;
+    clear_tail__();
+  }
+
+  void push_back(bool value) {
+    if (size_ % 64 == 0) {
+      w_.push_back(0);
+    }
+    w_.back() |= uint64_t(value) << (size_ % 64);
+    ++size_;
+  }
+
+  void pop_back() noexcept {
+    --size_;
+    if (size_ % 64 == 0) {
+      w_.pop_back();
+    } else {
+      clear_tail__();
+    }
+  }
+
+  void clear() noexcept {
+    w_.clear();
+    size_ = 0;
+  }
+
+  basic_bit_vector &set() noexcept {
+    for (uint64_t &w : w_) {
+      w = ~uint64_t(0);
+    }
+    clear_tail__();
+    return *this;
+  }
+
+  basic_bit_vector &set(size_t pos, bool value = true) {
+    if (pos >= size_) {
+      throw mstl::exception();
+    }
+    (*this)[pos] = value;
+    return *this;
+  }
+
+  basic_bit_vector &reset() noexcept {
+    for (uint64_t &w : w_) {
+      w = 0;
+    }
+    return *this;
+  }
+
+  basic_bit_vector &reset(size_t pos) { return set(pos, false); }
+
+  basic_bit_vector &flip() noexcept {
+    for (uint64_t &w : w_) {
+      w = ~w;
+    }
+    clear_tail__();
+    return *this;
+  }
+
+  basic_bit_vector &flip(size_t pos) {
+    if (pos >= size_) {
+      throw mstl::exception();
+    }
+    (*this)[pos].flip();
+    return *this;
+  }
+
+  basic_bit_vector &operator&=(const basic_bit_vector &other) {
+    return combine__<bits_UTILL::op__::and_>(other);
+  }
+  basic_bit_vector &operator|=(const basic_bit_vector &other) {
+    return combine__<bits_UTILL::op__::or_>(other);
+  }
+  basic_bit_vector &operator^=(const basic_bit_vector &other) {
+    return combine__<bits_UTILL::op__::xor_>(other);
+  }
+  // *this &= ~other, without building ~other.
+  basic_bit_vector &and_not(const basic_bit_vector &other) {
+    return combine__<bits_UTILL::op__::and_not_>(other);
+  }
+
+  void swap(basic_bit_vector &other) noexcept {
+    w_.swap(other.w_);
+    size_t tmp = size_;
+    size_ = other.size_;
+    other.size_ = tmp;
+  }
+
+  friend bool operator==(const basic_bit_vector &x,
+                         const basic_bit_vector &y) noexcept {
+    return x.size_ == y.size_ && x.w_ == y.w_;
+  }
+  friend bool operator!=(const basic_bit_vector &x,
+                         const basic_bit_vector &y) noexcept {
+    return !(x == y);
+  }
+
+private:
+  void clear_tail__() noexcept {
+    if (size_ % 64 != 0) {
+      w_.back() &= bits_UTILL::tail_mask__(size_);
+    }
+  }
+
+  template <bits_UTILL::op__ Op>
+  basic_bit_vector &combine__(const basic_bit_vector &other) {
+    if (other.size_ != size_) {
+      throw mstl::exception();
+    }
+    bits_UTILL::combine__<Op>(w_.data(), other.w_.data(), w_.size());
+    return *this;
+  }
+};
+
+using bit_vector = basic_bit_vector<>;
+
+// Rank and select over a bit set, rank9 style (Vigna, "Broadword
+// implementation of rank/select queries"). For every block of 512 bits:
+//
+//   [ ones before the block | ones before word 1, 2, ... 7 of the block ]
+//              64 bits             7 x 9 bits packed in 64 bits
+//
+// so rank is two loads from the index and one popcount. Select starts from
+// a sample taken every 512 ones (and zeros), narrows down to the block
+// with a binary search, then to the word with the packed counts.
+//
+// The search is over the blocks between two samples, which is what keeps
+// select constant time: where 512 ones are spread over more than 512
+// blocks, the positions of all of them are kept instead and select is a
+// single load. That costs 64 bits per one, at most 1/8 of the bits they
+// span. So the search never takes more than 9 steps.
+//
+// It keeps a pointer to the bits, and must be rebuilt after they change.
+class rank_select {
+  static constexpr size_t block_bits__ = 512;
+  static constexpr size_t sample_rate__ = 512;
+  static constexpr size_t sparse_blocks__ = 512;
+  static constexpr size_t dense__ = size_t(-1);
+
+  // for ones or for zeros.
+  struct directory__ {
+    mstl::vector<size_t> samples; // block of every 512th, then the end
+    mstl::vector<size_t> sparse;  // per sample, where in positions, or dense__
+    mstl::vector<size_t> positions;
+  };
+
+  const uint64_t *bits_ = nullptr;
+  size_t size_ = 0;
+  size_t ones_ = 0;
+  size_t blocks_count_ = 0;
+  mstl::vector<uint64_t> index_; // two words per block, one more at the end
+  directory__ dir1_;
+  directory__ dir0_;
+
+public:
+  rank_select() = default;
+
+  rank_select(const uint64_t *words, size_t bits) : bits_(words), size_(bits) {
+    size_t n = bits_UTILL::words_for__(bits);
+    blocks_count_ = (n + 7) / 8;
+    index_.resize(2 * (blocks_count_ + 1));
+    size_t ones = 0;
+    for (size_t b = 0; b < blocks_count_; ++b) {
+      index_[2 * b] = ones;
+      uint64_t packed = 0, inner = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        if (j > 0) {
+          packed |= inner << (9 * (j - 1));
+        }
+        size_t i = 8 * b + j;
+        inner += i < n ? bits_UTILL::popcount64__(words[i]) : 0;
+      }
+      index_[2 * b + 1] = packed;
+      ones += inner;
+    }
+    index_[2 * blocks_count_] = ones;
+    ones_ = ones;
+    sample__<true>(dir1_, ones_);
+    sample__<false>(dir0_, size_ - ones_);
+  }
+
+  template <typename A>
+  explicit rank_select(const basic_bit_vector<A> &v)
+      : rank_select(v.data(), v.size()) {}
+
+  template <size_t N>
+  explicit rank_select(const bitset<N> &b) : rank_select(b.data(), N) {}
+
+  size_t size() const noexcept { return size_; }
+  size_t ones() const noexcept { return ones_; }
+  size_t zeros() const noexcept { return size_ - ones_; }
+
+  // ones in [0, pos), pos <= size().
+  size_t rank1(size_t pos) const noexcept {
+    size_t b = pos / block_bits__;
+    size_t r = index_[2 * b] + packed__(index_[2 * b + 1], (pos / 64) % 8);
+    if (pos % 64 != 0) {
+      r += bits_UTILL::popcount64__(bits_[pos / 64] &
+                                    ((uint64_t(1) << (pos % 64)) - 1));
+    }
+    return r;
+  }
+
+  size_t rank0(size_t pos) const noexcept { return pos - rank1(pos); }
+
+  // position of the k-th one (from 0), k < ones().
+  size_t select1(size_t k) const noexcept { return select__<true>(k); }
+
+  // position of the k-th zero (from 0), k < zeros().
+  size_t select0(size_t k) const noexcept { return select__<false>(k); }
+
+private:
+  // ones before word j of a block, from the packed counts.
+  static size_t packed__(uint64_t packed, size_t j) noexcept {
+    return j == 0 ? 0 : size_t(packed >> (9 * (j - 1))) & 0x1ff;
+  }
+
+  // ones (or zeros) before block b.
+  template <bool One> size_t before__(size_t b) const noexcept {
+    return One ? index_[2 * b] : b * block_bits__ - index_[2 * b];
+  }
+
+  template <bool One> void sample__(directory__ &d, size_t total) {
+    size_t next = 0;
+    for (size_t b = 0; b < blocks_count_ && next < total; ++b) {
+      size_t end = before__<One>(b + 1);
+      for (; next < total && next < end; next += sample_rate__) {
+        d.samples.push_back(b);
+      }
+    }
+    d.samples.push_back(blocks_count_);
+
+    d.sparse.resize(d.samples.size() - 1, dense__);
+    for (size_t i = 0; i + 1 < d.samples.size(); ++i) {
+      if (d.samples[i + 1] - d.samples[i] > sparse_blocks__) {
+        size_t first = i * sample_rate__;
+        size_t last = first + sample_rate__ < total ? first + sample_rate__
+                                                    : total;
+        d.sparse[i] = d.positions.size();
+        positions__<One>(d.positions, first, last, d.samples[i]);
+      }
+    }
+  }
+
+  // append where the first-th to the last-th one (or zero) are, starting
+  // the scan at block b.
+  template <bool One>
+  void positions__(mstl::vector<size_t> &out, size_t first, size_t last,
+                   size_t b) {
+    size_t n = bits_UTILL::words_for__(size_);
+    size_t k = before__<One>(b);
+    for (size_t i = 8 * b; k < last; ++i) {
+      uint64_t w = One ? bits_[i] : ~bits_[i];
+      if (i == n - 1) {
+        w &= bits_UTILL::tail_mask__(size_);
+      }
+      for (; w != 0 && k < last; w &= w - 1, ++k) {
+        if (k >= first) {
+          out.push_back(64 * i + unsigned(__builtin_ctzll(w)));
+        }
+      }
+    }
+  }
+
+  template <bool One> size_t select__(size_t k) const noexcept {
+    const directory__ &d = One ? dir1_ : dir0_;
+    size_t s = k / sample_rate__;
+    if (d.sparse[s] != dense__) {
+      return d.positions[d.sparse[s] + k % sample_rate__];
+    }
+
+    // the last block with fewer than k ones before it.
+    size_t lo = d.samples[s];
+    size_t hi = d.samples[s + 1];
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo + 1) / 2;
+      if (before__<One>(mid) <= k) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    size_t b = lo;
+    k -= before__<One>(b);
+
+    uint64_t packed = index_[2 * b + 1];
+    size_t j = 7;
+    for (;; --j) {
+      size_t c = One ? packed__(packed, j) : 64 * j - packed__(packed, j);
+      if (c <= k) {
+        k -= c;
+        break;
+      }
+    }
+    uint64_t w = bits_[8 * b + j];
+    return 64 * (8 * b + j) +
+           bits_UTILL::select_in_word__(One ? w : ~w, unsigned(k));
+  }
+};
+
+} // namespace mstl
@@ -0,0 +1,1267 @@
+#pragma once
+#include "mexception.hpp"
+#include "mfunctional.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+// Ordered map and set on a B-tree.
+//
+// A red black tree has one element per node, so a lookup in ten million
+// keys follows ~24 pointers and takes a cache miss on most of them, and
+// every element pays for three pointers and a color. A B-tree node holds
+// as many elements as fit in a few cache lines (256 bytes by default) and
+// is searched in place, so the same lookup is 4 or 5 node visits, the
+// elements are packed, and a range scan walks arrays.
+//
+//          +-------[ 20 | 40 ]-------+
+//          |             |            |
+//   [ 5 | 9 | 13 ]  [ 27 | 33 ]  [ 45 | 51 | 60 ]
+//
+// Elements live in every node, not only the leaves. Each node knows its
+// parent and its index in the parent, so iterators are (node, index) and
+// need no stack.
+//
+// note: unlike std::map, insert and erase move elements between nodes, so
+// they invalidate iterators and references to other elements.
+namespace mstl::btree_UTILL {
+
+template <typename T, size_t Slots> struct internal__;
+
+template <typename T, size_t Slots> struct node__ {
+  internal__<T, Slots> *parent;
+  uint16_t position; // index in the parent's children
+  uint16_t count;
+  bool leaf;
+  alignas(T) unsigned char values[Slots * sizeof(T)];
+
+  T *slot(size_t i) noexcept { return reinterpret_cast<T *>(values) + i; }
+};
+
+template <typename T, size_t Slots>
+struct internal__ : node__<T, Slots> {
+  node__<T, Slots> *children[Slots + 1];
+};
+
+template <typename T, size_t Slots>
+node__<T, Slots> *child__(node__<T, Slots> *node, size_t i) noexcept {
+  return static_cast<internal__<T, Slots> *>(node)->children[i];
+}
+
+// as many elements as fit in NodeBytes, but at least 3 so splits make
+// sense for big elements.
+template <typename T, size_t NodeBytes> constexpr size_t node_slots__() {
+  constexpr size_t header = sizeof(void *) + 2 * sizeof(uint16_t) + 1;
+  constexpr size_t align = alignof(T) < alignof(void *) ? alignof(void *)
+                                                         : alignof(T);
+  constexpr size_t used = (header + align - 1) / align * align;
+  constexpr size_t n = NodeBytes > used ? (NodeBytes - used) / sizeof(T) : 0;
+  return n < 3 ? 3 : n > 0xffff ? 0xffff : n;
+}
+
+template <typename K> struct set_policy__ {
+  using key_type = K;
+  using value_type = K;
+  static constexpr bool is_set = true;
+
+  static const K &key(const value_type &v) noexcept { return v; }
+
+  template <typename Alloc>
+  static void transfer(Alloc &a, value_type *dst, value_type *src) {
+    mstl::allocator_traits<Alloc>::construct(a, dst, mstl::move(*src));
+    mstl::allocator_traits<Alloc>::destroy(a, src);
+  }
+};
+
+template <typename K, typename V> struct map_policy__ {
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = mstl::pair<const K, V>;
+  static constexpr bool is_set = false;
+
+  static const K &key(const value_type &v) noexcept { return v.first; }
+
+  // the slot is about to be destroyed, moving out of the const key is
+  // fine.
+  template <typename Alloc>
+  static void transfer(Alloc &a, value_type *dst, value_type *src) {
+    mstl::allocator_traits<Alloc>::construct(
+        a, dst, mstl::move(const_cast<K &>(src->first)),
+        mstl::move(src->second));
+    mstl::allocator_traits<Alloc>::destroy(a, src);
+  }
+};
+
+template <typename Policy, typename Compare, typename Alloc, size_t NodeBytes>
+class tree__;
+
+template <typename T, size_t Slots, bool Const, bool Set> class iterator__ {
+  template <typename, size_t, bool, bool> friend class iterator__;
+  template <typename, typename, typename, size_t> friend class tree__;
+
+  using node_type__ = node__<T, Slots>;
+  using elem__ = typename mstl::conditional<Const || Set, const T, T>::type;
+
+  node_type__ *node_ = nullptr;
+  size_t position_ = 0;
+
+  iterator__(node_type__ *node, size_t position) noexcept
+      : node_(node), position_(position) {}
+
+  // off the end of a leaf, or in an internal node where the next element
+  // is the leftmost one of the next subtree.
+  void increment_slow__() noexcept {
+    if (node_->leaf) {
+      node_type__ *save = node_;
+      size_t save_position = position_;
+      while (position_ == node_->count && node_->parent != nullptr) {
+        position_ = node_->position;
+        node_ = node_->parent;
+      }
+      if (position_ == node_->count) { // was the last element, now end.
+        node_ = save;
+        position_ = save_position;
+      }
+    } else {
+      node_ = child__(node_, position_ + 1);
+      while (!node_->leaf) {
+        node_ = child__(node_, 0);
+      }
+      position_ = 0;
+    }
+  }
+
+  void decrement_slow__() noexcept {
+    if (node_->leaf) {
+      while (position_ == 0 && node_->parent != nullptr) {
+        position_ = node_->position;
+        node_ = node_->parent;
+      }
+      --position_;
+    } else {
+      node_ = child__(node_, position_);
+      while (!node_->leaf) {
+        node_ = child__(node_, node_->count);
+      }
+      position_ = node_->count - 1;
+    }
+  }
+
+  T *slot__() const noexcept { return node_->slot(position_); }
+
+public:
+  using iterator_category = mstl::bidirectional_iterator_tag;
+  using value_type = T;
+  using difference_type = ptrdiff_t;
+  using pointer = elem__ *;
+  using reference = elem__ &;
+
+  iterator__() noexcept = default;
+
+  template <bool C, typename = mstl::enable_if_t<Const && !C>>
+  iterator__(const iterator__<T, Slots, C, Set> &other) noexcept
+      : node_(other.node_), position_(other.position_) {}
+
+  reference operator*() const noexcept { return *slot__(); }
+  pointer operator->() const noexcept { return slot__(); }
+
+  iterator__ &operator++() noexcept {
+    if (node_->leaf && ++position_ < node_->count) {
+      return *this;
+    }
+    increment_slow__();
+    return *this;
+  }
+
+  iterator__ operator++(int) noexcept {
+    iterator__ tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  iterator__ &operator--() noexcept {
+    if (node_->leaf && position_ > 0) {
+      --position_;
+      return *this;
+    }
+    decrement_slow__();
+    return *this;
+  }
+
+  iterator__ operator--(int) noexcept {
+    iterator__ tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  template <bool C>
+  bool operator==(const iterator__<T, Slots, C, Set> &other) const noexcept {
+    return node_ == other.node_ && position_ == other.position_;
+  }
+  template <bool C>
+  bool operator!=(const iterator__<T, Slots, C, Set> &other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+// The tree behind btree_set and btree_map.
+//
+// Insert goes to a leaf. A full node is split in two and the middle
+// element moves up into the parent, splitting that first if it's full
+// too, so the tree only grows at the root. When the insert is at the very
+// end of a node (appending sorted data) the split leaves the old node
+// full instead of half full, so building from sorted input packs every
+// node.
+//
+// Erase in an internal node swaps in the element just before it, which
+// is always in a leaf. A node that drops under half full merges with a
+// sibling when both fit in one node, or takes elements from it.
+template <typename Policy, typename Compare, typename Alloc, size_t NodeBytes>
+class tree__ {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Compare>::value;
+
+public:
+  using key_type = typename Policy::key_type;
+  using value_type = typename Policy::value_type;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using key_compare = Compare;
+  using allocator_type = Alloc;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = value_type *;
+  using const_pointer = const value_type *;
+
+  static constexpr size_t node_slots = node_slots__<value_type, NodeBytes>();
+
+  using iterator = iterator__<value_type, node_slots, false, Policy::is_set>;
+  using const_iterator =
+      iterator__<value_type, node_slots, true, Policy::is_set>;
+  using reverse_iterator = mstl::reverse_iterator<iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  template <typename K>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<K, key_type>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::value_type,
+                              value_type>::value,
+                "allocator value_type must be the tree's value_type");
+
+private:
+  using node_type__ = node__<value_type, node_slots>;
+  using internal_type__ = internal__<value_type, node_slots>;
+  using leaf_alloc__ =
+      typename alloc_traits__::template rebind_alloc<node_type__>;
+  using internal_alloc__ =
+      typename alloc_traits__::template rebind_alloc<internal_type__>;
+
+  static constexpr size_t min_values__ = node_slots / 2;
+
+  static constexpr bool relocatable__ =
+      mstl::is_trivially_relocatable<value_type>::value &&
+      !allocator_traits_UTILL::has_construct__<Alloc, value_type,
+                                               value_type &&>::value &&
+      !allocator_traits_UTILL::has_destroy__<Alloc, value_type>::value;
+
+  node_type__ *root_ = nullptr;
+  node_type__ *leftmost_ = nullptr;
+  node_type__ *rightmost_ = nullptr;
+  size_type size_ = 0;
+  memory_UTIL::compressed_pair__<Compare, Alloc> fns_;
+
+public:
+  tree__() noexcept(noexcept(Compare()) && noexcept(Alloc()))
+      : fns_(Compare(), Alloc()) {}
+
+  explicit tree__(const Compare &comp, const Alloc &a = Alloc())
+      : fns_(comp, a) {}
+
+  explicit tree__(const Alloc &a) : fns_(Compare(), a) {}
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  tree__(InputIt first, InputIt last, const Compare &comp = Compare(),
+         const Alloc &a = Alloc())
+      : fns_(comp, a) {
+    try {
+      insert(first, last);
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  // bulk load, the range must be sorted by comp and have no duplicates.
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  tree__(mstl::sorted_unique_t, InputIt first, InputIt last,
+         const Compare &comp = Compare(), const Alloc &a = Alloc())
+      : fns_(comp, a) {
+    try {
+      for (; first != last; ++first) {
+        append__(*first);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  tree__(std::initializer_list<value_type> il,
+         const Compare &comp = Compare(), const Alloc &a = Alloc())
+      : tree__(il.begin(), il.end(), comp, a) {}
+
+  tree__(const tree__ &other)
+      : tree__(other, alloc_traits__::select_on_container_copy_construction(
+                          other.alloc__())) {}
+
+  tree__(const tree__ &other, const Alloc &a) : fns_(other.comp__(), a) {
+    copy_from__(other);
+  }
+
+  tree__(tree__ &&other) noexcept : fns_(mstl::move(other.fns_)) {
+    steal__(other);
+  }
+
+  ~tree__() { clear(); }
+
+  tree__ &operator=(const tree__ &other) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (alloc_traits__::propagate_on_container_copy_assignment::
+                      value) {
+      alloc__() = other.alloc__();
+    }
+    comp__() = other.comp__();
+    copy_from__(other);
+    return *this;
+  }
+
+  tree__ &operator=(tree__ &&other) noexcept(
+      alloc_traits__::propagate_on_container_move_assignment::value ||
+      alloc_traits__::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    comp__() = mstl::move(other.comp__());
+    if constexpr (alloc_traits__::propagate_on_container_move_assignment::
+                      value) {
+      alloc__() = mstl::move(other.alloc__());
+      steal__(other);
+    } else {
+      if (alloc__() == other.alloc__()) {
+        steal__(other);
+      } else {
+        for (auto &v : other) {
+          append__(mstl::move(v));
+        }
+        other.clear();
+      }
+    }
+    return *this;
+  }
+
+  tree__ &operator=(std::initializer_list<value_type> il) {
+    clear();
+    insert(il);
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept { return alloc__(); }
+  key_compare key_comp() const { return comp__(); }
+
+  /*
+   * iterators
+   */
+  iterator begin() noexcept { return iterator(leftmost_, 0); }
+  const_iterator begin() const noexcept { return const_iterator(leftmost_, 0); }
+  const_iterator cbegin() const noexcept { return begin(); }
+
+  iterator end() noexcept {
+    return iterator(rightmost_, rightmost_ ? rightmost_->count : 0);
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(rightmost_, rightmost_ ? rightmost_->count : 0);
+  }
+  const_iterator cend() const noexcept { return end(); }
+
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  /*
+   * capacity
+   */
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  size_type max_size() const noexcept {
+    return alloc_traits__::max_size(alloc__());
+  }
+
+  // levels from the root down to the leaves, 0 when empty.
+  size_type height() const noexcept {
+    size_type h = 0;
+    for (node_type__ *n = root_; n != nullptr;
+         n = n->leaf ? nullptr : child__(n, 0)) {
+      ++h;
+    }
+    return h;
+  }
+
+  /*
+   * modifiers
+   */
+  void clear() noexcept {
+    if (root_ != nullptr) {
+      destroy_subtree__(root_);
+    }
+    root_ = leftmost_ = rightmost_ = nullptr;
+    size_ = 0;
+  }
+
+  mstl::pair<iterator, bool> insert(const value_type &v) {
+    return insert_unique__(Policy::key(v), v);
+  }
+
+  mstl::pair<iterator, bool> insert(value_type &&v) {
+    return insert_unique__(Policy::key(v), mstl::move(v));
+  }
+
+  iterator insert(const_iterator hint, const value_type &v) {
+    return insert_hint__(hint, Policy::key(v), v).first;
+  }
+
+  iterator insert(const_iterator hint, value_type &&v) {
+    return insert_hint__(hint, Policy::key(v), mstl::move(v)).first;
+  }
+
+  // every element is tried at the end first, so sorted input goes in
+  // without a search and packs the nodes, like the sorted_unique
+  // constructor.
+  template <typename InputIt> void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(cend(), value_type(*first));
+    }
+  }
+
+  void insert(std::initializer_list<value_type> il) {
+    insert(il.begin(), il.end());
+  }
+
+  template <typename... Args>
+  mstl::pair<iterator, bool> emplace(Args &&...args) {
+    value_type v(mstl::forward<Args>(args)...);
+    return insert_unique__(Policy::key(v), mstl::move(v));
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args &&...args) {
+    value_type v(mstl::forward<Args>(args)...);
+    return insert_hint__(hint, Policy::key(v), mstl::move(v)).first;
+  }
+
+  iterator erase(const_iterator pos) {
+    iterator it(pos.node_, pos.position_);
+    bool internal_delete = !it.node_->leaf;
+    alloc_traits__::destroy(alloc__(), it.slot__());
+    if (internal_delete) {
+      // fill the hole with the previous element, the last one of a leaf.
+      iterator hole = it;
+      --it;
+      relocate__(hole.slot__(), it.slot__(), 1);
+    } else {
+      relocate__(it.slot__(), it.slot__() + 1,
+                 it.node_->count - it.position_ - 1);
+    }
+    --it.node_->count;
+    --size_;
+
+    iterator res = rebalance_after_erase__(it);
+    // the erased element's successor is now right after the moved one.
+    if (internal_delete) {
+      ++res;
+    }
+    return res;
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first == cbegin() && last == cend()) {
+      clear();
+      return end();
+    }
+    // erasing moves elements around, so count instead of comparing with
+    // last.
+    size_type n = static_cast<size_type>(mstl::distance(first, last));
+    iterator it(first.node_, first.position_);
+    for (; n > 0; --n) {
+      it = erase(it);
+    }
+    return it;
+  }
+
+  template <typename K = key_type> size_type erase(const key_arg<K> &key) {
+    iterator it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    erase(it);
+    return 1;
+  }
+
+  void swap(tree__ &other) noexcept {
+    if constexpr (alloc_traits__::propagate_on_container_swap::value) {
+      swap__(alloc__(), other.alloc__());
+    }
+    swap__(comp__(), other.comp__());
+    swap__(root_, other.root_);
+    swap__(leftmost_, other.leftmost_);
+    swap__(rightmost_, other.rightmost_);
+    swap__(size_, other.size_);
+  }
+
+  /*
+   * lookup
+   */
+
+  // stops as soon as it sees the key, it doesn't have to reach a leaf.
+  template <typename K = key_type> iterator find(const key_arg<K> &key) {
+    for (node_type__ *node = root_; node != nullptr;) {
+      size_t i = node_lower_bound__(node, key);
+      if (i < node->count && !comp__()(key, Policy::key(*node->slot(i)))) {
+        return iterator(node, i);
+      }
+      node = node->leaf ? nullptr : child__(node, i);
+    }
+    return end();
+  }
+
+  template <typename K = key_type>
+  const_iterator find(const key_arg<K> &key) const {
+    return const_cast<tree__ *>(this)->find(key);
+  }
+
+  template <typename K = key_type>
+  bool contains(const key_arg<K> &key) const {
+    return find(key) != end();
+  }
+
+  template <typename K = key_type>
+  size_type count(const key_arg<K> &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  // first element not less than key.
+  template <typename K = key_type>
+  iterator lower_bound(const key_arg<K> &key) {
+    return bound__(key, [this](const value_type &v, const K &k) {
+      return !comp__()(Policy::key(v), k);
+    });
+  }
+
+  template <typename K = key_type>
+  const_iterator lower_bound(const key_arg<K> &key) const {
+    return const_cast<tree__ *>(this)->lower_bound(key);
+  }
+
+  // first element greater than key.
+  template <typename K = key_type>
+  iterator upper_bound(const key_arg<K> &key) {
+    return bound__(key, [this](const value_type &v, const K &k) {
+      return comp__()(k, Policy::key(v));
+    });
+  }
+
+  template <typename K = key_type>
+  const_iterator upper_bound(const key_arg<K> &key) const {
+    return const_cast<tree__ *>(this)->upper_bound(key);
+  }
+
+  template <typename K = key_type>
+  mstl::pair<iterator, iterator> equal_range(const key_arg<K> &key) {
+    iterator it = lower_bound(key);
+    if (it == end() || comp__()(key, Policy::key(*it))) {
+      return {it, it};
+    }
+    iterator next = it;
+    return {it, ++next};
+  }
+
+  template <typename K = key_type>
+  mstl::pair<const_iterator, const_iterator>
+  equal_range(const key_arg<K> &key) const {
+    auto r = const_cast<tree__ *>(this)->equal_range(key);
+    return {r.first, r.second};
+  }
+
+protected:
+  // the leaf slot where key belongs, or the element with an equal key.
+  // Every element passed on the way down is compared, so reaching a leaf
+  // without a match means the key is new.
+  template <typename K>
+  mstl::pair<iterator, bool> find_insert_position__(const K &key) {
+    node_type__ *node = root_;
+    while (true) {
+      size_t i = node_lower_bound__(node, key);
+      if (i < node->count && !comp__()(key, Policy::key(*node->slot(i)))) {
+        return {iterator(node, i), false};
+      }
+      if (node->leaf) {
+        return {iterator(node, i), true};
+      }
+      node = child__(node, i);
+    }
+  }
+
+  template <typename K, typename... Args>
+  mstl::pair<iterator, bool> insert_unique__(const K &key, Args &&...args) {
+    if (root_ == nullptr) {
+      return {emplace_at__(iterator(), mstl::forward<Args>(args)...), true};
+    }
+    auto r = find_insert_position__(key);
+    if (!r.second) {
+      return r;
+    }
+    return {emplace_at__(r.first, mstl::forward<Args>(args)...), true};
+  }
+
+  // right before hint if that's where key goes, else a normal insert.
+  template <typename K, typename... Args>
+  mstl::pair<iterator, bool> insert_hint__(const_iterator hint, const K &key,
+                                           Args &&...args) {
+    iterator pos(hint.node_, hint.position_);
+    if (root_ != nullptr &&
+        (pos == end() || comp__()(key, Policy::key(*pos)))) {
+      iterator prev = pos;
+      if (pos == begin() || comp__()(Policy::key(*--prev), key)) {
+        return {emplace_at__(pos, mstl::forward<Args>(args)...), true};
+      }
+    }
+    return insert_unique__(key, mstl::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  iterator emplace_at__(iterator pos, Args &&...args) {
+    if (root_ == nullptr) {
+      root_ = leftmost_ = rightmost_ = new_node__(true);
+      pos = iterator(root_, 0);
+    }
+    // new elements only go in leaves: in front of an internal element is
+    // right after the last element of its left subtree.
+    if (!pos.node_->leaf) {
+      --pos;
+      ++pos.position_;
+    }
+    if (pos.node_->count == node_slots) {
+      split__(pos);
+    }
+    node_type__ *node = pos.node_;
+    relocate__(node->slot(pos.position_ + 1), node->slot(pos.position_),
+               node->count - pos.position_);
+    try {
+      alloc_traits__::construct(alloc__(), node->slot(pos.position_),
+                                mstl::forward<Args>(args)...);
+    } catch (...) {
+      relocate__(node->slot(pos.position_), node->slot(pos.position_ + 1),
+                 node->count - pos.position_);
+      throw;
+    }
+    ++node->count;
+    ++size_;
+    return pos;
+  }
+
+  // append an element known to be greater than everything in the tree.
+  template <typename... Args> void append__(Args &&...args) {
+    emplace_at__(end(), mstl::forward<Args>(args)...);
+  }
+
+  Compare &comp__() noexcept { return fns_.first(); }
+  const Compare &comp__() const noexcept { return fns_.first(); }
+
+private:
+  template <typename T> static void swap__(T &a, T &b) {
+    T tmp(mstl::move(a));
+    a = mstl::move(b);
+    b = mstl::move(tmp);
+  }
+
+  Alloc &alloc__() noexcept { return fns_.second(); }
+  const Alloc &alloc__() const noexcept { return fns_.second(); }
+
+  internal_type__ *as_internal__(node_type__ *node) const noexcept {
+    return static_cast<internal_type__ *>(node);
+  }
+
+  // binary search inside one node, first i with !comp(slot i, key).
+  template <typename K>
+  size_t node_lower_bound__(node_type__ *node, const K &key) const {
+    size_t lo = 0, n = node->count;
+    while (n > 0) {
+      size_t half = n / 2;
+      if (comp__()(Policy::key(*node->slot(lo + half)), key)) {
+        lo += half + 1;
+        n -= half + 1;
+      } else {
+        n = half;
+      }
+    }
+    return lo;
+  }
+
+  // descend to the leaf where pred first holds, then step over the end of
+  // the node if the answer is in an ancestor.
+  template <typename K, typename Pred>
+  iterator bound__(const K &key, Pred pred) {
+    if (root_ == nullptr) {
+      return end();
+    }
+    node_type__ *node = root_;
+    while (true) {
+      size_t lo = 0, n = node->count;
+      while (n > 0) {
+        size_t half = n / 2;
+        if (!pred(*node->slot(lo + half), key)) {
+          lo += half + 1;
+          n -= half + 1;
+        } else {
+          n = half;
+        }
+      }
+      if (node->leaf) {
+        iterator it(node, lo);
+        if (lo == node->count) {
+          while (it.position_ == it.node_->count &&
+                 it.node_->parent != nullptr) {
+            it.position_ = it.node_->position;
+            it.node_ = it.node_->parent;
+          }
+          if (it.position_ == it.node_->count) {
+            return end();
+          }
+        }
+        return it;
+      }
+      node = child__(node, lo);
+    }
+  }
+
+  /*
+   * nodes
+   */
+  node_type__ *new_node__(bool leaf) {
+    node_type__ *node;
+    if (leaf) {
+      leaf_alloc__ a(alloc__());
+      node = ::new (static_cast<void *>(
+          mstl::allocator_traits<leaf_alloc__>::allocate(a, 1))) node_type__;
+    } else {
+      internal_alloc__ a(alloc__());
+      node = ::new (static_cast<void *>(
+          mstl::allocator_traits<internal_alloc__>::allocate(a, 1)))
+          internal_type__;
+    }
+    node->parent = nullptr;
+    node->position = 0;
+    node->count = 0;
+    node->leaf = leaf;
+    return node;
+  }
+
+  // the elements must be gone already.
+  void delete_node__(node_type__ *node) noexcept {
+    if (node->leaf) {
+      leaf_alloc__ a(alloc__());
+      mstl::allocator_traits<leaf_alloc__>::deallocate(a, node, 1);
+    } else {
+      internal_alloc__ a(alloc__());
+      mstl::allocator_traits<internal_alloc__>::deallocate(
+          a, as_internal__(node), 1);
+    }
+  }
+
+  void destroy_subtree__(node_type__ *node) noexcept {
+    if (!node->leaf) {
+      for (size_t i = 0; i <= node->count; ++i) {
+        destroy_subtree__(child__(node, i));
+      }
+    }
+    if constexpr (!mstl::is_trivially_destructible<value_type>::value ||
+                  allocator_traits_UTILL::has_destroy__<Alloc,
+                                                        value_type>::value) {
+      for (size_t i = 0; i < node->count; ++i) {
+        alloc_traits__::destroy(alloc__(), node->slot(i));
+      }
+    }
+    delete_node__(node);
+  }
+
+  void set_child__(node_type__ *parent, size_t i,
+                   node_type__ *child) noexcept {
+    as_internal__(parent)->children[i] = child;
+    child->parent = as_internal__(parent);
+    child->position = static_cast<uint16_t>(i);
+  }
+
+  // move n children from src[s] to dst[d], ranges may overlap inside one
+  // node.
+  void move_children__(node_type__ *dst, size_t d, node_type__ *src,
+                       size_t s, size_t n) noexcept {
+    if (dst == src && d > s) {
+      for (size_t i = n; i > 0; --i) {
+        set_child__(dst, d + i - 1, child__(src, s + i - 1));
+      }
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        set_child__(dst, d + i, child__(src, s + i));
+      }
+    }
+  }
+
+  // Move n elements from src to dst and end the old ones. The ranges may
+  // overlap. Trivially relocatable elements move as bytes.
+  void relocate__(value_type *dst, value_type *src, size_t n) noexcept {
+    if (n == 0 || dst == src) {
+      return;
+    }
+    if constexpr (relocatable__) {
+      memmove(static_cast<void *>(dst), static_cast<const void *>(src),
+              n * sizeof(value_type));
+    } else if (dst < src) {
+      for (size_t i = 0; i < n; ++i) {
+        Policy::transfer(alloc__(), dst + i, src + i);
+      }
+    } else {
+      for (size_t i = n; i > 0; --i) {
+        Policy::transfer(alloc__(), dst + i - 1, src + i - 1);
+      }
+    }
+  }
+
+  // Split the full node pos points into and fix pos to where the new
+  // element goes. Appending at the end of a node moves nothing to the new
+  // sibling, prepending moves everything, in the middle it's half and
+  // half.
+  void split__(iterator &pos) {
+    node_type__ *node = pos.node_;
+    if (node->parent == nullptr) {
+      node_type__ *root = new_node__(false);
+      set_child__(root, 0, node);
+      root_ = root;
+    } else if (node->parent->count == node_slots) {
+      iterator parent_pos(node->parent, node->position);
+      split__(parent_pos);
+    }
+    node_type__ *parent = node->parent;
+
+    size_t to_move = pos.position_ == 0            ? node->count - 1
+                     : pos.position_ == node_slots ? 0
+                                                   : node->count / 2;
+    // if this throws the tree is still fine, a root with no elements and
+    // one child is undone by the next erase.
+    node_type__ *sibling = new_node__(node->leaf);
+    size_t keep = node->count - to_move;
+    relocate__(sibling->slot(0), node->slot(keep), to_move);
+    if (!node->leaf) {
+      move_children__(sibling, 0, node, keep, to_move + 1);
+    }
+    sibling->count = static_cast<uint16_t>(to_move);
+    node->count = static_cast<uint16_t>(keep - 1);
+
+    // the element left at the end of node goes up between the two.
+    size_t p = node->position;
+    relocate__(parent->slot(p + 1), parent->slot(p), parent->count - p);
+    relocate__(parent->slot(p), node->slot(node->count), 1);
+    move_children__(parent, p + 2, parent, p + 1, parent->count - p);
+    set_child__(parent, p + 1, sibling);
+    ++parent->count;
+
+    if (rightmost_ == node) {
+      rightmost_ = sibling;
+    }
+    if (pos.position_ > node->count) {
+      pos.node_ = sibling;
+      pos.position_ -= node->count + 1;
+    }
+  }
+
+  // Walk up from the node that lost an element, merging or borrowing
+  // while nodes are under half full. Returns where the element after the
+  // erased one is now.
+  iterator rebalance_after_erase__(iterator it) {
+    iterator res = it;
+    bool first = true;
+    while (true) {
+      if (it.node_ == root_) {
+        shrink_root__();
+        if (empty()) {
+          return end();
+        }
+        break;
+      }
+      if (it.node_->count >= min_values__) {
+        break;
+      }
+      bool merged = merge_or_rebalance__(it);
+      if (first) {
+        res = it;
+        first = false;
+      }
+      if (!merged) {
+        break;
+      }
+      it.position_ = it.node_->position;
+      it.node_ = it.node_->parent;
+    }
+    if (res.position_ == res.node_->count) {
+      res.position_ = res.node_->count - 1;
+      ++res;
+    }
+    return res;
+  }
+
+  bool merge_or_rebalance__(iterator &it) {
+    node_type__ *node = it.node_;
+    node_type__ *parent = node->parent;
+    if (node->position > 0) {
+      node_type__ *left = child__(parent, node->position - 1);
+      if (1u + left->count + node->count <= node_slots) {
+        it.position_ += 1 + left->count;
+        merge__(left, node);
+        it.node_ = left;
+        return true;
+      }
+    }
+    if (node->position < parent->count) {
+      node_type__ *right = child__(parent, node->position + 1);
+      if (1u + node->count + right->count <= node_slots) {
+        merge__(node, right);
+        return true;
+      }
+      // Deleting from the front over and over is common (a queue, an
+      // expiry index), don't shuffle elements back for it.
+      if (right->count > min_values__ &&
+          (node->count == 0 || it.position_ > 0)) {
+        size_t to_move = (right->count - node->count) / 2;
+        if (to_move > right->count - 1u) {
+          to_move = right->count - 1u;
+        }
+        rebalance_right_to_left__(node, right, to_move);
+        return false;
+      }
+    }
+    if (node->position > 0) {
+      // and the same for deleting from the back.
+      node_type__ *left = child__(parent, node->position - 1);
+      if (left->count > min_values__ &&
+          (node->count == 0 || it.position_ < node->count)) {
+        size_t to_move = (left->count - node->count) / 2;
+        if (to_move > left->count - 1u) {
+          to_move = left->count - 1u;
+        }
+        rebalance_left_to_right__(left, node, to_move);
+        it.position_ += to_move;
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // right and the separator between them go into left, right goes away.
+  void merge__(node_type__ *left, node_type__ *right) noexcept {
+    node_type__ *parent = left->parent;
+    size_t p = left->position;
+    relocate__(left->slot(left->count), parent->slot(p), 1);
+    relocate__(left->slot(left->count + 1), right->slot(0), right->count);
+    if (!left->leaf) {
+      move_children__(left, left->count + 1, right, 0, right->count + 1u);
+    }
+    left->count = static_cast<uint16_t>(left->count + 1 + right->count);
+
+    relocate__(parent->slot(p), parent->slot(p + 1), parent->count - p - 1);
+    move_children__(parent, p + 1, parent, p + 2, parent->count - p - 1);
+    --parent->count;
+
+    if (rightmost_ == right) {
+      rightmost_ = left;
+    }
+    delete_node__(right);
+  }
+
+  // the separator comes down into node, right's first elements go up.
+  void rebalance_right_to_left__(node_type__ *node, node_type__ *right,
+                                 size_t n) noexcept {
+    node_type__ *parent = node->parent;
+    size_t p = node->position;
+    relocate__(node->slot(node->count), parent->slot(p), 1);
+    relocate__(node->slot(node->count + 1), right->slot(0), n - 1);
+    relocate__(parent->slot(p), right->slot(n - 1), 1);
+    relocate__(right->slot(0), right->slot(n), right->count - n);
+    if (!node->leaf) {
+      move_children__(node, node->count + 1, right, 0, n);
+      move_children__(right, 0, right, n, right->count - n + 1);
+    }
+    node->count = static_cast<uint16_t>(node->count + n);
+    right->count = static_cast<uint16_t>(right->count - n);
+  }
+
+  void rebalance_left_to_right__(node_type__ *left, node_type__ *node,
+                                 size_t n) noexcept {
+    node_type__ *parent = node->parent;
+    size_t p = left->position;
+    relocate__(node->slot(n), node->slot(0), node->count);
+    relocate__(node->slot(n - 1), parent->slot(p), 1);
+    relocate__(node->slot(0), left->slot(left->count - n + 1), n - 1);
+    relocate__(parent->slot(p), left->slot(left->count - n), 1);
+    if (!node->leaf) {
+      move_children__(node, n, node, 0, node->count + 1u);
+      move_children__(node, 0, left, left->count - n + 1, n);
+    }
+    left->count = static_cast<uint16_t>(left->count - n);
+    node->count = static_cast<uint16_t>(node->count + n);
+  }
+
+  // an empty root goes away, its only child takes over.
+  void shrink_root__() noexcept {
+    node_type__ *root = root_;
+    if (root->count > 0) {
+      return;
+    }
+    if (root->leaf) {
+      root_ = leftmost_ = rightmost_ = nullptr;
+    } else {
+      root_ = child__(root, 0);
+      root_->parent = nullptr;
+      root_->position = 0;
+    }
+    delete_node__(root);
+  }
+
+  // appending in order packs the copy as tight as it gets.
+  void copy_from__(const tree__ &other) {
+    try {
+      for (const auto &v : other) {
+        append__(v);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  void steal__(tree__ &other) noexcept {
+    root_ = other.root_;
+    leftmost_ = other.leftmost_;
+    rightmost_ = other.rightmost_;
+    size_ = other.size_;
+    other.root_ = other.leftmost_ = other.rightmost_ = nullptr;
+    other.size_ = 0;
+  }
+};
+
+template <typename P, typename C, typename A, size_t N>
+bool operator==(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  if (x.size() != y.size()) {
+    return false;
+  }
+  for (auto i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+    if (!(*i == *j)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename P, typename C, typename A, size_t N>
+bool operator!=(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  return !(x == y);
+}
+
+template <typename P, typename C, typename A, size_t N>
+bool operator<(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  auto i = x.begin(), j = y.begin();
+  for (; i != x.end() && j != y.end(); ++i, ++j) {
+    if (*i < *j) {
+      return true;
+    }
+    if (*j < *i) {
+      return false;
+    }
+  }
+  return i == x.end() && j != y.end();
+}
+
+template <typename P, typename C, typename A, size_t N>
+bool operator>(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  return y < x;
+}
+
+template <typename P, typename C, typename A, size_t N>
+bool operator<=(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  return !(y < x);
+}
+
+template <typename P, typename C, typename A, size_t N>
+bool operator>=(const tree__<P, C, A, N> &x, const tree__<P, C, A, N> &y) {
+  return !(x < y);
+}
+
+} // namespace mstl::btree_UTILL
+
+namespace mstl {
+
+// Ordered set on a B-tree, see the top of the file. NodeBytes is the size
+// a node aims for. Bigger nodes make the tree shallower and scans faster,
+// but inserts shift more elements.
+// With a transparent Compare (mstl::less<>) lookups take any type the
+// comparator accepts.
+template <typename K, typename Compare = mstl::less<K>,
+          typename Alloc = mstl::allocator<K>, size_t NodeBytes = 256>
+class btree_set
+    : public btree_UTILL::tree__<btree_UTILL::set_policy__<K>, Compare,
+                                 Alloc, NodeBytes> {
+  using base__ = btree_UTILL::tree__<btree_UTILL::set_policy__<K>, Compare,
+                                     Alloc, NodeBytes>;
+
+public:
+  using base__::base__;
+
+  btree_set() = default;
+  btree_set(std::initializer_list<K> il, const Compare &comp = Compare(),
+            const Alloc &a = Alloc())
+      : base__(il, comp, a) {}
+
+  btree_set &operator=(std::initializer_list<K> il) {
+    base__::operator=(il);
+    return *this;
+  }
+};
+
+// Ordered map on a B-tree. Same rules as btree_set, and like every
+// B-tree, insert and erase invalidate iterators to other elements.
+template <typename K, typename V, typename Compare = mstl::less<K>,
+          typename Alloc = mstl::allocator<mstl::pair<const K, V>>,
+          size_t NodeBytes = 256>
+class btree_map
+    : public btree_UTILL::tree__<btree_UTILL::map_policy__<K, V>, Compare,
+                                 Alloc, NodeBytes> {
+  using base__ = btree_UTILL::tree__<btree_UTILL::map_policy__<K, V>,
+                                     Compare, Alloc, NodeBytes>;
+
+public:
+  using mapped_type = V;
+  using typename base__::const_iterator;
+  using typename base__::iterator;
+  using typename base__::value_type;
+  template <typename Q> using key_arg = typename base__::template key_arg<Q>;
+
+  using base__::base__;
+
+  btree_map() = default;
+  btree_map(std::initializer_list<value_type> il,
+            const Compare &comp = Compare(), const Alloc &a = Alloc())
+      : base__(il, comp, a) {}
+
+  btree_map &operator=(std::initializer_list<value_type> il) {
+    base__::operator=(il);
+    return *this;
+  }
+
+  // construct the value only if the key is new.
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(const K &key, Args &&...args) {
+    return try_emplace__(key, mstl::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+    return try_emplace__(mstl::move(key), mstl::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(const K &key, M &&value) {
+    return insert_or_assign__(key, mstl::forward<M>(value));
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(K &&key, M &&value) {
+    return insert_or_assign__(mstl::move(key), mstl::forward<M>(value));
+  }
+
+  V &operator[](const K &key) { return try_emplace(key).first->second; }
+  V &operator[](K &&key) {
+    return try_emplace(mstl::move(key)).first->second;
+  }
+
+  template <typename Q = K> V &at(const key_arg<Q> &key) {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw mstl::exception();
+    }
+    return it->second;
+  }
+
+  template <typename Q = K> const V &at(const key_arg<Q> &key) const {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw mstl::exception();
+    }
+    return it->second;
+  }
+
+private:
+  template <typename KK, typename... Args>
+  mstl::pair<iterator, bool> try_emplace__(KK &&key, Args &&...args) {
+    if (this->empty()) {
+      return {this->emplace_at__(this->end(), mstl::forward<KK>(key),
+                                 V(mstl::forward<Args>(args)...)),
+              true};
+    }
+    auto r = this->find_insert_position__(key);
+    if (!r.second) {
+      return r;
+    }
+    return {this->emplace_at__(r.first, mstl::forward<KK>(key),
+                               V(mstl::forward<Args>(args)...)),
+            true};
+  }
+
+  template <typename KK, typename M>
+  mstl::pair<iterator, bool> insert_or_assign__(KK &&key, M &&value) {
+    auto r = try_emplace__(mstl::forward<KK>(key), mstl::forward<M>(value));
+    if (!r.second) {
+      r.first->second = mstl::forward<M>(value);
+    }
+    return r;
+  }
+};
+
+template <typename K, typename C, typename A, size_t N>
+void swap(btree_set<K, C, A, N> &x, btree_set<K, C, A, N> &y) noexcept {
+  x.swap(y);
+}
+
+template <typename K, typename V, typename C, typename A, size_t N>
+void swap(btree_map<K, V, C, A, N> &x, btree_map<K, V, C, A, N> &y) noexcept {
+  x.swap(y);
+}
+
+} // namespace mstl
@@ -0,0 +1,175 @@
+#pragma once
+#include "mtype_traits.hpp"
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Bits shared by the concurrent containers: cache line padding, the spin
+// loop hint, and wait strategies for when there's nothing to do.
+namespace mstl::concurrency_UTILL {
+
+// two atomics written by different threads must not share a line, or
+// every write by one thread steals the line from the other (false
+// sharing). Some cpus prefetch lines in pairs, but 64 is what matters on
+// x86 and most arm cores.
+constexpr size_t cache_line__ = 64;
+
+// tell the cpu we're spinning: it saves power and doesn't flood the memory
+// pipeline with speculative loads of the same line.
+inline void cpu_relax__() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// how many times to poll before a blocking strategy goes to sleep. Most
+// waits are short and a syscall costs more than the wait itself.
+constexpr int spin_before_sleep__ = 128;
+
+} // namespace mstl::concurrency_UTILL
+
+namespace mstl {
+
+// Wait strategies, what a thread does while a queue is full or empty.
+//
+//   spin_wait   burn the core polling. Lowest latency, only for threads
+//               pinned to their own cores.
+//   yield_wait  poll, but give the core to other threads in between.
+//   futex_wait  poll for a moment, then sleep in the kernel until woken.
+//               The other side pays an extra fence per operation to check
+//               for sleepers, and a syscall only when there are some.
+//
+// Non blocking strategies only provide pause(). Blocking ones wait on a
+// 32 bit word instead: wait(word, old) sleeps while word == old, and
+// wake_all(word) wakes the sleepers after the word changed, wake_one(word)
+// one of them.
+struct spin_wait {
+  static constexpr bool blocking = false;
+  static void pause() noexcept { concurrency_UTILL::cpu_relax__(); }
+};
+
+struct yield_wait {
+  static constexpr bool blocking = false;
+  static void pause() noexcept { std::this_thread::yield(); }
+};
+
+struct futex_wait {
+  static constexpr bool blocking = true;
+
+  static void wait(std::atomic<uint32_t> &word, uint32_t old) noexcept {
+#ifdef __linux__
+    static_assert(sizeof(word) == sizeof(uint32_t), "futex needs 32 bits");
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word),
+            FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+#else
+    while (word.load(std::memory_order_acquire) == old) {
+      std::this_thread::yield();
+    }
+#endif
+  }
+
+  static void wake_all(std::atomic<uint32_t> &word) noexcept {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word),
+            FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+  }
+
+  static void wake_one(std::atomic<uint32_t> &word) noexcept {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word),
+            FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+  }
+};
+
+} // namespace mstl
+
+namespace mstl::concurrency_UTILL {
+
+// "Something changed" signal for one side of a queue, e.g. not empty.
+// With a non blocking strategy it's empty and notify() is a no-op.
+template <typename Wait, bool = Wait::blocking> struct event__ {
+  template <typename Ready> void wait_until(Ready ready) {
+    while (!ready()) {
+      Wait::pause();
+    }
+  }
+  void notify() noexcept {}
+  void notify_one() noexcept {}
+};
+
+// The sleeper registers itself, then checks the condition once more before
+// sleeping, the notifier publishes its change and then checks for sleepers.
+// The two seq_cst fences in the middle guarantee that at least one side
+// sees the other, so a wake up is never lost:
+//
+//   waiter: waiters++  | seq_cst fence |  check ready, sleep on epoch
+//   notifier: publish  | seq_cst fence |  waiters? -> epoch++, wake
+//
+// and if the epoch moves between the check and the sleep, the futex sees
+// a different value and returns at once.
+template <typename Wait> struct event__<Wait, true> {
+  alignas(cache_line__) std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+
+  template <typename Ready> void wait_until(Ready ready) {
+    for (int i = 0; i < spin_before_sleep__; ++i) {
+      if (ready()) {
+        return;
+      }
+      cpu_relax__();
+    }
+    for (;;) {
+      waiters_.fetch_add(1, std::memory_order_seq_cst);
+      // ready() loads with acquire at most, so the increment alone doesn't
+      // order them against the notifier's fence. This fence does.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      uint32_t e = epoch_.load(std::memory_order_seq_cst);
+      if (ready()) {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+      Wait::wait(epoch_, e);
+      waiters_.fetch_sub(1, std::memory_order_relaxed);
+      if (ready()) {
+        return;
+      }
+    }
+  }
+
+  void notify() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) != 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      Wait::wake_all(epoch_);
+    }
+  }
+
+  // wake a single sleeper, for a change only one thread can act on. The
+  // ones between registering and sleeping see the epoch move and don't
+  // sleep, so nobody who should have seen the change misses it.
+  void notify_one() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) != 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      Wait::wake_one(epoch_);
+    }
+  }
+};
+
+} // namespace mstl::concurrency_UTILL
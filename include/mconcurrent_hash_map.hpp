@@ -0,0 +1,700 @@
+#pragma once
+#include "mconcurrency.hpp"
+#include "mfunctional.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+// Hash map for many threads at once.
+//
+// The map is split into shards by the hash, and each shard is a small
+// linear probing table with its own lock. Two writers only contend when
+// they hit the same shard, and with a few shards per core that's rare.
+//
+//   hash:    [ . | shard | ............ slot ............ ]
+//   shards:  [ lock seq table ] [ lock seq table ] ...   one cache line
+//                                                        of header each
+//
+// Reads don't lock at all when both K and V are trivially copyable (ids,
+// counters, small structs). Each shard has a sequence number that writers
+// make odd while they change the table and even again when they are done.
+// A reader notes the number, copies what it's looking for, and checks the
+// number didn't move: if it did, it retries. The table itself is read and
+// written word by word with relaxed atomics, so a torn copy is detected,
+// never a data race. A reader that keeps losing falls back to the shard
+// lock. Other types are read under a shared lock.
+//
+// Growing a shard doesn't stop it. The shard gets a table twice the size
+// and every following write moves a few slots over from the old one;
+// lookups check both until the old one is empty. Erase shifts the
+// following elements back instead of leaving tombstones, so tables only
+// ever grow.
+//
+// note: a lock free reader may still be looking at a table that was just
+// migrated away from, so old tables are only freed by the destructor.
+// They halve in size going back, so together they take less memory than
+// the current tables.
+//
+// note: the callbacks of visit, update and upsert run under the shard lock.
+// They must not touch the map.
+namespace mstl::concurrent_hash_UTILL {
+
+// the hash word of a slot. A full slot stores the hash with the top bit
+// set, so it's never confused with the two markers.
+constexpr uint64_t empty__ = 0;
+constexpr uint64_t moved__ = 1; // only in a table being migrated away from
+constexpr uint64_t full_bit__ = uint64_t(1) << 63;
+
+template <typename T> constexpr size_t words__ = (sizeof(T) + 7) / 8;
+
+template <typename T> struct slot__ {
+  std::atomic<uint64_t> hash{empty__};
+  alignas(alignof(T) > 8 ? alignof(T) : 8) uint64_t words[words__<T>];
+
+  T *get() noexcept { return reinterpret_cast<T *>(words); }
+};
+
+template <typename T> struct table__ {
+  slot__<T> *slots;
+  size_t mask;
+  size_t size;
+  table__ *retired; // next in the shard's list of old tables
+};
+
+template <typename T> struct alignas(concurrency_UTILL::cache_line__) shard__ {
+  std::atomic<uint32_t> seq{0};
+  std::atomic<table__<T> *> cur{nullptr};
+  std::atomic<table__<T> *> old{nullptr};
+  size_t migrated = 0; // old slots before this one are moved already
+  std::atomic<size_t> size{0};
+  table__<T> *retired = nullptr;
+  mutable std::shared_mutex lock;
+};
+
+// Copy a trivially copyable object in or out of a slot with relaxed
+// atomic word accesses, see the top of the file.
+template <typename T>
+void load_words__(const uint64_t *src, unsigned char *dst) noexcept {
+  uint64_t buf[words__<T>];
+  for (size_t i = 0; i < words__<T>; ++i) {
+    buf[i] = __atomic_load_n(src + i, __ATOMIC_RELAXED);
+  }
+  memcpy(dst, buf, sizeof(T));
+}
+
+template <typename T> void store_words__(uint64_t *dst, const T &src) noexcept {
+  uint64_t buf[words__<T>] = {};
+  memcpy(buf, &src, sizeof(T));
+  for (size_t i = 0; i < words__<T>; ++i) {
+    __atomic_store_n(dst + i, buf[i], __ATOMIC_RELAXED);
+  }
+}
+
+constexpr size_t min_capacity__ = 16;
+
+// every write moves this many slots of an old table.
+constexpr size_t migrate_batch__ = 32;
+
+// lock free attempts before a reader takes the lock.
+constexpr int optimistic_retries__ = 16;
+
+// up to 3/4 full, linear probing gets slow beyond that.
+constexpr size_t max_load__(size_t capacity) noexcept {
+  return capacity - capacity / 4;
+}
+
+} // namespace mstl::concurrent_hash_UTILL
+
+namespace mstl {
+
+template <typename K, typename V, typename Hash = mstl::hash<K>,
+          typename Eq = mstl::equal_to<K>,
+          typename Alloc = mstl::allocator<mstl::pair<K, V>>>
+class concurrent_hash_map {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = mstl::pair<K, V>;
+  using size_type = size_t;
+  using hasher = Hash;
+  using key_equal = Eq;
+  using allocator_type = Alloc;
+
+  // true when lookups don't lock.
+  static constexpr bool lock_free_reads =
+      mstl::is_trivially_copyable<K>::value &&
+      mstl::is_trivially_copyable<V>::value;
+
+private:
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Hash>::value &&
+      functional_UTILL::is_transparent__<Eq>::value;
+
+  using slot_type__ = concurrent_hash_UTILL::slot__<value_type>;
+  using table_type__ = concurrent_hash_UTILL::table__<value_type>;
+  using shard_type__ = concurrent_hash_UTILL::shard__<value_type>;
+
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+  using slot_alloc__ =
+      typename alloc_traits__::template rebind_alloc<slot_type__>;
+  using table_alloc__ =
+      typename alloc_traits__::template rebind_alloc<table_type__>;
+  using shard_alloc__ =
+      typename alloc_traits__::template rebind_alloc<shard_type__>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::value_type,
+                              value_type>::value,
+                "Alloc::value_type must be the map's value_type");
+
+  // a copy of an element, for the lock free paths.
+  struct copy__ {
+    alignas(value_type) unsigned char bytes[sizeof(value_type)];
+    value_type &get() noexcept {
+      return *reinterpret_cast<value_type *>(bytes);
+    }
+  };
+
+  using eq_alloc__ = memory_UTIL::compressed_pair__<Eq, Alloc>;
+
+  shard_type__ *shards_;
+  size_t shard_mask_;
+  memory_UTIL::compressed_pair__<Hash, eq_alloc__> fns_;
+
+public:
+  template <typename Q>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<Q, key_type>;
+
+  // shards = 0 picks a few per hardware thread. It's rounded up to a
+  // power of two.
+  explicit concurrent_hash_map(size_type shards = 0,
+                               const Hash &hash = Hash(), const Eq &eq = Eq(),
+                               const Alloc &a = Alloc())
+      : shards_(nullptr), shard_mask_(0),
+        fns_(hash, eq_alloc__(eq, a)) {
+    if (shards == 0) {
+      shards = 4 * size_t(std::thread::hardware_concurrency());
+    }
+    size_t n = 8;
+    while (n < shards && n < (size_t(1) << 15)) {
+      n <<= 1;
+    }
+    shard_alloc__ sa(alloc__());
+    shards_ = mstl::allocator_traits<shard_alloc__>::allocate(sa, n);
+    for (size_t i = 0; i < n; ++i) {
+      mstl::allocator_traits<shard_alloc__>::construct(sa, shards_ + i);
+    }
+    shard_mask_ = n - 1;
+  }
+
+  concurrent_hash_map(const concurrent_hash_map &) = delete;
+  concurrent_hash_map &operator=(const concurrent_hash_map &) = delete;
+
+  ~concurrent_hash_map() {
+    shard_alloc__ sa(alloc__());
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+      shard_type__ &s = shards_[i];
+      destroy_all__(s);
+      free_table__(s.cur.load(std::memory_order_relaxed));
+      free_table__(s.old.load(std::memory_order_relaxed));
+      while (table_type__ *t = s.retired) {
+        s.retired = t->retired;
+        free_table__(t);
+      }
+      mstl::allocator_traits<shard_alloc__>::destroy(sa, shards_ + i);
+    }
+    mstl::allocator_traits<shard_alloc__>::deallocate(sa, shards_,
+                                                      shard_mask_ + 1);
+  }
+
+  // a snapshot, other threads may be changing it.
+  size_type size() const noexcept {
+    size_t n = 0;
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+      n += shards_[i].size.load(std::memory_order_relaxed);
+    }
+    return n;
+  }
+  bool empty() const noexcept { return size() == 0; }
+  size_type shard_count() const noexcept { return shard_mask_ + 1; }
+
+  hasher hash_function() const { return fns_.first(); }
+  key_equal key_eq() const { return eq__(); }
+  allocator_type get_allocator() const { return alloc__(); }
+
+  /*
+   * lookup
+   */
+
+  // copies the value into out. False if the key isn't there.
+  template <typename Q = K> bool find(const key_arg<Q> &key, V &out) const {
+    return visit(key, [&](const V &v) { out = v; });
+  }
+
+  template <typename Q = K> bool contains(const key_arg<Q> &key) const {
+    return visit(key, [](const V &) {});
+  }
+
+  template <typename Q = K> size_type count(const key_arg<Q> &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  // f(const V &) on the value if the key is there. With lock free reads f
+  // sees a consistent copy, otherwise the value itself under a shared
+  // lock.
+  template <typename Q = K, typename F>
+  bool visit(const key_arg<Q> &key, F &&f) const {
+    uint64_t stored = stored_hash__(key);
+    shard_type__ &s = shard_of__(stored);
+    if constexpr (lock_free_reads) {
+      for (int i = 0; i < concurrent_hash_UTILL::optimistic_retries__; ++i) {
+        uint32_t seq = s.seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+          concurrency_UTILL::cpu_relax__();
+          continue;
+        }
+        copy__ c;
+        bool found = find_slot__(s, key, stored, c) != nullptr;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == seq) {
+          if (found) {
+            f(static_cast<const V &>(c.get().second));
+          }
+          return found;
+        }
+      }
+    }
+    std::shared_lock<std::shared_mutex> guard(s.lock);
+    copy__ c;
+    slot_type__ *slot = find_slot__(s, key, stored, c);
+    if (slot == nullptr) {
+      return false;
+    }
+    f(static_cast<const V &>(element__(*slot, c).second));
+    return true;
+  }
+
+  /*
+   * modifiers
+   */
+
+  // constructs V from args if the key isn't there. True if it inserted.
+  template <typename KK, typename... Args>
+  bool emplace(KK &&key, Args &&...args) {
+    return upsert__(
+        mstl::forward<KK>(key), [](V &) {},
+        mstl::forward<Args>(args)...);
+  }
+
+  bool insert(const value_type &v) { return emplace(v.first, v.second); }
+  bool insert(value_type &&v) {
+    return emplace(mstl::move(v.first), mstl::move(v.second));
+  }
+
+  template <typename KK, typename M>
+  bool insert_or_assign(KK &&key, M &&value) {
+    return upsert__(
+        mstl::forward<KK>(key), [&](V &v) { v = mstl::forward<M>(value); },
+        mstl::forward<M>(value));
+  }
+
+  // update(V &) in place if the key is there, otherwise insert V(args...).
+  // True if it inserted.
+  //
+  //   sessions.upsert(id, [](session &s) { ++s.hits; }, now);
+  template <typename KK, typename F, typename... Args>
+  bool upsert(KK &&key, F &&update, Args &&...args) {
+    return upsert__(mstl::forward<KK>(key), mstl::forward<F>(update),
+                    mstl::forward<Args>(args)...);
+  }
+
+  // update(V &) in place if the key is there. True if it was.
+  template <typename Q = K, typename F>
+  bool update(const key_arg<Q> &key, F &&f) {
+    uint64_t stored = stored_hash__(key);
+    shard_type__ &s = shard_of__(stored);
+    write_guard__ g(s);
+    migrate__(s, concurrent_hash_UTILL::migrate_batch__);
+    copy__ c;
+    slot_type__ *slot = find_slot__(s, key, stored, c);
+    if (slot == nullptr) {
+      return false;
+    }
+    update_in_place__(*slot, c, f);
+    return true;
+  }
+
+  template <typename Q = K> size_type erase(const key_arg<Q> &key) {
+    uint64_t stored = stored_hash__(key);
+    shard_type__ &s = shard_of__(stored);
+    write_guard__ g(s);
+    migrate__(s, concurrent_hash_UTILL::migrate_batch__);
+    copy__ c;
+    table_type__ *cur = s.cur.load(std::memory_order_relaxed);
+    if (slot_type__ *slot = probe__(cur, key, stored, c)) {
+      destroy__(*slot);
+      backward_shift__(cur, size_t(slot - cur->slots));
+      --cur->size;
+    } else {
+      table_type__ *old = s.old.load(std::memory_order_relaxed);
+      slot = probe__(old, key, stored, c);
+      if (slot == nullptr) {
+        return 0;
+      }
+      // no shifting here, the migration walks the old table in order.
+      destroy__(*slot);
+      slot->hash.store(concurrent_hash_UTILL::moved__,
+                       std::memory_order_relaxed);
+      --old->size;
+    }
+    s.size.store(s.size.load(std::memory_order_relaxed) - 1,
+                 std::memory_order_relaxed);
+    return 1;
+  }
+
+  // one shard at a time, so it's not atomic with respect to other writers.
+  void clear() {
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+      write_guard__ g(shards_[i]);
+      destroy_all__(shards_[i]);
+    }
+  }
+
+  // make room for n elements, spread over the shards. Unlike the growth
+  // on insert, this moves everything right away.
+  void reserve(size_type n) {
+    size_t per_shard = n / (shard_mask_ + 1) + 1;
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+      shard_type__ &s = shards_[i];
+      write_guard__ g(s);
+      table_type__ *cur = s.cur.load(std::memory_order_relaxed);
+      size_t cap = cur ? cur->mask + 1 : concurrent_hash_UTILL::min_capacity__;
+      while (concurrent_hash_UTILL::max_load__(cap) < per_shard) {
+        cap *= 2;
+      }
+      if (cur == nullptr || cap > cur->mask + 1) {
+        grow__(s, cap);
+        migrate__(s, size_t(-1));
+      }
+    }
+  }
+
+  // f(const K &, const V &) on every element, shard by shard under the
+  // shared lock. Elements inserted or erased meanwhile in other shards may
+  // or may not be seen.
+  template <typename F> void for_each(F &&f) const {
+    for (size_t i = 0; i <= shard_mask_; ++i) {
+      shard_type__ &s = shards_[i];
+      std::shared_lock<std::shared_mutex> guard(s.lock);
+      for (table_type__ *t : {s.old.load(std::memory_order_relaxed),
+                              s.cur.load(std::memory_order_relaxed)}) {
+        for (size_t j = 0; t != nullptr && j <= t->mask; ++j) {
+          if (t->slots[j].hash.load(std::memory_order_relaxed) >=
+              concurrent_hash_UTILL::full_bit__) {
+            copy__ c;
+            const value_type &v = element__(t->slots[j], c);
+            f(static_cast<const K &>(v.first),
+              static_cast<const V &>(v.second));
+          }
+        }
+      }
+    }
+  }
+
+private:
+  const Hash &hash__() const noexcept { return fns_.first(); }
+  const Eq &eq__() const noexcept { return fns_.second().first(); }
+  Alloc &alloc__() noexcept { return fns_.second().second(); }
+  const Alloc &alloc__() const noexcept { return fns_.second().second(); }
+
+  // Writers hold the shard lock and keep the sequence number odd.
+  struct write_guard__ {
+    shard_type__ &s;
+
+    explicit write_guard__(shard_type__ &shard) : s(shard) {
+      s.lock.lock();
+      if constexpr (lock_free_reads) {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+    }
+
+    ~write_guard__() {
+      if constexpr (lock_free_reads) {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+      }
+      s.lock.unlock();
+    }
+
+    write_guard__(const write_guard__ &) = delete;
+    write_guard__ &operator=(const write_guard__ &) = delete;
+  };
+
+  // the top bit marks the slot full, bits 48..62 pick the shard and the
+  // low bits the slot.
+  template <typename Q> uint64_t stored_hash__(const Q &key) const {
+    uint64_t h = hash__()(key);
+    if constexpr (!functional_UTILL::is_avalanching__<Hash>::value) {
+      h = functional_UTILL::mul_fold__(h ^ functional_UTILL::k0__,
+                                       functional_UTILL::k1__);
+    }
+    return h | concurrent_hash_UTILL::full_bit__;
+  }
+
+  shard_type__ &shard_of__(uint64_t stored) const noexcept {
+    return shards_[(stored >> 48) & shard_mask_];
+  }
+
+  // the element in a full slot. Lock free tables hold bare words, so it
+  // is copied out into c.
+  static value_type &element__(slot_type__ &slot, copy__ &c) noexcept {
+    if constexpr (lock_free_reads) {
+      concurrent_hash_UTILL::load_words__<value_type>(slot.words, c.bytes);
+      return c.get();
+    } else {
+      return *slot.get();
+    }
+  }
+
+  template <typename Q>
+  slot_type__ *probe__(table_type__ *t, const Q &key, uint64_t stored,
+                       copy__ &c) const {
+    if (t == nullptr) {
+      return nullptr;
+    }
+    size_t i = stored & t->mask;
+    // bounded, a lock free reader can see a table mid change.
+    for (size_t n = 0; n <= t->mask; ++n, i = (i + 1) & t->mask) {
+      slot_type__ &slot = t->slots[i];
+      uint64_t h = slot.hash.load(std::memory_order_relaxed);
+      if (h == concurrent_hash_UTILL::empty__) {
+        return nullptr;
+      }
+      if (h == stored && eq__()(element__(slot, c).first, key)) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename Q>
+  slot_type__ *find_slot__(shard_type__ &s, const Q &key, uint64_t stored,
+                           copy__ &c) const {
+    if (slot_type__ *slot =
+            probe__(s.cur.load(std::memory_order_acquire), key, stored, c)) {
+      return slot;
+    }
+    return probe__(s.old.load(std::memory_order_acquire), key, stored, c);
+  }
+
+  template <typename KK, typename F, typename... Args>
+  bool upsert__(KK &&key, F &&update, Args &&...args) {
+    uint64_t stored = stored_hash__(key);
+    shard_type__ &s = shard_of__(stored);
+    write_guard__ g(s);
+    migrate__(s, concurrent_hash_UTILL::migrate_batch__);
+
+    copy__ c;
+    table_type__ *cur = s.cur.load(std::memory_order_relaxed);
+    if (slot_type__ *slot = probe__(cur, key, stored, c)) {
+      update_in_place__(*slot, c, update);
+      return false;
+    }
+    table_type__ *old = s.old.load(std::memory_order_relaxed);
+    if (slot_type__ *slot = probe__(old, key, stored, c)) {
+      update_in_place__(*slot, c, update);
+      return false;
+    }
+
+    if (cur == nullptr ||
+        cur->size + 1 > concurrent_hash_UTILL::max_load__(cur->mask + 1)) {
+      grow__(s, cur ? (cur->mask + 1) * 2
+                    : concurrent_hash_UTILL::min_capacity__);
+      migrate__(s, concurrent_hash_UTILL::migrate_batch__);
+      cur = s.cur.load(std::memory_order_relaxed);
+    }
+    slot_type__ &slot = free_slot__(cur, stored);
+    construct__(slot, stored, mstl::forward<KK>(key),
+                mstl::forward<Args>(args)...);
+    ++cur->size;
+    s.size.store(s.size.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    return true;
+  }
+
+  template <typename F>
+  void update_in_place__(slot_type__ &slot, copy__ &c, F &update) {
+    if constexpr (lock_free_reads) {
+      // c holds the element already, probe__ copied it.
+      update(c.get().second);
+      concurrent_hash_UTILL::store_words__(slot.words, c.get());
+    } else {
+      (void)c;
+      update(slot.get()->second);
+    }
+  }
+
+  template <typename KK, typename... Args>
+  void construct__(slot_type__ &slot, uint64_t stored, KK &&key,
+                   Args &&...args) {
+    if constexpr (lock_free_reads) {
+      value_type v(mstl::forward<KK>(key), V(mstl::forward<Args>(args)...));
+      concurrent_hash_UTILL::store_words__(slot.words, v);
+    } else {
+      alloc_traits__::construct(alloc__(), slot.get(),
+                                mstl::forward<KK>(key),
+                                V(mstl::forward<Args>(args)...));
+    }
+    slot.hash.store(stored, std::memory_order_relaxed);
+  }
+
+  void destroy__(slot_type__ &slot) noexcept {
+    if constexpr (!lock_free_reads) {
+      alloc_traits__::destroy(alloc__(), slot.get());
+    }
+  }
+
+  // move the element of from into the empty slot to. from is left
+  // destroyed, its hash word untouched.
+  void relocate__(slot_type__ &to, slot_type__ &from) {
+    if constexpr (lock_free_reads) {
+      for (size_t i = 0; i < concurrent_hash_UTILL::words__<value_type>;
+           ++i) {
+        __atomic_store_n(to.words + i, from.words[i], __ATOMIC_RELAXED);
+      }
+    } else {
+      alloc_traits__::construct(alloc__(), to.get(), mstl::move(*from.get()));
+      alloc_traits__::destroy(alloc__(), from.get());
+    }
+    to.hash.store(from.hash.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  }
+
+  static slot_type__ &free_slot__(table_type__ *t, uint64_t stored) noexcept {
+    size_t i = stored & t->mask;
+    while (t->slots[i].hash.load(std::memory_order_relaxed) !=
+           concurrent_hash_UTILL::empty__) {
+      i = (i + 1) & t->mask;
+    }
+    return t->slots[i];
+  }
+
+  // Linear probing without tombstones: after emptying slot i, pull back
+  // every following element of the run that may live at i or before,
+  // i.e. whose home slot isn't between i and itself.
+  void backward_shift__(table_type__ *t, size_t i) {
+    for (size_t j = (i + 1) & t->mask;; j = (j + 1) & t->mask) {
+      uint64_t h = t->slots[j].hash.load(std::memory_order_relaxed);
+      if (h == concurrent_hash_UTILL::empty__) {
+        break;
+      }
+      size_t home = h & t->mask;
+      if (((j - home) & t->mask) >= ((j - i) & t->mask)) {
+        relocate__(t->slots[i], t->slots[j]);
+        i = j;
+      }
+    }
+    t->slots[i].hash.store(concurrent_hash_UTILL::empty__,
+                           std::memory_order_relaxed);
+  }
+
+  // Start moving to a table of the given capacity. An unfinished
+  // migration is finished first, normally it's long done by now.
+  void grow__(shard_type__ &s, size_t capacity) {
+    migrate__(s, size_t(-1));
+    table_type__ *t = new_table__(capacity);
+    table_type__ *cur = s.cur.load(std::memory_order_relaxed);
+    s.migrated = 0;
+    s.old.store(cur, std::memory_order_release);
+    s.cur.store(t, std::memory_order_release);
+  }
+
+  // move up to n slots of the old table, retire it when it's empty.
+  void migrate__(shard_type__ &s, size_t n) {
+    table_type__ *old = s.old.load(std::memory_order_relaxed);
+    if (old == nullptr) {
+      return;
+    }
+    table_type__ *cur = s.cur.load(std::memory_order_relaxed);
+    size_t cap = old->mask + 1;
+    size_t end = n < cap - s.migrated ? s.migrated + n : cap;
+    for (size_t i = s.migrated; i < end; ++i) {
+      slot_type__ &from = old->slots[i];
+      uint64_t h = from.hash.load(std::memory_order_relaxed);
+      if (h >= concurrent_hash_UTILL::full_bit__) {
+        relocate__(free_slot__(cur, h), from);
+        from.hash.store(concurrent_hash_UTILL::moved__,
+                        std::memory_order_relaxed);
+        ++cur->size;
+        --old->size;
+      }
+    }
+    s.migrated = end;
+    if (end == cap) {
+      s.old.store(nullptr, std::memory_order_release);
+      old->retired = s.retired;
+      s.retired = old;
+    }
+  }
+
+  void destroy_all__(shard_type__ &s) noexcept {
+    for (table_type__ *t : {s.old.load(std::memory_order_relaxed),
+                            s.cur.load(std::memory_order_relaxed)}) {
+      for (size_t j = 0; t != nullptr && j <= t->mask; ++j) {
+        slot_type__ &slot = t->slots[j];
+        if (slot.hash.load(std::memory_order_relaxed) >=
+            concurrent_hash_UTILL::full_bit__) {
+          destroy__(slot);
+        }
+        slot.hash.store(concurrent_hash_UTILL::empty__,
+                        std::memory_order_relaxed);
+      }
+      if (t != nullptr) {
+        t->size = 0;
+      }
+    }
+    s.size.store(0, std::memory_order_relaxed);
+  }
+
+  table_type__ *new_table__(size_t capacity) {
+    table_alloc__ ta(alloc__());
+    slot_alloc__ sa(alloc__());
+    table_type__ *t = mstl::allocator_traits<table_alloc__>::allocate(ta, 1);
+    try {
+      t->slots = mstl::allocator_traits<slot_alloc__>::allocate(sa, capacity);
+    } catch (...) {
+      mstl::allocator_traits<table_alloc__>::deallocate(ta, t, 1);
+      throw;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+      mstl::allocator_traits<slot_alloc__>::construct(sa, t->slots + i);
+    }
+    t->mask = capacity - 1;
+    t->size = 0;
+    t->retired = nullptr;
+    return t;
+  }
+
+  // the elements must be destroyed already.
+  void free_table__(table_type__ *t) noexcept {
+    if (t == nullptr) {
+      return;
+    }
+    table_alloc__ ta(alloc__());
+    slot_alloc__ sa(alloc__());
+    mstl::allocator_traits<slot_alloc__>::deallocate(sa, t->slots,
+                                                     t->mask + 1);
+    mstl::allocator_traits<table_alloc__>::deallocate(ta, t, 1);
+  }
+};
+
+} // namespace mstl
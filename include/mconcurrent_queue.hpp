@@ -0,0 +1,463 @@
+#pragma once
+#include "mconcurrency.hpp"
+#include "mexception.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock free queues on a ring buffer.
+//
+// spsc_queue: one producer thread, one consumer thread. Each side owns one
+// index and only reads the other's, so a push or a pop is a couple of
+// plain loads and one release store. Each side also keeps a private copy
+// of the other side's index and only rereads the shared one when the copy
+// says full (or empty). In the steady state the two threads touch each
+// other's cache lines once per lap, not once per element.
+//
+//   producer line: [ tail | head_cache ]
+//   consumer line: [ head | tail_cache ]
+//   ring:          [ . . x x x x x . . ]
+//                        ^head    ^tail
+//
+// mpmc_queue: any number of producers and consumers (Vyukov's bounded
+// queue). Every slot has a sequence number saying whose turn it is:
+//
+//   seq == pos          free, for the producer of position pos
+//   seq == pos + 1      full, for the consumer of position pos
+//
+// A producer claims a position with one CAS on tail, fills the slot, and
+// hands it over by bumping seq. Consumers do the same on head. Batches
+// claim a whole run of positions with one CAS.
+//
+// The try_ functions never wait. push/pop wait with the Wait strategy
+// (spin_wait, yield_wait, futex_wait, see mconcurrency.hpp).
+namespace mstl {
+
+template <typename T, size_t N, typename Wait = mstl::spin_wait>
+class spsc_queue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0,
+                "spsc_queue capacity must be a power of two");
+
+  static constexpr size_t mask__ = N - 1;
+  static constexpr size_t line__ = concurrency_UTILL::cache_line__;
+  using event__ = concurrency_UTILL::event__<Wait>;
+
+  // producer side
+  alignas(line__) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+
+  // consumer side
+  alignas(line__) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+
+  event__ not_empty_;
+  event__ not_full_;
+
+  alignas(line__ > alignof(T) ? line__ : alignof(T)) unsigned char
+      storage_[N * sizeof(T)];
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+
+  spsc_queue() = default;
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  ~spsc_queue() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i) {
+      mstl::destroy_at(slot__(i));
+    }
+  }
+
+  static constexpr size_type capacity() noexcept { return N; }
+
+  // only a snapshot when the other side is running. A third thread can see
+  // head move past a stale tail, that reads as empty.
+  size_type size() const noexcept {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+  /*
+   * producer
+   */
+  template <typename... Args> bool try_emplace(Args &&...args) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == N) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == N) {
+        return false;
+      }
+    }
+    mstl::construct_at(slot__(tail), mstl::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    not_empty_.notify();
+    return true;
+  }
+
+  bool try_push(const T &value) { return try_emplace(value); }
+  bool try_push(T &&value) { return try_emplace(mstl::move(value)); }
+
+  // push up to n elements from first, as many as fit. They become visible
+  // to the consumer all at once. Returns how many were pushed.
+  template <typename InputIt> size_type try_push_n(InputIt first, size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (N - (tail - head_cache_) < n) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+    }
+    size_t free = N - (tail - head_cache_);
+    n = n < free ? n : free;
+    size_t i = 0;
+    try {
+      for (; i < n; ++i, ++first) {
+        mstl::construct_at(slot__(tail + i), *first);
+      }
+    } catch (...) {
+      publish_tail__(tail + i);
+      throw;
+    }
+    if (n != 0) {
+      publish_tail__(tail + n);
+    }
+    return n;
+  }
+
+  template <typename... Args> void emplace(Args &&...args) {
+    not_full_.wait_until(
+        [&] { return try_emplace(mstl::forward<Args>(args)...); });
+  }
+
+  void push(const T &value) { emplace(value); }
+  void push(T &&value) { emplace(mstl::move(value)); }
+
+  /*
+   * consumer
+   */
+  bool try_pop(T &out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    T *p = slot__(head);
+    out = mstl::move(*p);
+    mstl::destroy_at(p);
+    head_.store(head + 1, std::memory_order_release);
+    not_full_.notify();
+    return true;
+  }
+
+  // pop up to n elements into out, returns how many were popped.
+  template <typename OutputIt> size_type try_pop_n(OutputIt out, size_t n) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - head < n) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t avail = tail_cache_ - head;
+    n = n < avail ? n : avail;
+    size_t i = 0;
+    try {
+      for (; i < n; ++i, ++out) {
+        T *p = slot__(head + i);
+        *out = mstl::move(*p);
+        mstl::destroy_at(p);
+      }
+    } catch (...) {
+      publish_head__(head + i);
+      throw;
+    }
+    if (n != 0) {
+      publish_head__(head + n);
+    }
+    return n;
+  }
+
+  void pop(T &out) {
+    not_empty_.wait_until([&] { return try_pop(out); });
+  }
+
+private:
+  T *slot__(size_t i) noexcept {
+    return reinterpret_cast<T *>(storage_) + (i & mask__);
+  }
+
+  void publish_tail__(size_t tail) noexcept {
+    tail_.store(tail, std::memory_order_release);
+    not_empty_.notify();
+  }
+
+  void publish_head__(size_t head) noexcept {
+    head_.store(head, std::memory_order_release);
+    not_full_.notify();
+  }
+};
+
+} // namespace mstl
+
+namespace mstl::concurrent_queue_UTILL {
+
+template <typename T> struct slot__ {
+  std::atomic<size_t> seq;
+  alignas(T) unsigned char value[sizeof(T)];
+
+  T *get() noexcept { return reinterpret_cast<T *>(value); }
+};
+
+inline size_t round_up_pow2__(size_t n) noexcept {
+  size_t cap = 2;
+  while (cap < n) {
+    cap <<= 1;
+  }
+  return cap;
+}
+
+} // namespace mstl::concurrent_queue_UTILL
+
+namespace mstl {
+
+// The capacity is rounded up to a power of two.
+// Once a position is claimed the slot must be filled (or emptied), or the
+// queue stops there. So elements must be nothrow movable: a throwing
+// constructor runs before claiming, into a temporary.
+template <typename T, typename Wait = mstl::spin_wait,
+          typename Alloc = mstl::allocator<T>>
+class mpmc_queue {
+  static_assert(mstl::is_nothrow_move_constructible<T>::value &&
+                    mstl::is_nothrow_move_assignable<T>::value,
+                "mpmc_queue elements must be nothrow movable");
+
+  using slot_type__ = concurrent_queue_UTILL::slot__<T>;
+  using slot_alloc__ = typename mstl::allocator_traits<
+      Alloc>::template rebind_alloc<slot_type__>;
+  using slot_traits__ = mstl::allocator_traits<slot_alloc__>;
+  using event__ = concurrency_UTILL::event__<Wait>;
+  static constexpr size_t line__ = concurrency_UTILL::cache_line__;
+
+  // read only after construction, shared by everyone.
+  memory_UTIL::compressed_pair__<slot_type__ *, slot_alloc__> slots_;
+  size_t mask_;
+
+  alignas(line__) std::atomic<size_t> tail_{0};
+  alignas(line__) std::atomic<size_t> head_{0};
+
+  event__ not_empty_;
+  event__ not_full_;
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using allocator_type = Alloc;
+
+  explicit mpmc_queue(size_type capacity, const Alloc &a = Alloc())
+      : slots_(nullptr, slot_alloc__(a)),
+        mask_(concurrent_queue_UTILL::round_up_pow2__(capacity) - 1) {
+    slots_.first() = slot_traits__::allocate(slots_.second(), mask_ + 1);
+    for (size_t i = 0; i <= mask_; ++i) {
+      slot_traits__::construct(slots_.second(), slots_.first() + i);
+      slots_.first()[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpmc_queue(const mpmc_queue &) = delete;
+  mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+  ~mpmc_queue() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i) {
+      mstl::destroy_at(slot__(i).get());
+    }
+    for (size_t i = 0; i <= mask_; ++i) {
+      slot_traits__::destroy(slots_.second(), slots_.first() + i);
+    }
+    slot_traits__::deallocate(slots_.second(), slots_.first(), mask_ + 1);
+  }
+
+  size_type capacity() const noexcept { return mask_ + 1; }
+
+  // only a snapshot when other threads are running.
+  size_type size() const noexcept {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+  /*
+   * producers
+   */
+  template <typename... Args> bool try_emplace(Args &&...args) {
+    if constexpr (mstl::is_nothrow_constructible<T, Args &&...>::value) {
+      size_t pos;
+      if (!claim__(tail_, pos, 1, 0)) {
+        return false;
+      }
+      mstl::construct_at(slot__(pos).get(), mstl::forward<Args>(args)...);
+      slot__(pos).seq.store(pos + 1, std::memory_order_release);
+      not_empty_.notify();
+      return true;
+    } else {
+      T tmp(mstl::forward<Args>(args)...);
+      return try_emplace(mstl::move(tmp));
+    }
+  }
+
+  bool try_push(const T &value) { return try_emplace(value); }
+  bool try_push(T &&value) { return try_emplace(mstl::move(value)); }
+
+  // push up to n elements from first with a single CAS. Returns how many
+  // were pushed, which can be short of the free room while other producers
+  // or consumers are mid way through a slot. Never waits.
+  template <typename InputIt> size_type try_push_n(InputIt first, size_t n) {
+    if constexpr (!mstl::is_nothrow_constructible<
+                      T, decltype(*mstl::declval<InputIt &>())>::value) {
+      size_t i = 0;
+      for (; i < n && try_emplace(*first); ++i, ++first) {
+      }
+      return i;
+    } else {
+      size_t pos;
+      n = claim_n__(tail_, pos, n, 0);
+      for (size_t i = 0; i < n; ++i, ++first) {
+        auto &s = slot__(pos + i);
+        mstl::construct_at(s.get(), *first);
+        s.seq.store(pos + i + 1, std::memory_order_release);
+      }
+      if (n != 0) {
+        not_empty_.notify();
+      }
+      return n;
+    }
+  }
+
+  template <typename... Args> void emplace(Args &&...args) {
+    if constexpr (mstl::is_nothrow_constructible<T, Args &&...>::value) {
+      not_full_.wait_until(
+          [&] { return try_emplace(mstl::forward<Args>(args)...); });
+    } else {
+      T tmp(mstl::forward<Args>(args)...);
+      emplace(mstl::move(tmp));
+    }
+  }
+
+  void push(const T &value) { emplace(value); }
+  void push(T &&value) { emplace(mstl::move(value)); }
+
+  /*
+   * consumers
+   */
+  bool try_pop(T &out) noexcept {
+    size_t pos;
+    if (!claim__(head_, pos, 1, 1)) {
+      return false;
+    }
+    auto &s = slot__(pos);
+    out = mstl::move(*s.get());
+    mstl::destroy_at(s.get());
+    s.seq.store(pos + mask_ + 1, std::memory_order_release);
+    not_full_.notify();
+    return true;
+  }
+
+  // pop up to n elements into out with a single CAS. Returns how many were
+  // popped, which can be short of size() while other producers or consumers
+  // are mid way through a slot. Never waits.
+  template <typename OutputIt> size_type try_pop_n(OutputIt out, size_t n) {
+    if constexpr (!noexcept(*mstl::declval<OutputIt &>() =
+                                mstl::declval<T &&>())) {
+      // the output might throw after the claim, take them one by one.
+      size_t i = 0;
+      for (T tmp; i < n && try_pop(tmp); ++i, ++out) {
+        *out = mstl::move(tmp);
+      }
+      return i;
+    } else {
+      size_t pos;
+      n = claim_n__(head_, pos, n, 1);
+      for (size_t i = 0; i < n; ++i, ++out) {
+        auto &s = slot__(pos + i);
+        *out = mstl::move(*s.get());
+        mstl::destroy_at(s.get());
+        s.seq.store(pos + i + mask_ + 1, std::memory_order_release);
+      }
+      if (n != 0) {
+        not_full_.notify();
+      }
+      return n;
+    }
+  }
+
+  void pop(T &out) {
+    not_empty_.wait_until([&] { return try_pop(out); });
+  }
+
+private:
+  slot_type__ &slot__(size_t pos) noexcept {
+    return slots_.first()[pos & mask_];
+  }
+
+  // Claim the next position on index (tail for producers with turn 0,
+  // head for consumers with turn 1). The slot is ours when its seq is
+  // pos + turn. Behind means the queue is full (or empty), ahead means
+  // someone else took pos first.
+  bool claim__(std::atomic<size_t> &index, size_t &pos, size_t count,
+               size_t turn) noexcept {
+    pos = index.load(std::memory_order_relaxed);
+    for (;;) {
+      size_t seq = slot__(pos + count - 1).seq.load(std::memory_order_acquire);
+      ptrdiff_t diff = ptrdiff_t(seq - (pos + count - 1 + turn));
+      if (diff == 0) {
+        if (index.compare_exchange_weak(pos, pos + count,
+                                        std::memory_order_relaxed)) {
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = index.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Claim up to n positions with one CAS. Only the run of slots the other
+  // side is done with counts, so the caller never waits on a slot, and
+  // gets fewer than n when a slot further on is still being filled (or
+  // emptied).
+  size_t claim_n__(std::atomic<size_t> &index, size_t &pos, size_t n,
+                   size_t turn) noexcept {
+    if (n == 0) {
+      return 0;
+    }
+    pos = index.load(std::memory_order_relaxed);
+    for (;;) {
+      size_t k = 0;
+      ptrdiff_t diff = 0;
+      for (; k < n; ++k) {
+        size_t seq = slot__(pos + k).seq.load(std::memory_order_acquire);
+        diff = ptrdiff_t(seq - (pos + k + turn));
+        if (diff != 0) {
+          break;
+        }
+      }
+      if (k != 0) {
+        if (index.compare_exchange_weak(pos, pos + k,
+                                        std::memory_order_relaxed)) {
+          return k;
+        }
+      } else if (diff < 0) {
+        return 0;
+      } else {
+        pos = index.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+} // namespace mstl
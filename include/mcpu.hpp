@@ -0,0 +1,42 @@
+#pragma once
+
+// What the cpu we're running on can do, for picking a SIMD code path at
+// run time. The library is compiled for the baseline target (plain x86-64
+// has SSE2 and nothing newer), and the hot loops come in a second version
+// compiled with __attribute__((target("avx2"))) (or "avx512f", ...) that
+// is only called when the check below says it's safe.
+//
+// note: x86 only for now, everything reads false elsewhere and the
+// portable loops run.
+namespace mstl::cpu_UTILL {
+
+struct features__ {
+  bool popcnt;
+  bool avx2;
+  bool bmi2;
+  bool avx512f;
+  bool avx512bw;
+};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MSTL_X86_DISPATCH__ 1
+#endif
+
+// detected once, on first use.
+inline const features__ &cpu_features__() noexcept {
+  static const features__ f = [] {
+    features__ r{};
+#ifdef MSTL_X86_DISPATCH__
+    __builtin_cpu_init();
+    r.popcnt = __builtin_cpu_supports("popcnt");
+    r.avx2 = __builtin_cpu_supports("avx2");
+    r.bmi2 = __builtin_cpu_supports("bmi2");
+    r.avx512f = __builtin_cpu_supports("avx512f");
+    r.avx512bw = __builtin_cpu_supports("avx512bw");
+#endif
+    return r;
+  }();
+  return f;
+}
+
+} // namespace mstl::cpu_UTILL
@@ -0,0 +1,762 @@
+#pragma once
+#include "mexception.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mnew.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+namespace mstl::deque_UTILL {
+
+constexpr size_t round_up_pow2__(size_t n) noexcept {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+// mstl::swap lives in malgorithm, which includes us through miterator.
+template <typename T> void swap__(T &a, T &b) {
+  T tmp(mstl::move(a));
+  a = mstl::move(b);
+  b = mstl::move(tmp);
+}
+
+// A position is an index that is not wrapped yet, head + i. It's only
+// masked when we touch the buffer, so iterators compare and subtract like
+// plain integers even when the elements wrap around the end of the buffer.
+template <typename T, bool Const> class iterator__ {
+  template <typename, bool> friend class iterator__;
+  template <typename, typename> friend class mstl::deque;
+
+  using elem__ = typename mstl::conditional<Const, const T, T>::type;
+
+  T *buf_ = nullptr;
+  size_t mask_ = 0;
+  size_t pos_ = 0;
+
+  constexpr iterator__(T *buf, size_t mask, size_t pos) noexcept
+      : buf_(buf), mask_(mask), pos_(pos) {}
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type = T;
+  using pointer = elem__ *;
+  using reference = elem__ &;
+  using iterator_category = mstl::random_access_iterator_tag;
+
+  constexpr iterator__() noexcept = default;
+
+  // iterator converts to const_iterator, not the other way around.
+  template <bool C, typename = mstl::enable_if_t<Const && !C>>
+  constexpr iterator__(const iterator__<T, C> &other) noexcept
+      : buf_(other.buf_), mask_(other.mask_), pos_(other.pos_) {}
+
+  constexpr reference operator*() const noexcept {
+    return buf_[pos_ & mask_];
+  }
+  constexpr pointer operator->() const noexcept {
+    return buf_ + (pos_ & mask_);
+  }
+  constexpr reference operator[](difference_type n) const noexcept {
+    return buf_[(pos_ + n) & mask_];
+  }
+
+  constexpr iterator__ &operator++() noexcept {
+    ++pos_;
+    return *this;
+  }
+  constexpr iterator__ operator++(int) noexcept {
+    iterator__ tmp(*this);
+    ++pos_;
+    return tmp;
+  }
+  constexpr iterator__ &operator--() noexcept {
+    --pos_;
+    return *this;
+  }
+  constexpr iterator__ operator--(int) noexcept {
+    iterator__ tmp(*this);
+    --pos_;
+    return tmp;
+  }
+
+  constexpr iterator__ &operator+=(difference_type n) noexcept {
+    pos_ += n;
+    return *this;
+  }
+  constexpr iterator__ &operator-=(difference_type n) noexcept {
+    pos_ -= n;
+    return *this;
+  }
+  constexpr iterator__ operator+(difference_type n) const noexcept {
+    return iterator__(buf_, mask_, pos_ + n);
+  }
+  constexpr iterator__ operator-(difference_type n) const noexcept {
+    return iterator__(buf_, mask_, pos_ - n);
+  }
+  friend constexpr iterator__ operator+(difference_type n,
+                                        const iterator__ &it) noexcept {
+    return it + n;
+  }
+
+  template <bool C>
+  constexpr difference_type
+  operator-(const iterator__<T, C> &other) const noexcept {
+    return difference_type(pos_ - other.pos_);
+  }
+
+  template <bool C>
+  constexpr bool operator==(const iterator__<T, C> &other) const noexcept {
+    return pos_ == other.pos_;
+  }
+  template <bool C>
+  constexpr bool operator!=(const iterator__<T, C> &other) const noexcept {
+    return pos_ != other.pos_;
+  }
+  template <bool C>
+  constexpr bool operator<(const iterator__<T, C> &other) const noexcept {
+    return pos_ < other.pos_;
+  }
+  template <bool C>
+  constexpr bool operator>(const iterator__<T, C> &other) const noexcept {
+    return pos_ > other.pos_;
+  }
+  template <bool C>
+  constexpr bool operator<=(const iterator__<T, C> &other) const noexcept {
+    return pos_ <= other.pos_;
+  }
+  template <bool C>
+  constexpr bool operator>=(const iterator__<T, C> &other) const noexcept {
+    return pos_ >= other.pos_;
+  }
+};
+
+} // namespace mstl::deque_UTILL
+
+namespace mstl {
+
+// Double ended queue on a single ring buffer.
+// The usual deque is a map of fixed size blocks, so it never moves its
+// elements, but every access goes through the map and iterating means
+// hopping from block to block. Here all elements live in one buffer whose
+// size is a power of two, so element i is buf_[(head_ + i) & mask_]: one
+// add and one and, no pointer chasing.
+//
+//   [ 4 5 _ _ _ _ 1 2 3 ]     push_back writes after 5,
+//         ^tail     ^head_    push_front writes before 1.
+//
+// push and pop at both ends are O(1), growing doubles the buffer and
+// straightens the elements out. Unlike std::deque, growing invalidates
+// references.
+//
+// Fixed capacity mode: deque(mstl::fixed_capacity, n) allocates room for n
+// (rounded up to a power of two) once and never again. Pushing into a full
+// fixed deque throws bad_alloc. Good for sliding windows, where the size is
+// bounded by the window and the hot loop shouldn't branch into allocation.
+template <typename T, typename Alloc = mstl::allocator<T>> class deque {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+
+public:
+  using value_type = T;
+  using allocator_type = Alloc;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+
+  using iterator = deque_UTILL::iterator__<T, false>;
+  using const_iterator = deque_UTILL::iterator__<T, true>;
+  using reverse_iterator = mstl::reverse_iterator<iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::pointer, T *>::value,
+                "deque needs an allocator with raw pointers");
+
+private:
+  static constexpr bool relocatable__ =
+      mstl::is_trivially_relocatable<T>::value;
+
+  T *buf_ = nullptr;
+  size_type mask_ = 0; // capacity - 1, or 0 without a buffer.
+  size_type head_ = 0; // always < capacity.
+  size_type size_ = 0;
+  memory_UTIL::compressed_pair__<bool, Alloc> fixed_;
+
+public:
+  deque() noexcept(noexcept(Alloc())) : fixed_(false, Alloc()) {}
+  explicit deque(const Alloc &a) noexcept : fixed_(false, a) {}
+
+  deque(mstl::fixed_capacity_t, size_type n, const Alloc &a = Alloc())
+      : fixed_(false, a) {
+    if (n > 0) {
+      reallocate__(deque_UTILL::round_up_pow2__(n));
+    }
+    fixed_.first() = true;
+  }
+
+  explicit deque(size_type n, const Alloc &a = Alloc()) : fixed_(false, a) {
+    init__([&] { resize(n); });
+  }
+
+  deque(size_type n, const T &value, const Alloc &a = Alloc())
+      : fixed_(false, a) {
+    init__([&] { resize(n, value); });
+  }
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  deque(InputIt first, InputIt last, const Alloc &a = Alloc())
+      : fixed_(false, a) {
+    init__([&] { assign(first, last); });
+  }
+
+  deque(std::initializer_list<T> il, const Alloc &a = Alloc())
+      : deque(il.begin(), il.end(), a) {}
+
+  deque(const deque &other)
+      : fixed_(false, alloc_traits__::select_on_container_copy_construction(
+                          other.alloc__())) {
+    init__([&] { copy_from__(other); });
+  }
+
+  deque(deque &&other) noexcept
+      : buf_(other.buf_), mask_(other.mask_), head_(other.head_),
+        size_(other.size_),
+        fixed_(other.fixed(), mstl::move(other.alloc__())) {
+    other.buf_ = nullptr;
+    other.mask_ = other.head_ = other.size_ = 0;
+  }
+
+  ~deque() {
+    clear();
+    release__();
+  }
+
+  deque &operator=(const deque &other) {
+    if (this != &other) {
+      clear();
+      if constexpr (alloc_traits__::propagate_on_container_copy_assignment::
+                        value) {
+        if (alloc__() != other.alloc__()) {
+          release__();
+        }
+        alloc__() = other.alloc__();
+      }
+      copy_from__(other);
+    }
+    return *this;
+  }
+
+  deque &operator=(deque &&other) noexcept(
+      alloc_traits__::propagate_on_container_move_assignment::value ||
+      alloc_traits__::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (alloc_traits__::propagate_on_container_move_assignment::
+                      value) {
+      release__();
+      alloc__() = mstl::move(other.alloc__());
+    }
+    if (alloc__() == other.alloc__()) {
+      release__();
+      steal__(other);
+    } else {
+      for (T &x : other) {
+        emplace_back(mstl::move(x));
+      }
+      other.clear();
+    }
+    return *this;
+  }
+
+  deque &operator=(std::initializer_list<T> il) {
+    assign(il.begin(), il.end());
+    return *this;
+  }
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  void assign(InputIt first, InputIt last) {
+    clear();
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  void assign(size_type n, const T &value) {
+    T tmp(value);
+    clear();
+    resize(n, tmp);
+  }
+
+  void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+  allocator_type get_allocator() const noexcept { return alloc__(); }
+
+  bool fixed() const noexcept { return fixed_.first(); }
+
+  // element access
+
+  reference operator[](size_type n) noexcept {
+    return buf_[(head_ + n) & mask_];
+  }
+  const_reference operator[](size_type n) const noexcept {
+    return buf_[(head_ + n) & mask_];
+  }
+
+  reference at(size_type n) {
+    if (n >= size_) {
+      throw mstl::exception();
+    }
+    return (*this)[n];
+  }
+
+  const_reference at(size_type n) const {
+    if (n >= size_) {
+      throw mstl::exception();
+    }
+    return (*this)[n];
+  }
+
+  reference front() noexcept { return buf_[head_]; }
+  const_reference front() const noexcept { return buf_[head_]; }
+  reference back() noexcept { return (*this)[size_ - 1]; }
+  const_reference back() const noexcept { return (*this)[size_ - 1]; }
+
+  // iterators
+
+  iterator begin() noexcept { return iterator(buf_, mask_, head_); }
+  const_iterator begin() const noexcept {
+    return const_iterator(buf_, mask_, head_);
+  }
+  iterator end() noexcept { return iterator(buf_, mask_, head_ + size_); }
+  const_iterator end() const noexcept {
+    return const_iterator(buf_, mask_, head_ + size_);
+  }
+
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+  const_reverse_iterator crend() const noexcept { return rend(); }
+
+  // capacity
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return buf_ ? mask_ + 1 : 0; }
+
+  size_type max_size() const noexcept {
+    size_type m = alloc_traits__::max_size(alloc__());
+    size_type d = size_type(PTRDIFF_MAX) / sizeof(T);
+    m = m < d ? m : d;
+    // the largest power of two that fits.
+    size_type p = 1;
+    while (p <= m / 2) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  void reserve(size_type n) {
+    if (n > capacity()) {
+      grow__(n);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (fixed()) {
+      return;
+    }
+    if (size_ == 0) {
+      release__();
+      return;
+    }
+    size_type cap = deque_UTILL::round_up_pow2__(size_);
+    if (cap < capacity()) {
+      reallocate__(cap);
+    }
+  }
+
+  // modifiers
+
+  void clear() noexcept { pop_back_n__(size_); }
+
+  template <typename... Args> reference emplace_back(Args &&...args) {
+    if (size_ == capacity()) {
+      grow_emplace__(size_, mstl::forward<Args>(args)...);
+    } else {
+      alloc_traits__::construct(alloc__(), buf_ + ((head_ + size_) & mask_),
+                                mstl::forward<Args>(args)...);
+    }
+    ++size_;
+    return back();
+  }
+
+  template <typename... Args> reference emplace_front(Args &&...args) {
+    if (size_ == capacity()) {
+      grow_emplace__(size_type(-1), mstl::forward<Args>(args)...);
+    } else {
+      alloc_traits__::construct(alloc__(), buf_ + ((head_ - 1) & mask_),
+                                mstl::forward<Args>(args)...);
+      head_ = (head_ - 1) & mask_;
+    }
+    ++size_;
+    return front();
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(mstl::move(value)); }
+  void push_front(const T &value) { emplace_front(value); }
+  void push_front(T &&value) { emplace_front(mstl::move(value)); }
+
+  void pop_back() noexcept { pop_back_n__(1); }
+
+  void pop_front() noexcept {
+    alloc_traits__::destroy(alloc__(), buf_ + head_);
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  // Insert goes in at whichever end is closer, then gets shifted into
+  // place, so at most half the elements move.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args &&...args) {
+    size_type off = size_type(pos - cbegin());
+    if (off < size_ / 2) {
+      emplace_front(mstl::forward<Args>(args)...);
+      shift__(0, off);
+    } else {
+      emplace_back(mstl::forward<Args>(args)...);
+      shift__(size_ - 1, off);
+    }
+    return begin() + off;
+  }
+
+  iterator insert(const_iterator pos, const T &value) {
+    return emplace(pos, value);
+  }
+
+  iterator insert(const_iterator pos, T &&value) {
+    return emplace(pos, mstl::move(value));
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  // Close the gap from the shorter side. Erasing a suffix, which is what a
+  // monotonic queue does all the time, moves nothing.
+  iterator erase(const_iterator first, const_iterator last) {
+    size_type off = size_type(first - cbegin());
+    size_type n = size_type(last - first);
+    if (n == 0) {
+      return begin() + off;
+    }
+    deque &d = *this;
+    if (off < size_ - off - n) {
+      for (size_type i = off; i > 0; --i) {
+        d[i - 1 + n] = mstl::move(d[i - 1]);
+      }
+      for (size_type i = 0; i < n; ++i) {
+        pop_front();
+      }
+    } else {
+      for (size_type i = off + n; i < size_; ++i) {
+        d[i - n] = mstl::move(d[i]);
+      }
+      pop_back_n__(n);
+    }
+    return begin() + off;
+  }
+
+  void resize(size_type n) {
+    if (n < size_) {
+      pop_back_n__(size_ - n);
+      return;
+    }
+    reserve(n);
+    while (size_ < n) {
+      emplace_back();
+    }
+  }
+
+  void resize(size_type n, const T &value) {
+    if (n < size_) {
+      pop_back_n__(size_ - n);
+      return;
+    }
+    T tmp(value);
+    reserve(n);
+    while (size_ < n) {
+      emplace_back(tmp);
+    }
+  }
+
+  void swap(deque &other) noexcept {
+    if constexpr (alloc_traits__::propagate_on_container_swap::value) {
+      deque_UTILL::swap__(alloc__(), other.alloc__());
+    }
+    deque_UTILL::swap__(buf_, other.buf_);
+    deque_UTILL::swap__(mask_, other.mask_);
+    deque_UTILL::swap__(head_, other.head_);
+    deque_UTILL::swap__(size_, other.size_);
+    deque_UTILL::swap__(fixed_.first(), other.fixed_.first());
+  }
+
+private:
+  Alloc &alloc__() noexcept { return fixed_.second(); }
+  const Alloc &alloc__() const noexcept { return fixed_.second(); }
+
+  template <typename Fn> void init__(Fn &&fn) {
+    try {
+      fn();
+    } catch (...) {
+      clear();
+      release__();
+      throw;
+    }
+  }
+
+  void copy_from__(const deque &other) {
+    if (other.fixed() && other.capacity() > capacity()) {
+      reallocate__(other.capacity());
+    } else {
+      reserve(other.size_);
+    }
+    fixed_.first() = other.fixed();
+    for (const T &x : other) {
+      emplace_back(x);
+    }
+  }
+
+  // move the element at index from to index to, sliding the ones in
+  // between over by one.
+  void shift__(size_type from, size_type to) {
+    deque &d = *this;
+    if (from == to) {
+      return;
+    }
+    T tmp(mstl::move(d[from]));
+    for (; from < to; ++from) {
+      d[from] = mstl::move(d[from + 1]);
+    }
+    for (; from > to; --from) {
+      d[from] = mstl::move(d[from - 1]);
+    }
+    d[to] = mstl::move(tmp);
+  }
+
+  void steal__(deque &other) noexcept {
+    buf_ = other.buf_;
+    mask_ = other.mask_;
+    head_ = other.head_;
+    size_ = other.size_;
+    fixed_.first() = other.fixed();
+    other.buf_ = nullptr;
+    other.mask_ = other.head_ = other.size_ = 0;
+  }
+
+  void release__() noexcept {
+    if (buf_ != nullptr) {
+      alloc_traits__::deallocate(alloc__(), buf_, mask_ + 1);
+      buf_ = nullptr;
+      mask_ = head_ = 0;
+    }
+  }
+
+  void pop_back_n__(size_type n) noexcept {
+    if constexpr (!mstl::is_trivially_destructible<T>::value ||
+                  allocator_traits_UTILL::has_destroy__<Alloc, T>::value) {
+      for (size_type i = 0; i < n; ++i) {
+        alloc_traits__::destroy(alloc__(),
+                                buf_ + ((head_ + size_ - 1 - i) & mask_));
+      }
+    }
+    size_ -= n;
+  }
+
+  size_type next_capacity__(size_type needed) const {
+    if (fixed()) {
+      throw mstl::bad_alloc();
+    }
+    if (needed > max_size()) {
+      throw mstl::bad_array_new_length();
+    }
+    size_type cap = capacity() ? capacity() * 2 : 8;
+    return cap < needed ? deque_UTILL::round_up_pow2__(needed) : cap;
+  }
+
+  void grow__(size_type needed) { reallocate__(next_capacity__(needed)); }
+
+  // Copy the (at most two) wrapped segments into dst, in order. Same rules
+  // as vector: memcpy for trivially relocatable types, otherwise move if
+  // it can't throw, else copy. The sources are left for release_sources__.
+  void transfer__(T *dst) {
+    size_type first_len = capacity() - head_;
+    first_len = first_len < size_ ? first_len : size_;
+    T *a = buf_ + head_;
+    T *b = buf_;
+    size_type second_len = size_ - first_len;
+    if constexpr (relocatable__) {
+      if (first_len) {
+        memcpy(static_cast<void *>(dst), static_cast<const void *>(a),
+               first_len * sizeof(T));
+      }
+      if (second_len) {
+        memcpy(static_cast<void *>(dst + first_len),
+               static_cast<const void *>(b), second_len * sizeof(T));
+      }
+    } else {
+      T *mid = transfer_range__(a, a + first_len, dst);
+      try {
+        transfer_range__(b, b + second_len, mid);
+      } catch (...) {
+        mstl::destroy(dst, mid);
+        throw;
+      }
+    }
+  }
+
+  static T *transfer_range__(T *first, T *last, T *dst) {
+    if constexpr (mstl::is_nothrow_move_constructible<T>::value ||
+                  !mstl::is_copy_constructible<T>::value) {
+      return mstl::uninitialized_move(first, last, dst);
+    } else {
+      return mstl::uninitialized_copy(first, last, dst);
+    }
+  }
+
+  void release_sources__() noexcept {
+    if constexpr (!relocatable__) {
+      for (size_type i = 0; i < size_; ++i) {
+        mstl::destroy_at(buf_ + ((head_ + i) & mask_));
+      }
+    }
+  }
+
+  // straighten the elements out into a new buffer of cap, cap is a power
+  // of two and >= size_.
+  void reallocate__(size_type cap) {
+    T *buf = alloc_traits__::allocate(alloc__(), cap);
+    try {
+      transfer__(buf);
+    } catch (...) {
+      alloc_traits__::deallocate(alloc__(), buf, cap);
+      throw;
+    }
+    adopt__(buf, cap);
+  }
+
+  void adopt__(T *buf, size_type cap) noexcept {
+    if (buf_ != nullptr) {
+      release_sources__();
+      alloc_traits__::deallocate(alloc__(), buf_, mask_ + 1);
+    }
+    buf_ = buf;
+    mask_ = cap - 1;
+    head_ = 0;
+  }
+
+  // full deque: build the new element in a new buffer first, args might
+  // point into the old one. at is size_ for the back, -1 for the front.
+  template <typename... Args>
+  void grow_emplace__(size_type at, Args &&...args) {
+    size_type cap = next_capacity__(size_ + 1);
+    T *buf = alloc_traits__::allocate(alloc__(), cap);
+    // for the front, the new element goes into the last slot and head
+    // becomes cap - 1, so the old elements still start at index 0.
+    T *slot = at == size_ ? buf + size_ : buf + (cap - 1);
+    try {
+      alloc_traits__::construct(alloc__(), slot, mstl::forward<Args>(args)...);
+    } catch (...) {
+      alloc_traits__::deallocate(alloc__(), buf, cap);
+      throw;
+    }
+    try {
+      transfer__(buf);
+    } catch (...) {
+      alloc_traits__::destroy(alloc__(), slot);
+      alloc_traits__::deallocate(alloc__(), buf, cap);
+      throw;
+    }
+    adopt__(buf, cap);
+    if (at != size_) {
+      head_ = cap - 1;
+    }
+  }
+};
+
+template <typename T, typename A>
+bool operator==(const deque<T, A> &x, const deque<T, A> &y) {
+  if (x.size() != y.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (!(x[i] == y[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T, typename A>
+bool operator!=(const deque<T, A> &x, const deque<T, A> &y) {
+  return !(x == y);
+}
+
+template <typename T, typename A>
+bool operator<(const deque<T, A> &x, const deque<T, A> &y) {
+  size_t n = x.size() < y.size() ? x.size() : y.size();
+  for (size_t i = 0; i < n; ++i) {
+    if (x[i] < y[i]) {
+      return true;
+    }
+    if (y[i] < x[i]) {
+      return false;
+    }
+  }
+  return x.size() < y.size();
+}
+
+template <typename T, typename A>
+bool operator>(const deque<T, A> &x, const deque<T, A> &y) {
+  return y < x;
+}
+
+template <typename T, typename A>
+bool operator<=(const deque<T, A> &x, const deque<T, A> &y) {
+  return !(y < x);
+}
+
+template <typename T, typename A>
+bool operator>=(const deque<T, A> &x, const deque<T, A> &y) {
+  return !(x < y);
+}
+
+template <typename T, typename A>
+void swap(deque<T, A> &x, deque<T, A> &y) noexcept {
+  x.swap(y);
+}
+
+// one pointer to the heap, like vector.
+template <typename T, typename A>
+struct is_trivially_relocatable<deque<T, A>>
+    : mstl::is_trivially_relocatable<A> {};
+
+} // namespace mstl
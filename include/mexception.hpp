@@ -12,15 +12,15 @@ public:
   exception() noexcept {}
   exception(const exception &) noexcept = default;
 
-  virtual ~exception() noexcept;
-  virtual const char *what() const noexcept;
+  virtual ~exception() noexcept {}
+  virtual const char *what() const noexcept { return "mstl::exception"; }
 };
 
 class bad_exception : public exception {
 public:
   bad_exception() noexcept {}
-  virtual ~bad_exception() noexcept;
-  virtual const char *what() const noexcept;
+  virtual ~bad_exception() noexcept {}
+  virtual const char *what() const noexcept { return "mstl::bad_exception"; }
 };
 
 } // namespace mstl
@@ -0,0 +1,586 @@
+#pragma once
+#include "malgorithm.hpp"
+#include "mconcurrency.hpp"
+#include "mconcurrent_queue.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Execution policies, the parallel overloads of the algorithms in
+// malgorithm.hpp, and the thread pool they run on. They live here so that
+// malgorithm.hpp, and every container that includes it, doesn't pull in
+// threads; include this header to use them.
+//
+//   seq        run on the calling thread, in order, like no policy at all.
+//   par        split the range over the pool. The function runs on any
+//              thread, on different elements at the same time.
+//   par_unseq  the same as par. Every chunk already runs the serial loop,
+//              SIMD fast paths included, there's nothing left to unsequence.
+//
+// The pool has a thread per core but one, the caller works too while it
+// waits. Every pool thread has a work stealing deque (Chase and Lev): it
+// pushes and pops its own tasks at the bottom, so it keeps working on what
+// is in its cache, and idle threads steal from the top, where the oldest
+// and biggest pieces are. Threads outside the pool hand their tasks over
+// through a shared queue.
+//
+// A parallel algorithm is a fork join over an index range: split it in
+// half, push the right half, go on with the left, then join the right:
+// run it here if nobody stole it, or help with other tasks until the
+// thief is done. Ranges stop splitting at n / (8 * threads) elements, so
+// there are a few pieces per thread to balance the load, but never below
+// min_chunk__, where splitting costs more than the work.
+//
+// note: like std, an exception escaping the function of a parallel
+// algorithm calls std::terminate.
+namespace mstl::execution {
+
+struct sequenced_policy {};
+struct parallel_policy {};
+struct parallel_unsequenced_policy {};
+
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy par{};
+inline constexpr parallel_unsequenced_policy par_unseq{};
+
+} // namespace mstl::execution
+
+namespace mstl {
+
+template <typename T> struct is_execution_policy : mstl::false_type {};
+template <>
+struct is_execution_policy<execution::sequenced_policy> : mstl::true_type {};
+template <>
+struct is_execution_policy<execution::parallel_policy> : mstl::true_type {};
+template <>
+struct is_execution_policy<execution::parallel_unsequenced_policy>
+    : mstl::true_type {};
+
+} // namespace mstl
+
+namespace mstl::execution_UTILL {
+
+constexpr size_t line__ = concurrency_UTILL::cache_line__;
+
+// elements, below this a range isn't split any more.
+constexpr size_t min_chunk__ = 1024;
+
+// tasks. A thread only has one task pushed per level of splitting, plus
+// whatever it runs while it waits, so this is plenty. When it's full the
+// task runs at once instead.
+constexpr size_t deque_capacity__ = 1024;
+constexpr size_t inject_capacity__ = 1024;
+
+// A piece of work. It lives on the stack of the thread that spawned it,
+// which joins it before returning.
+struct task__ {
+  void (*run)(task__ *) noexcept;
+  std::atomic<bool> done{false};
+};
+
+inline void execute__(task__ *t) noexcept {
+  t->run(t);
+  t->done.store(true, std::memory_order_release);
+}
+
+// Chase and Lev's deque, with the C11 orderings of Le et al. The owner
+// pushes and pops at the bottom, anyone steals at the top. The two only
+// meet over the last task, and a CAS on top decides who gets it.
+class deque__ {
+  alignas(line__) std::atomic<int64_t> top_{0};
+  alignas(line__) std::atomic<int64_t> bottom_{0};
+  std::atomic<task__ *> tasks_[deque_capacity__];
+
+  static constexpr int64_t mask__ = int64_t(deque_capacity__) - 1;
+
+public:
+  // owner only. false when full.
+  bool push(task__ *t) noexcept {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    if (b - top >= int64_t(deque_capacity__)) {
+      return false;
+    }
+    tasks_[b & mask__].store(t, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_release);
+    return true;
+  }
+
+  // owner only, the newest task.
+  task__ *pop() noexcept {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > b) { // empty
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    task__ *t = tasks_[b & mask__].load(std::memory_order_relaxed);
+    if (top == b) { // the last one, race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        t = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return t;
+  }
+
+  // any thread, the oldest task. Null when empty or when another thread
+  // got there first.
+  task__ *steal() noexcept {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (top >= b) {
+      return nullptr;
+    }
+    task__ *t = tasks_[top & mask__].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return t;
+  }
+
+  // only a snapshot.
+  bool empty() const noexcept {
+    return bottom_.load(std::memory_order_relaxed) <=
+           top_.load(std::memory_order_relaxed);
+  }
+};
+
+class pool__ {
+  struct alignas(line__) worker__ {
+    deque__ tasks;
+    std::thread thread;
+  };
+
+  // the pool the calling thread works for, if any, and its index there.
+  struct self__ {
+    pool__ *pool;
+    size_t index;
+  };
+
+  worker__ *workers_ = nullptr;
+  size_t size_ = 0;
+  mstl::mpmc_queue<task__ *> inject_;
+  concurrency_UTILL::event__<mstl::futex_wait> work_;
+  std::atomic<bool> stop_{false};
+
+  static self__ &here__() noexcept {
+    static thread_local self__ s{nullptr, 0};
+    return s;
+  }
+
+public:
+  explicit pool__(size_t workers) : inject_(inject_capacity__) {
+    mstl::allocator<worker__> a;
+    workers_ = a.allocate(workers);
+    for (; size_ < workers; ++size_) {
+      mstl::construct_at(workers_ + size_);
+    }
+    try {
+      for (size_t i = 0; i < workers; ++i) {
+        workers_[i].thread = std::thread([this, i] { loop__(i); });
+      }
+    } catch (...) {
+      shut_down__();
+      throw;
+    }
+  }
+
+  pool__(const pool__ &) = delete;
+  pool__ &operator=(const pool__ &) = delete;
+
+  ~pool__() { shut_down__(); }
+
+  // the one the algorithms use, a thread per core but the caller's.
+  static pool__ &instance() {
+    static pool__ pool([] {
+      size_t cores = std::thread::hardware_concurrency();
+      return cores > 1 ? cores - 1 : 0;
+    }());
+    return pool;
+  }
+
+  // threads working on a parallel algorithm, the caller's included.
+  size_t concurrency() const noexcept { return size_ + 1; }
+
+  // make t runnable by any thread. false if there's no room, the caller
+  // runs it then. One task needs one thread, so only one sleeper is woken;
+  // if it splits the task further, it wakes the next.
+  bool spawn(task__ *t) noexcept {
+    self__ &s = here__();
+    bool pushed = s.pool == this ? workers_[s.index].tasks.push(t)
+                                 : inject_.try_push(t);
+    if (pushed) {
+      work_.notify_one();
+    }
+    return pushed;
+  }
+
+  // run other tasks until t is done.
+  void join(task__ *t) noexcept {
+    int idle = 0;
+    while (!t->done.load(std::memory_order_acquire)) {
+      if (task__ *other = take__()) {
+        execute__(other);
+        idle = 0;
+      } else if (++idle < concurrency_UTILL::spin_before_sleep__) {
+        concurrency_UTILL::cpu_relax__();
+      } else {
+        std::this_thread::yield(); // the thief might be off the cpu.
+      }
+    }
+  }
+
+private:
+  // the newest task of our own, else the oldest of someone else's.
+  task__ *take__() noexcept {
+    self__ &s = here__();
+    task__ *t = nullptr;
+    bool ours = s.pool == this;
+    if (ours && (t = workers_[s.index].tasks.pop()) != nullptr) {
+      return t;
+    }
+    if (inject_.try_pop(t)) {
+      return t;
+    }
+    // start with the next thread over, so thieves spread out.
+    size_t start = ours ? s.index + 1 : 0;
+    for (size_t k = 0; k < size_; ++k) {
+      if ((t = workers_[(start + k) % size_].tasks.steal()) != nullptr) {
+        return t;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_work__() const noexcept {
+    if (!inject_.empty()) {
+      return true;
+    }
+    for (size_t i = 0; i < size_; ++i) {
+      if (!workers_[i].tasks.empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void loop__(size_t index) noexcept {
+    here__() = {this, index};
+    while (!stop_.load(std::memory_order_acquire)) {
+      if (task__ *t = take__()) {
+        execute__(t);
+        continue;
+      }
+      work_.wait_until([this] {
+        return stop_.load(std::memory_order_acquire) || has_work__();
+      });
+    }
+  }
+
+  void shut_down__() noexcept {
+    stop_.store(true, std::memory_order_release);
+    work_.notify();
+    for (size_t i = 0; i < size_; ++i) {
+      if (workers_[i].thread.joinable()) {
+        workers_[i].thread.join();
+      }
+      mstl::destroy_at(workers_ + i);
+    }
+    mstl::allocator<worker__>().deallocate(workers_, size_);
+  }
+};
+
+/*
+ * fork join over [0, n)
+ */
+
+// skip the indices from *stop up, if there is a stop.
+inline bool stopped__(const std::atomic<size_t> *stop, size_t i) noexcept {
+  return stop != nullptr && i >= stop->load(std::memory_order_relaxed);
+}
+
+template <typename Body> struct range_task__ : task__ {
+  pool__ *pool;
+  const Body *body;
+  const std::atomic<size_t> *stop;
+  size_t begin;
+  size_t end;
+  size_t chunk;
+};
+
+template <typename Body>
+void split__(pool__ &pool, const Body &body, const std::atomic<size_t> *stop,
+             size_t begin, size_t end, size_t chunk) noexcept {
+  if (stopped__(stop, begin)) {
+    return;
+  }
+  if (end - begin <= chunk) {
+    body(begin, end);
+    return;
+  }
+  size_t mid = begin + (end - begin) / 2;
+  range_task__<Body> right;
+  right.run = [](task__ *t) noexcept {
+    auto *r = static_cast<range_task__<Body> *>(t);
+    split__(*r->pool, *r->body, r->stop, r->begin, r->end, r->chunk);
+  };
+  right.pool = &pool;
+  right.body = &body;
+  right.stop = stop;
+  right.begin = mid;
+  right.end = end;
+  right.chunk = chunk;
+  bool spawned = pool.spawn(&right);
+  split__(pool, body, stop, begin, mid, chunk);
+  if (spawned) {
+    pool.join(&right);
+  } else {
+    execute__(&right);
+  }
+}
+
+// call body(begin, end) on pieces of [0, n), in parallel. Pieces starting
+// at or past *stop are skipped.
+template <typename Body>
+void for_ranges__(pool__ &pool, size_t n, const Body &body,
+                  const std::atomic<size_t> *stop = nullptr) {
+  size_t threads = pool.concurrency();
+  if (threads == 1 || n < 2 * min_chunk__) {
+    body(size_t(0), n);
+    return;
+  }
+  size_t chunk = n / (8 * threads);
+  split__(pool, body, stop, 0, n, chunk > min_chunk__ ? chunk : min_chunk__);
+}
+
+template <typename Body>
+void for_ranges__(size_t n, const Body &body,
+                  const std::atomic<size_t> *stop = nullptr) {
+  for_ranges__(pool__::instance(), n, body, stop);
+}
+
+// look for an i in [0, n) with hit(i), n if there is none. With first
+// the smallest one: pieces past a hit stop. Without, any hit stops
+// everything, and only whether there was one counts.
+template <typename Hit>
+size_t search__(pool__ &pool, size_t n, const Hit &hit, bool first) {
+  std::atomic<size_t> found{n};
+  for_ranges__(
+      pool, n,
+      [&](size_t begin, size_t end) {
+        // between blocks, check if someone found one before us.
+        for (size_t i = begin; i < end && !stopped__(&found, i);) {
+          size_t block = end - i < min_chunk__ ? end : i + min_chunk__;
+          for (; i < block; ++i) {
+            if (hit(i)) {
+              size_t want = first ? i : 0;
+              size_t cur = found.load(std::memory_order_relaxed);
+              while (want < cur &&
+                     !found.compare_exchange_weak(cur, want,
+                                                  std::memory_order_relaxed)) {
+              }
+              return;
+            }
+          }
+        }
+      },
+      &found);
+  return found.load(std::memory_order_relaxed);
+}
+
+template <typename Hit> size_t find_first__(size_t n, const Hit &hit) {
+  return search__(pool__::instance(), n, hit, true);
+}
+
+template <typename Hit> bool find_any__(size_t n, const Hit &hit) {
+  return search__(pool__::instance(), n, hit, false) != n;
+}
+
+} // namespace mstl::execution_UTILL
+
+// Parallel algorithms, the overloads of the malgorithm.hpp ones that take
+// an execution policy first. They split the index range over the pool and run
+// the serial algorithm on every piece, so the pieces keep the memmove and
+// SIMD fast paths. The searches stop early: find_if skips the pieces past
+// a match, any_of, all_of and none_of stop everything at the first one.
+//
+// note: only random access ranges run in parallel, anything else, and seq,
+// is the serial algorithm.
+namespace mstl::execution_UTILL {
+
+template <typename P, typename R = void>
+using if_policy__ = mstl::enable_if_t<
+    mstl::is_execution_policy<typename mstl::remove_cvref<P>::type>::value,
+    R>;
+
+template <typename P, typename... Iters>
+constexpr bool is_parallel__ =
+    !mstl::is_same<typename mstl::remove_cvref<P>::type,
+                   mstl::execution::sequenced_policy>::value &&
+    (mstl::is_convertible<
+         typename mstl::iterator_traits<Iters>::iterator_category,
+         mstl::random_access_iterator_tag>::value &&
+     ...);
+
+} // namespace mstl::execution_UTILL
+
+namespace mstl {
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryFunction>
+execution_UTILL::if_policy__<ExecutionPolicy>
+for_each(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+         UnaryFunction fn) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt>) {
+    execution_UTILL::for_ranges__(
+        size_t(last - first), [&](size_t b, size_t e) {
+          mstl::for_each(first + ptrdiff_t(b), first + ptrdiff_t(e), fn);
+        });
+  } else {
+    mstl::for_each(first, last, fn);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt1, typename ForwardIt2,
+          typename UnaryOperation>
+execution_UTILL::if_policy__<ExecutionPolicy, ForwardIt2>
+transform(ExecutionPolicy &&, ForwardIt1 first, ForwardIt1 last,
+          ForwardIt2 d_first, UnaryOperation op) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt1,
+                                               ForwardIt2>) {
+    ptrdiff_t n = last - first;
+    execution_UTILL::for_ranges__(size_t(n), [&](size_t b, size_t e) {
+      mstl::transform(first + ptrdiff_t(b), first + ptrdiff_t(e),
+                      d_first + ptrdiff_t(b), op);
+    });
+    return d_first + n;
+  } else {
+    return mstl::transform(first, last, d_first, op);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt1, typename ForwardIt2,
+          typename ForwardIt3, typename BinaryOperation>
+execution_UTILL::if_policy__<ExecutionPolicy, ForwardIt3>
+transform(ExecutionPolicy &&, ForwardIt1 first1, ForwardIt1 last1,
+          ForwardIt2 first2, ForwardIt3 d_first, BinaryOperation op) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt1,
+                                               ForwardIt2, ForwardIt3>) {
+    ptrdiff_t n = last1 - first1;
+    execution_UTILL::for_ranges__(size_t(n), [&](size_t b, size_t e) {
+      mstl::transform(first1 + ptrdiff_t(b), first1 + ptrdiff_t(e),
+                      first2 + ptrdiff_t(b), d_first + ptrdiff_t(b), op);
+    });
+    return d_first + n;
+  } else {
+    return mstl::transform(first1, last1, first2, d_first, op);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename T>
+execution_UTILL::if_policy__<ExecutionPolicy>
+fill(ExecutionPolicy &&, ForwardIt first, ForwardIt last, const T &value) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt>) {
+    execution_UTILL::for_ranges__(
+        size_t(last - first), [&](size_t b, size_t e) {
+          mstl::fill(first + ptrdiff_t(b), first + ptrdiff_t(e), value);
+        });
+  } else {
+    mstl::fill(first, last, value);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt1, typename ForwardIt2>
+execution_UTILL::if_policy__<ExecutionPolicy, ForwardIt2>
+copy(ExecutionPolicy &&, ForwardIt1 first, ForwardIt1 last,
+     ForwardIt2 d_first) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt1,
+                                               ForwardIt2>) {
+    ptrdiff_t n = last - first;
+    execution_UTILL::for_ranges__(size_t(n), [&](size_t b, size_t e) {
+      mstl::copy(first + ptrdiff_t(b), first + ptrdiff_t(e),
+                 d_first + ptrdiff_t(b));
+    });
+    return d_first + n;
+  } else {
+    return mstl::copy(first, last, d_first);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
+execution_UTILL::if_policy__<
+    ExecutionPolicy, typename mstl::iterator_traits<ForwardIt>::difference_type>
+count_if(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+         UnaryPredicate pred) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt>) {
+    using difference_type =
+        typename mstl::iterator_traits<ForwardIt>::difference_type;
+    std::atomic<difference_type> total{0};
+    execution_UTILL::for_ranges__(
+        size_t(last - first), [&](size_t b, size_t e) {
+          total.fetch_add(mstl::count_if(first + ptrdiff_t(b),
+                                         first + ptrdiff_t(e), pred),
+                          std::memory_order_relaxed);
+        });
+    return total.load(std::memory_order_relaxed);
+  } else {
+    return mstl::count_if(first, last, pred);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
+execution_UTILL::if_policy__<ExecutionPolicy, ForwardIt>
+find_if(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+        UnaryPredicate pred) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt>) {
+    size_t i = execution_UTILL::find_first__(
+        size_t(last - first),
+        [&](size_t k) -> bool { return pred(first[ptrdiff_t(k)]); });
+    return first + ptrdiff_t(i);
+  } else {
+    return mstl::find_if(first, last, pred);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
+execution_UTILL::if_policy__<ExecutionPolicy, bool>
+any_of(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+       UnaryPredicate pred) {
+  if constexpr (execution_UTILL::is_parallel__<ExecutionPolicy, ForwardIt>) {
+    return execution_UTILL::find_any__(
+        size_t(last - first),
+        [&](size_t k) -> bool { return pred(first[ptrdiff_t(k)]); });
+  } else {
+    return mstl::any_of(first, last, pred);
+  }
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
+execution_UTILL::if_policy__<ExecutionPolicy, bool>
+all_of(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last,
+       UnaryPredicate pred) {
+  return !mstl::any_of(
+      mstl::forward<ExecutionPolicy>(policy), first, last,
+      [&](const auto &v) -> bool { return !pred(v); });
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
+execution_UTILL::if_policy__<ExecutionPolicy, bool>
+none_of(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last,
+        UnaryPredicate pred) {
+  return !mstl::any_of(mstl::forward<ExecutionPolicy>(policy), first, last,
+                       pred);
+}
+
+} // namespace mstl
@@ -0,0 +1,1132 @@
+#pragma once
+#include "mexception.hpp"
+#include "mfunctional.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Open addressing hash tables, swiss table style.
+//
+// Elements live directly in one flat array of slots, no nodes and no
+// chains. Next to the slots is an array of control bytes, one per slot:
+//
+//   empty     1000 0000
+//   deleted   1111 1110
+//   sentinel  1111 1111   (one past the last slot, stops iteration)
+//   full      0hhh hhhh   (the low 7 bits of the hash, "h2")
+//
+// A lookup hashes the key once, the high bits pick where to start ("h1"),
+// and then reads the control bytes a group at a time: 16 with SSE2, 8 with
+// plain 64 bit arithmetic elsewhere. One compare finds every slot in the
+// group whose h2 matches, so the key comparison is only done on those,
+// and a false hit happens 1 time in 128. Any empty byte in the group ends
+// the search. Most lookups touch one cache line of control bytes and one
+// slot.
+//
+// The table is kept at most 7/8 full. Erase only leaves a tombstone
+// (deleted) when a probe could have walked past the slot while its group
+// was full. Otherwise the slot goes straight back to empty, so tables that
+// churn don't fill up with tombstones and rehash.
+//
+// note: like every open addressing table, pointers and iterators are
+// invalidated by any insert that grows the table. After reserve(n) the
+// first n elements go in without growing.
+// note: the hash and the move of an element must not throw while the
+// table grows, an exception in the middle of a rehash loses elements.
+namespace mstl::flat_hash_UTILL {
+
+using ctrl_t = signed char;
+
+constexpr ctrl_t empty__ = -128;
+constexpr ctrl_t deleted__ = -2;
+constexpr ctrl_t sentinel__ = -1;
+
+constexpr bool is_full__(ctrl_t c) noexcept { return c >= 0; }
+
+// Set of slots out of a group, as a bit mask. Shift is log2 of the bits
+// per slot: SSE2 gives one bit per slot, the portable version one bit in
+// each byte.
+template <typename M, size_t Width, size_t Shift> class bitmask__ {
+  M mask_;
+
+public:
+  explicit bitmask__(M mask) noexcept : mask_(mask) {}
+
+  explicit operator bool() const noexcept { return mask_ != 0; }
+
+  uint32_t lowest() const noexcept {
+    return static_cast<uint32_t>(__builtin_ctzll(mask_)) >> Shift;
+  }
+
+  uint32_t trailing_zeros() const noexcept {
+    return mask_ == 0 ? Width : lowest();
+  }
+
+  uint32_t leading_zeros() const noexcept {
+    constexpr size_t extra = 64 - (Width << Shift);
+    return mask_ == 0 ? Width
+                      : static_cast<uint32_t>(__builtin_clzll(
+                            static_cast<uint64_t>(mask_) << extra)) >>
+                            Shift;
+  }
+
+  // for (uint32_t i : mask) visits the set slots in order.
+  uint32_t operator*() const noexcept { return lowest(); }
+  bitmask__ &operator++() noexcept {
+    mask_ &= mask_ - 1;
+    return *this;
+  }
+  bitmask__ begin() const noexcept { return *this; }
+  bitmask__ end() const noexcept { return bitmask__(0); }
+  bool operator!=(const bitmask__ &other) const noexcept {
+    return mask_ != other.mask_;
+  }
+};
+
+#ifdef __SSE2__
+
+// SSE2 is part of x86-64, so every x86-64 build takes this path. AVX2
+// would allow 32 byte groups, but that doubles the false hits per probe
+// and the extra bytes are almost never needed at 7/8 load, so the group
+// stays at 16 there too.
+struct group__ {
+  static constexpr size_t width = 16;
+
+  __m128i ctrl;
+
+  explicit group__(const ctrl_t *p) noexcept
+      : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+  bitmask__<uint32_t, width, 0> match(ctrl_t h2) const noexcept {
+    return bitmask__<uint32_t, width, 0>(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+  }
+
+  bitmask__<uint32_t, width, 0> mask_empty() const noexcept {
+    return match(empty__);
+  }
+
+  // empty and deleted are the only bytes below the sentinel.
+  bitmask__<uint32_t, width, 0> mask_empty_or_deleted() const noexcept {
+    return bitmask__<uint32_t, width, 0>(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(sentinel__), ctrl))));
+  }
+
+  uint32_t count_leading_empty_or_deleted() const noexcept {
+    uint32_t mask = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(sentinel__), ctrl)));
+    return static_cast<uint32_t>(__builtin_ctz(mask + 1));
+  }
+};
+
+#else
+
+// The same with 8 control bytes in a uint64_t. The result has the high bit
+// of every selected byte set.
+struct group__ {
+  static constexpr size_t width = 8;
+  static constexpr uint64_t msbs = 0x8080808080808080ull;
+  static constexpr uint64_t lsbs = 0x0101010101010101ull;
+
+  uint64_t ctrl;
+
+  explicit group__(const ctrl_t *p) noexcept {
+    memcpy(&ctrl, p, sizeof(ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    ctrl = __builtin_bswap64(ctrl);
+#endif
+  }
+
+  // zero byte detection on ctrl ^ h2. It can report a byte right above a
+  // real match that doesn't match, which only costs a key comparison.
+  bitmask__<uint64_t, width, 3> match(ctrl_t h2) const noexcept {
+    uint64_t x = ctrl ^ (lsbs * static_cast<unsigned char>(h2));
+    return bitmask__<uint64_t, width, 3>((x - lsbs) & ~x & msbs);
+  }
+
+  // empty is the only byte with the high bit set and bit 1 clear.
+  bitmask__<uint64_t, width, 3> mask_empty() const noexcept {
+    return bitmask__<uint64_t, width, 3>(ctrl & (~ctrl << 6) & msbs);
+  }
+
+  // and empty or deleted the only ones with the high bit set and bit 0
+  // clear.
+  bitmask__<uint64_t, width, 3> mask_empty_or_deleted() const noexcept {
+    return bitmask__<uint64_t, width, 3>(ctrl & (~ctrl << 7) & msbs);
+  }
+
+  uint32_t count_leading_empty_or_deleted() const noexcept {
+    constexpr uint64_t gaps = 0x00FEFEFEFEFEFEFEull;
+    return static_cast<uint32_t>(
+        (__builtin_ctzll(((~ctrl & (ctrl >> 7)) | gaps) + 1) + 7) >> 3);
+  }
+};
+
+#endif
+
+constexpr size_t width__ = group__::width;
+
+// What an empty table points at, so lookups on it need no branch. A group
+// load sees a sentinel and then nothing but empty bytes.
+alignas(16) inline constexpr ctrl_t empty_group__[16] = {
+    sentinel__, empty__, empty__, empty__, empty__, empty__,
+    empty__,    empty__, empty__, empty__, empty__, empty__,
+    empty__,    empty__, empty__, empty__};
+
+// Groups are visited in triangular steps: offsets h1, +1, +3, +6... groups
+// away. With a power of two number of slots that hits every group once.
+struct probe__ {
+  size_t mask;
+  size_t offset;
+  size_t index = 0;
+
+  probe__(size_t h1, size_t mask) noexcept : mask(mask), offset(h1 & mask) {}
+
+  size_t at(size_t i) const noexcept { return (offset + i) & mask; }
+
+  void next() noexcept {
+    index += width__;
+    offset = (offset + index) & mask;
+  }
+};
+
+// capacities are 2^k - 1, so capacity is also the mask.
+constexpr size_t normalize_capacity__(size_t n) noexcept {
+  size_t cap = width__ - 1;
+  while (cap < n) {
+    cap = cap * 2 + 1;
+  }
+  return cap;
+}
+
+// 7/8 of the slots, but at least one must stay empty so every probe ends.
+// cap - cap / 8 would fill all 7 slots of the smallest portable table.
+constexpr size_t capacity_to_growth__(size_t cap) noexcept {
+  return cap == 7 ? 6 : cap - cap / 8;
+}
+
+// smallest capacity that holds n elements below the max load factor.
+constexpr size_t growth_to_capacity__(size_t n) noexcept {
+  if (n == 0) {
+    return 0;
+  }
+  size_t cap = normalize_capacity__(n + (n - 1) / 7);
+  return capacity_to_growth__(cap) < n ? cap * 2 + 1 : cap;
+}
+
+using functional_UTILL::is_avalanching__;
+
+template <typename K> struct set_policy__ {
+  using key_type = K;
+  using value_type = K;
+  static constexpr bool is_set = true;
+
+  static const K &key(const value_type &v) noexcept { return v; }
+
+  template <typename Alloc>
+  static void transfer(Alloc &a, value_type *dst, value_type *src) {
+    mstl::allocator_traits<Alloc>::construct(a, dst, mstl::move(*src));
+    mstl::allocator_traits<Alloc>::destroy(a, src);
+  }
+};
+
+template <typename K, typename V> struct map_policy__ {
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = mstl::pair<const K, V>;
+  static constexpr bool is_set = false;
+
+  static const K &key(const value_type &v) noexcept { return v.first; }
+
+  // the key is const for users, but the table owns the slot and is about
+  // to destroy it, so moving out of it is fine.
+  template <typename Alloc>
+  static void transfer(Alloc &a, value_type *dst, value_type *src) {
+    mstl::allocator_traits<Alloc>::construct(
+        a, dst, mstl::move(const_cast<K &>(src->first)),
+        mstl::move(src->second));
+    mstl::allocator_traits<Alloc>::destroy(a, src);
+  }
+};
+
+template <typename Policy, typename Hash, typename Eq, typename Alloc>
+class table__;
+
+// Sets hand out const elements from both iterators, the key can't change.
+template <typename T, bool Const, bool Set> class iterator__ {
+  template <typename, bool, bool> friend class iterator__;
+  template <typename, typename, typename, typename> friend class table__;
+
+  using elem__ = typename mstl::conditional<Const || Set, const T, T>::type;
+
+  ctrl_t *ctrl_ = nullptr;
+  T *slot_ = nullptr;
+
+  iterator__(ctrl_t *ctrl, T *slot) noexcept : ctrl_(ctrl), slot_(slot) {}
+
+  // jump over empty and deleted slots, a group at a time.
+  void skip__() noexcept {
+    while (*ctrl_ < sentinel__) {
+      uint32_t n = group__(ctrl_).count_leading_empty_or_deleted();
+      ctrl_ += n;
+      slot_ += n;
+    }
+  }
+
+public:
+  using iterator_category = mstl::forward_iterator_tag;
+  using value_type = T;
+  using difference_type = ptrdiff_t;
+  using pointer = elem__ *;
+  using reference = elem__ &;
+
+  iterator__() noexcept = default;
+
+  template <bool C, typename = mstl::enable_if_t<Const && !C>>
+  iterator__(const iterator__<T, C, Set> &other) noexcept
+      : ctrl_(other.ctrl_), slot_(other.slot_) {}
+
+  reference operator*() const noexcept { return *slot_; }
+  pointer operator->() const noexcept { return slot_; }
+
+  iterator__ &operator++() noexcept {
+    ++ctrl_;
+    ++slot_;
+    skip__();
+    return *this;
+  }
+
+  iterator__ operator++(int) noexcept {
+    iterator__ tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  template <bool C>
+  bool operator==(const iterator__<T, C, Set> &other) const noexcept {
+    return ctrl_ == other.ctrl_;
+  }
+  template <bool C>
+  bool operator!=(const iterator__<T, C, Set> &other) const noexcept {
+    return ctrl_ != other.ctrl_;
+  }
+};
+
+// The table behind flat_hash_set and flat_hash_map. Policy says what an
+// element is and where its key is.
+//
+// Layout is one allocation, the slots first and then the control bytes:
+//
+//   [ slot 0 ... slot cap-1 | ctrl 0 ... ctrl cap-1, sentinel, clones ]
+//
+// The last width - 1 bytes repeat the first ones, so a group can be loaded
+// at any slot without wrapping around.
+template <typename Policy, typename Hash, typename Eq, typename Alloc>
+class table__ {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Hash>::value &&
+      functional_UTILL::is_transparent__<Eq>::value;
+
+public:
+  using key_type = typename Policy::key_type;
+  using value_type = typename Policy::value_type;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = Eq;
+  using allocator_type = Alloc;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = value_type *;
+  using const_pointer = const value_type *;
+
+  using iterator = iterator__<value_type, false, Policy::is_set>;
+  using const_iterator = iterator__<value_type, true, Policy::is_set>;
+
+  template <typename K>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<K, key_type>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::value_type,
+                              value_type>::value,
+                "allocator value_type must be the table's value_type");
+  static_assert(
+      mstl::is_same<typename alloc_traits__::pointer, value_type *>::value,
+      "flat hash tables need an allocator with raw pointers");
+
+private:
+  static constexpr bool relocatable__ =
+      mstl::is_trivially_relocatable<value_type>::value &&
+      !allocator_traits_UTILL::has_construct__<Alloc, value_type,
+                                               value_type &&>::value &&
+      !allocator_traits_UTILL::has_destroy__<Alloc, value_type>::value;
+
+  ctrl_t *ctrl_ = const_cast<ctrl_t *>(empty_group__);
+  value_type *slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  size_type growth_left_ = 0;
+  memory_UTIL::compressed_pair__<Hash,
+                                 memory_UTIL::compressed_pair__<Eq, Alloc>>
+      fns_;
+
+public:
+  table__() noexcept(noexcept(Hash()) && noexcept(Eq()) &&
+                     noexcept(Alloc()))
+      : fns_(Hash(), memory_UTIL::compressed_pair__<Eq, Alloc>(Eq(),
+                                                               Alloc())) {}
+
+  explicit table__(size_type bucket_count, const Hash &hash = Hash(),
+                   const Eq &eq = Eq(), const Alloc &a = Alloc())
+      : fns_(hash, memory_UTIL::compressed_pair__<Eq, Alloc>(eq, a)) {
+    if (bucket_count != 0) {
+      allocate__(normalize_capacity__(bucket_count));
+    }
+  }
+
+  explicit table__(const Alloc &a)
+      : fns_(Hash(), memory_UTIL::compressed_pair__<Eq, Alloc>(Eq(), a)) {}
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  table__(InputIt first, InputIt last, size_type bucket_count = 0,
+          const Hash &hash = Hash(), const Eq &eq = Eq(),
+          const Alloc &a = Alloc())
+      : table__(bucket_count, hash, eq, a) {
+    insert(first, last);
+  }
+
+  table__(std::initializer_list<value_type> il, size_type bucket_count = 0,
+          const Hash &hash = Hash(), const Eq &eq = Eq(),
+          const Alloc &a = Alloc())
+      : table__(il.begin(), il.end(), bucket_count, hash, eq, a) {}
+
+  table__(const table__ &other)
+      : table__(other,
+                alloc_traits__::select_on_container_copy_construction(
+                    other.alloc__())) {}
+
+  table__(const table__ &other, const Alloc &a)
+      : fns_(other.hash_function(),
+             memory_UTIL::compressed_pair__<Eq, Alloc>(other.key_eq(), a)) {
+    copy_from__(other);
+  }
+
+  table__(table__ &&other) noexcept
+      : fns_(mstl::move(other.fns_)) {
+    steal__(other);
+  }
+
+  ~table__() {
+    destroy_all__();
+    release__();
+  }
+
+  table__ &operator=(const table__ &other) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    release__();
+    if constexpr (alloc_traits__::propagate_on_container_copy_assignment::
+                      value) {
+      alloc__() = other.alloc__();
+    }
+    hash__() = other.hash__();
+    eq__() = other.eq__();
+    copy_from__(other);
+    return *this;
+  }
+
+  table__ &operator=(table__ &&other) noexcept(
+      alloc_traits__::propagate_on_container_move_assignment::value ||
+      alloc_traits__::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    hash__() = mstl::move(other.hash__());
+    eq__() = mstl::move(other.eq__());
+    if constexpr (alloc_traits__::propagate_on_container_move_assignment::
+                      value) {
+      release__();
+      alloc__() = mstl::move(other.alloc__());
+      steal__(other);
+    } else {
+      if (alloc__() == other.alloc__()) {
+        release__();
+        steal__(other);
+      } else {
+        reserve(other.size_);
+        for (auto &v : other) {
+          insert(mstl::move(v));
+        }
+        other.clear();
+      }
+    }
+    return *this;
+  }
+
+  table__ &operator=(std::initializer_list<value_type> il) {
+    clear();
+    insert(il);
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept { return alloc__(); }
+  hasher hash_function() const { return hash__(); }
+  key_equal key_eq() const { return eq__(); }
+
+  /*
+   * iterators
+   */
+  iterator begin() noexcept {
+    iterator it(ctrl_, slots_);
+    it.skip__();
+    return it;
+  }
+  const_iterator begin() const noexcept {
+    return const_cast<table__ *>(this)->begin();
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+
+  iterator end() noexcept {
+    return iterator(ctrl_ + capacity_, slots_ + capacity_);
+  }
+  const_iterator end() const noexcept {
+    return const_cast<table__ *>(this)->end();
+  }
+  const_iterator cend() const noexcept { return end(); }
+
+  /*
+   * capacity
+   */
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  size_type max_size() const noexcept {
+    return alloc_traits__::max_size(alloc__()) / 2;
+  }
+
+  // number of slots.
+  size_type capacity() const noexcept { return capacity_; }
+  size_type bucket_count() const noexcept { return capacity_; }
+
+  float load_factor() const noexcept {
+    return capacity_ == 0 ? 0.0f : float(size_) / float(capacity_);
+  }
+  // fixed, the control byte scheme assumes 7/8.
+  float max_load_factor() const noexcept { return 7.0f / 8.0f; }
+
+  // make room for n elements. Inserting up to n never rehashes after.
+  void reserve(size_type n) {
+    if (n > size_ + growth_left_) {
+      resize__(growth_to_capacity__(n));
+    }
+  }
+
+  // rebuild with at least n slots, or as few as the elements need with
+  // n = 0. Also drops every tombstone.
+  void rehash(size_type n) {
+    size_type cap = growth_to_capacity__(size_);
+    if (n > cap) {
+      cap = normalize_capacity__(n);
+    }
+    if (cap == 0) {
+      release__();
+      return;
+    }
+    resize__(cap);
+  }
+
+  /*
+   * modifiers
+   */
+
+  // keeps the slots, so a table reused for every request doesn't
+  // allocate again.
+  void clear() noexcept {
+    if (capacity_ == 0) {
+      return;
+    }
+    destroy_all__();
+    reset_ctrl__();
+    size_ = 0;
+    growth_left_ = capacity_to_growth__(capacity_);
+  }
+
+  mstl::pair<iterator, bool> insert(const value_type &v) {
+    return emplace_key__(Policy::key(v), v);
+  }
+
+  mstl::pair<iterator, bool> insert(value_type &&v) {
+    return emplace_key__(Policy::key(v), mstl::move(v));
+  }
+
+  iterator insert(const_iterator, const value_type &v) {
+    return insert(v).first;
+  }
+  iterator insert(const_iterator, value_type &&v) {
+    return insert(mstl::move(v)).first;
+  }
+
+  template <typename InputIt> void insert(InputIt first, InputIt last) {
+    if constexpr (mstl::is_convertible<
+                      typename mstl::iterator_traits<
+                          InputIt>::iterator_category,
+                      mstl::forward_iterator_tag>::value) {
+      reserve(size_ + static_cast<size_type>(mstl::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> il) {
+    insert(il.begin(), il.end());
+  }
+
+  // the element is built first to get at its key, and dropped if the key
+  // is already there.
+  template <typename... Args>
+  mstl::pair<iterator, bool> emplace(Args &&...args) {
+    value_type v(mstl::forward<Args>(args)...);
+    return emplace_key__(Policy::key(v), mstl::move(v));
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator, Args &&...args) {
+    return emplace(mstl::forward<Args>(args)...).first;
+  }
+
+  iterator erase(const_iterator pos) {
+    iterator it(pos.ctrl_, pos.slot_);
+    erase_at__(size_type(it.ctrl_ - ctrl_));
+    ++it;
+    return it;
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.ctrl_, last.slot_);
+  }
+
+  template <typename K = key_type> size_type erase(const key_arg<K> &key) {
+    size_type idx = find_index__(key);
+    if (idx == capacity_) {
+      return 0;
+    }
+    erase_at__(idx);
+    return 1;
+  }
+
+  void swap(table__ &other) noexcept {
+    if constexpr (alloc_traits__::propagate_on_container_swap::value) {
+      swap__(alloc__(), other.alloc__());
+    }
+    swap__(hash__(), other.hash__());
+    swap__(eq__(), other.eq__());
+    swap__(ctrl_, other.ctrl_);
+    swap__(slots_, other.slots_);
+    swap__(capacity_, other.capacity_);
+    swap__(size_, other.size_);
+    swap__(growth_left_, other.growth_left_);
+  }
+
+  /*
+   * lookup
+   */
+  template <typename K = key_type> iterator find(const key_arg<K> &key) {
+    return iterator_at__(find_index__(key));
+  }
+
+  template <typename K = key_type>
+  const_iterator find(const key_arg<K> &key) const {
+    return const_cast<table__ *>(this)->find(key);
+  }
+
+  template <typename K = key_type>
+  bool contains(const key_arg<K> &key) const {
+    return find_index__(key) != capacity_;
+  }
+
+  template <typename K = key_type>
+  size_type count(const key_arg<K> &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  template <typename K = key_type>
+  mstl::pair<iterator, iterator> equal_range(const key_arg<K> &key) {
+    iterator it = find(key);
+    if (it == end()) {
+      return {it, it};
+    }
+    iterator next = it;
+    return {it, ++next};
+  }
+
+  template <typename K = key_type>
+  mstl::pair<const_iterator, const_iterator>
+  equal_range(const key_arg<K> &key) const {
+    auto r = const_cast<table__ *>(this)->equal_range(key);
+    return {r.first, r.second};
+  }
+
+  // Pull the key's first group and slot into cache. Issue it for a batch
+  // of keys before looking them up and the misses overlap.
+  template <typename K = key_type>
+  void prefetch([[maybe_unused]] const key_arg<K> &key) const noexcept {
+#if defined(__GNUC__)
+    size_type off = probe__(h1__(hash_of__(key)), capacity_).offset;
+    __builtin_prefetch(ctrl_ + off);
+    __builtin_prefetch(slots_ + off);
+#endif
+  }
+
+protected:
+  // index of the key's slot, or capacity_.
+  template <typename K> size_type find_index__(const K &key) const {
+    size_t hash = hash_of__(key);
+    ctrl_t h2 = h2__(hash);
+    probe__ seq(h1__(hash), capacity_);
+    while (true) {
+      group__ g(ctrl_ + seq.offset);
+      for (uint32_t i : g.match(h2)) {
+        size_type idx = seq.at(i);
+        if (eq__()(Policy::key(slots_[idx]), key)) {
+          return idx;
+        }
+      }
+      if (g.mask_empty()) {
+        return capacity_;
+      }
+      seq.next();
+    }
+  }
+
+  // the slot holding key, or a fresh one claimed for it. The caller must
+  // construct the element in a fresh slot, or give it back with
+  // erase_meta__ if that throws.
+  template <typename K>
+  mstl::pair<size_type, bool> find_or_prepare_insert__(const K &key) {
+    size_t hash = hash_of__(key);
+    ctrl_t h2 = h2__(hash);
+    probe__ seq(h1__(hash), capacity_);
+    while (true) {
+      group__ g(ctrl_ + seq.offset);
+      for (uint32_t i : g.match(h2)) {
+        size_type idx = seq.at(i);
+        if (eq__()(Policy::key(slots_[idx]), key)) {
+          return {idx, false};
+        }
+      }
+      if (g.mask_empty()) {
+        break;
+      }
+      seq.next();
+    }
+    return {prepare_insert__(hash), true};
+  }
+
+  template <typename K, typename... Args>
+  mstl::pair<iterator, bool> emplace_key__(const K &key, Args &&...args) {
+    auto r = find_or_prepare_insert__(key);
+    if (r.second) {
+      construct_at__(r.first, mstl::forward<Args>(args)...);
+    }
+    return {iterator_at__(r.first), r.second};
+  }
+
+  template <typename... Args>
+  void construct_at__(size_type idx, Args &&...args) {
+    try {
+      alloc_traits__::construct(alloc__(), slots_ + idx,
+                                mstl::forward<Args>(args)...);
+    } catch (...) {
+      erase_meta__(idx);
+      throw;
+    }
+  }
+
+  iterator iterator_at__(size_type idx) noexcept {
+    return iterator(ctrl_ + idx, slots_ + idx);
+  }
+
+  value_type &slot__(size_type idx) noexcept { return slots_[idx]; }
+
+private:
+  template <typename T> static void swap__(T &a, T &b) {
+    T tmp(mstl::move(a));
+    a = mstl::move(b);
+    b = mstl::move(tmp);
+  }
+
+  Hash &hash__() noexcept { return fns_.first(); }
+  const Hash &hash__() const noexcept { return fns_.first(); }
+  Eq &eq__() noexcept { return fns_.second().first(); }
+  const Eq &eq__() const noexcept { return fns_.second().first(); }
+  Alloc &alloc__() noexcept { return fns_.second().second(); }
+  const Alloc &alloc__() const noexcept { return fns_.second().second(); }
+
+  // a hash that isn't known to be good gets one more multiply, the low
+  // bits pick the group and the high ones are compared.
+  template <typename K> size_t hash_of__(const K &key) const {
+    size_t h = hash__()(key);
+    if constexpr (!is_avalanching__<Hash>::value) {
+      h = functional_UTILL::mul_fold__(h ^ functional_UTILL::k0__,
+                                       functional_UTILL::k1__);
+    }
+    return h;
+  }
+
+  static size_t h1__(size_t hash) noexcept { return hash >> 7; }
+  static ctrl_t h2__(size_t hash) noexcept { return ctrl_t(hash & 0x7f); }
+
+  // write a control byte, and its clone if it has one.
+  void set_ctrl__(size_type i, ctrl_t h) noexcept {
+    ctrl_[i] = h;
+    ctrl_[((i - (width__ - 1)) & capacity_) + (width__ - 1)] = h;
+  }
+
+  size_type find_first_non_full__(size_t hash) const noexcept {
+    probe__ seq(h1__(hash), capacity_);
+    while (true) {
+      auto mask = group__(ctrl_ + seq.offset).mask_empty_or_deleted();
+      if (mask) {
+        return seq.at(mask.lowest());
+      }
+      seq.next();
+    }
+  }
+
+  // Only growth_left_ decides when to grow. Reusing a tombstone doesn't
+  // take from it, so there is always an empty slot to end a probe.
+  size_type prepare_insert__(size_t hash) {
+    size_type target = find_first_non_full__(hash);
+    if (growth_left_ == 0 && ctrl_[target] != deleted__) {
+      grow__();
+      target = find_first_non_full__(hash);
+    }
+    ++size_;
+    growth_left_ -= ctrl_[target] == empty__;
+    set_ctrl__(target, h2__(hash));
+    return target;
+  }
+
+  // Full of tombstones rather than elements: rebuild at the same size.
+  void grow__() {
+    if (capacity_ > width__ && size_ * 32 <= capacity_ * 25) {
+      resize__(capacity_);
+    } else {
+      resize__(capacity_ == 0 ? normalize_capacity__(1) : capacity_ * 2 + 1);
+    }
+  }
+
+  void erase_at__(size_type idx) {
+    alloc_traits__::destroy(alloc__(), slots_ + idx);
+    erase_meta__(idx);
+  }
+
+  // If there is an empty slot within a group's reach on both sides, no
+  // probe ever saw this slot's group full, so no probe went past it and it
+  // can be plain empty again.
+  void erase_meta__(size_type idx) noexcept {
+    --size_;
+    size_type before = (idx - width__) & capacity_;
+    auto empty_after = group__(ctrl_ + idx).mask_empty();
+    auto empty_before = group__(ctrl_ + before).mask_empty();
+    bool was_never_full = empty_before && empty_after &&
+                          empty_after.trailing_zeros() +
+                                  empty_before.leading_zeros() <
+                              width__;
+    set_ctrl__(idx, was_never_full ? empty__ : deleted__);
+    growth_left_ += was_never_full;
+  }
+
+  static size_type alloc_size__(size_type cap) noexcept {
+    size_type bytes = cap * sizeof(value_type) + cap + width__;
+    return (bytes + sizeof(value_type) - 1) / sizeof(value_type);
+  }
+
+  void reset_ctrl__() noexcept {
+    memset(ctrl_, static_cast<unsigned char>(empty__), capacity_ + width__);
+    ctrl_[capacity_] = sentinel__;
+  }
+
+  void allocate__(size_type cap) {
+    slots_ = alloc_traits__::allocate(alloc__(), alloc_size__(cap));
+    ctrl_ = reinterpret_cast<ctrl_t *>(slots_ + cap);
+    capacity_ = cap;
+    growth_left_ = capacity_to_growth__(cap) - size_;
+    reset_ctrl__();
+  }
+
+  void release__() noexcept {
+    if (capacity_ != 0) {
+      alloc_traits__::deallocate(alloc__(), slots_, alloc_size__(capacity_));
+      ctrl_ = const_cast<ctrl_t *>(empty_group__);
+      slots_ = nullptr;
+      capacity_ = growth_left_ = 0;
+    }
+  }
+
+  void destroy_all__() noexcept {
+    if constexpr (!mstl::is_trivially_destructible<value_type>::value ||
+                  allocator_traits_UTILL::has_destroy__<Alloc,
+                                                        value_type>::value) {
+      for (size_type i = 0; i < capacity_; ++i) {
+        if (is_full__(ctrl_[i])) {
+          alloc_traits__::destroy(alloc__(), slots_ + i);
+        }
+      }
+    }
+  }
+
+  // Move every element into a new block of cap slots. Hashes are
+  // recomputed, the old positions mean nothing in the new table.
+  void resize__(size_type cap) {
+    ctrl_t *old_ctrl = ctrl_;
+    value_type *old_slots = slots_;
+    size_type old_cap = capacity_;
+
+    allocate__(cap);
+    for (size_type i = 0; i < old_cap; ++i) {
+      if (!is_full__(old_ctrl[i])) {
+        continue;
+      }
+      size_t hash = hash_of__(Policy::key(old_slots[i]));
+      size_type target = find_first_non_full__(hash);
+      set_ctrl__(target, h2__(hash));
+      if constexpr (relocatable__) {
+        memcpy(static_cast<void *>(slots_ + target),
+               static_cast<const void *>(old_slots + i), sizeof(value_type));
+      } else {
+        Policy::transfer(alloc__(), slots_ + target, old_slots + i);
+      }
+    }
+    if (old_cap != 0) {
+      alloc_traits__::deallocate(alloc__(), old_slots, alloc_size__(old_cap));
+    }
+  }
+
+  // Same hash, same capacity, so every element goes to the same slot as
+  // in other: copy the control bytes as they are and the elements in
+  // place, no hashing at all.
+  void copy_from__(const table__ &other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    allocate__(other.capacity_);
+    memcpy(ctrl_, other.ctrl_, capacity_ + width__);
+    size_type i = 0;
+    try {
+      for (; i < capacity_; ++i) {
+        if (is_full__(ctrl_[i])) {
+          alloc_traits__::construct(alloc__(), slots_ + i, other.slots_[i]);
+        }
+      }
+    } catch (...) {
+      while (i-- > 0) {
+        if (is_full__(ctrl_[i])) {
+          alloc_traits__::destroy(alloc__(), slots_ + i);
+        }
+      }
+      release__();
+      throw;
+    }
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+  }
+
+  void steal__(table__ &other) noexcept {
+    ctrl_ = other.ctrl_;
+    slots_ = other.slots_;
+    capacity_ = other.capacity_;
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+    other.ctrl_ = const_cast<ctrl_t *>(empty_group__);
+    other.slots_ = nullptr;
+    other.capacity_ = other.size_ = other.growth_left_ = 0;
+  }
+};
+
+// equal if they have the same keys, and for maps the same values too.
+template <typename P, typename H, typename E, typename A>
+bool operator==(const table__<P, H, E, A> &x, const table__<P, H, E, A> &y) {
+  if (x.size() != y.size()) {
+    return false;
+  }
+  for (const auto &v : x) {
+    auto it = y.find(P::key(v));
+    if (it == y.end() || !(*it == v)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename P, typename H, typename E, typename A>
+bool operator!=(const table__<P, H, E, A> &x, const table__<P, H, E, A> &y) {
+  return !(x == y);
+}
+
+} // namespace mstl::flat_hash_UTILL
+
+namespace mstl {
+
+// Hash set with the elements stored inline. See the top of the file.
+// For heterogeneous lookup use mstl::hash<> and mstl::equal_to<>, then
+// find, contains, count and erase take anything those accept:
+//
+//   flat_hash_set<std::string, hash<>, equal_to<>> s;
+//   s.contains(std::string_view("key"));   // no std::string built
+template <typename K, typename Hash = mstl::hash<K>,
+          typename Eq = mstl::equal_to<K>, typename Alloc = mstl::allocator<K>>
+class flat_hash_set
+    : public flat_hash_UTILL::table__<flat_hash_UTILL::set_policy__<K>, Hash,
+                                      Eq, Alloc> {
+  using base__ =
+      flat_hash_UTILL::table__<flat_hash_UTILL::set_policy__<K>, Hash, Eq,
+                               Alloc>;
+
+public:
+  using base__::base__;
+
+  flat_hash_set() = default;
+  flat_hash_set(std::initializer_list<K> il, size_t bucket_count = 0,
+                const Hash &hash = Hash(), const Eq &eq = Eq(),
+                const Alloc &a = Alloc())
+      : base__(il, bucket_count, hash, eq, a) {}
+
+  flat_hash_set &operator=(std::initializer_list<K> il) {
+    base__::operator=(il);
+    return *this;
+  }
+};
+
+// Hash map with the key value pairs stored inline. Same rules as
+// flat_hash_set. References to elements are invalidated when the table
+// grows, hold keys rather than pointers across inserts.
+template <typename K, typename V, typename Hash = mstl::hash<K>,
+          typename Eq = mstl::equal_to<K>,
+          typename Alloc = mstl::allocator<mstl::pair<const K, V>>>
+class flat_hash_map
+    : public flat_hash_UTILL::table__<flat_hash_UTILL::map_policy__<K, V>,
+                                      Hash, Eq, Alloc> {
+  using base__ = flat_hash_UTILL::table__<flat_hash_UTILL::map_policy__<K, V>,
+                                          Hash, Eq, Alloc>;
+
+public:
+  using mapped_type = V;
+  using typename base__::const_iterator;
+  using typename base__::iterator;
+  using typename base__::value_type;
+  template <typename Q> using key_arg = typename base__::template key_arg<Q>;
+
+  using base__::base__;
+
+  flat_hash_map() = default;
+  flat_hash_map(std::initializer_list<value_type> il, size_t bucket_count = 0,
+                const Hash &hash = Hash(), const Eq &eq = Eq(),
+                const Alloc &a = Alloc())
+      : base__(il, bucket_count, hash, eq, a) {}
+
+  flat_hash_map &operator=(std::initializer_list<value_type> il) {
+    base__::operator=(il);
+    return *this;
+  }
+
+  // construct the value only if the key is new. Nothing is moved out of
+  // args when the key is already there.
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(const K &key, Args &&...args) {
+    return try_emplace__(key, mstl::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+    return try_emplace__(mstl::move(key), mstl::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(const K &key, M &&value) {
+    return insert_or_assign__(key, mstl::forward<M>(value));
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(K &&key, M &&value) {
+    return insert_or_assign__(mstl::move(key), mstl::forward<M>(value));
+  }
+
+  V &operator[](const K &key) { return try_emplace(key).first->second; }
+  V &operator[](K &&key) {
+    return try_emplace(mstl::move(key)).first->second;
+  }
+
+  template <typename Q = K> V &at(const key_arg<Q> &key) {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw mstl::exception();
+    }
+    return it->second;
+  }
+
+  template <typename Q = K> const V &at(const key_arg<Q> &key) const {
+    auto it = this->find(key);
+    if (it == this->end()) {
+      throw mstl::exception();
+    }
+    return it->second;
+  }
+
+private:
+  template <typename KK, typename... Args>
+  mstl::pair<iterator, bool> try_emplace__(KK &&key, Args &&...args) {
+    auto r = this->find_or_prepare_insert__(key);
+    if (r.second) {
+      this->construct_at__(r.first, mstl::forward<KK>(key),
+                           V(mstl::forward<Args>(args)...));
+    }
+    return {this->iterator_at__(r.first), r.second};
+  }
+
+  template <typename KK, typename M>
+  mstl::pair<iterator, bool> insert_or_assign__(KK &&key, M &&value) {
+    auto r = this->find_or_prepare_insert__(key);
+    if (r.second) {
+      this->construct_at__(r.first, mstl::forward<KK>(key),
+                           mstl::forward<M>(value));
+    } else {
+      this->slot__(r.first).second = mstl::forward<M>(value);
+    }
+    return {this->iterator_at__(r.first), r.second};
+  }
+};
+
+template <typename K, typename H, typename E, typename A>
+void swap(flat_hash_set<K, H, E, A> &x,
+          flat_hash_set<K, H, E, A> &y) noexcept {
+  x.swap(y);
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+void swap(flat_hash_map<K, V, H, E, A> &x,
+          flat_hash_map<K, V, H, E, A> &y) noexcept {
+  x.swap(y);
+}
+
+} // namespace mstl
@@ -0,0 +1,902 @@
+#pragma once
+#include "malgorithm.hpp"
+#include "mexception.hpp"
+#include "mfunctional.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "mvector.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <initializer_list>
+
+// Sorted associative containers on top of sequence containers.
+//
+// flat_map keeps its keys sorted in one vector and the values in another,
+// at the same indices:
+//
+//   keys    [ 3 | 8 | 11 | 42 ]
+//   values  [ c | h | k  | z  ]
+//
+// A lookup is a binary search over nothing but keys, so it touches a few
+// cache lines of densely packed keys and then one value. There is no per
+// element overhead at all.
+//
+// The price is insertion: one element in the middle shifts everything
+// after it. That's fine for tables built once and queried many times, and
+// batch insert(first, last) sorts the new elements on their own and
+// merges them in with a single pass, O(n + m log m) instead of m shifts.
+//
+// note: any insert or erase invalidates iterators and references.
+namespace mstl {
+template <typename K, typename V, typename Compare, typename KeyContainer,
+          typename MappedContainer>
+class flat_map;
+} // namespace mstl
+
+namespace mstl::flat_map_UTILL {
+
+// Keep the first of every run of equal keys. Returns the new end.
+template <typename It, typename Less>
+It unique__(It first, It last, Less less) {
+  if (first == last) {
+    return last;
+  }
+  It out = first;
+  for (It p = first + 1; p != last; ++p) {
+    if (less(*out, *p) && ++out != p) {
+      *out = mstl::move(*p);
+    }
+  }
+  return out + 1;
+}
+
+// an old element for the merged container: moved out when Move, copied
+// otherwise. Moving is only safe when nothing in the merge can throw, or a
+// merge that throws half way has already emptied some of the old elements.
+template <bool Move, typename T>
+typename mstl::conditional<Move, T &&, const T &>::type
+take__(T &x) noexcept {
+  return mstl::move(x);
+}
+
+// Iterator over the two sequences at once. Dereferencing gives a pair of
+// references, pair<const K &, V &>, not a reference to a pair: there is no
+// pair stored anywhere to point at.
+template <typename KeyIt, typename ValIt> class iterator__ {
+  template <typename, typename> friend class iterator__;
+  template <typename, typename, typename, typename, typename>
+  friend class mstl::flat_map;
+
+  KeyIt key_;
+  ValIt value_;
+
+  iterator__(KeyIt key, ValIt value) : key_(key), value_(value) {}
+
+public:
+  using iterator_category = mstl::random_access_iterator_tag;
+  using value_type =
+      mstl::pair<typename mstl::iterator_traits<KeyIt>::value_type,
+                 typename mstl::iterator_traits<ValIt>::value_type>;
+  using difference_type = ptrdiff_t;
+  using reference =
+      mstl::pair<typename mstl::iterator_traits<KeyIt>::reference,
+                 typename mstl::iterator_traits<ValIt>::reference>;
+
+  // it->second works by keeping the pair of references alive here.
+  struct pointer {
+    reference ref;
+    reference *operator->() noexcept { return &ref; }
+  };
+
+  iterator__() = default;
+
+  template <typename V2, typename = mstl::enable_if_t<
+                             mstl::is_convertible<V2, ValIt>::value &&
+                             !mstl::is_same<V2, ValIt>::value>>
+  iterator__(const iterator__<KeyIt, V2> &other)
+      : key_(other.key_), value_(other.value_) {}
+
+  reference operator*() const { return reference(*key_, *value_); }
+  pointer operator->() const { return pointer{**this}; }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  iterator__ &operator++() {
+    ++key_;
+    ++value_;
+    return *this;
+  }
+  iterator__ operator++(int) {
+    iterator__ tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  iterator__ &operator--() {
+    --key_;
+    --value_;
+    return *this;
+  }
+  iterator__ operator--(int) {
+    iterator__ tmp = *this;
+    --*this;
+    return tmp;
+  }
+  iterator__ &operator+=(difference_type n) {
+    key_ += n;
+    value_ += n;
+    return *this;
+  }
+  iterator__ &operator-=(difference_type n) { return *this += -n; }
+
+  friend iterator__ operator+(iterator__ it, difference_type n) {
+    return it += n;
+  }
+  friend iterator__ operator+(difference_type n, iterator__ it) {
+    return it += n;
+  }
+  friend iterator__ operator-(iterator__ it, difference_type n) {
+    return it -= n;
+  }
+
+  template <typename V2>
+  difference_type operator-(const iterator__<KeyIt, V2> &other) const {
+    return key_ - other.key_;
+  }
+
+  template <typename V2>
+  bool operator==(const iterator__<KeyIt, V2> &other) const {
+    return key_ == other.key_;
+  }
+  template <typename V2>
+  bool operator!=(const iterator__<KeyIt, V2> &other) const {
+    return key_ != other.key_;
+  }
+  template <typename V2>
+  bool operator<(const iterator__<KeyIt, V2> &other) const {
+    return key_ < other.key_;
+  }
+  template <typename V2>
+  bool operator>(const iterator__<KeyIt, V2> &other) const {
+    return key_ > other.key_;
+  }
+  template <typename V2>
+  bool operator<=(const iterator__<KeyIt, V2> &other) const {
+    return key_ <= other.key_;
+  }
+  template <typename V2>
+  bool operator>=(const iterator__<KeyIt, V2> &other) const {
+    return key_ >= other.key_;
+  }
+};
+
+} // namespace mstl::flat_map_UTILL
+
+namespace mstl {
+
+// Sorted map over two sequence containers, see the top of the file. Any
+// random access container with insert, erase and push_back works, e.g.
+// small_vector for maps that are usually tiny.
+// With a transparent Compare (mstl::less<>) lookups take any type the
+// comparator accepts.
+template <typename K, typename V, typename Compare = mstl::less<K>,
+          typename KeyContainer = mstl::vector<K>,
+          typename MappedContainer = mstl::vector<V>>
+class flat_map {
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Compare>::value;
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = mstl::pair<K, V>;
+  using key_compare = Compare;
+  using reference = mstl::pair<const K &, V &>;
+  using const_reference = mstl::pair<const K &, const V &>;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using key_container_type = KeyContainer;
+  using mapped_container_type = MappedContainer;
+
+  using iterator =
+      flat_map_UTILL::iterator__<typename KeyContainer::const_iterator,
+                                 typename MappedContainer::iterator>;
+  using const_iterator =
+      flat_map_UTILL::iterator__<typename KeyContainer::const_iterator,
+                                 typename MappedContainer::const_iterator>;
+  using reverse_iterator = mstl::reverse_iterator<iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  template <typename Q>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<Q, key_type>;
+
+  struct containers {
+    KeyContainer keys;
+    MappedContainer values;
+  };
+
+private:
+  memory_UTIL::compressed_pair__<Compare, KeyContainer> keys_;
+  MappedContainer values_;
+
+public:
+  flat_map() = default;
+
+  explicit flat_map(const Compare &comp) : keys_(comp, KeyContainer()) {}
+
+  // takes the containers as they are and sorts them. Of equal keys the
+  // first one stays.
+  flat_map(KeyContainer keys, MappedContainer values,
+           const Compare &comp = Compare())
+      : keys_(comp, KeyContainer()) {
+    if (keys.size() != values.size()) {
+      throw mstl::exception();
+    }
+    mstl::vector<value_type> batch;
+    batch.reserve(keys.size());
+    for (size_type i = 0; i < keys.size(); ++i) {
+      batch.emplace_back(mstl::move(keys[i]), mstl::move(values[i]));
+    }
+    merge__(batch, false);
+  }
+
+  // the containers must be sorted already with no duplicate keys.
+  flat_map(mstl::sorted_unique_t, KeyContainer keys, MappedContainer values,
+           const Compare &comp = Compare())
+      : keys_(comp, mstl::move(keys)), values_(mstl::move(values)) {
+    if (keys_.second().size() != values_.size()) {
+      throw mstl::exception();
+    }
+  }
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  flat_map(InputIt first, InputIt last, const Compare &comp = Compare())
+      : keys_(comp, KeyContainer()) {
+    insert(first, last);
+  }
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  flat_map(mstl::sorted_unique_t, InputIt first, InputIt last,
+           const Compare &comp = Compare())
+      : keys_(comp, KeyContainer()) {
+    for (; first != last; ++first) {
+      value_type v(*first);
+      keys__().push_back(mstl::move(v.first));
+      values_.push_back(mstl::move(v.second));
+    }
+  }
+
+  flat_map(std::initializer_list<value_type> il,
+           const Compare &comp = Compare())
+      : flat_map(il.begin(), il.end(), comp) {}
+
+  flat_map &operator=(std::initializer_list<value_type> il) {
+    clear();
+    insert(il);
+    return *this;
+  }
+
+  key_compare key_comp() const { return comp__(); }
+
+  const KeyContainer &keys() const noexcept { return keys_.second(); }
+  const MappedContainer &values() const noexcept { return values_; }
+
+  // take the containers out, the map is left empty.
+  containers extract() && {
+    containers c{mstl::move(keys__()), mstl::move(values_)};
+    clear();
+    return c;
+  }
+
+  // put containers in, sorted with no duplicate keys.
+  void replace(KeyContainer &&keys, MappedContainer &&values) {
+    if (keys.size() != values.size()) {
+      throw mstl::exception();
+    }
+    keys__() = mstl::move(keys);
+    values_ = mstl::move(values);
+  }
+
+  /*
+   * iterators
+   */
+  iterator begin() noexcept {
+    return iterator(keys_.second().cbegin(), values_.begin());
+  }
+  const_iterator begin() const noexcept {
+    return const_iterator(keys_.second().cbegin(), values_.cbegin());
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+
+  iterator end() noexcept {
+    return iterator(keys_.second().cend(), values_.end());
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(keys_.second().cend(), values_.cend());
+  }
+  const_iterator cend() const noexcept { return end(); }
+
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  /*
+   * capacity
+   */
+  bool empty() const noexcept { return keys_.second().empty(); }
+  size_type size() const noexcept { return keys_.second().size(); }
+  size_type max_size() const noexcept { return keys_.second().max_size(); }
+
+  void reserve(size_type n) {
+    keys__().reserve(n);
+    values_.reserve(n);
+  }
+
+  /*
+   * element access
+   */
+  V &operator[](const K &key) { return try_emplace(key).first->second; }
+  V &operator[](K &&key) {
+    return try_emplace(mstl::move(key)).first->second;
+  }
+
+  template <typename Q = K> V &at(const key_arg<Q> &key) {
+    size_type i = find_index__(key);
+    if (i == size()) {
+      throw mstl::exception();
+    }
+    return values_[i];
+  }
+
+  template <typename Q = K> const V &at(const key_arg<Q> &key) const {
+    size_type i = find_index__(key);
+    if (i == size()) {
+      throw mstl::exception();
+    }
+    return values_[i];
+  }
+
+  /*
+   * modifiers
+   */
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(const K &key, Args &&...args) {
+    return try_emplace__(key, mstl::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  mstl::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+    return try_emplace__(mstl::move(key), mstl::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(const K &key, M &&value) {
+    auto r = try_emplace__(key, mstl::forward<M>(value));
+    if (!r.second) {
+      r.first->second = mstl::forward<M>(value);
+    }
+    return r;
+  }
+
+  template <typename M>
+  mstl::pair<iterator, bool> insert_or_assign(K &&key, M &&value) {
+    auto r = try_emplace__(mstl::move(key), mstl::forward<M>(value));
+    if (!r.second) {
+      r.first->second = mstl::forward<M>(value);
+    }
+    return r;
+  }
+
+  template <typename... Args>
+  mstl::pair<iterator, bool> emplace(Args &&...args) {
+    value_type v(mstl::forward<Args>(args)...);
+    return try_emplace__(mstl::move(v.first), mstl::move(v.second));
+  }
+
+  mstl::pair<iterator, bool> insert(const value_type &v) {
+    return try_emplace__(v.first, v.second);
+  }
+
+  mstl::pair<iterator, bool> insert(value_type &&v) {
+    return try_emplace__(mstl::move(v.first), mstl::move(v.second));
+  }
+
+  iterator insert(const_iterator, const value_type &v) {
+    return insert(v).first;
+  }
+
+  iterator insert(const_iterator, value_type &&v) {
+    return insert(mstl::move(v)).first;
+  }
+
+  // Batch insert: sort the new elements on their own, then merge the two
+  // sorted runs in one pass. Keys already in the map keep their values,
+  // and of equal keys in the batch the first one is taken.
+  template <typename InputIt> void insert(InputIt first, InputIt last) {
+    mstl::vector<value_type> batch(first, last);
+    merge__(batch, false);
+  }
+
+  // the same for a batch that is sorted already, it skips the sort.
+  template <typename InputIt>
+  void insert(mstl::sorted_unique_t, InputIt first, InputIt last) {
+    mstl::vector<value_type> batch(first, last);
+    merge__(batch, true);
+  }
+
+  void insert(std::initializer_list<value_type> il) {
+    insert(il.begin(), il.end());
+  }
+
+  iterator erase(const_iterator pos) {
+    size_type i = size_type(pos - cbegin());
+    keys__().erase(keys__().begin() + i);
+    values_.erase(values_.begin() + i);
+    return begin() + difference_type(i);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    size_type i = size_type(first - cbegin());
+    size_type j = size_type(last - cbegin());
+    keys__().erase(keys__().begin() + i, keys__().begin() + j);
+    values_.erase(values_.begin() + i, values_.begin() + j);
+    return begin() + difference_type(i);
+  }
+
+  template <typename Q = K> size_type erase(const key_arg<Q> &key) {
+    size_type i = find_index__(key);
+    if (i == size()) {
+      return 0;
+    }
+    erase(cbegin() + difference_type(i));
+    return 1;
+  }
+
+  void swap(flat_map &other) noexcept {
+    flat_map tmp(mstl::move(other));
+    other = mstl::move(*this);
+    *this = mstl::move(tmp);
+  }
+
+  void clear() noexcept {
+    keys__().clear();
+    values_.clear();
+  }
+
+  /*
+   * lookup
+   */
+  template <typename Q = K> iterator find(const key_arg<Q> &key) {
+    return begin() + difference_type(find_index__(key));
+  }
+
+  template <typename Q = K>
+  const_iterator find(const key_arg<Q> &key) const {
+    return begin() + difference_type(find_index__(key));
+  }
+
+  template <typename Q = K> bool contains(const key_arg<Q> &key) const {
+    return find_index__(key) != size();
+  }
+
+  template <typename Q = K> size_type count(const key_arg<Q> &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  template <typename Q = K> iterator lower_bound(const key_arg<Q> &key) {
+    return begin() + difference_type(lower_index__(key));
+  }
+
+  template <typename Q = K>
+  const_iterator lower_bound(const key_arg<Q> &key) const {
+    return begin() + difference_type(lower_index__(key));
+  }
+
+  template <typename Q = K> iterator upper_bound(const key_arg<Q> &key) {
+    return begin() + difference_type(upper_index__(key));
+  }
+
+  template <typename Q = K>
+  const_iterator upper_bound(const key_arg<Q> &key) const {
+    return begin() + difference_type(upper_index__(key));
+  }
+
+  template <typename Q = K>
+  mstl::pair<iterator, iterator> equal_range(const key_arg<Q> &key) {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  template <typename Q = K>
+  mstl::pair<const_iterator, const_iterator>
+  equal_range(const key_arg<Q> &key) const {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  friend bool operator==(const flat_map &x, const flat_map &y) {
+    return x.keys() == y.keys() && x.values_ == y.values_;
+  }
+  friend bool operator!=(const flat_map &x, const flat_map &y) {
+    return !(x == y);
+  }
+
+private:
+  Compare &comp__() noexcept { return keys_.first(); }
+  const Compare &comp__() const noexcept { return keys_.first(); }
+  KeyContainer &keys__() noexcept { return keys_.second(); }
+  const KeyContainer &keys__() const noexcept { return keys_.second(); }
+
+  template <typename Q> size_type lower_index__(const Q &key) const {
+    return size_type(mstl::lower_bound(keys__().begin(), keys__().end(), key,
+                                       comp__()) -
+                     keys__().begin());
+  }
+
+  template <typename Q> size_type upper_index__(const Q &key) const {
+    return size_type(mstl::upper_bound(keys__().begin(), keys__().end(), key,
+                                       comp__()) -
+                     keys__().begin());
+  }
+
+  // index of the key, or size().
+  template <typename Q> size_type find_index__(const Q &key) const {
+    size_type i = lower_index__(key);
+    if (i != size() && comp__()(key, keys__()[i])) {
+      return size();
+    }
+    return i;
+  }
+
+  template <typename KK, typename... Args>
+  mstl::pair<iterator, bool> try_emplace__(KK &&key, Args &&...args) {
+    size_type i = lower_index__(key);
+    if (i != size() && !comp__()(key, keys__()[i])) {
+      return {begin() + difference_type(i), false};
+    }
+    keys__().insert(keys__().begin() + i, mstl::forward<KK>(key));
+    try {
+      values_.insert(values_.begin() + i, V(mstl::forward<Args>(args)...));
+    } catch (...) {
+      keys__().erase(keys__().begin() + i);
+      throw;
+    }
+    return {begin() + difference_type(i), true};
+  }
+
+  // nothing in merge__ throws, or the old elements can't be copied anyway.
+  static constexpr bool move_merge__ =
+      (mstl::is_nothrow_move_constructible<K>::value &&
+       mstl::is_nothrow_move_constructible<V>::value) ||
+      !mstl::is_copy_constructible<K>::value ||
+      !mstl::is_copy_constructible<V>::value;
+
+  // Merge a batch into new containers and move them in. The old elements
+  // are copied unless nothing can throw, so a throw while merging leaves
+  // the map as it was (short of move only elements that throw on move).
+  // Moving the containers in at the end mustn't throw, it doesn't for
+  // mstl::vector.
+  void merge__(mstl::vector<value_type> &batch, bool sorted) {
+    auto less = [this](const value_type &a, const value_type &b) {
+      return comp__()(a.first, b.first);
+    };
+    if (!sorted) {
+      mstl::stable_sort(batch.begin(), batch.end(), less);
+    }
+    value_type *b = batch.begin();
+    value_type *b_end = flat_map_UTILL::unique__(batch.begin(), batch.end(),
+                                                 less);
+    if (b == b_end) {
+      return;
+    }
+
+    KeyContainer new_keys;
+    MappedContainer new_values;
+    new_keys.reserve(size() + size_type(b_end - b));
+    new_values.reserve(size() + size_type(b_end - b));
+    size_type i = 0, n = size();
+    while (i < n && b != b_end) {
+      if (comp__()(b->first, keys__()[i])) {
+        new_keys.push_back(mstl::move(b->first));
+        new_values.push_back(mstl::move(b->second));
+        ++b;
+      } else {
+        if (!comp__()(keys__()[i], b->first)) {
+          ++b; // already in the map, the old value stays.
+        }
+        new_keys.push_back(flat_map_UTILL::take__<move_merge__>(keys__()[i]));
+        new_values.push_back(flat_map_UTILL::take__<move_merge__>(values_[i]));
+        ++i;
+      }
+    }
+    for (; i < n; ++i) {
+      new_keys.push_back(flat_map_UTILL::take__<move_merge__>(keys__()[i]));
+      new_values.push_back(flat_map_UTILL::take__<move_merge__>(values_[i]));
+    }
+    for (; b != b_end; ++b) {
+      new_keys.push_back(mstl::move(b->first));
+      new_values.push_back(mstl::move(b->second));
+    }
+    keys__() = mstl::move(new_keys);
+    values_ = mstl::move(new_values);
+  }
+};
+
+// Sorted set over one sequence container. Same idea as flat_map, with
+// plain iterators into the container.
+template <typename K, typename Compare = mstl::less<K>,
+          typename KeyContainer = mstl::vector<K>>
+class flat_set {
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Compare>::value;
+
+public:
+  using key_type = K;
+  using value_type = K;
+  using key_compare = Compare;
+  using value_compare = Compare;
+  using reference = const K &;
+  using const_reference = const K &;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using container_type = KeyContainer;
+
+  using iterator = typename KeyContainer::const_iterator;
+  using const_iterator = typename KeyContainer::const_iterator;
+  using reverse_iterator = mstl::reverse_iterator<const_iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  template <typename Q>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<Q, key_type>;
+
+private:
+  memory_UTIL::compressed_pair__<Compare, KeyContainer> keys_;
+
+public:
+  flat_set() = default;
+
+  explicit flat_set(const Compare &comp) : keys_(comp, KeyContainer()) {}
+
+  explicit flat_set(KeyContainer keys, const Compare &comp = Compare())
+      : keys_(comp, KeyContainer()) {
+    merge__(keys, false);
+  }
+
+  flat_set(mstl::sorted_unique_t, KeyContainer keys,
+           const Compare &comp = Compare())
+      : keys_(comp, mstl::move(keys)) {}
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  flat_set(InputIt first, InputIt last, const Compare &comp = Compare())
+      : keys_(comp, KeyContainer()) {
+    insert(first, last);
+  }
+
+  template <typename InputIt,
+            typename = mstl::enable_if_t<!mstl::is_integral<InputIt>::value>>
+  flat_set(mstl::sorted_unique_t, InputIt first, InputIt last,
+           const Compare &comp = Compare())
+      : keys_(comp, KeyContainer(first, last)) {}
+
+  flat_set(std::initializer_list<K> il, const Compare &comp = Compare())
+      : flat_set(il.begin(), il.end(), comp) {}
+
+  flat_set &operator=(std::initializer_list<K> il) {
+    clear();
+    insert(il);
+    return *this;
+  }
+
+  key_compare key_comp() const { return comp__(); }
+  value_compare value_comp() const { return comp__(); }
+
+  const KeyContainer &keys() const noexcept { return keys__(); }
+
+  // take the container out, the set is left empty.
+  KeyContainer extract() && {
+    KeyContainer c(mstl::move(keys__()));
+    clear();
+    return c;
+  }
+
+  // put a container in, sorted with no duplicates.
+  void replace(KeyContainer &&keys) { this->keys__() = mstl::move(keys); }
+
+  /*
+   * iterators
+   */
+  const_iterator begin() const noexcept { return keys__().cbegin(); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator end() const noexcept { return keys__().cend(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  /*
+   * capacity
+   */
+  bool empty() const noexcept { return keys__().empty(); }
+  size_type size() const noexcept { return keys__().size(); }
+  size_type max_size() const noexcept { return keys__().max_size(); }
+  void reserve(size_type n) { keys__().reserve(n); }
+
+  /*
+   * modifiers
+   */
+  template <typename... Args>
+  mstl::pair<iterator, bool> emplace(Args &&...args) {
+    return insert(K(mstl::forward<Args>(args)...));
+  }
+
+  mstl::pair<iterator, bool> insert(const K &key) { return insert__(key); }
+  mstl::pair<iterator, bool> insert(K &&key) {
+    return insert__(mstl::move(key));
+  }
+
+  iterator insert(const_iterator, const K &key) { return insert(key).first; }
+  iterator insert(const_iterator, K &&key) {
+    return insert(mstl::move(key)).first;
+  }
+
+  // batch insert, see flat_map::insert.
+  template <typename InputIt> void insert(InputIt first, InputIt last) {
+    KeyContainer batch(first, last);
+    merge__(batch, false);
+  }
+
+  template <typename InputIt>
+  void insert(mstl::sorted_unique_t, InputIt first, InputIt last) {
+    KeyContainer batch(first, last);
+    merge__(batch, true);
+  }
+
+  void insert(std::initializer_list<K> il) { insert(il.begin(), il.end()); }
+
+  iterator erase(const_iterator pos) { return keys__().erase(pos); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    return keys__().erase(first, last);
+  }
+
+  template <typename Q = K> size_type erase(const key_arg<Q> &key) {
+    size_type i = find_index__(key);
+    if (i == size()) {
+      return 0;
+    }
+    keys__().erase(begin() + difference_type(i));
+    return 1;
+  }
+
+  void swap(flat_set &other) noexcept {
+    flat_set tmp(mstl::move(other));
+    other = mstl::move(*this);
+    *this = mstl::move(tmp);
+  }
+
+  void clear() noexcept { keys__().clear(); }
+
+  /*
+   * lookup
+   */
+  template <typename Q = K>
+  const_iterator find(const key_arg<Q> &key) const {
+    return begin() + difference_type(find_index__(key));
+  }
+
+  template <typename Q = K> bool contains(const key_arg<Q> &key) const {
+    return find_index__(key) != size();
+  }
+
+  template <typename Q = K> size_type count(const key_arg<Q> &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  template <typename Q = K>
+  const_iterator lower_bound(const key_arg<Q> &key) const {
+    return mstl::lower_bound(begin(), end(), key, comp__());
+  }
+
+  template <typename Q = K>
+  const_iterator upper_bound(const key_arg<Q> &key) const {
+    return mstl::upper_bound(begin(), end(), key, comp__());
+  }
+
+  template <typename Q = K>
+  mstl::pair<const_iterator, const_iterator>
+  equal_range(const key_arg<Q> &key) const {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  friend bool operator==(const flat_set &x, const flat_set &y) {
+    return x.keys() == y.keys();
+  }
+  friend bool operator!=(const flat_set &x, const flat_set &y) {
+    return !(x == y);
+  }
+
+private:
+  Compare &comp__() noexcept { return keys_.first(); }
+  const Compare &comp__() const noexcept { return keys_.first(); }
+  KeyContainer &keys__() noexcept { return keys_.second(); }
+  const KeyContainer &keys__() const noexcept { return keys_.second(); }
+
+  template <typename Q> size_type find_index__(const Q &key) const {
+    auto it = lower_bound(key);
+    if (it == end() || comp__()(key, *it)) {
+      return size();
+    }
+    return size_type(it - begin());
+  }
+
+  template <typename KK> mstl::pair<iterator, bool> insert__(KK &&key) {
+    auto it = lower_bound(key);
+    if (it != end() && !comp__()(key, *it)) {
+      return {it, false};
+    }
+    return {keys__().insert(it, mstl::forward<KK>(key)), true};
+  }
+
+  static constexpr bool move_merge__ =
+      mstl::is_nothrow_move_constructible<K>::value ||
+      !mstl::is_copy_constructible<K>::value;
+
+  // see flat_map::merge__.
+  void merge__(KeyContainer &batch, bool sorted) {
+    auto less = [this](const K &a, const K &b) { return comp__()(a, b); };
+    if (!sorted) {
+      mstl::stable_sort(batch.begin(), batch.end(), less);
+    }
+    auto b = batch.begin();
+    auto b_end = flat_map_UTILL::unique__(batch.begin(), batch.end(), less);
+    if (b == b_end) {
+      return;
+    }
+
+    KeyContainer merged;
+    merged.reserve(size() + size_type(b_end - b));
+    size_type i = 0, n = size();
+    while (i < n && b != b_end) {
+      if (comp__()(*b, keys__()[i])) {
+        merged.push_back(mstl::move(*b++));
+      } else {
+        if (!comp__()(keys__()[i], *b)) {
+          ++b;
+        }
+        merged.push_back(flat_map_UTILL::take__<move_merge__>(keys__()[i++]));
+      }
+    }
+    for (; i < n; ++i) {
+      merged.push_back(flat_map_UTILL::take__<move_merge__>(keys__()[i]));
+    }
+    for (; b != b_end; ++b) {
+      merged.push_back(mstl::move(*b));
+    }
+    keys__() = mstl::move(merged);
+  }
+};
+
+template <typename K, typename V, typename C, typename KC, typename MC>
+void swap(flat_map<K, V, C, KC, MC> &x, flat_map<K, V, C, KC, MC> &y) noexcept {
+  x.swap(y);
+}
+
+template <typename K, typename C, typename KC>
+void swap(flat_set<K, C, KC> &x, flat_set<K, C, KC> &y) noexcept {
+  x.swap(y);
+}
+
+} // namespace mstl
@@ -1,4 +1,9 @@
 #pragma once
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace mstl {
 
@@ -19,3 +24,186 @@ public:
 };
 
 } // namespace mstl
+
+namespace mstl {
+
+template <typename T = void> struct less {
+  constexpr bool operator()(const T &x, const T &y) const { return x < y; }
+};
+
+// less<> compares anything with anything, see equal_to<> below.
+template <> struct less<void> {
+  using is_transparent = void;
+
+  template <typename T, typename U>
+  constexpr bool operator()(T &&x, U &&y) const {
+    return mstl::forward<T>(x) < mstl::forward<U>(y);
+  }
+};
+
+template <typename T = void> struct equal_to {
+  constexpr bool operator()(const T &x, const T &y) const { return x == y; }
+};
+
+// equal_to<> compares anything with anything. Being transparent is what
+// lets a hash table keyed by a string look up a string_view without
+// building a string first.
+template <> struct equal_to<void> {
+  using is_transparent = void;
+
+  template <typename T, typename U>
+  constexpr bool operator()(T &&x, U &&y) const {
+    return mstl::forward<T>(x) == mstl::forward<U>(y);
+  }
+};
+
+} // namespace mstl
+
+namespace mstl::functional_UTILL {
+
+// wyhash constants.
+constexpr uint64_t k0__ = 0xa0761d6478bd642full;
+constexpr uint64_t k1__ = 0xe7037ed1a0b428dbull;
+constexpr uint64_t k2__ = 0x8ebc6af09c88c6e3ull;
+
+// 64 x 64 -> 128 bit multiply, folded back to 64 bits. One instruction on
+// x86-64 and arm64, and every input bit reaches every output bit.
+constexpr uint64_t mul_fold__(uint64_t a, uint64_t b) noexcept {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t ha = a >> 32, la = a & 0xffffffff;
+  uint64_t hb = b >> 32, lb = b & 0xffffffff;
+  uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+  uint64_t mid = (ll >> 32) + (hl & 0xffffffff) + (lh & 0xffffffff);
+  uint64_t lo = (mid << 32) | (ll & 0xffffffff);
+  uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+  return lo ^ hi;
+#endif
+}
+
+inline uint64_t load64__(const unsigned char *p) noexcept {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t load32__(const unsigned char *p) noexcept {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+// 16 bytes per multiply, short keys take one or two overlapping loads and
+// no loop at all.
+inline uint64_t hash_bytes__(const void *data, size_t n) noexcept {
+  auto p = static_cast<const unsigned char *>(data);
+  uint64_t h = k0__ ^ mul_fold__(n, k2__);
+  uint64_t a = 0, b = 0;
+  if (n <= 16) {
+    if (n >= 8) {
+      a = load64__(p);
+      b = load64__(p + n - 8);
+    } else if (n >= 4) {
+      a = load32__(p);
+      b = load32__(p + n - 4);
+    } else if (n > 0) {
+      a = (uint64_t(p[0]) << 16) | (uint64_t(p[n >> 1]) << 8) | p[n - 1];
+    }
+  } else {
+    for (; n > 16; p += 16, n -= 16) {
+      h = mul_fold__(load64__(p) ^ k1__, load64__(p + 8) ^ h);
+    }
+    a = load64__(p + n - 16);
+    b = load64__(p + n - 8);
+  }
+  return mul_fold__(k1__ ^ n, mul_fold__(a ^ k1__, b ^ h));
+}
+
+template <typename T, typename = void>
+struct is_contiguous_bytes__ : mstl::false_type {};
+template <typename T>
+struct is_contiguous_bytes__<
+    T, mstl::void_t<decltype(mstl::declval<const T &>().data()),
+                    decltype(mstl::declval<const T &>().size())>>
+    : mstl::is_integral<typename mstl::remove_reference<
+          decltype(*mstl::declval<const T &>().data())>::type> {};
+
+template <typename T, typename = void>
+struct is_transparent__ : mstl::false_type {};
+template <typename T>
+struct is_transparent__<T, mstl::void_t<typename T::is_transparent>>
+    : mstl::true_type {};
+
+// see hash::is_avalanching below.
+template <typename H, typename = void>
+struct is_avalanching__ : mstl::false_type {};
+template <typename H>
+struct is_avalanching__<H, mstl::void_t<typename H::is_avalanching>>
+    : mstl::true_type {};
+
+// For containers with heterogeneous lookup. key_arg__<true>::type<K, Key>
+// is K and key_arg__<false>::type<K, Key> is Key. The alias resolves
+// when the container is instantiated, so a member like
+//
+//   template <typename K = key_type> iterator find(const key_arg<K> &);
+//
+// still deduces K in the transparent case, and takes key_type (with its
+// implicit conversions) otherwise.
+template <bool Transparent> struct key_arg__ {
+  template <typename K, typename Key> using type = Key;
+};
+template <> struct key_arg__<true> {
+  template <typename K, typename Key> using type = K;
+};
+
+} // namespace mstl::functional_UTILL
+
+namespace mstl {
+
+// Hash function.
+// Integers, enums, pointers and floats are mixed with one wide multiply.
+// Anything with data() and size() over integers (std::string,
+// std::string_view, mstl::vector<char>...) hashes its bytes, so all of
+// those agree with each other for the same content.
+//
+// is_avalanching says every bit of the input affects every bit of the
+// output. Hash tables trust such hashes as they are and mix the rest
+// themselves, so a weak user hash like the identity still works.
+template <typename T = void> struct hash {
+  using is_avalanching = void;
+
+  size_t operator()(const T &x) const noexcept {
+    using namespace functional_UTILL;
+    if constexpr (mstl::is_integral<T>::value || mstl::is_enum<T>::value) {
+      return mul_fold__(static_cast<uint64_t>(x) ^ k0__, k1__);
+    } else if constexpr (mstl::is_pointer<T>::value) {
+      return mul_fold__(reinterpret_cast<uintptr_t>(x) ^ k0__, k1__);
+    } else if constexpr (mstl::is_null_pointer<T>::value) {
+      return mul_fold__(k0__, k1__);
+    } else if constexpr (mstl::is_floating_point<T>::value) {
+      if (x == 0) {
+        return mul_fold__(k0__, k1__); // 0.0 == -0.0
+      }
+      return hash_bytes__(&x, sizeof(x));
+    } else {
+      static_assert(is_contiguous_bytes__<T>::value,
+                    "mstl::hash doesn't know how to hash this type");
+      return hash_bytes__(x.data(), x.size() * sizeof(*x.data()));
+    }
+  }
+};
+
+// hash<> hashes whatever it's given with hash<that type>. Used with
+// equal_to<> for heterogeneous lookup.
+template <> struct hash<void> {
+  using is_transparent = void;
+  using is_avalanching = void;
+
+  template <typename T> size_t operator()(const T &x) const noexcept {
+    return hash<T>()(x);
+  }
+};
+
+} // namespace mstl
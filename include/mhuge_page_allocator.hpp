@@ -0,0 +1,252 @@
+#pragma once
+#include "mmemory.hpp"
+#include "mnew.hpp"
+#include "mtype_traits.hpp"
+#include <cstddef>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// mmap backed allocator for very large arrays.
+// For a multi GB table two things hurt:
+//   1. TLB misses. With 4KiB pages a 4GiB table needs a million TLB entries.
+//      With 2MiB huge pages it's two thousand.
+//   2. page faults on first touch. The kernel only hands out a page when you
+//      first write to it, so the first pass over a fresh table is a storm of
+//      page faults. Pre faulting moves that cost to allocation time.
+//
+// So big allocations bypass the heap entirely, get mapped directly, aligned
+// to the huge page size, and madvise'd as MADV_HUGEPAGE so transparent huge
+// pages can back them. Small allocations are not worth a syscall, they go to
+// mstl::operator_new as usual.
+//
+// note: linux only (madvise flags and mremap).
+namespace mstl {
+
+enum mmap_flags : unsigned {
+  mmap_none = 0,
+  mmap_huge_pages = 1, // align to 2MiB and ask for transparent huge pages.
+  mmap_populate = 2,   // pre fault every page on allocation.
+};
+
+} // namespace mstl
+
+namespace mstl::mmap_UTILL {
+
+constexpr size_t huge_page_size__ = 2 * 1024 * 1024;
+
+// below this we just use the heap.
+constexpr size_t mmap_threshold__ = 256 * 1024;
+
+inline size_t page_size__() noexcept {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+constexpr size_t round_up__(size_t n, size_t align) noexcept {
+  return (n + align - 1) & ~(align - 1);
+}
+
+inline size_t mapped_size__(size_t bytes, unsigned flags) noexcept {
+  return round_up__(bytes, (flags & mmap_huge_pages) ? huge_page_size__
+                                                     : page_size__());
+}
+
+// ask for huge pages on [p, p + size) and pre fault it, as flags say. A
+// new mapping gets it whole, a grown one for the part it gained.
+inline void prepare__(char *p, size_t size, unsigned flags) noexcept {
+#ifdef MADV_HUGEPAGE
+  if (flags & mmap_huge_pages) {
+    madvise(p, size, MADV_HUGEPAGE);
+  }
+#endif
+
+  // populate after madvise, otherwise the pages are faulted in as small
+  // pages. MAP_POPULATE would do it too early for that reason.
+  if (flags & mmap_populate) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(p, size, MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+#endif
+    size_t step = (flags & mmap_huge_pages) ? huge_page_size__ : page_size__();
+    for (size_t off = 0; off < size; off += step) {
+      static_cast<volatile char *>(p)[off] = 0;
+    }
+  }
+}
+
+// huge pages only happen on huge page aligned ranges, but mmap only promises
+// page alignment. Map one huge page more than needed and cut off both ends.
+inline void *map__(size_t size, unsigned flags) noexcept {
+  size_t slack = (flags & mmap_huge_pages) ? huge_page_size__ : 0;
+  void *raw = mmap(nullptr, size + slack, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+
+  char *p = static_cast<char *>(raw);
+  if (slack) {
+    char *aligned = reinterpret_cast<char *>(
+        round_up__(reinterpret_cast<size_t>(p), huge_page_size__));
+    size_t head = aligned - p;
+    if (head) {
+      munmap(p, head);
+    }
+    if (slack - head) {
+      munmap(aligned + size, slack - head);
+    }
+    p = aligned;
+  }
+  prepare__(p, size, flags);
+  return p;
+}
+
+// Grow the mapping at p from old_size to new_size, where it is if it can,
+// elsewhere if not. Null if the kernel says no, p is untouched then.
+//
+// A mapping mremap moves is only page aligned, which would lose the huge
+// pages. With mmap_huge_pages the old pages go into the head of a fresh,
+// aligned mapping instead (still without copying, MREMAP_FIXED moves page
+// table entries too).
+inline void *grow__(void *p, size_t old_size, size_t new_size,
+                    unsigned flags) noexcept {
+  void *q;
+  if (flags & mmap_huge_pages) {
+    q = mremap(p, old_size, new_size, 0);
+    if (q == MAP_FAILED) {
+      q = map__(new_size, flags & ~unsigned(mmap_populate));
+      if (q == nullptr) {
+        return nullptr;
+      }
+#ifdef MREMAP_FIXED
+      if (mremap(p, old_size, old_size, MREMAP_MAYMOVE | MREMAP_FIXED, q) ==
+          MAP_FAILED)
+#endif
+      {
+        memcpy(q, p, old_size);
+        munmap(p, old_size);
+      }
+    }
+  } else {
+    q = mremap(p, old_size, new_size, MREMAP_MAYMOVE);
+    if (q == MAP_FAILED) {
+      return nullptr;
+    }
+  }
+  prepare__(static_cast<char *>(q) + old_size, new_size - old_size, flags);
+  return q;
+}
+
+} // namespace mstl::mmap_UTILL
+
+namespace mstl {
+
+// stateless, the flags are part of the type.
+template <typename T, unsigned Flags = mmap_huge_pages> class mmap_allocator {
+public:
+  using value_type = T;
+  using is_always_equal = mstl::true_type;
+  using propagate_on_container_move_assignment = mstl::true_type;
+
+  // the default rebind only swaps type parameters, we have a value one.
+  template <typename U> struct rebind {
+    using other = mmap_allocator<U, Flags>;
+  };
+
+  constexpr mmap_allocator() noexcept = default;
+  template <typename U>
+  constexpr mmap_allocator(const mmap_allocator<U, Flags> &) noexcept {}
+
+  static bool is_mapped(size_t n) noexcept {
+    return n * sizeof(T) >= mmap_UTILL::mmap_threshold__;
+  }
+
+  T *allocate(size_t n) {
+    if (n > size_t(-1) / sizeof(T)) {
+      throw mstl::bad_array_new_length();
+    }
+    if (!is_mapped(n)) {
+      return mstl::allocator<T>().allocate(n);
+    }
+    size_t size = mmap_UTILL::mapped_size__(n * sizeof(T), Flags);
+    return static_cast<T *>(new_UTILL::allocate_loop__(
+        [size] { return mmap_UTILL::map__(size, Flags); }));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    if (!is_mapped(n)) {
+      mstl::allocator<T>().deallocate(p, n);
+      return;
+    }
+    munmap(p, mmap_UTILL::mapped_size__(n * sizeof(T), Flags));
+  }
+
+  // Grow or shrink a mapping without copying. Returns false if the kernel
+  // can't resize it where it is, nothing changes in that case.
+  bool try_resize(T *p, size_t old_n, size_t new_n) noexcept {
+    if (!is_mapped(old_n) || !is_mapped(new_n)) {
+      return false;
+    }
+    size_t old_size = mmap_UTILL::mapped_size__(old_n * sizeof(T), Flags);
+    size_t new_size = mmap_UTILL::mapped_size__(new_n * sizeof(T), Flags);
+    if (old_size == new_size) {
+      return true;
+    }
+    if (mremap(p, old_size, new_size, 0) == MAP_FAILED) {
+      return false;
+    }
+    if (new_size > old_size) {
+      mmap_UTILL::prepare__(reinterpret_cast<char *>(p) + old_size,
+                            new_size - old_size, Flags);
+    }
+    return true;
+  }
+
+  // Resize, moving the mapping if needed. The kernel moves page table entries
+  // instead of bytes, so a multi GB table grows in constant time.
+  // Only valid for types that can be moved by moving bytes, the objects
+  // don't get their move constructor called.
+  T *reallocate(T *p, size_t old_n, size_t new_n) {
+    if (is_mapped(old_n) && is_mapped(new_n)) {
+      size_t old_size = mmap_UTILL::mapped_size__(old_n * sizeof(T), Flags);
+      size_t new_size = mmap_UTILL::mapped_size__(new_n * sizeof(T), Flags);
+      if (old_size == new_size) {
+        return p;
+      }
+      if (new_size < old_size) { // shrinking never moves.
+        if (mremap(p, old_size, new_size, 0) == MAP_FAILED) {
+          throw mstl::bad_alloc();
+        }
+        return p;
+      }
+      void *q = mmap_UTILL::grow__(p, old_size, new_size, Flags);
+      if (q == nullptr) {
+        throw mstl::bad_alloc();
+      }
+      return static_cast<T *>(q);
+    }
+
+    // crossing the threshold, copy over.
+    T *q = allocate(new_n);
+    memcpy(static_cast<void *>(q), static_cast<const void *>(p),
+           (old_n < new_n ? old_n : new_n) * sizeof(T));
+    deallocate(p, old_n);
+    return q;
+  }
+};
+
+template <typename T, typename U, unsigned F>
+constexpr bool operator==(const mmap_allocator<T, F> &,
+                          const mmap_allocator<U, F> &) noexcept {
+  return true;
+}
+
+template <typename T, typename U, unsigned F>
+constexpr bool operator!=(const mmap_allocator<T, F> &,
+                          const mmap_allocator<U, F> &) noexcept {
+  return false;
+}
+
+} // namespace mstl
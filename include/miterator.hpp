@@ -3,7 +3,6 @@
 #include "mtype_traits.hpp"
 #include "utility.hpp"
 #include <cstddef>
-#include <vector>
 
 namespace mstl {
 
@@ -12,7 +11,12 @@ struct input_iterator_tag {};
 struct output_iterator_tag {};
 struct forward_iterator_tag : public input_iterator_tag {};
 struct bidirectional_iterator_tag : public forward_iterator_tag {};
-struct random_access_iterator_tag {};
+struct random_access_iterator_tag : public bidirectional_iterator_tag {};
+
+// random access, and the elements sit next to each other in memory, so
+// [it, it + n) is the array [&*it, &*it + n). Algorithms use it to hand
+// whole ranges to memmove, memset and friends.
+struct contiguous_iterator_tag : public random_access_iterator_tag {};
 
 // iterator trait provides a uniform interface for iterators
 //
@@ -38,6 +42,17 @@ template <typename T> struct iterator_traits<T *> {
   using iterator_category = mstl::random_access_iterator_tag;
 };
 
+// Pointers keep random access as their category, like the standard, so
+// ask this trait instead of looking at the tag.
+template <typename Iter, typename = void>
+struct is_contiguous_iterator : mstl::false_type {};
+template <typename T> struct is_contiguous_iterator<T *> : mstl::true_type {};
+template <typename Iter>
+struct is_contiguous_iterator<Iter,
+                              mstl::void_t<typename Iter::iterator_category>>
+    : mstl::is_convertible<typename Iter::iterator_category,
+                           mstl::contiguous_iterator_tag> {};
+
 // Note: before C++17 there was a type called std::iterator, which is used as
 // the based class for other types of iterator to inherit. e.g
 // template <typename T>
@@ -69,10 +84,40 @@ distance__(Iter first, Iter last, mstl::random_access_iterator_tag) {
 // return the distance between first and list.
 // note ub: if the last is not reachable from the first.
 template <typename Iter>
-typename mstl::iterator_traits<Iter>::difference_type distance(Iter first,
-                                                               Iter last) {
+constexpr typename mstl::iterator_traits<Iter>::difference_type
+distance(Iter first, Iter last) {
   return distance__(first, last,
-                    mstl::iterator_traits<Iter>::iterator_category());
+                    typename mstl::iterator_traits<Iter>::iterator_category());
+}
+
+template <typename Iter, typename Distance>
+constexpr void advance__(Iter &it, Distance n, mstl::input_iterator_tag) {
+  for (; n > 0; --n) {
+    ++it;
+  }
+}
+
+template <typename Iter, typename Distance>
+constexpr void advance__(Iter &it, Distance n,
+                         mstl::bidirectional_iterator_tag) {
+  for (; n > 0; --n) {
+    ++it;
+  }
+  for (; n < 0; ++n) {
+    --it;
+  }
+}
+
+template <typename Iter, typename Distance>
+constexpr void advance__(Iter &it, Distance n,
+                         mstl::random_access_iterator_tag) {
+  it += n;
+}
+
+// move it by n steps. Only bidirectional iterators can go backwards.
+template <typename Iter, typename Distance>
+constexpr void advance(Iter &it, Distance n) {
+  advance__(it, n, typename mstl::iterator_traits<Iter>::iterator_category());
 }
 
 } // namespace mstl
@@ -328,13 +373,21 @@ namespace mstl {
 
 } // namespace mstl
 
-// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-// TODO remove these dependencies.
-#include <deque>
-#include <functional>
-#include <iostream>
-#include <stack>
-#include <vector>
+namespace mstl {
+
+// The monotonic iterators below keep their state in a deque and a vector,
+// which need the adaptors above themselves. So they are declared here and
+// pulled in at the end of the file.
+template <typename T, typename Alloc> class deque;
+
+// tag for deques that never reallocate, see mdeque.hpp.
+struct fixed_capacity_t {
+  explicit fixed_capacity_t() = default;
+};
+
+inline constexpr fixed_capacity_t fixed_capacity{};
+
+} // namespace mstl
 
 namespace mstl {
 
@@ -346,72 +399,93 @@ namespace mstl {
 //
 // The idea is to maintain a deque, and only include elements that are
 // `possible` to be the biggest (smallest) value in the subsequence.
+// A new element kicks out everything at the back it beats, since those can
+// never be the answer again while it's in the window. So the deque stays
+// sorted and the front is the answer for the current window.
+//
+// The deque never holds more than window_size elements, so it's allocated
+// once with a fixed capacity, and sliding the window never allocates.
+
+// the tags are the comparators too. comp(a, b) is true when a beats b.
+struct monotonic_increasing {
+  template <typename A, typename B>
+  constexpr bool operator()(const A &a, const B &b) const {
+    return a < b;
+  }
+};
 
-struct monotonic_increasing {};
-struct monotonic_decreasing {};
+struct monotonic_decreasing {
+  template <typename A, typename B>
+  constexpr bool operator()(const A &a, const B &b) const {
+    return a > b;
+  }
+};
 
 template <typename Tag, typename = void>
 struct is_monotonic_iterator_tag : mstl::false_type {};
 
 template <typename Tag>
 struct is_monotonic_iterator_tag<
-    Tag, mstl::void_t<typename mstl::enable_if<std::conjunction_v<
-             mstl::is_same<Tag, monotonic_increasing>::value,
-             mstl::is_same<Tag, monotonic_decreasing>::value>>::type>>
+    Tag, mstl::enable_if_t<mstl::is_same<Tag, monotonic_increasing>::value ||
+                           mstl::is_same<Tag, monotonic_decreasing>::value>>
     : mstl::true_type {};
 
+// Iter needs to be random access to build the end iterator.
+// note ub: the range must hold at least window_size elements.
 template <typename Iter, typename Comp> class monotonic_queue_iterator {
 private:
   using T = typename mstl::iterator_traits<Iter>::value_type;
-  mstl::deque<T> queue;
+  using queue_type = mstl::deque<T, mstl::allocator<T>>;
+
+  queue_type queue;
   size_t win_size;
   Iter first;
+  Iter back; // last element of the window.
+  Iter last; // end of the whole range.
 
   Comp comp;
 
+  constexpr monotonic_queue_iterator(Iter first, size_t window_size,
+                                     const Comp &comp, Iter last, bool)
+      : queue(), win_size(window_size), first(first), back(last), last(last),
+        comp(comp) {}
+
+  void push__(const T &x) {
+    auto qit = queue.rbegin();
+    while (qit != queue.rend() && comp(x, *qit)) {
+      ++qit;
+    }
+    queue.erase(qit.base(), queue.end());
+    queue.push_back(x);
+  }
+
 public:
   using difference_type = void;
-  using value_type = mstl::deque<T>;
-  using pointer = mstl::deque<T> *;
-  using reference = mstl::deque<T> &;
-  using const_reference = const mstl::deque<T> &;
+  using value_type = queue_type;
+  using pointer = const queue_type *;
+  using reference = const queue_type &;
+  using const_reference = const queue_type &;
   using iterator_category = mstl::input_iterator_tag;
 
   // initialize the first window.
-  explicit constexpr monotonic_queue_iterator(Iter first, size_t window_size,
-                                              const Comp &comp)
-      : win_size(window_size), first(first), comp(comp) {
-    auto it = first;
-    auto max_it = it;
-
-    for (size_t i = 0; i < win_size; ++i) {
-      mstl::cout << *it << mstl::endl;
-      if (comp(*it, *max_it)) {
-        max_it = it;
-      }
-
-      if (i < win_size - 1)
-        ++it;
-    }
-
-    queue.push_back(*max_it);
-
-    if (max_it != it) {
-      queue.push_back(*it);
+  constexpr monotonic_queue_iterator(Iter first, Iter last,
+                                     size_t window_size,
+                                     const Comp &comp = Comp())
+      : queue(mstl::fixed_capacity, window_size), win_size(window_size),
+        first(first), back(first), last(last), comp(comp) {
+    for (size_t i = 0; i < win_size; ++i, ++back) {
+      push__(*back);
     }
+    --back;
   }
 
-  explicit constexpr monotonic_queue_iterator(Iter first, size_t win_size,
-                                              monotonic_decreasing g)
-      : monotonic_queue_iterator(
-            first, win_size,
-            [](const auto &a, const auto &b) { return a > b; }) {}
-
-  explicit constexpr monotonic_queue_iterator(Iter first, size_t win_size,
-                                              monotonic_increasing g)
-      : monotonic_queue_iterator(
-            first, win_size,
-            [](const auto &a, const auto &b) { return a < b; }) {}
+  // the end iterator, it sits one past the last full window and never
+  // looks at the elements.
+  static constexpr monotonic_queue_iterator
+  sentinel(Iter last, size_t window_size, const Comp &comp = Comp()) {
+    return monotonic_queue_iterator(last - (window_size - 1), window_size,
+                                    comp, last, true);
+  }
 
   constexpr inline friend bool
   operator==(const monotonic_queue_iterator &self,
@@ -425,86 +499,64 @@ public:
     return !(self == other);
   }
 
-  constexpr inline monotonic_queue_iterator<Iter, Comp> operator++() {
-    auto it = ++first;
-    mstl::advance(it, win_size - 1);
-
-    auto qit = queue.rbegin();
-    while (!queue.empty() && qit != queue.rend() && *qit < *it) {
-      qit++;
+  // slide by one. The element leaving the window is only in the queue if
+  // nothing beat it, and then it's at the front.
+  constexpr inline monotonic_queue_iterator &operator++() {
+    const T &leaving = *first;
+    if (!queue.empty() && !comp(queue.front(), leaving) &&
+        !comp(leaving, queue.front())) {
+      queue.pop_front();
+    }
+    ++first;
+    if (++back != last) {
+      push__(*back);
     }
-
-    queue.erase(qit.base(), queue.end());
-    queue.push_back(*it);
-
     return *this;
   }
 
-  constexpr inline monotonic_queue_iterator<Iter, Comp> operator++(int) {
+  constexpr inline monotonic_queue_iterator operator++(int) {
     monotonic_queue_iterator tmp(*this);
-    ++this;
+    ++*this;
     return tmp;
   }
 
+  // the front of the queue is the extremum of the current window.
   constexpr inline const_reference operator*() const noexcept { return queue; }
-  constexpr inline const_reference operator*() noexcept { return queue; }
 
-  constexpr pointer operator->() noexcept {
+  constexpr pointer operator->() const noexcept {
     return mstl::addressof(operator*());
   }
 };
 
-template <typename Iter, typename Comp, typename Tag,
-          typename mstl::enable_if_t<is_monotonic_iterator_tag<Tag>::value>>
-constexpr decltype(auto) make_monotonic_queue_iterators(Iter begin, Iter end,
-                                                        size_t window_size,
-                                                        Tag tag) {
-  return mstl::make_pair(
-      monotonic_queue_iterator{begin, window_size, tag},
-      monotonic_queue_iterator{end - window_size + 1, window_size, tag});
-}
+template <typename Iter, typename Comp>
+monotonic_queue_iterator(Iter, Iter, size_t, Comp)
+    -> monotonic_queue_iterator<Iter, Comp>;
 
 template <typename Iter, typename Comp>
 constexpr decltype(auto) make_monotonic_queue_iterators(Iter begin, Iter end,
                                                         size_t window_size,
                                                         const Comp &comp) {
-  return mstl::make_pair(
-      monotonic_queue_iterator{begin, window_size, comp},
-      monotonic_queue_iterator{end - window_size + 1, window_size, comp});
+  using iter = monotonic_queue_iterator<Iter, Comp>;
+  return mstl::make_pair(iter(begin, end, window_size, comp),
+                         iter::sentinel(end, window_size, comp));
 }
 
-template <typename Iter, typename Comp>
+// sliding window maximum by default.
+template <typename Iter>
 constexpr decltype(auto) make_monotonic_queue_iterators(Iter begin, Iter end,
                                                         size_t window_size) {
-  return mstl::make_pair(
-      monotonic_queue_iterator{begin, window_size, monotonic_decreasing()},
-      monotonic_queue_iterator{end - window_size + 1, window_size,
-                               monotonic_decreasing()});
+  return make_monotonic_queue_iterators(begin, end, window_size,
+                                        monotonic_decreasing());
 }
 
 template <typename C, typename Comp>
-constexpr decltype(auto) make_monotonic_queue_iterators(C container,
+constexpr decltype(auto) make_monotonic_queue_iterators(C &container,
                                                         size_t window_size,
                                                         const Comp &comp) {
-
-  return mstl::make_pair(
-      monotonic_queue_iterator{mstl::begin(container), window_size, comp},
-      monotonic_queue_iterator{mstl::end(container) - window_size + 1,
-                               window_size, comp});
+  return make_monotonic_queue_iterators(container.begin(), container.end(),
+                                        window_size, comp);
 }
 
-template <typename Iter, typename Tag>
-monotonic_queue_iterator(Iter, size_t, Tag) -> monotonic_queue_iterator<
-    Iter,
-    mstl::function<bool(typename mstl::iterator_traits<Iter>::value_type,
-                        typename mstl::iterator_traits<Iter>::value_type)>>;
-
-template <typename Iter>
-monotonic_queue_iterator(Iter, size_t) -> monotonic_queue_iterator<
-    Iter,
-    mstl::function<bool(typename mstl::iterator_traits<Iter>::value_type,
-                        typename mstl::iterator_traits<Iter>::value_type)>>;
-
 // monotonic stack
 // to solve NGE (next greater element) problem in O(n)
 // find the next greater element for all elements.
@@ -514,30 +566,22 @@ monotonic_queue_iterator(Iter, size_t) -> monotonic_queue_iterator<
 template <typename Iter, typename Comp> class monotonic_stack_iterator {
 private:
   using T = typename mstl::iterator_traits<Iter>::value_type;
-  using stack = mstl::vector<T>;
+  using stack = mstl::deque<T, mstl::allocator<T>>;
   Comp comp;
   stack data;
   Iter first;
 
 public:
   using difference_type = void;
-  using pointer = stack *;
-  using reference = stack &;
+  using pointer = const stack *;
+  using reference = const stack &;
   using const_reference = const stack &;
-  using value_type = T;
+  using value_type = stack;
   using iterator_category = mstl::input_iterator_tag;
 
-  constexpr monotonic_stack_iterator(Iter first, const Comp &comp)
+  constexpr monotonic_stack_iterator(Iter first, const Comp &comp = Comp())
       : comp(comp), data(), first(first) {}
 
-  constexpr monotonic_stack_iterator(Iter first, monotonic_decreasing tag)
-      : monotonic_stack_iterator(
-            first, [](const auto &a, const auto &b) { return a > b; }) {}
-
-  constexpr monotonic_stack_iterator(Iter first, monotonic_increasing tag)
-      : monotonic_stack_iterator(
-            first, [](const auto &a, const auto &b) { return a < b; }) {}
-
   constexpr friend bool operator==(const monotonic_stack_iterator &self,
                                    const monotonic_stack_iterator &other) {
     return self.first == other.first;
@@ -548,55 +592,35 @@ public:
     return !(self == other);
   }
 
-  constexpr monotonic_stack_iterator<Iter, Comp> operator++() {
+  // consume one element.
+  constexpr monotonic_stack_iterator &operator++() {
     auto it = first++;
-    if (data.empty()) {
-      data.push_back(*it);
-      return *this;
-    }
-
     while (!data.empty() && comp(*it, data.back())) {
       data.pop_back();
     }
-
     data.push_back(*it);
     return *this;
   }
 
-  constexpr monotonic_stack_iterator<Iter, Comp> operator++(int) {
+  constexpr monotonic_stack_iterator operator++(int) {
     monotonic_stack_iterator tmp(*this);
-    ++this;
+    ++*this;
     return tmp;
   }
 
-  constexpr const_reference operator*() { return data; }
   constexpr const_reference operator*() const { return data; }
 };
 
-template <typename Iter>
-monotonic_stack_iterator(Iter) -> monotonic_stack_iterator<
-    Iter,
-    mstl::function<bool(typename mstl::iterator_traits<Iter>::value_type,
-                        typename mstl::iterator_traits<Iter>::value_type)>>;
-
-template <typename Iter, typename Tag>
-monotonic_stack_iterator(Iter, Tag) -> monotonic_stack_iterator<
-    Iter,
-    mstl::function<bool(typename mstl::iterator_traits<Iter>::value_type,
-                        typename mstl::iterator_traits<Iter>::value_type)>>;
+template <typename Iter, typename Comp>
+monotonic_stack_iterator(Iter, Comp) -> monotonic_stack_iterator<Iter, Comp>;
 
 template <typename Iter, typename Comp>
 constexpr decltype(auto) make_monotonic_stack_iterators(Iter begin, Iter end,
                                                         const Comp &comp) {
-  return mstl::pair(monotonic_stack_iterator{begin, comp},
-                    monotonic_stack_iterator{end + 1, comp});
+  return mstl::make_pair(monotonic_stack_iterator{begin, comp},
+                         monotonic_stack_iterator{end, comp});
 }
 
-template <typename Iter, typename Comp, typename Tag,
-          typename mstl::enable_if_t<is_monotonic_iterator_tag<Tag>::value>>
-constexpr decltype(auto) make_monotonic_stack_iterators(Iter begin, Iter end,
-                                                        Tag tag) {
-  return mstl::pair(monotonic_stack_iterator{begin, tag},
-                    monotonic_stack_iterator{end + 1, tag});
-}
 } // namespace mstl
+
+#include "mdeque.hpp"
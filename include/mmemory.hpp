@@ -1,6 +1,11 @@
 #pragma once
+#include "mnew.hpp"
 #include "mtype_traits.hpp"
 #include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
 
 namespace mstl {
 
@@ -17,10 +22,89 @@ constexpr T *addressof(const T &&arg) = delete; // no addr for const rvalue
 
 } // namespace mstl
 
+namespace mstl::memory_UTIL {
+
+// bytes for n objects of T. A count whose size doesn't fit in size_t would
+// wrap around to a small block, throw instead.
+template <typename T> constexpr size_t array_bytes__(size_t n) {
+  if (n > size_t(-1) / sizeof(T)) {
+    throw mstl::bad_array_new_length();
+  }
+  return n * sizeof(T);
+}
+
+} // namespace mstl::memory_UTIL
+
 namespace mstl {
-template <typename T> class allocator;
+
+// the default allocator. It's stateless, every instance is equal to each
+// other, and it just forwards to mstl::operator_new. Over aligned types
+// take the aligned overload, which is served from the aligned slabs.
+// Most of the members are deprecated in c++17 and removed in c++20, because
+// allocator_traits can fill them in with default values anyway.
+template <typename T> class allocator {
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using propagate_on_container_move_assignment = mstl::true_type;
+  using is_always_equal = mstl::true_type;
+
+  constexpr allocator() noexcept = default;
+  template <typename U> constexpr allocator(const allocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    size_t bytes = memory_UTIL::array_bytes__<T>(n);
+    if constexpr (alignof(T) > alignof(std::max_align_t)) {
+      return static_cast<T *>(
+          mstl::operator_new(bytes, mstl::align_val_t(alignof(T))));
+    } else {
+      return static_cast<T *>(mstl::operator_new(bytes));
+    }
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    if constexpr (alignof(T) > alignof(std::max_align_t)) {
+      mstl::operator_delete(p, n * sizeof(T), mstl::align_val_t(alignof(T)));
+    } else {
+      mstl::operator_delete(p, n * sizeof(T));
+    }
+  }
+
+  // Resize a block, moving its bytes. Ordinary blocks come from malloc, so
+  // realloc can often grow them in place. Only for trivially relocatable
+  // types, no constructor or destructor is called.
+  T *reallocate(T *p, size_t old_n, size_t new_n) {
+    if constexpr (alignof(T) > alignof(std::max_align_t)) {
+      T *q = allocate(new_n);
+      if (old_n != 0) {
+        memcpy(static_cast<void *>(q), static_cast<const void *>(p),
+               (old_n < new_n ? old_n : new_n) * sizeof(T));
+        deallocate(p, old_n);
+      }
+      return q;
+    } else {
+      size_t bytes = new_n == 0 ? 1 : memory_UTIL::array_bytes__<T>(new_n);
+      void *q = new_UTILL::allocate_loop__([p, bytes]() -> void * {
+        return realloc(static_cast<void *>(p), bytes);
+      });
+      return static_cast<T *>(q);
+    }
+  }
+};
+
+template <typename T, typename U>
+constexpr bool operator==(const allocator<T> &, const allocator<U> &) noexcept {
+  return true;
+}
+
+template <typename T, typename U>
+constexpr bool operator!=(const allocator<T> &, const allocator<U> &) noexcept {
+  return false;
+}
 
 template <> class allocator<void> {
+public:
   using pointer = void *;
   using const_pointer = const void *;
   using value_type = void;
@@ -29,6 +113,7 @@ template <> class allocator<void> {
 };
 
 template <> class allocator<const void> {
+public:
   using pointer = const void *;
   using const_pointer = const void *;
   using value_type = const void;
@@ -178,7 +263,7 @@ template <typename T> struct pointer_traits<T *> {
   using element_type = T;
   using difference_type = ptrdiff_t;
 
-  template <typename U> struct rebind { using Other = U *; };
+  template <typename U> struct rebind { using other = U *; };
 
 private:
   struct nat__ {};
@@ -226,82 +311,2295 @@ template <typename Ptr> auto to_address(const Ptr &p) noexcept {
 }
 } // namespace mstl
 
-namespace mstl // allocator traits
-{}             // namespace mstl
+namespace mstl::memory_UTIL {
+
+template <typename Iter>
+using iter_value__ = typename mstl::remove_cvref<decltype(
+    *mstl::declval<Iter &>())>::type;
+
+// Copying a range of Src into raw storage of Dst can be one memcpy when both
+// sides are raw pointers to the same trivially copyable type. Other
+// iterators might not be contiguous, so they always take the loop.
+template <typename Src, typename Dst>
+struct is_bitwise_copyable__ : mstl::false_type {};
+
+template <typename T, typename U>
+struct is_bitwise_copyable__<T *, U *>
+    : mstl::integral_constant<
+          bool, mstl::is_same<typename mstl::remove_cv<T>::type, U>::value &&
+                    mstl::is_trivially_copyable<U>::value> {};
+
+// a fill can only be a memset if every byte of the value is the same. Zero
+// is by far the common case, so that's the only one we check for.
+template <typename T> bool is_zero_bytes__(const T &value) noexcept {
+  auto bytes = reinterpret_cast<const unsigned char *>(mstl::addressof(value));
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    if (bytes[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace mstl::memory_UTIL
 
 namespace mstl {
 
-// only for unique pointer
-template <typename T> struct default_delete {
-  constexpr default_delete() noexcept = default;
-  template <typename U> default_delete(const default_delete<U> &) noexcept;
-  void operator()(T *) const noexcept;
+// The uninitialized algorithms construct objects into raw memory. They are
+// the inner loops of every container growth and copy, so for trivial types
+// on raw pointers they collapse into a memcpy, a memset, or nothing at all.
+//
+// If a constructor throws halfway, whatever was constructed so far is
+// destroyed before the exception leaves, so the storage is raw again.
+
+template <typename T, typename... Args>
+T *construct_at(T *p, Args &&...args) {
+  return ::new (static_cast<void *>(p)) T(mstl::forward<Args>(args)...);
+}
+
+template <typename T> void destroy_at(T *p) noexcept {
+  if constexpr (!mstl::is_trivially_destructible<T>::value) {
+    p->~T();
+  }
+}
+
+template <typename ForwardIt> void destroy(ForwardIt first, ForwardIt last) {
+  using T = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (!mstl::is_trivially_destructible<T>::value) {
+    for (; first != last; ++first) {
+      mstl::destroy_at(mstl::addressof(*first));
+    }
+  }
+}
+
+template <typename ForwardIt, typename Size>
+ForwardIt destroy_n(ForwardIt first, Size n) {
+  using T = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (mstl::is_trivially_destructible<T>::value &&
+                mstl::is_pointer<ForwardIt>::value) {
+    return n > 0 ? first + n : first;
+  } else {
+    for (; n > 0; ++first, --n) {
+      mstl::destroy_at(mstl::addressof(*first));
+    }
+    return first;
+  }
+}
+
+template <typename InputIt, typename ForwardIt>
+ForwardIt uninitialized_copy(InputIt first, InputIt last, ForwardIt d_first) {
+  if constexpr (memory_UTIL::is_bitwise_copyable__<InputIt,
+                                                   ForwardIt>::value) {
+    size_t n = static_cast<size_t>(last - first);
+    if (n) {
+      memcpy(static_cast<void *>(d_first), static_cast<const void *>(first),
+             n * sizeof(*d_first));
+    }
+    return d_first + n;
+  } else {
+    using T = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = d_first;
+    try {
+      for (; first != last; ++first, ++cur) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T(*first);
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(d_first, cur);
+      throw;
+    }
+  }
+}
+
+template <typename InputIt, typename Size, typename ForwardIt>
+ForwardIt uninitialized_copy_n(InputIt first, Size n, ForwardIt d_first) {
+  if constexpr (memory_UTIL::is_bitwise_copyable__<InputIt,
+                                                   ForwardIt>::value) {
+    return mstl::uninitialized_copy(first, n > 0 ? first + n : first,
+                                    d_first);
+  } else {
+    using T = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = d_first;
+    try {
+      for (; n > 0; ++first, ++cur, --n) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T(*first);
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(d_first, cur);
+      throw;
+    }
+  }
+}
+
+// moving a trivially copyable object is copying its bytes.
+template <typename InputIt, typename ForwardIt>
+ForwardIt uninitialized_move(InputIt first, InputIt last, ForwardIt d_first) {
+  if constexpr (memory_UTIL::is_bitwise_copyable__<InputIt,
+                                                   ForwardIt>::value) {
+    return mstl::uninitialized_copy(first, last, d_first);
+  } else {
+    using T = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = d_first;
+    try {
+      for (; first != last; ++first, ++cur) {
+        ::new (static_cast<void *>(mstl::addressof(*cur)))
+            T(mstl::move(*first));
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(d_first, cur);
+      throw;
+    }
+  }
+}
+
+// note: std returns a pair of both ends here. We don't have a pair yet, and
+// the source end is first + n anyway, so only the output end is returned.
+template <typename InputIt, typename Size, typename ForwardIt>
+ForwardIt uninitialized_move_n(InputIt first, Size n, ForwardIt d_first) {
+  if constexpr (memory_UTIL::is_bitwise_copyable__<InputIt,
+                                                   ForwardIt>::value) {
+    return mstl::uninitialized_copy(first, n > 0 ? first + n : first,
+                                    d_first);
+  } else {
+    using T = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = d_first;
+    try {
+      for (; n > 0; ++first, ++cur, --n) {
+        ::new (static_cast<void *>(mstl::addressof(*cur)))
+            T(mstl::move(*first));
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(d_first, cur);
+      throw;
+    }
+  }
+}
+
+template <typename ForwardIt, typename Size, typename T>
+ForwardIt uninitialized_fill_n(ForwardIt first, Size n, const T &value) {
+  using V = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (mstl::is_pointer<ForwardIt>::value &&
+                mstl::is_same<V, T>::value &&
+                mstl::is_trivially_copyable<V>::value) {
+    if (n <= 0) {
+      return first;
+    }
+    if (sizeof(V) == 1 || memory_UTIL::is_zero_bytes__(value)) {
+      memset(static_cast<void *>(first),
+             *reinterpret_cast<const unsigned char *>(mstl::addressof(value)),
+             static_cast<size_t>(n) * sizeof(V));
+      return first + n;
+    }
+    // no throwing possible, a plain loop the compiler can vectorize.
+    for (Size i = 0; i < n; ++i) {
+      ::new (static_cast<void *>(first + i)) V(value);
+    }
+    return first + n;
+  } else {
+    ForwardIt cur = first;
+    try {
+      for (; n > 0; ++cur, --n) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) V(value);
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+template <typename ForwardIt, typename T>
+void uninitialized_fill(ForwardIt first, ForwardIt last, const T &value) {
+  if constexpr (mstl::is_pointer<ForwardIt>::value) {
+    mstl::uninitialized_fill_n(first, last - first, value);
+  } else {
+    using V = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = first;
+    try {
+      for (; cur != last; ++cur) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) V(value);
+      }
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+// default initialization leaves trivial types indeterminate, which means
+// doing nothing at all.
+template <typename ForwardIt, typename Size>
+ForwardIt uninitialized_default_construct_n(ForwardIt first, Size n) {
+  using T = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (mstl::is_trivially_default_constructible<T>::value &&
+                mstl::is_pointer<ForwardIt>::value) {
+    return n > 0 ? first + n : first;
+  } else {
+    ForwardIt cur = first;
+    try {
+      for (; n > 0; ++cur, --n) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T;
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+template <typename ForwardIt>
+void uninitialized_default_construct(ForwardIt first, ForwardIt last) {
+  using T = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (!mstl::is_trivially_default_constructible<T>::value) {
+    ForwardIt cur = first;
+    try {
+      for (; cur != last; ++cur) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T;
+      }
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+// value initialization of a scalar is zero. For everything else let the
+// compiler decide, it turns trivial loops into memset on its own.
+template <typename ForwardIt, typename Size>
+ForwardIt uninitialized_value_construct_n(ForwardIt first, Size n) {
+  using T = memory_UTIL::iter_value__<ForwardIt>;
+  if constexpr (mstl::is_pointer<ForwardIt>::value &&
+                (mstl::is_arithmetic<T>::value ||
+                 mstl::is_pointer<T>::value || mstl::is_enum<T>::value)) {
+    if (n <= 0) {
+      return first;
+    }
+    memset(static_cast<void *>(first), 0, static_cast<size_t>(n) * sizeof(T));
+    return first + n;
+  } else {
+    ForwardIt cur = first;
+    try {
+      for (; n > 0; ++cur, --n) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T();
+      }
+      return cur;
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+template <typename ForwardIt>
+void uninitialized_value_construct(ForwardIt first, ForwardIt last) {
+  if constexpr (mstl::is_pointer<ForwardIt>::value) {
+    mstl::uninitialized_value_construct_n(first, last - first);
+  } else {
+    using T = memory_UTIL::iter_value__<ForwardIt>;
+    ForwardIt cur = first;
+    try {
+      for (; cur != last; ++cur) {
+        ::new (static_cast<void *>(mstl::addressof(*cur))) T();
+      }
+    } catch (...) {
+      mstl::destroy(first, cur);
+      throw;
+    }
+  }
+}
+
+} // namespace mstl
+
+namespace mstl { // allocator traits
+
+namespace allocator_traits_UTILL {
+// same trick as pointer_traits. allocator_traits is mostly a big list of
+// "use Alloc::X if it exists, otherwise pick a sensible default".
+
+template <typename T, typename = void>
+struct has_pointer__ : mstl::false_type {};
+template <typename T>
+struct has_pointer__<T, mstl::void_t<typename T::pointer>> : mstl::true_type {
 };
 
-template <typename T> struct default_delete<T[]> {
-  constexpr default_delete() noexcept = default;
-  void operator()(T *) const noexcept;
-  template <typename U> void operator()(U *) const = delete;
+template <typename Alloc, bool = has_pointer__<Alloc>::value>
+struct pointer__ {
+  using type = typename Alloc::value_type *;
+};
+template <typename Alloc> struct pointer__<Alloc, true> {
+  using type = typename Alloc::pointer;
 };
 
-template <typename T, typename D = default_delete<T>> class unique_ptr {
+// the rest of the pointer types are rebinds of pointer, so a fancy pointer
+// allocator get fancy void pointers for free.
+template <typename T, typename = void>
+struct has_const_pointer__ : mstl::false_type {};
+template <typename T>
+struct has_const_pointer__<T, mstl::void_t<typename T::const_pointer>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename Ptr,
+          bool = has_const_pointer__<Alloc>::value>
+struct const_pointer__ {
+  using type = typename mstl::pointer_traits<Ptr>::template rebind<
+      const typename Alloc::value_type>::other;
+};
+template <typename Alloc, typename Ptr>
+struct const_pointer__<Alloc, Ptr, true> {
+  using type = typename Alloc::const_pointer;
+};
+
+template <typename T, typename = void>
+struct has_void_pointer__ : mstl::false_type {};
+template <typename T>
+struct has_void_pointer__<T, mstl::void_t<typename T::void_pointer>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename Ptr, bool = has_void_pointer__<Alloc>::value>
+struct void_pointer__ {
+  using type =
+      typename mstl::pointer_traits<Ptr>::template rebind<void>::other;
+};
+template <typename Alloc, typename Ptr>
+struct void_pointer__<Alloc, Ptr, true> {
+  using type = typename Alloc::void_pointer;
+};
+
+template <typename T, typename = void>
+struct has_const_void_pointer__ : mstl::false_type {};
+template <typename T>
+struct has_const_void_pointer__<T,
+                                mstl::void_t<typename T::const_void_pointer>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename Ptr,
+          bool = has_const_void_pointer__<Alloc>::value>
+struct const_void_pointer__ {
+  using type =
+      typename mstl::pointer_traits<Ptr>::template rebind<const void>::other;
+};
+template <typename Alloc, typename Ptr>
+struct const_void_pointer__<Alloc, Ptr, true> {
+  using type = typename Alloc::const_void_pointer;
+};
+
+template <typename T, typename = void>
+struct has_difference_type__ : mstl::false_type {};
+template <typename T>
+struct has_difference_type__<T, mstl::void_t<typename T::difference_type>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename Ptr,
+          bool = has_difference_type__<Alloc>::value>
+struct difference_type__ {
+  using type = typename mstl::pointer_traits<Ptr>::difference_type;
+};
+template <typename Alloc, typename Ptr>
+struct difference_type__<Alloc, Ptr, true> {
+  using type = typename Alloc::difference_type;
+};
+
+template <typename T, typename = void>
+struct has_size_type__ : mstl::false_type {};
+template <typename T>
+struct has_size_type__<T, mstl::void_t<typename T::size_type>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename Diff, bool = has_size_type__<Alloc>::value>
+struct size_type__ {
+  using type = typename mstl::make_unsigned<Diff>::type;
+};
+template <typename Alloc, typename Diff> struct size_type__<Alloc, Diff, true> {
+  using type = typename Alloc::size_type;
+};
+
+// propagate_on_container_xxx all default to false, is_always_equal
+// defaults to "the allocator has no state".
+template <typename T, typename = void>
+struct propagate_on_container_copy_assignment__ {
+  using type = mstl::false_type;
+};
+template <typename T>
+struct propagate_on_container_copy_assignment__<T,
+    mstl::void_t<typename T::propagate_on_container_copy_assignment>> {
+  using type = typename T::propagate_on_container_copy_assignment;
+};
+
+template <typename T, typename = void>
+struct propagate_on_container_move_assignment__ {
+  using type = mstl::false_type;
+};
+template <typename T>
+struct propagate_on_container_move_assignment__<T,
+    mstl::void_t<typename T::propagate_on_container_move_assignment>> {
+  using type = typename T::propagate_on_container_move_assignment;
+};
+
+template <typename T, typename = void>
+struct propagate_on_container_swap__ {
+  using type = mstl::false_type;
+};
+template <typename T>
+struct propagate_on_container_swap__<T,
+    mstl::void_t<typename T::propagate_on_container_swap>> {
+  using type = typename T::propagate_on_container_swap;
+};
+
+template <typename T, typename = void>
+struct is_always_equal__ {
+  using type = typename mstl::is_empty<T>::type;
+};
+template <typename T>
+struct is_always_equal__<T,
+    mstl::void_t<typename T::is_always_equal>> {
+  using type = typename T::is_always_equal;
+};
+
+// rebind. If the allocator has rebind<U>::other use it, otherwise replace
+// the first template parameter, just like pointer_traits does.
+template <typename T, typename U, typename = void>
+struct has_alloc_rebind__ : mstl::false_type {};
+template <typename T, typename U>
+struct has_alloc_rebind__<
+    T, U, mstl::void_t<typename T::template rebind<U>::other>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename U,
+          bool = has_alloc_rebind__<Alloc, U>::value>
+struct rebind_alloc__ {
+  using type = typename Alloc::template rebind<U>::other;
+};
+template <template <typename, typename...> typename Al, typename T,
+          typename... Args, typename U>
+struct rebind_alloc__<Al<T, Args...>, U, false> {
+  using type = Al<U, Args...>;
+};
+
+// member function detection. Here we can't check the existence of a type,
+// so we check if the expression is well formed instead.
+template <typename Alloc, typename SizeType, typename ConstVoidPtr,
+          typename = void>
+struct has_allocate_hint__ : mstl::false_type {};
+template <typename Alloc, typename SizeType, typename ConstVoidPtr>
+struct has_allocate_hint__<
+    Alloc, SizeType, ConstVoidPtr,
+    mstl::void_t<decltype(mstl::declval<Alloc &>().allocate(
+        mstl::declval<SizeType>(), mstl::declval<ConstVoidPtr>()))>>
+    : mstl::true_type {};
+
+template <typename Void, typename Alloc, typename T, typename... Args>
+struct has_construct_impl__ : mstl::false_type {};
+template <typename Alloc, typename T, typename... Args>
+struct has_construct_impl__<
+    mstl::void_t<decltype(mstl::declval<Alloc &>().construct(
+        mstl::declval<T *>(), mstl::declval<Args>()...))>,
+    Alloc, T, Args...> : mstl::true_type {};
+template <typename Alloc, typename T, typename... Args>
+struct has_construct__ : has_construct_impl__<void, Alloc, T, Args...> {};
+
+template <typename Alloc, typename T, typename = void>
+struct has_destroy__ : mstl::false_type {};
+template <typename Alloc, typename T>
+struct has_destroy__<Alloc, T,
+                     mstl::void_t<decltype(mstl::declval<Alloc &>().destroy(
+                         mstl::declval<T *>()))>> : mstl::true_type {};
+
+template <typename Alloc, typename = void>
+struct has_max_size__ : mstl::false_type {};
+template <typename Alloc>
+struct has_max_size__<
+    Alloc, mstl::void_t<decltype(mstl::declval<const Alloc &>().max_size())>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename = void>
+struct has_select_on_copy__ : mstl::false_type {};
+template <typename Alloc>
+struct has_select_on_copy__<
+    Alloc,
+    mstl::void_t<decltype(mstl::declval<const Alloc &>()
+                              .select_on_container_copy_construction())>>
+    : mstl::true_type {};
+
+template <typename Alloc, typename = void>
+struct has_reallocate__ : mstl::false_type {};
+template <typename Alloc>
+struct has_reallocate__<
+    Alloc, mstl::void_t<decltype(mstl::declval<Alloc &>().reallocate(
+               mstl::declval<typename pointer__<Alloc>::type>(), size_t(),
+               size_t()))>> : mstl::true_type {};
+
+} // namespace allocator_traits_UTILL
+
+namespace tracking_UTILL {
+// Allocation telemetry hook, see mtracking_allocator.hpp. Build with
+// MSTL_TRACK_ALLOCATIONS and every allocation that goes through
+// allocator_traits is counted under its value_type.
+template <typename Alloc> struct is_tracking_allocator__ : mstl::false_type {};
+template <typename T, typename Tag> void hook_allocate__(size_t bytes) noexcept;
+template <typename T, typename Tag>
+void hook_deallocate__(size_t bytes) noexcept;
+struct untagged;
+} // namespace tracking_UTILL
+
+// allocator_traits is the only thing a container talks to. The container
+// never calls alloc.allocate() directly, it calls
+// allocator_traits<Alloc>::allocate(alloc, n).
+// This way the allocator author only needs to provide value_type, allocate
+// and deallocate, everything else is filled in here.
+template <typename Alloc> struct allocator_traits {
+  using allocator_type = Alloc;
+  using value_type = typename Alloc::value_type;
+
+  using pointer = typename allocator_traits_UTILL::pointer__<Alloc>::type;
+  using const_pointer =
+      typename allocator_traits_UTILL::const_pointer__<Alloc, pointer>::type;
+  using void_pointer =
+      typename allocator_traits_UTILL::void_pointer__<Alloc, pointer>::type;
+  using const_void_pointer =
+      typename allocator_traits_UTILL::const_void_pointer__<Alloc,
+                                                           pointer>::type;
+  using difference_type =
+      typename allocator_traits_UTILL::difference_type__<Alloc, pointer>::type;
+  using size_type =
+      typename allocator_traits_UTILL::size_type__<Alloc,
+                                                   difference_type>::type;
+
+  using propagate_on_container_copy_assignment =
+      typename allocator_traits_UTILL::propagate_on_container_copy_assignment__<
+          Alloc>::type;
+  using propagate_on_container_move_assignment =
+      typename allocator_traits_UTILL::propagate_on_container_move_assignment__<
+          Alloc>::type;
+  using propagate_on_container_swap =
+      typename allocator_traits_UTILL::propagate_on_container_swap__<
+          Alloc>::type;
+  using is_always_equal =
+      typename allocator_traits_UTILL::is_always_equal__<Alloc>::type;
+
+  template <typename U>
+  using rebind_alloc =
+      typename allocator_traits_UTILL::rebind_alloc__<Alloc, U>::type;
+  template <typename U> using rebind_traits = allocator_traits<rebind_alloc<U>>;
+
+private:
+  static void track_allocate__([[maybe_unused]] size_type n) noexcept {
+#ifdef MSTL_TRACK_ALLOCATIONS
+    if constexpr (!tracking_UTILL::is_tracking_allocator__<Alloc>::value) {
+      tracking_UTILL::hook_allocate__<value_type, tracking_UTILL::untagged>(
+          n * sizeof(value_type));
+    }
+#endif
+  }
+
+  static void track_deallocate__([[maybe_unused]] size_type n) noexcept {
+#ifdef MSTL_TRACK_ALLOCATIONS
+    if constexpr (!tracking_UTILL::is_tracking_allocator__<Alloc>::value) {
+      tracking_UTILL::hook_deallocate__<value_type, tracking_UTILL::untagged>(
+          n * sizeof(value_type));
+    }
+#endif
+  }
+
 public:
-  using element_type = T;
-  using deleter_type = D;
-  using pointer = T *; // if default_delete::pointer present, use it. TODO
+  // allocations are counted once they succeeded, a throw counts nothing.
+  static pointer allocate(Alloc &a, size_type n) {
+    pointer p = a.allocate(n);
+    track_allocate__(n);
+    return p;
+  }
 
-  constexpr unique_ptr() noexcept;
-  explicit unique_ptr(pointer p) noexcept;
+  // the hint is only a suggestion, ignore it if the allocator doesn't care.
+  static pointer allocate(Alloc &a, size_type n, const_void_pointer hint) {
+    pointer p;
+    if constexpr (allocator_traits_UTILL::has_allocate_hint__<
+                      Alloc, size_type, const_void_pointer>::value) {
+      p = a.allocate(n, hint);
+    } else {
+      p = a.allocate(n);
+    }
+    track_allocate__(n);
+    return p;
+  }
 
-  unique_ptr(unique_ptr &&u) noexcept;
-  unique_ptr(std::nullptr_t) noexcept : unique_ptr() {}
+  static void deallocate(Alloc &a, pointer p, size_type n) {
+    track_deallocate__(n);
+    a.deallocate(p, n);
+  }
 
-  template <typename U, typename E> unique_ptr(unique_ptr<U, E> &&u) noexcept;
-  template <typename U> unique_ptr(unique_ptr<U> &&u) noexcept;
+  // not in std. Resize a block of old_n objects to new_n, keeping the
+  // bytes of the first min(old_n, new_n). Only for trivially relocatable
+  // value types, nothing is constructed or destroyed. Allocators that can
+  // do it in place (realloc, mremap) provide reallocate(p, old_n, new_n).
+  static pointer reallocate(Alloc &a, pointer p, size_type old_n,
+                            size_type new_n) {
+    if constexpr (allocator_traits_UTILL::has_reallocate__<Alloc>::value) {
+      pointer q = a.reallocate(p, old_n, new_n);
+      track_deallocate__(old_n);
+      track_allocate__(new_n);
+      return q;
+    } else {
+      pointer q = allocate(a, new_n);
+      if (old_n != 0) {
+        memcpy(static_cast<void *>(mstl::to_address(q)),
+               static_cast<const void *>(mstl::to_address(p)),
+               (old_n < new_n ? old_n : new_n) * sizeof(value_type));
+        deallocate(a, p, old_n);
+      }
+      return q;
+    }
+  }
 
-  ~unique_ptr();
+  template <typename T, typename... Args>
+  static void construct(Alloc &a, T *p, Args &&...args) {
+    if constexpr (allocator_traits_UTILL::has_construct__<Alloc, T,
+                                                          Args...>::value) {
+      a.construct(p, mstl::forward<Args>(args)...);
+    } else {
+      ::new (static_cast<void *>(p)) T(mstl::forward<Args>(args)...);
+    }
+  }
 
-  typename mstl::add_lvalue_reference<T>::type operator*() const;
-  pointer operator->() const noexcept;
-  pointer get() const noexcept;
-  deleter_type &get_deleter() noexcept;
-  const deleter_type &get_deleter() const noexcept;
-  explicit operator bool() const noexcept;
+  template <typename T> static void destroy(Alloc &a, T *p) {
+    if constexpr (allocator_traits_UTILL::has_destroy__<Alloc, T>::value) {
+      a.destroy(p);
+    } else {
+      p->~T();
+    }
+  }
 
-  // modifier
+  static size_type max_size(const Alloc &a) noexcept {
+    if constexpr (allocator_traits_UTILL::has_max_size__<Alloc>::value) {
+      return a.max_size();
+    } else {
+      return size_type(-1) / sizeof(value_type);
+    }
+  }
 
-  pointer release() noexcept;
-  void reset(pointer p = pointer()) noexcept;
-  void swap(unique_ptr &u) noexcept;
+  static Alloc select_on_container_copy_construction(const Alloc &a) {
+    if constexpr (allocator_traits_UTILL::has_select_on_copy__<Alloc>::value) {
+      return a.select_on_container_copy_construction();
+    } else {
+      return a;
+    }
+  }
 };
 
-template <typename T, typename D>
-void swap(mstl::unique_ptr<T, D> &x, mstl::unique_ptr<T, D> &y) noexcept;
+} // namespace mstl
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator==(const mstl::unique_ptr<T1, D1> &x,
-                const mstl::unique_ptr<T2, D2> &y);
+namespace mstl {
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator!=(const mstl::unique_ptr<T1, D1> &x,
-                const mstl::unique_ptr<T2, D2> &y) {
-  return !(x == y);
-}
+// Monotonic arena.
+// An arena hands out memory by bumping a pointer, and never gives anything
+// back until the whole arena is released. Deallocating a single object is a
+// no op. This is perfect for request scoped work: allocate everything
+// while handling the request, drop all of it at the end in one go.
+//
+// The arena starts from an optional buffer supplied by the caller (a stack
+// buffer for example), and when that runs out it chains heap chunks, each
+// one bigger than the last so the number of chunks stays logarithmic.
+//
+//   [ caller buffer ] -> [ chunk 1 ] -> [ chunk 2 (x2) ] -> ...
+//                                        ^cur      ^end
+//
+// note: the arena is not thread safe, and it must outlive every allocator
+// and every object that uses it.
+class monotonic_arena {
+  // chunk header lives at the front of each heap chunk.
+  struct chunk__ {
+    chunk__ *next;
+    size_t size; // total bytes including the header.
+  };
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator<(const mstl::unique_ptr<T1, D1> &x,
-               const mstl::unique_ptr<T2, D2> &y);
+  static constexpr size_t default_chunk_size__ = 4096;
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator<=(const mstl::unique_ptr<T1, D1> &x,
-                const mstl::unique_ptr<T2, D2> &y);
+  char *cur_ = nullptr;
+  char *end_ = nullptr;
+  chunk__ *chunks_ = nullptr;
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator>(const mstl::unique_ptr<T1, D1> &x,
-               const mstl::unique_ptr<T2, D2> &y);
+  void *initial_buffer_ = nullptr;
+  size_t initial_size_ = 0;
+  size_t first_chunk_size_ = default_chunk_size__; // what release() rewinds to.
+  size_t next_chunk_size_ = default_chunk_size__;
 
-template <typename T1, typename D1, typename T2, typename D2>
-bool operator>=(const mstl::unique_ptr<T1, D1> &x,
-                const mstl::unique_ptr<T2, D2> &y);
+  static char *align_up__(char *p, size_t align) noexcept {
+    auto v = reinterpret_cast<size_t>(p);
+    return reinterpret_cast<char *>((v + align - 1) & ~(align - 1));
+  }
+
+  void grow__(size_t bytes, size_t align) {
+    size_t need = sizeof(chunk__) + bytes + align;
+    size_t size = next_chunk_size_;
+    while (size < need) {
+      size *= 2;
+    }
+
+    auto *c = static_cast<chunk__ *>(::operator new(size));
+    c->next = chunks_;
+    c->size = size;
+    chunks_ = c;
+
+    cur_ = reinterpret_cast<char *>(c + 1);
+    end_ = reinterpret_cast<char *>(c) + size;
+    next_chunk_size_ = size * 2;
+  }
+
+public:
+  monotonic_arena() noexcept = default;
+
+  explicit monotonic_arena(size_t initial_chunk_size) noexcept
+      : first_chunk_size_(initial_chunk_size ? initial_chunk_size
+                                             : default_chunk_size__),
+        next_chunk_size_(first_chunk_size_) {}
+
+  // carve from the caller's buffer first. The arena doesn't own it.
+  monotonic_arena(void *buffer, size_t size) noexcept
+      : cur_(static_cast<char *>(buffer)),
+        end_(static_cast<char *>(buffer) + size), initial_buffer_(buffer),
+        initial_size_(size) {}
+
+  monotonic_arena(const monotonic_arena &) = delete;
+  monotonic_arena &operator=(const monotonic_arena &) = delete;
+
+  ~monotonic_arena() { release(); }
+
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    char *p = align_up__(cur_, align);
+    if (cur_ == nullptr || p + bytes > end_) {
+      grow__(bytes, align);
+      p = align_up__(cur_, align);
+    }
+    cur_ = p + bytes;
+    return p;
+  }
+
+  // nothing. memory only goes away with release().
+  void deallocate(void *, size_t,
+                  size_t = alignof(std::max_align_t)) noexcept {}
+
+  // free all chunks at once, and rewind to the caller's buffer.
+  void release() noexcept {
+    while (chunks_) {
+      chunk__ *next = chunks_->next;
+      ::operator delete(chunks_);
+      chunks_ = next;
+    }
+    cur_ = static_cast<char *>(initial_buffer_);
+    end_ = cur_ + initial_size_;
+    next_chunk_size_ = first_chunk_size_;
+  }
+
+  // bytes left in the current chunk.
+  size_t remaining() const noexcept { return end_ - cur_; }
+};
+
+// The allocator is just a handle to the arena, so copying and rebinding it
+// is cheap, and all copies share the same memory.
+template <typename T> class monotonic_allocator {
+  template <typename U> friend class monotonic_allocator;
+  monotonic_arena *arena_;
+
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = mstl::true_type;
+  using propagate_on_container_move_assignment = mstl::true_type;
+  using propagate_on_container_swap = mstl::true_type;
+  using is_always_equal = mstl::false_type;
+
+  explicit monotonic_allocator(monotonic_arena &arena) noexcept
+      : arena_(mstl::addressof(arena)) {}
+
+  template <typename U>
+  monotonic_allocator(const monotonic_allocator<U> &other) noexcept
+      : arena_(other.arena_) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        arena_->allocate(memory_UTIL::array_bytes__<T>(n), alignof(T)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    arena_->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  monotonic_arena *arena() const noexcept { return arena_; }
+};
+
+template <typename T, typename U>
+bool operator==(const monotonic_allocator<T> &a,
+                const monotonic_allocator<U> &b) noexcept {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const monotonic_allocator<T> &a,
+                const monotonic_allocator<U> &b) noexcept {
+  return !(a == b);
+}
 
 } // namespace mstl
+
+namespace mstl::pool_UTILL {
+
+// Size class pool.
+// Node based containers allocate one node at a time, and all nodes have the
+// same size. Instead of asking the heap every time we keep free lists of
+// fixed size blocks, one free list per size class.
+//
+// Layout of the pool for one size class:
+//
+//   thread 1 cache:  [b] -> [b] -> [b]        (no synchronization)
+//   thread 2 cache:  [b] -> [b]
+//                      |  overflow / refill
+//                      v
+//   global depot:    [b] -> [b] -> [b] -> ... (lock free stack)
+//                      ^
+//   slabs:           carved into blocks when the depot is empty.
+//
+// Allocation and deallocation hit the thread local cache almost all the
+// time. A thread only touches the depot when its cache runs dry, or when it
+// has freed too many blocks (e.g the producer allocates nodes and the
+// consumer frees them). That's how cross thread frees flow back.
+//
+// The depot only supports "push a chain" and "take everything". Popping a
+// single node from a lock free stack suffers from ABA, taking the whole
+// stack with one exchange doesn't.
+//
+// note: slabs are never returned to the system. The memory stays in the pool
+// for the lifetime of the program.
+
+struct free_block__ {
+  free_block__ *next;
+};
+
+constexpr size_t pool_granularity__ = 16;
+constexpr size_t pool_max_block_size__ = 512;
+constexpr size_t pool_slab_size__ = 64 * 1024;
+constexpr size_t pool_cache_high_water__ = 256;
+
+constexpr size_t pool_size_class__(size_t bytes) noexcept {
+  return (bytes + pool_granularity__ - 1) & ~(pool_granularity__ - 1);
+}
+
+// all slabs of all size classes are chained here, so they stay reachable.
+struct slab_registry__ {
+  std::atomic<free_block__ *> head{nullptr};
+
+  static slab_registry__ &instance() noexcept {
+    static slab_registry__ r;
+    return r;
+  }
+
+  void add(void *slab) noexcept {
+    auto *s = static_cast<free_block__ *>(slab);
+    s->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(s->next, s, std::memory_order_release,
+                                       std::memory_order_relaxed))
+      ;
+  }
+};
+
+template <size_t BlockSize> class depot__ {
+  std::atomic<free_block__ *> head_{nullptr};
+
+public:
+  static depot__ &instance() noexcept {
+    static depot__ d;
+    return d;
+  }
+
+  void push_chain(free_block__ *first, free_block__ *last) noexcept {
+    last->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(last->next, first,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+      ;
+  }
+
+  free_block__ *take_all() noexcept {
+    if (head_.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+    return head_.exchange(nullptr, std::memory_order_acquire);
+  }
+};
+
+// the cache itself is trivially destructible so it's still safe to touch
+// after the thread starts tearing down (some other thread_local object might
+// use pool memory in its destructor). The guard below flushes it and marks
+// it dead, from then on blocks go straight to and from the depot.
+template <size_t BlockSize> struct thread_cache__ {
+  free_block__ *head;
+  size_t count;
+  bool dead;
+
+  static thread_cache__ &local() noexcept {
+    static thread_local thread_cache__ cache{nullptr, 0, false};
+    return cache;
+  }
+
+  void *allocate() {
+    if (dead) {
+      return allocate_shared__();
+    }
+    if (head == nullptr) {
+      refill__();
+    }
+    free_block__ *b = head;
+    head = b->next;
+    --count;
+    return b;
+  }
+
+  void deallocate(void *p) noexcept {
+    auto *b = static_cast<free_block__ *>(p);
+    if (dead) {
+      depot__<BlockSize>::instance().push_chain(b, b);
+      return;
+    }
+    if (head == nullptr) {
+      ensure_guard__();
+    }
+    b->next = head;
+    head = b;
+    if (++count > pool_cache_high_water__) {
+      flush__(count / 2);
+    }
+  }
+
+  // give n blocks back to the depot in one CAS.
+  void flush__(size_t n) noexcept {
+    if (n == 0 || head == nullptr) {
+      return;
+    }
+    free_block__ *first = head;
+    free_block__ *last = head;
+    for (size_t i = 1; i < n && last->next; ++i) {
+      last = last->next;
+    }
+    head = last->next;
+    count -= n;
+    depot__<BlockSize>::instance().push_chain(first, last);
+  }
+
+  void refill__() {
+    ensure_guard__();
+    if (free_block__ *chain = depot__<BlockSize>::instance().take_all()) {
+      head = chain;
+      for (count = 0; chain; chain = chain->next) {
+        ++count;
+      }
+      return;
+    }
+    head = new_slab__(count);
+  }
+
+  // a new slab cut into a chain of n blocks. The first block of each slab
+  // is used to link the slab into the registry.
+  static free_block__ *new_slab__(size_t &n) {
+    char *slab = static_cast<char *>(::operator new(pool_slab_size__));
+    slab_registry__::instance().add(slab);
+
+    char *first = slab + pool_size_class__(sizeof(free_block__));
+    n = (pool_slab_size__ - (first - slab)) / BlockSize;
+    free_block__ *chain = nullptr;
+    for (size_t i = n; i > 0; --i) {
+      auto *b = reinterpret_cast<free_block__ *>(first + (i - 1) * BlockSize);
+      b->next = chain;
+      chain = b;
+    }
+    return chain;
+  }
+
+  // The guard is gone, the thread is tearing down (a thread_local destructor
+  // allocating). Nothing would flush the cache any more, so take one block
+  // from the depot, or a new slab, and give the rest straight back. Slow,
+  // but it only happens at thread exit.
+  static void *allocate_shared__() {
+    depot__<BlockSize> &depot = depot__<BlockSize>::instance();
+    free_block__ *chain = depot.take_all();
+    if (chain == nullptr) {
+      size_t n;
+      chain = new_slab__(n);
+    }
+    if (free_block__ *rest = chain->next) {
+      free_block__ *last = rest;
+      while (last->next) {
+        last = last->next;
+      }
+      depot.push_chain(rest, last);
+    }
+    return chain;
+  }
+
+  struct guard__ {
+    ~guard__() {
+      thread_cache__ &c = local();
+      c.flush__(c.count);
+      c.dead = true;
+    }
+  };
+
+  static void ensure_guard__() noexcept { static thread_local guard__ g; }
+};
+
+} // namespace mstl::pool_UTILL
+
+namespace mstl {
+
+// Pool allocator for node based containers.
+// Single object allocations are served from the size class pool of
+// sizeof(T), everything else (arrays, big or over aligned types) goes
+// straight to the global operator new.
+// It's stateless, so any pool_allocator can free memory from any other one,
+// and from any thread.
+template <typename T> class pool_allocator {
+  static constexpr size_t block_size__ =
+      pool_UTILL::pool_size_class__(sizeof(T));
+  static constexpr bool pooled__ =
+      block_size__ <= pool_UTILL::pool_max_block_size__ &&
+      alignof(T) <= pool_UTILL::pool_granularity__;
+
+public:
+  using value_type = T;
+  using is_always_equal = mstl::true_type;
+  using propagate_on_container_move_assignment = mstl::true_type;
+
+  constexpr pool_allocator() noexcept = default;
+  template <typename U>
+  constexpr pool_allocator(const pool_allocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    if constexpr (pooled__) {
+      if (n == 1) {
+        return static_cast<T *>(
+            pool_UTILL::thread_cache__<block_size__>::local().allocate());
+      }
+    }
+    return static_cast<T *>(
+        ::operator new(memory_UTIL::array_bytes__<T>(n)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    if constexpr (pooled__) {
+      if (n == 1) {
+        pool_UTILL::thread_cache__<block_size__>::local().deallocate(p);
+        return;
+      }
+    }
+    ::operator delete(p);
+  }
+};
+
+template <typename T, typename U>
+constexpr bool operator==(const pool_allocator<T> &,
+                          const pool_allocator<U> &) noexcept {
+  return true;
+}
+
+template <typename T, typename U>
+constexpr bool operator!=(const pool_allocator<T> &,
+                          const pool_allocator<U> &) noexcept {
+  return false;
+}
+
+} // namespace mstl
+
+namespace mstl::memory_UTIL {
+
+// Compressed pair.
+// A stateless deleter still takes at least one byte as a member, and with
+// padding that byte becomes a whole pointer. But if we inherit from the
+// deleter instead, the empty base optimization (EBO) kicks in and the base
+// takes no space at all. So unique_ptr<T> can be as small as T*.
+//
+// Idx is there so compressed_pair__<A, A> doesn't inherit the same base
+// twice. Final classes can't be inherited, they are stored as a member.
+template <typename T, int Idx,
+          bool = mstl::is_empty<T>::value && !mstl::is_final<T>::value>
+struct compressed_elem__ {
+  T value__;
+
+  constexpr compressed_elem__() : value__() {}
+  template <typename U>
+  constexpr explicit compressed_elem__(U &&u) : value__(mstl::forward<U>(u)) {}
+
+  constexpr T &get() noexcept { return value__; }
+  constexpr const T &get() const noexcept { return value__; }
+};
+
+template <typename T, int Idx>
+struct compressed_elem__<T, Idx, true> : private T {
+  constexpr compressed_elem__() : T() {}
+  template <typename U>
+  constexpr explicit compressed_elem__(U &&u) : T(mstl::forward<U>(u)) {}
+
+  constexpr T &get() noexcept { return *this; }
+  constexpr const T &get() const noexcept { return *this; }
+};
+
+template <typename T1, typename T2>
+class compressed_pair__ : private compressed_elem__<T1, 0>,
+                          private compressed_elem__<T2, 1> {
+  using first__ = compressed_elem__<T1, 0>;
+  using second__ = compressed_elem__<T2, 1>;
+
+public:
+  constexpr compressed_pair__() : first__(), second__() {}
+
+  template <typename U1, typename U2>
+  constexpr compressed_pair__(U1 &&a, U2 &&b)
+      : first__(mstl::forward<U1>(a)), second__(mstl::forward<U2>(b)) {}
+
+  // second default constructed. Not a copy or move, those are implicit.
+  template <typename U1,
+            typename = mstl::enable_if_t<!mstl::is_same<
+                typename mstl::decay<U1>::type, compressed_pair__>::value>>
+  constexpr explicit compressed_pair__(U1 &&a)
+      : first__(mstl::forward<U1>(a)), second__() {}
+
+  constexpr T1 &first() noexcept { return first__::get(); }
+  constexpr const T1 &first() const noexcept { return first__::get(); }
+  constexpr T2 &second() noexcept { return second__::get(); }
+  constexpr const T2 &second() const noexcept { return second__::get(); }
+};
+
+// unique_ptr<T, D>::pointer is D::pointer if D has one, otherwise T*.
+// This lets a deleter own handles that are not raw pointers, e.g
+// offset_ptr or a file descriptor wrapper.
+template <typename T, typename D, typename = void> struct unique_pointer__ {
+  using type = T *;
+};
+template <typename T, typename D>
+struct unique_pointer__<
+    T, D,
+    mstl::void_t<typename mstl::remove_reference<D>::type::pointer>> {
+  using type = typename mstl::remove_reference<D>::type::pointer;
+};
+
+} // namespace mstl::memory_UTIL
+
+namespace mstl {
+
+// only for unique pointer
+template <typename T> struct default_delete {
+  constexpr default_delete() noexcept = default;
+
+  template <typename U, typename = mstl::enable_if_t<
+                            mstl::is_convertible<U *, T *>::value>>
+  default_delete(const default_delete<U> &) noexcept {}
+
+  void operator()(T *p) const noexcept {
+    static_assert(sizeof(T) > 0, "can't delete an incomplete type");
+    delete p;
+  }
+};
+
+template <typename T> struct default_delete<T[]> {
+  constexpr default_delete() noexcept = default;
+
+  void operator()(T *p) const noexcept {
+    static_assert(sizeof(T) > 0, "can't delete an incomplete type");
+    delete[] p;
+  }
+
+  // deleting a Derived[] through Base* is ub, reject it.
+  template <typename U> void operator()(U *) const = delete;
+};
+
+template <typename T, typename D = default_delete<T>> class unique_ptr {
+public:
+  using element_type = T;
+  using deleter_type = D;
+  using pointer = typename memory_UTIL::unique_pointer__<T, D>::type;
+
+private:
+  memory_UTIL::compressed_pair__<pointer, D> ptr_;
+
+  template <typename U, typename E>
+  using convertible__ = mstl::enable_if_t<
+      mstl::is_convertible<typename unique_ptr<U, E>::pointer,
+                           pointer>::value &&
+      !mstl::is_array<U>::value>;
+
+public:
+  constexpr unique_ptr() noexcept : ptr_(pointer(), D()) {}
+  constexpr unique_ptr(std::nullptr_t) noexcept : unique_ptr() {}
+  explicit unique_ptr(pointer p) noexcept : ptr_(p, D()) {}
+
+  // a reference deleter is bound, a value deleter is copied or moved.
+  unique_ptr(pointer p,
+             typename mstl::conditional<mstl::is_reference<D>::value, D,
+                                        const D &>::type d) noexcept
+      : ptr_(p, d) {}
+  template <typename E = D,
+            typename = mstl::enable_if_t<!mstl::is_reference<E>::value>>
+  unique_ptr(pointer p, D &&d) noexcept : ptr_(p, mstl::move(d)) {}
+
+  unique_ptr(unique_ptr &&u) noexcept
+      : ptr_(u.release(), mstl::forward<D>(u.get_deleter())) {}
+
+  template <typename U, typename E, typename = convertible__<U, E>>
+  unique_ptr(unique_ptr<U, E> &&u) noexcept
+      : ptr_(u.release(), mstl::forward<E>(u.get_deleter())) {}
+
+  unique_ptr(const unique_ptr &) = delete;
+  unique_ptr &operator=(const unique_ptr &) = delete;
+
+  ~unique_ptr() { reset(); }
+
+  unique_ptr &operator=(unique_ptr &&u) noexcept {
+    reset(u.release());
+    get_deleter() = mstl::forward<D>(u.get_deleter());
+    return *this;
+  }
+
+  template <typename U, typename E, typename = convertible__<U, E>>
+  unique_ptr &operator=(unique_ptr<U, E> &&u) noexcept {
+    reset(u.release());
+    get_deleter() = mstl::forward<E>(u.get_deleter());
+    return *this;
+  }
+
+  unique_ptr &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  typename mstl::add_lvalue_reference<T>::type operator*() const {
+    return *ptr_.first();
+  }
+  pointer operator->() const noexcept { return ptr_.first(); }
+  pointer get() const noexcept { return ptr_.first(); }
+  deleter_type &get_deleter() noexcept { return ptr_.second(); }
+  const deleter_type &get_deleter() const noexcept { return ptr_.second(); }
+  explicit operator bool() const noexcept { return ptr_.first() != nullptr; }
+
+  // modifier
+
+  pointer release() noexcept {
+    pointer p = ptr_.first();
+    ptr_.first() = pointer();
+    return p;
+  }
+
+  // set the new pointer before deleting the old one, in case the deleter
+  // somehow reaches back to this unique_ptr.
+  void reset(pointer p = pointer()) noexcept {
+    pointer old = ptr_.first();
+    ptr_.first() = p;
+    if (old) {
+      get_deleter()(old);
+    }
+  }
+
+  void swap(unique_ptr &u) noexcept {
+    pointer p = ptr_.first();
+    ptr_.first() = u.ptr_.first();
+    u.ptr_.first() = p;
+
+    D d = mstl::move(get_deleter());
+    get_deleter() = mstl::move(u.get_deleter());
+    u.get_deleter() = mstl::move(d);
+  }
+};
+
+// array version. No operator* and operator->, but operator[].
+template <typename T, typename D> class unique_ptr<T[], D> {
+public:
+  using element_type = T;
+  using deleter_type = D;
+  using pointer = typename memory_UTIL::unique_pointer__<T, D>::type;
+
+private:
+  memory_UTIL::compressed_pair__<pointer, D> ptr_;
+
+public:
+  constexpr unique_ptr() noexcept : ptr_(pointer(), D()) {}
+  constexpr unique_ptr(std::nullptr_t) noexcept : unique_ptr() {}
+  explicit unique_ptr(pointer p) noexcept : ptr_(p, D()) {}
+
+  unique_ptr(pointer p,
+             typename mstl::conditional<mstl::is_reference<D>::value, D,
+                                        const D &>::type d) noexcept
+      : ptr_(p, d) {}
+  template <typename E = D,
+            typename = mstl::enable_if_t<!mstl::is_reference<E>::value>>
+  unique_ptr(pointer p, D &&d) noexcept : ptr_(p, mstl::move(d)) {}
+
+  unique_ptr(unique_ptr &&u) noexcept
+      : ptr_(u.release(), mstl::forward<D>(u.get_deleter())) {}
+
+  unique_ptr(const unique_ptr &) = delete;
+  unique_ptr &operator=(const unique_ptr &) = delete;
+
+  ~unique_ptr() { reset(); }
+
+  unique_ptr &operator=(unique_ptr &&u) noexcept {
+    reset(u.release());
+    get_deleter() = mstl::forward<D>(u.get_deleter());
+    return *this;
+  }
+
+  unique_ptr &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  T &operator[](size_t i) const { return ptr_.first()[i]; }
+  pointer get() const noexcept { return ptr_.first(); }
+  deleter_type &get_deleter() noexcept { return ptr_.second(); }
+  const deleter_type &get_deleter() const noexcept { return ptr_.second(); }
+  explicit operator bool() const noexcept { return ptr_.first() != nullptr; }
+
+  pointer release() noexcept {
+    pointer p = ptr_.first();
+    ptr_.first() = pointer();
+    return p;
+  }
+
+  void reset(pointer p = pointer()) noexcept {
+    pointer old = ptr_.first();
+    ptr_.first() = p;
+    if (old) {
+      get_deleter()(old);
+    }
+  }
+
+  void reset(std::nullptr_t) noexcept { reset(pointer()); }
+
+  void swap(unique_ptr &u) noexcept {
+    pointer p = ptr_.first();
+    ptr_.first() = u.ptr_.first();
+    u.ptr_.first() = p;
+
+    D d = mstl::move(get_deleter());
+    get_deleter() = mstl::move(u.get_deleter());
+    u.get_deleter() = mstl::move(d);
+  }
+};
+
+template <typename T, typename D>
+void swap(mstl::unique_ptr<T, D> &x, mstl::unique_ptr<T, D> &y) noexcept {
+  x.swap(y);
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator==(const mstl::unique_ptr<T1, D1> &x,
+                const mstl::unique_ptr<T2, D2> &y) {
+  return x.get() == y.get();
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator!=(const mstl::unique_ptr<T1, D1> &x,
+                const mstl::unique_ptr<T2, D2> &y) {
+  return !(x == y);
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator<(const mstl::unique_ptr<T1, D1> &x,
+               const mstl::unique_ptr<T2, D2> &y) {
+  return x.get() < y.get();
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator<=(const mstl::unique_ptr<T1, D1> &x,
+                const mstl::unique_ptr<T2, D2> &y) {
+  return !(y < x);
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator>(const mstl::unique_ptr<T1, D1> &x,
+               const mstl::unique_ptr<T2, D2> &y) {
+  return y < x;
+}
+
+template <typename T1, typename D1, typename T2, typename D2>
+bool operator>=(const mstl::unique_ptr<T1, D1> &x,
+                const mstl::unique_ptr<T2, D2> &y) {
+  return !(x < y);
+}
+
+template <typename T, typename D>
+bool operator==(const mstl::unique_ptr<T, D> &x, std::nullptr_t) noexcept {
+  return !x;
+}
+
+template <typename T, typename D>
+bool operator==(std::nullptr_t, const mstl::unique_ptr<T, D> &x) noexcept {
+  return !x;
+}
+
+template <typename T, typename D>
+bool operator!=(const mstl::unique_ptr<T, D> &x, std::nullptr_t) noexcept {
+  return static_cast<bool>(x);
+}
+
+template <typename T, typename D>
+bool operator!=(std::nullptr_t, const mstl::unique_ptr<T, D> &x) noexcept {
+  return static_cast<bool>(x);
+}
+
+template <typename T, typename... Args,
+          typename = mstl::enable_if_t<!mstl::is_array<T>::value>>
+unique_ptr<T> make_unique(Args &&...args) {
+  return unique_ptr<T>(new T(mstl::forward<Args>(args)...));
+}
+
+// make_unique<int[]>(n), elements are value initialized.
+template <typename T, typename = mstl::enable_if_t<mstl::is_array<T>::value>>
+unique_ptr<T> make_unique(size_t n) {
+  return unique_ptr<T>(new typename mstl::remove_extent<T>::type[n]());
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+// Deleter for objects created by allocate_unique. It keeps a copy of the
+// allocator, so the object is destroyed and freed through the same
+// allocator it came from.
+// For stateless allocators (mstl::allocator, pool_allocator) the deleter is
+// empty, and the unique_ptr stays pointer sized. A stateful allocator like
+// monotonic_allocator costs one extra word for its arena pointer.
+template <typename Alloc>
+class allocator_delete : private memory_UTIL::compressed_elem__<Alloc, 0> {
+  using traits__ = mstl::allocator_traits<Alloc>;
+  using alloc__ = memory_UTIL::compressed_elem__<Alloc, 0>;
+
+public:
+  using allocator_type = Alloc;
+  using pointer = typename traits__::pointer;
+
+  allocator_delete() = default;
+  explicit allocator_delete(const Alloc &a) : alloc__(a) {}
+
+  void operator()(pointer p) {
+    traits__::destroy(alloc__::get(), mstl::to_address(p));
+    traits__::deallocate(alloc__::get(), p, 1);
+  }
+
+  Alloc &get_allocator() noexcept { return alloc__::get(); }
+  const Alloc &get_allocator() const noexcept { return alloc__::get(); }
+};
+
+// like make_unique, but the object lives in memory from `alloc`, e.g an
+// arena or a pool.
+template <typename T, typename Alloc, typename... Args>
+unique_ptr<T, allocator_delete<typename mstl::allocator_traits<
+                  Alloc>::template rebind_alloc<T>>>
+allocate_unique(const Alloc &alloc, Args &&...args) {
+  using A = typename mstl::allocator_traits<Alloc>::template rebind_alloc<T>;
+  using traits = mstl::allocator_traits<A>;
+
+  A a(alloc);
+  auto p = traits::allocate(a, 1);
+  try {
+    traits::construct(a, mstl::to_address(p), mstl::forward<Args>(args)...);
+  } catch (...) {
+    traits::deallocate(a, p, 1);
+    throw;
+  }
+  return unique_ptr<T, allocator_delete<A>>(p, allocator_delete<A>(a));
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+class bad_weak_ptr : public mstl::exception {
+public:
+  bad_weak_ptr() noexcept {}
+  virtual ~bad_weak_ptr() noexcept {}
+  virtual const char *what() const noexcept { return "mstl::bad_weak_ptr"; }
+};
+
+} // namespace mstl
+
+namespace mstl {
+template <typename T> class shared_ptr;
+template <typename T> class weak_ptr;
+} // namespace mstl
+
+namespace mstl::shared_ptr_UTILL {
+
+// Control block.
+// Every group of shared_ptrs pointing to the same object shares one control
+// block. It holds two counts:
+//   use_:  number of shared_ptr. When it hits 0 the object is destroyed.
+//   weak_: number of weak_ptr, plus one as long as use_ > 0. When it hits 0
+//          the control block itself is freed.
+//
+// The counts are std::atomic, but a block can be made unsynchronized. In
+// that mode we do a plain load and store instead of a read-modify-write, so
+// no lock prefixed instruction is emitted and the cache line is never
+// fought over. It's only correct if the object never leaves its thread.
+class control_block__ {
+  std::atomic<long> use_{1};
+  std::atomic<long> weak_{1};
+  bool unsynchronized_ = false;
+
+  static void inc__(std::atomic<long> &c, bool unsync) noexcept {
+    if (unsync) {
+      c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+      c.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // return the value after decrement.
+  static long dec__(std::atomic<long> &c, bool unsync) noexcept {
+    if (unsync) {
+      long v = c.load(std::memory_order_relaxed) - 1;
+      c.store(v, std::memory_order_relaxed);
+      return v;
+    }
+    return c.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+
+public:
+  virtual ~control_block__() = default;
+
+  // destroy the managed object.
+  virtual void dispose() noexcept = 0;
+  // free the control block.
+  virtual void destroy() noexcept = 0;
+
+  void set_unsynchronized() noexcept { unsynchronized_ = true; }
+
+  void add_ref() noexcept { inc__(use_, unsynchronized_); }
+
+  void release() noexcept {
+    if (dec__(use_, unsynchronized_) == 0) {
+      dispose();
+      weak_release();
+    }
+  }
+
+  void weak_add_ref() noexcept { inc__(weak_, unsynchronized_); }
+
+  void weak_release() noexcept {
+    if (dec__(weak_, unsynchronized_) == 0) {
+      destroy();
+    }
+  }
+
+  // for weak_ptr::lock(). Only succeed if the object is still alive, so we
+  // can't blindly increment.
+  bool add_ref_if_alive() noexcept {
+    long n = use_.load(std::memory_order_relaxed);
+    if (unsynchronized_) {
+      if (n == 0) {
+        return false;
+      }
+      use_.store(n + 1, std::memory_order_relaxed);
+      return true;
+    }
+    while (n != 0) {
+      if (use_.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel,
+                                     std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  long use_count() const noexcept {
+    return use_.load(std::memory_order_relaxed);
+  }
+};
+
+// shared_ptr<T>(new T, d): the object and the block are two allocations.
+template <typename Ptr, typename D>
+class control_block_ptr__ : public control_block__ {
+  memory_UTIL::compressed_pair__<Ptr, D> ptr_;
+
+public:
+  control_block_ptr__(Ptr p, D d) : ptr_(p, mstl::move(d)) {}
+
+  void dispose() noexcept override { ptr_.second()(ptr_.first()); }
+  void destroy() noexcept override { delete this; }
+};
+
+// make_shared / allocate_shared: the object lives inside the block, so
+// there is only one allocation, and the counts sit right next to the object.
+//
+//   [ vptr | use | weak | alloc | T ... ]
+template <typename T, typename Alloc>
+class control_block_inplace__ : public control_block__ {
+  using block_alloc__ = typename mstl::allocator_traits<
+      Alloc>::template rebind_alloc<control_block_inplace__>;
+  using traits__ = mstl::allocator_traits<block_alloc__>;
+
+  // room for T, left alone until the constructor puts T there.
+  struct storage__ {
+    storage__() noexcept {}
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+
+  // the allocator is almost always empty, and then takes no space.
+  memory_UTIL::compressed_pair__<block_alloc__, storage__> data_;
+
+public:
+  template <typename... Args>
+  explicit control_block_inplace__(const Alloc &a, Args &&...args)
+      : data_(block_alloc__(a)) {
+    ::new (static_cast<void *>(data_.second().bytes))
+        T(mstl::forward<Args>(args)...);
+  }
+
+  T *get() noexcept { return reinterpret_cast<T *>(data_.second().bytes); }
+
+  void dispose() noexcept override { get()->~T(); }
+
+  void destroy() noexcept override {
+    block_alloc__ a(data_.first());
+    this->~control_block_inplace__();
+    traits__::deallocate(a, this, 1);
+  }
+
+  template <typename... Args>
+  static control_block_inplace__ *create(const Alloc &alloc, Args &&...args) {
+    block_alloc__ a(alloc);
+    control_block_inplace__ *cb = traits__::allocate(a, 1);
+    try {
+      ::new (static_cast<void *>(cb))
+          control_block_inplace__(alloc, mstl::forward<Args>(args)...);
+    } catch (...) {
+      traits__::deallocate(a, cb, 1);
+      throw;
+    }
+    return cb;
+  }
+};
+
+// the only way to build a shared_ptr from a raw control block.
+struct access__ {
+  template <typename T, typename CB>
+  static mstl::shared_ptr<T> make(T *p, CB *cb) noexcept {
+    return mstl::shared_ptr<T>(
+        p, cb, typename mstl::shared_ptr<T>::from_block__());
+  }
+};
+
+} // namespace mstl::shared_ptr_UTILL
+
+namespace mstl {
+
+// shared ownership. The pointer and the control block are kept separately,
+// so a shared_ptr can point to a sub object of what the block owns (the
+// aliasing constructor).
+template <typename T> class shared_ptr {
+  template <typename U> friend class shared_ptr;
+  template <typename U> friend class weak_ptr;
+  friend struct shared_ptr_UTILL::access__;
+
+  using control_block__ = shared_ptr_UTILL::control_block__;
+
+  T *ptr_ = nullptr;
+  control_block__ *cb_ = nullptr;
+
+  template <typename U>
+  using convertible__ =
+      mstl::enable_if_t<mstl::is_convertible<U *, T *>::value>;
+
+  struct from_block__ {};
+  shared_ptr(T *p, control_block__ *cb, from_block__) noexcept
+      : ptr_(p), cb_(cb) {}
+
+public:
+  using element_type = T;
+  using weak_type = weak_ptr<T>;
+
+  constexpr shared_ptr() noexcept = default;
+  constexpr shared_ptr(std::nullptr_t) noexcept {}
+
+  template <typename U, typename = convertible__<U>>
+  explicit shared_ptr(U *p) : shared_ptr(p, mstl::default_delete<U>()) {}
+
+  // if we can't allocate the control block, the object is deleted before
+  // rethrowing, otherwise it leaks.
+  template <typename U, typename D, typename = convertible__<U>>
+  shared_ptr(U *p, D d) : ptr_(p) {
+    try {
+      cb_ = new shared_ptr_UTILL::control_block_ptr__<U *, D>(p, d);
+    } catch (...) {
+      d(p);
+      throw;
+    }
+  }
+
+  // aliasing constructor. Shares ownership with r, but points to p.
+  template <typename U>
+  shared_ptr(const shared_ptr<U> &r, T *p) noexcept : ptr_(p), cb_(r.cb_) {
+    if (cb_) {
+      cb_->add_ref();
+    }
+  }
+
+  shared_ptr(const shared_ptr &r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_) {
+      cb_->add_ref();
+    }
+  }
+
+  template <typename U, typename = convertible__<U>>
+  shared_ptr(const shared_ptr<U> &r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_) {
+      cb_->add_ref();
+    }
+  }
+
+  // moving doesn't touch the counts at all.
+  shared_ptr(shared_ptr &&r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    r.ptr_ = nullptr;
+    r.cb_ = nullptr;
+  }
+
+  template <typename U, typename = convertible__<U>>
+  shared_ptr(shared_ptr<U> &&r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    r.ptr_ = nullptr;
+    r.cb_ = nullptr;
+  }
+
+  template <typename U, typename = convertible__<U>>
+  explicit shared_ptr(const weak_ptr<U> &r) : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_ == nullptr || !cb_->add_ref_if_alive()) {
+      throw mstl::bad_weak_ptr();
+    }
+  }
+
+  template <typename U, typename D, typename = convertible__<U>>
+  shared_ptr(mstl::unique_ptr<U, D> &&r) : shared_ptr() {
+    if (r) {
+      D &d = r.get_deleter();
+      shared_ptr(r.get(), mstl::move(d)).swap(*this);
+      r.release();
+    }
+  }
+
+  ~shared_ptr() {
+    if (cb_) {
+      cb_->release();
+    }
+  }
+
+  // copy and swap, so self assignment is fine.
+  shared_ptr &operator=(const shared_ptr &r) noexcept {
+    shared_ptr(r).swap(*this);
+    return *this;
+  }
+
+  template <typename U> shared_ptr &operator=(const shared_ptr<U> &r) noexcept {
+    shared_ptr(r).swap(*this);
+    return *this;
+  }
+
+  shared_ptr &operator=(shared_ptr &&r) noexcept {
+    shared_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  template <typename U> shared_ptr &operator=(shared_ptr<U> &&r) noexcept {
+    shared_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  template <typename U, typename D>
+  shared_ptr &operator=(mstl::unique_ptr<U, D> &&r) {
+    shared_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { shared_ptr().swap(*this); }
+  template <typename U> void reset(U *p) { shared_ptr(p).swap(*this); }
+  template <typename U, typename D> void reset(U *p, D d) {
+    shared_ptr(p, d).swap(*this);
+  }
+
+  void swap(shared_ptr &r) noexcept {
+    T *p = ptr_;
+    ptr_ = r.ptr_;
+    r.ptr_ = p;
+    control_block__ *cb = cb_;
+    cb_ = r.cb_;
+    r.cb_ = cb;
+  }
+
+  T *get() const noexcept { return ptr_; }
+  typename mstl::add_lvalue_reference<T>::type operator*() const noexcept {
+    return *ptr_;
+  }
+  T *operator->() const noexcept { return ptr_; }
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+  long use_count() const noexcept { return cb_ ? cb_->use_count() : 0; }
+
+  // ordering by control block instead of pointer value. Two aliasing
+  // shared_ptrs are equivalent here.
+  template <typename U>
+  bool owner_before(const shared_ptr<U> &r) const noexcept {
+    return cb_ < r.cb_;
+  }
+  template <typename U>
+  bool owner_before(const weak_ptr<U> &r) const noexcept {
+    return cb_ < r.cb_;
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const shared_ptr<T> &a, const shared_ptr<U> &b) noexcept {
+  return a.get() == b.get();
+}
+
+template <typename T, typename U>
+bool operator!=(const shared_ptr<T> &a, const shared_ptr<U> &b) noexcept {
+  return !(a == b);
+}
+
+template <typename T, typename U>
+bool operator<(const shared_ptr<T> &a, const shared_ptr<U> &b) noexcept {
+  return a.get() < b.get();
+}
+
+template <typename T>
+bool operator==(const shared_ptr<T> &a, std::nullptr_t) noexcept {
+  return !a;
+}
+
+template <typename T>
+bool operator!=(const shared_ptr<T> &a, std::nullptr_t) noexcept {
+  return static_cast<bool>(a);
+}
+
+template <typename T> void swap(shared_ptr<T> &a, shared_ptr<T> &b) noexcept {
+  a.swap(b);
+}
+
+template <typename T, typename U>
+shared_ptr<T> static_pointer_cast(const shared_ptr<U> &r) noexcept {
+  return shared_ptr<T>(r, static_cast<T *>(r.get()));
+}
+
+template <typename T, typename U>
+shared_ptr<T> const_pointer_cast(const shared_ptr<U> &r) noexcept {
+  return shared_ptr<T>(r, const_cast<T *>(r.get()));
+}
+
+template <typename T, typename U>
+shared_ptr<T> dynamic_pointer_cast(const shared_ptr<U> &r) noexcept {
+  if (T *p = dynamic_cast<T *>(r.get())) {
+    return shared_ptr<T>(r, p);
+  }
+  return shared_ptr<T>();
+}
+
+// weak_ptr observes without owning. It keeps the control block alive, but
+// not the object.
+template <typename T> class weak_ptr {
+  template <typename U> friend class shared_ptr;
+  template <typename U> friend class weak_ptr;
+
+  using control_block__ = shared_ptr_UTILL::control_block__;
+
+  T *ptr_ = nullptr;
+  control_block__ *cb_ = nullptr;
+
+public:
+  using element_type = T;
+
+  constexpr weak_ptr() noexcept = default;
+
+  template <typename U>
+  weak_ptr(const shared_ptr<U> &r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_) {
+      cb_->weak_add_ref();
+    }
+  }
+
+  weak_ptr(const weak_ptr &r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_) {
+      cb_->weak_add_ref();
+    }
+  }
+
+  template <typename U>
+  weak_ptr(const weak_ptr<U> &r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    if (cb_) {
+      cb_->weak_add_ref();
+    }
+  }
+
+  weak_ptr(weak_ptr &&r) noexcept : ptr_(r.ptr_), cb_(r.cb_) {
+    r.ptr_ = nullptr;
+    r.cb_ = nullptr;
+  }
+
+  ~weak_ptr() {
+    if (cb_) {
+      cb_->weak_release();
+    }
+  }
+
+  weak_ptr &operator=(const weak_ptr &r) noexcept {
+    weak_ptr(r).swap(*this);
+    return *this;
+  }
+
+  weak_ptr &operator=(weak_ptr &&r) noexcept {
+    weak_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  template <typename U> weak_ptr &operator=(const shared_ptr<U> &r) noexcept {
+    weak_ptr(r).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { weak_ptr().swap(*this); }
+
+  void swap(weak_ptr &r) noexcept {
+    T *p = ptr_;
+    ptr_ = r.ptr_;
+    r.ptr_ = p;
+    control_block__ *cb = cb_;
+    cb_ = r.cb_;
+    r.cb_ = cb;
+  }
+
+  long use_count() const noexcept { return cb_ ? cb_->use_count() : 0; }
+  bool expired() const noexcept { return use_count() == 0; }
+
+  shared_ptr<T> lock() const noexcept {
+    if (cb_ && cb_->add_ref_if_alive()) {
+      return shared_ptr_UTILL::access__::make(ptr_, cb_);
+    }
+    return shared_ptr<T>();
+  }
+
+  template <typename U>
+  bool owner_before(const weak_ptr<U> &r) const noexcept {
+    return cb_ < r.cb_;
+  }
+  template <typename U>
+  bool owner_before(const shared_ptr<U> &r) const noexcept {
+    return cb_ < r.cb_;
+  }
+};
+
+template <typename T, typename Alloc, typename... Args>
+shared_ptr<T> allocate_shared(const Alloc &alloc, Args &&...args) {
+  using block = shared_ptr_UTILL::control_block_inplace__<T, Alloc>;
+  block *cb = block::create(alloc, mstl::forward<Args>(args)...);
+  return shared_ptr_UTILL::access__::make(cb->get(), cb);
+}
+
+// one allocation for both the object and the control block.
+template <typename T, typename... Args>
+shared_ptr<T> make_shared(Args &&...args) {
+  return mstl::allocate_shared<T>(mstl::allocator<T>(),
+                                  mstl::forward<Args>(args)...);
+}
+
+// same as make_shared, but the counts are not atomic. The result and every
+// copy/weak_ptr of it must stay in the creating thread.
+template <typename T, typename... Args>
+shared_ptr<T> make_shared_unsynchronized(Args &&...args) {
+  using block = shared_ptr_UTILL::control_block_inplace__<T, allocator<T>>;
+  block *cb =
+      block::create(mstl::allocator<T>(), mstl::forward<Args>(args)...);
+  cb->set_unsynchronized();
+  return shared_ptr_UTILL::access__::make(cb->get(), cb);
+}
+
+} // namespace mstl
+
+namespace mstl::shared_ptr_UTILL {
+template <typename T> struct local_block__ {
+  long count;
+  mstl::shared_ptr<T> owner;
+};
+} // namespace mstl::shared_ptr_UTILL
+
+namespace mstl {
+
+// Deferred counting for objects shared read mostly across threads.
+// A hot config object copied around by every worker hammers the same
+// atomic count, and the cache line holding it bounces between cores.
+// local_shared_ptr takes one atomic reference per thread, and all copies
+// inside that thread count on a private, non atomic block instead:
+//
+//   thread 1: local, local, local -> [ local count 3 | shared_ptr ] --+
+//   thread 2: local, local        -> [ local count 2 | shared_ptr ] --+-> obj
+//
+// So the shared count only changes when a thread picks the object up or
+// drops it for good. A local_shared_ptr must not cross threads, convert it
+// back to shared_ptr to hand it to someone else.
+//
+// Picking it up is not free: every conversion from shared_ptr, and every
+// make_local_shared, heap allocates a new local block. Convert once per
+// thread and copy the local_shared_ptr from then on; converting on every
+// use is slower than copying the shared_ptr.
+template <typename T> class local_shared_ptr {
+  template <typename U> friend class local_shared_ptr;
+  using block__ = shared_ptr_UTILL::local_block__<T>;
+
+  T *ptr_ = nullptr;
+  block__ *lb_ = nullptr;
+
+public:
+  using element_type = T;
+
+  constexpr local_shared_ptr() noexcept = default;
+  constexpr local_shared_ptr(std::nullptr_t) noexcept {}
+
+  // the one atomic increment, and a new local block.
+  explicit local_shared_ptr(const shared_ptr<T> &p) : ptr_(p.get()) {
+    if (p) {
+      lb_ = new block__{1, p};
+    }
+  }
+
+  explicit local_shared_ptr(shared_ptr<T> &&p) : ptr_(p.get()) {
+    if (p) {
+      lb_ = new block__{1, mstl::move(p)};
+    }
+  }
+
+  local_shared_ptr(const local_shared_ptr &r) noexcept
+      : ptr_(r.ptr_), lb_(r.lb_) {
+    if (lb_) {
+      ++lb_->count;
+    }
+  }
+
+  local_shared_ptr(local_shared_ptr &&r) noexcept : ptr_(r.ptr_), lb_(r.lb_) {
+    r.ptr_ = nullptr;
+    r.lb_ = nullptr;
+  }
+
+  ~local_shared_ptr() {
+    if (lb_ && --lb_->count == 0) {
+      delete lb_;
+    }
+  }
+
+  local_shared_ptr &operator=(const local_shared_ptr &r) noexcept {
+    local_shared_ptr(r).swap(*this);
+    return *this;
+  }
+
+  local_shared_ptr &operator=(local_shared_ptr &&r) noexcept {
+    local_shared_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { local_shared_ptr().swap(*this); }
+
+  void swap(local_shared_ptr &r) noexcept {
+    T *p = ptr_;
+    ptr_ = r.ptr_;
+    r.ptr_ = p;
+    block__ *lb = lb_;
+    lb_ = r.lb_;
+    r.lb_ = lb;
+  }
+
+  // back to a real, thread safe reference.
+  operator shared_ptr<T>() const noexcept {
+    return lb_ ? lb_->owner : shared_ptr<T>();
+  }
+
+  T *get() const noexcept { return ptr_; }
+  typename mstl::add_lvalue_reference<T>::type operator*() const noexcept {
+    return *ptr_;
+  }
+  T *operator->() const noexcept { return ptr_; }
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+  // copies in this thread only.
+  long local_use_count() const noexcept { return lb_ ? lb_->count : 0; }
+};
+
+template <typename T, typename... Args>
+local_shared_ptr<T> make_local_shared(Args &&...args) {
+  return local_shared_ptr<T>(
+      mstl::make_shared<T>(mstl::forward<Args>(args)...));
+}
+
+} // namespace mstl
+
+namespace mstl {
+
+// Intrusive pointer.
+// The count lives inside the object, so there is no control block at all:
+// intrusive_ptr<T> is one pointer, and a raw T* can always be turned back
+// into an owning pointer.
+// The object type provides two free functions, found by adl:
+//   void intrusive_ptr_add_ref(T *);
+//   void intrusive_ptr_release(T *);
+// or just inherits from intrusive_ref_counter below.
+template <typename T> class intrusive_ptr {
+  T *ptr_ = nullptr;
+
+public:
+  using element_type = T;
+
+  constexpr intrusive_ptr() noexcept = default;
+
+  // add_ref = false adopts a reference that was already taken.
+  intrusive_ptr(T *p, bool add_ref = true) : ptr_(p) {
+    if (ptr_ && add_ref) {
+      intrusive_ptr_add_ref(ptr_);
+    }
+  }
+
+  intrusive_ptr(const intrusive_ptr &r) : ptr_(r.ptr_) {
+    if (ptr_) {
+      intrusive_ptr_add_ref(ptr_);
+    }
+  }
+
+  template <typename U, typename = mstl::enable_if_t<
+                            mstl::is_convertible<U *, T *>::value>>
+  intrusive_ptr(const intrusive_ptr<U> &r) : ptr_(r.get()) {
+    if (ptr_) {
+      intrusive_ptr_add_ref(ptr_);
+    }
+  }
+
+  intrusive_ptr(intrusive_ptr &&r) noexcept : ptr_(r.ptr_) { r.ptr_ = nullptr; }
+
+  ~intrusive_ptr() {
+    if (ptr_) {
+      intrusive_ptr_release(ptr_);
+    }
+  }
+
+  intrusive_ptr &operator=(const intrusive_ptr &r) {
+    intrusive_ptr(r).swap(*this);
+    return *this;
+  }
+
+  intrusive_ptr &operator=(intrusive_ptr &&r) noexcept {
+    intrusive_ptr(mstl::move(r)).swap(*this);
+    return *this;
+  }
+
+  intrusive_ptr &operator=(T *p) {
+    intrusive_ptr(p).swap(*this);
+    return *this;
+  }
+
+  void reset() { intrusive_ptr().swap(*this); }
+  void reset(T *p, bool add_ref = true) {
+    intrusive_ptr(p, add_ref).swap(*this);
+  }
+
+  // give up ownership without touching the count.
+  T *detach() noexcept {
+    T *p = ptr_;
+    ptr_ = nullptr;
+    return p;
+  }
+
+  void swap(intrusive_ptr &r) noexcept {
+    T *p = ptr_;
+    ptr_ = r.ptr_;
+    r.ptr_ = p;
+  }
+
+  T *get() const noexcept { return ptr_; }
+  T &operator*() const noexcept { return *ptr_; }
+  T *operator->() const noexcept { return ptr_; }
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+};
+
+template <typename T, typename U>
+bool operator==(const intrusive_ptr<T> &a, const intrusive_ptr<U> &b) noexcept {
+  return a.get() == b.get();
+}
+
+template <typename T, typename U>
+bool operator!=(const intrusive_ptr<T> &a, const intrusive_ptr<U> &b) noexcept {
+  return a.get() != b.get();
+}
+
+// counter policies for intrusive_ref_counter.
+struct thread_safe_counter {
+  using type = std::atomic<long>;
+
+  static long load(const type &c) noexcept {
+    return c.load(std::memory_order_relaxed);
+  }
+  static void increment(type &c) noexcept {
+    c.fetch_add(1, std::memory_order_relaxed);
+  }
+  static long decrement(type &c) noexcept {
+    return c.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+};
+
+// for objects owned by a single thread. No atomic instruction at all.
+struct thread_unsafe_counter {
+  using type = long;
+
+  static long load(const type &c) noexcept { return c; }
+  static void increment(type &c) noexcept { ++c; }
+  static long decrement(type &c) noexcept { return --c; }
+};
+
+// crtp base that gives Derived a reference count and the two adl hooks.
+template <typename Derived, typename Counter = thread_safe_counter>
+class intrusive_ref_counter {
+  mutable typename Counter::type count_{0};
+
+protected:
+  intrusive_ref_counter() noexcept = default;
+  // copying an object doesn't copy who refers to it.
+  intrusive_ref_counter(const intrusive_ref_counter &) noexcept {}
+  intrusive_ref_counter &operator=(const intrusive_ref_counter &) noexcept {
+    return *this;
+  }
+  ~intrusive_ref_counter() = default;
+
+public:
+  long use_count() const noexcept { return Counter::load(count_); }
+
+  friend void intrusive_ptr_add_ref(const intrusive_ref_counter *p) noexcept {
+    Counter::increment(p->count_);
+  }
+
+  friend void intrusive_ptr_release(const intrusive_ref_counter *p) noexcept {
+    if (Counter::decrement(p->count_) == 0) {
+      delete static_cast<const Derived *>(p);
+    }
+  }
+};
+
+} // namespace mstl
+
+namespace mstl {
+
+// smart pointers only hold pointers, moving their bytes is fine.
+template <typename T, typename D>
+struct is_trivially_relocatable<unique_ptr<T, D>>
+    : mstl::is_trivially_relocatable<D> {};
+template <typename T>
+struct is_trivially_relocatable<shared_ptr<T>> : mstl::true_type {};
+template <typename T>
+struct is_trivially_relocatable<weak_ptr<T>> : mstl::true_type {};
+template <typename T>
+struct is_trivially_relocatable<local_shared_ptr<T>> : mstl::true_type {};
+template <typename T>
+struct is_trivially_relocatable<intrusive_ptr<T>> : mstl::true_type {};
+
+} // namespace mstl
+
+#ifdef MSTL_TRACK_ALLOCATIONS
+#include "mtracking_allocator.hpp"
+#endif
@@ -0,0 +1,551 @@
+#pragma once
+#include "mmemory.hpp"
+#include "mnew.hpp"
+#include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace mstl::pmr {
+
+// memory_resource is the OOP flavour of allocator. With normal allocators
+// the allocation strategy is part of the container type, so
+// vector<int, A> and vector<int, B> are two different types, and every
+// template using them gets instantiated twice.
+// With memory_resource the strategy is hidden behind a virtual function, and
+// the container only stores a pointer to the resource. One instantiation,
+// any strategy, picked at runtime.
+//
+// The public functions are non virtual and forward to the private virtual
+// ones (the NVI idiom), so the interface can check things in one place.
+class memory_resource {
+  static constexpr size_t max_align__ = alignof(std::max_align_t);
+
+public:
+  virtual ~memory_resource() = default;
+
+  void *allocate(size_t bytes, size_t align = max_align__) {
+    return do_allocate(bytes, align);
+  }
+
+  void deallocate(void *p, size_t bytes, size_t align = max_align__) {
+    do_deallocate(p, bytes, align);
+  }
+
+  // two resources are equal if memory allocated from one can be freed by
+  // the other.
+  bool is_equal(const memory_resource &other) const noexcept {
+    return do_is_equal(other);
+  }
+
+private:
+  virtual void *do_allocate(size_t bytes, size_t align) = 0;
+  virtual void do_deallocate(void *p, size_t bytes, size_t align) = 0;
+  virtual bool do_is_equal(const memory_resource &other) const noexcept = 0;
+};
+
+inline bool operator==(const memory_resource &a,
+                       const memory_resource &b) noexcept {
+  return &a == &b || a.is_equal(b);
+}
+
+inline bool operator!=(const memory_resource &a,
+                       const memory_resource &b) noexcept {
+  return !(a == b);
+}
+
+} // namespace mstl::pmr
+
+namespace mstl::pmr {
+
+namespace memory_resource_UTILL {
+
+// goes to mstl::operator_new.
+class new_delete_resource__ : public memory_resource {
+  void *do_allocate(size_t bytes, size_t align) override {
+    return mstl::operator_new(bytes, mstl::align_val_t(align));
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    mstl::operator_delete(p, bytes, mstl::align_val_t(align));
+  }
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// always fails. Useful as the upstream of a buffer resource when you want to
+// make sure nothing ever touches the heap.
+class null_memory_resource__ : public memory_resource {
+  void *do_allocate(size_t, size_t) override { throw mstl::bad_alloc(); }
+
+  void do_deallocate(void *, size_t, size_t) override {}
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+} // namespace memory_resource_UTILL
+
+inline memory_resource *new_delete_resource() noexcept {
+  static memory_resource_UTILL::new_delete_resource__ r;
+  return &r;
+}
+
+inline memory_resource *null_memory_resource() noexcept {
+  static memory_resource_UTILL::null_memory_resource__ r;
+  return &r;
+}
+
+namespace memory_resource_UTILL {
+inline std::atomic<memory_resource *> &default_resource__() noexcept {
+  static std::atomic<memory_resource *> r{new_delete_resource()};
+  return r;
+}
+} // namespace memory_resource_UTILL
+
+inline memory_resource *set_default_resource(memory_resource *r) noexcept {
+  if (r == nullptr) {
+    r = new_delete_resource();
+  }
+  return memory_resource_UTILL::default_resource__().exchange(r);
+}
+
+inline memory_resource *get_default_resource() noexcept {
+  return memory_resource_UTILL::default_resource__().load();
+}
+
+} // namespace mstl::pmr
+
+namespace mstl::pmr {
+
+// Bump pointer resource, the pmr sibling of mstl::monotonic_arena. The
+// difference is that chunks come from an upstream resource instead of the
+// global heap, so you can stack them: a stack buffer first, then the heap.
+//
+//   char buf[4096];
+//   monotonic_buffer_resource fast(buf, sizeof(buf));
+//   // allocations use buf until it's full, then go upstream.
+class monotonic_buffer_resource : public memory_resource {
+  struct chunk__ {
+    chunk__ *next;
+    size_t size;
+    size_t align;
+  };
+
+  static constexpr size_t default_chunk_size__ = 1024;
+
+  memory_resource *upstream_;
+  char *cur_ = nullptr;
+  char *end_ = nullptr;
+  chunk__ *chunks_ = nullptr;
+
+  void *initial_buffer_ = nullptr;
+  size_t initial_size_ = 0;
+  size_t first_chunk_size_ = default_chunk_size__; // what release() rewinds to.
+  size_t next_chunk_size_ = default_chunk_size__;
+
+  static char *align_up__(char *p, size_t align) noexcept {
+    auto v = reinterpret_cast<size_t>(p);
+    return reinterpret_cast<char *>((v + align - 1) & ~(align - 1));
+  }
+
+  void grow__(size_t bytes, size_t align) {
+    size_t need = sizeof(chunk__) + bytes + align;
+    size_t size = next_chunk_size_;
+    while (size < need) {
+      size *= 2;
+    }
+    size_t chunk_align = alignof(chunk__) < align ? align : alignof(chunk__);
+
+    auto *c = static_cast<chunk__ *>(upstream_->allocate(size, chunk_align));
+    c->next = chunks_;
+    c->size = size;
+    c->align = chunk_align;
+    chunks_ = c;
+
+    cur_ = reinterpret_cast<char *>(c + 1);
+    end_ = reinterpret_cast<char *>(c) + size;
+    next_chunk_size_ = size * 2;
+  }
+
+public:
+  monotonic_buffer_resource() : upstream_(get_default_resource()) {}
+
+  explicit monotonic_buffer_resource(memory_resource *upstream)
+      : upstream_(upstream) {}
+
+  monotonic_buffer_resource(size_t initial_size, memory_resource *upstream)
+      : upstream_(upstream),
+        first_chunk_size_(initial_size ? initial_size : default_chunk_size__),
+        next_chunk_size_(first_chunk_size_) {}
+
+  monotonic_buffer_resource(void *buffer, size_t size,
+                            memory_resource *upstream = get_default_resource())
+      : upstream_(upstream), cur_(static_cast<char *>(buffer)),
+        end_(static_cast<char *>(buffer) + size), initial_buffer_(buffer),
+        initial_size_(size) {}
+
+  monotonic_buffer_resource(const monotonic_buffer_resource &) = delete;
+  monotonic_buffer_resource &
+  operator=(const monotonic_buffer_resource &) = delete;
+
+  ~monotonic_buffer_resource() override { release(); }
+
+  void release() noexcept {
+    while (chunks_) {
+      chunk__ *next = chunks_->next;
+      upstream_->deallocate(chunks_, chunks_->size, chunks_->align);
+      chunks_ = next;
+    }
+    cur_ = static_cast<char *>(initial_buffer_);
+    end_ = cur_ + initial_size_;
+    next_chunk_size_ = first_chunk_size_;
+  }
+
+  memory_resource *upstream_resource() const noexcept { return upstream_; }
+
+private:
+  void *do_allocate(size_t bytes, size_t align) override {
+    char *p = align_up__(cur_, align);
+    if (cur_ == nullptr || p + bytes > end_) {
+      grow__(bytes, align);
+      p = align_up__(cur_, align);
+    }
+    cur_ = p + bytes;
+    return p;
+  }
+
+  void do_deallocate(void *, size_t, size_t) override {}
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+} // namespace mstl::pmr
+
+namespace mstl::pmr {
+
+struct pool_options {
+  size_t max_blocks_per_chunk = 0;
+  size_t largest_required_pool_block = 0;
+};
+
+// Pool resource.
+// Keeps one pool per power of two block size, from 8 bytes up to
+// largest_required_pool_block. Each pool hands out blocks from chunks it
+// gets from upstream, and keeps freed blocks in a free list. Requests that
+// are bigger than the largest pool go straight to upstream.
+//
+//   pool[0]  8B:   free -> [ ] -> [ ]    chunks: [........]
+//   pool[1] 16B:   free -> [ ]           chunks: [........] -> [....]
+//   ...
+//
+// Chunks grow geometrically up to max_blocks_per_chunk. Everything goes back
+// upstream on release() or destruction.
+class unsynchronized_pool_resource : public memory_resource {
+  struct free_block__ {
+    free_block__ *next;
+  };
+
+  struct chunk__ {
+    chunk__ *next;
+    size_t size;
+  };
+
+  struct pool__ {
+    free_block__ *free = nullptr;
+    chunk__ *chunks = nullptr;
+    size_t next_blocks = first_blocks__;
+  };
+
+  // oversized allocations are tracked so release() can free them.
+  struct oversized__ {
+    oversized__ *prev;
+    oversized__ *next;
+    size_t size;
+    size_t align;
+  };
+
+  static constexpr size_t min_block__ = 8;
+  static constexpr size_t pool_count__ = 10; // 8B .. 4KiB
+  static constexpr size_t default_max_blocks__ = 1024;
+  static constexpr size_t first_blocks__ = 16;
+
+  memory_resource *upstream_;
+  pool_options opts_;
+  size_t pools_ = 0;
+  pool__ pool_[pool_count__];
+  oversized__ *oversized_ = nullptr;
+
+  static size_t pool_index__(size_t bytes) noexcept {
+    size_t idx = 0;
+    for (size_t b = min_block__; b < bytes; b *= 2) {
+      ++idx;
+    }
+    return idx;
+  }
+
+  static constexpr size_t block_size__(size_t idx) noexcept {
+    return min_block__ << idx;
+  }
+
+  void refill__(size_t idx) {
+    pool__ &pool = pool_[idx];
+    size_t block = block_size__(idx);
+    size_t header = (sizeof(chunk__) + block - 1) / block * block;
+    size_t n = pool.next_blocks;
+    size_t size = header + n * block;
+
+    auto *c = static_cast<chunk__ *>(upstream_->allocate(size, block));
+    c->next = pool.chunks;
+    c->size = size;
+    pool.chunks = c;
+
+    char *first = reinterpret_cast<char *>(c) + header;
+    for (size_t i = n; i > 0; --i) {
+      auto *b = reinterpret_cast<free_block__ *>(first + (i - 1) * block);
+      b->next = pool.free;
+      pool.free = b;
+    }
+
+    if (pool.next_blocks * 2 <= opts_.max_blocks_per_chunk) {
+      pool.next_blocks *= 2;
+    }
+  }
+
+  // the first chunk of a pool stays within max_blocks_per_chunk too.
+  void reset_pools__() noexcept {
+    size_t first = first_blocks__ < opts_.max_blocks_per_chunk
+                       ? first_blocks__
+                       : opts_.max_blocks_per_chunk;
+    for (size_t i = 0; i < pools_; ++i) {
+      pool_[i] = pool__();
+      pool_[i].next_blocks = first;
+    }
+  }
+
+  // a request fits a pool if both its size and its alignment are covered by
+  // the block size. Blocks are aligned to their own size.
+  bool pooled__(size_t bytes, size_t align) const noexcept {
+    size_t need = bytes < align ? align : bytes;
+    return need <= block_size__(pools_ - 1);
+  }
+
+public:
+  unsynchronized_pool_resource()
+      : unsynchronized_pool_resource(pool_options(), get_default_resource()) {
+  }
+
+  explicit unsynchronized_pool_resource(memory_resource *upstream)
+      : unsynchronized_pool_resource(pool_options(), upstream) {}
+
+  explicit unsynchronized_pool_resource(const pool_options &opts)
+      : unsynchronized_pool_resource(opts, get_default_resource()) {}
+
+  unsynchronized_pool_resource(const pool_options &opts,
+                               memory_resource *upstream)
+      : upstream_(upstream), opts_(opts) {
+    // clamp the options to what we actually support.
+    if (opts_.max_blocks_per_chunk == 0) {
+      opts_.max_blocks_per_chunk = default_max_blocks__;
+    }
+    size_t largest = block_size__(pool_count__ - 1);
+    if (opts_.largest_required_pool_block == 0 ||
+        opts_.largest_required_pool_block > largest) {
+      opts_.largest_required_pool_block = largest;
+    }
+    pools_ = pool_index__(opts_.largest_required_pool_block) + 1;
+    opts_.largest_required_pool_block = block_size__(pools_ - 1);
+    reset_pools__();
+  }
+
+  unsynchronized_pool_resource(const unsynchronized_pool_resource &) = delete;
+  unsynchronized_pool_resource &
+  operator=(const unsynchronized_pool_resource &) = delete;
+
+  ~unsynchronized_pool_resource() override { release(); }
+
+  void release() {
+    for (size_t i = 0; i < pools_; ++i) {
+      pool__ &pool = pool_[i];
+      while (pool.chunks) {
+        chunk__ *next = pool.chunks->next;
+        upstream_->deallocate(pool.chunks, pool.chunks->size, block_size__(i));
+        pool.chunks = next;
+      }
+    }
+    reset_pools__();
+    while (oversized_) {
+      oversized__ *next = oversized_->next;
+      upstream_->deallocate(oversized_, oversized_->size, oversized_->align);
+      oversized_ = next;
+    }
+  }
+
+  memory_resource *upstream_resource() const noexcept { return upstream_; }
+
+  pool_options options() const noexcept { return opts_; }
+
+private:
+  void *do_allocate(size_t bytes, size_t align) override {
+    if (pooled__(bytes, align)) {
+      size_t idx = pool_index__(bytes < align ? align : bytes);
+      pool__ &pool = pool_[idx];
+      if (pool.free == nullptr) {
+        refill__(idx);
+      }
+      free_block__ *b = pool.free;
+      pool.free = b->next;
+      return b;
+    }
+
+    // prepend a header to oversized blocks, keeping the payload aligned.
+    size_t a = align < alignof(oversized__) ? alignof(oversized__) : align;
+    size_t header = (sizeof(oversized__) + a - 1) / a * a;
+    size_t size = header + bytes;
+    char *raw = static_cast<char *>(upstream_->allocate(size, a));
+    auto *h = reinterpret_cast<oversized__ *>(raw + header) - 1;
+    h->prev = nullptr;
+    h->next = oversized_;
+    h->size = size;
+    h->align = a;
+    if (oversized_) {
+      oversized_->prev = h;
+    }
+    oversized_ = h;
+    return raw + header;
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    if (pooled__(bytes, align)) {
+      pool__ &pool = pool_[pool_index__(bytes < align ? align : bytes)];
+      auto *b = static_cast<free_block__ *>(p);
+      b->next = pool.free;
+      pool.free = b;
+      return;
+    }
+
+    auto *h = static_cast<oversized__ *>(p) - 1;
+    if (h->prev) {
+      h->prev->next = h->next;
+    } else {
+      oversized_ = h->next;
+    }
+    if (h->next) {
+      h->next->prev = h->prev;
+    }
+    size_t header = (sizeof(oversized__) + h->align - 1) / h->align * h->align;
+    upstream_->deallocate(static_cast<char *>(p) - header, h->size, h->align);
+  }
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// same as above, with a lock around it.
+class synchronized_pool_resource : public memory_resource {
+  mutable std::mutex lock_;
+  unsynchronized_pool_resource pool_;
+
+public:
+  synchronized_pool_resource() = default;
+
+  explicit synchronized_pool_resource(memory_resource *upstream)
+      : pool_(upstream) {}
+
+  explicit synchronized_pool_resource(const pool_options &opts)
+      : pool_(opts) {}
+
+  synchronized_pool_resource(const pool_options &opts,
+                             memory_resource *upstream)
+      : pool_(opts, upstream) {}
+
+  void release() {
+    std::lock_guard<std::mutex> g(lock_);
+    pool_.release();
+  }
+
+  memory_resource *upstream_resource() const noexcept {
+    return pool_.upstream_resource();
+  }
+
+  pool_options options() const noexcept { return pool_.options(); }
+
+private:
+  void *do_allocate(size_t bytes, size_t align) override {
+    std::lock_guard<std::mutex> g(lock_);
+    return pool_.allocate(bytes, align);
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    std::lock_guard<std::mutex> g(lock_);
+    pool_.deallocate(p, bytes, align);
+  }
+
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+} // namespace mstl::pmr
+
+namespace mstl::pmr {
+
+// The allocator side of pmr. It's just a pointer to a resource, so every
+// polymorphic_allocator<T> has the same type no matter what strategy is
+// behind it.
+// note: a copy of a container doesn't inherit the resource, it gets the
+// default one (see select_on_container_copy_construction). The resource is
+// also never propagated on assignment or swap.
+template <typename T> class polymorphic_allocator {
+  memory_resource *resource_;
+
+public:
+  using value_type = T;
+
+  polymorphic_allocator() noexcept : resource_(get_default_resource()) {}
+
+  polymorphic_allocator(memory_resource *r) noexcept : resource_(r) {}
+
+  polymorphic_allocator(const polymorphic_allocator &other) = default;
+
+  template <typename U>
+  polymorphic_allocator(const polymorphic_allocator<U> &other) noexcept
+      : resource_(other.resource()) {}
+
+  polymorphic_allocator &operator=(const polymorphic_allocator &) = delete;
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        resource_->allocate(memory_UTIL::array_bytes__<T>(n), alignof(T)));
+  }
+
+  void deallocate(T *p, size_t n) {
+    resource_->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  polymorphic_allocator select_on_container_copy_construction() const {
+    return polymorphic_allocator();
+  }
+
+  memory_resource *resource() const noexcept { return resource_; }
+};
+
+template <typename T, typename U>
+bool operator==(const polymorphic_allocator<T> &a,
+                const polymorphic_allocator<U> &b) noexcept {
+  return *a.resource() == *b.resource();
+}
+
+template <typename T, typename U>
+bool operator!=(const polymorphic_allocator<T> &a,
+                const polymorphic_allocator<U> &b) noexcept {
+  return !(a == b);
+}
+
+} // namespace mstl::pmr
@@ -1,3 +1,4 @@
+#pragma once
 #include "mtype_traits.hpp"
 #include <stdlib.h>
 
@@ -2,7 +2,10 @@
 
 #include "mexception.hpp"
 #include "stddef.h"
+#include "stdint.h"
 #include "stdlib.h"
+#include <atomic>
+#include <mutex>
 
 // there are two steps for both new and delete:
 // 1. operator new   : allocate space
@@ -14,16 +17,18 @@ namespace mstl {
 
 class bad_alloc : public mstl::exception {
 public:
-  bad_alloc() noexcept;
-  virtual ~bad_alloc() noexcept;
-  virtual const char *what() const noexcept;
+  bad_alloc() noexcept {}
+  virtual ~bad_alloc() noexcept {}
+  virtual const char *what() const noexcept { return "mstl::bad_alloc"; }
 };
 
 class bad_array_new_length : public mstl::bad_alloc {
 public:
-  bad_array_new_length() noexcept;
-  virtual ~bad_array_new_length() noexcept;
-  virtual const char *what() const noexcept;
+  bad_array_new_length() noexcept {}
+  virtual ~bad_array_new_length() noexcept {}
+  virtual const char *what() const noexcept {
+    return "mstl::bad_array_new_length";
+  }
 };
 
 enum class align_val_t : size_t {};
@@ -38,11 +43,266 @@ struct nothrow_t {
   explicit nothrow_t() = default;
 };
 
-extern const nothrow_t notthrow;
+inline constexpr nothrow_t nothrow{};
 
 typedef void (*new_handler)();
 
-new_handler set_new_handler(new_handler new_p) noexcept;
-new_handler get_new_handler() noexcept;
+namespace new_UTILL {
+inline std::atomic<new_handler> new_handler__{nullptr};
+} // namespace new_UTILL
+
+inline new_handler set_new_handler(new_handler new_p) noexcept {
+  return new_UTILL::new_handler__.exchange(new_p, std::memory_order_acq_rel);
+}
+
+inline new_handler get_new_handler() noexcept {
+  return new_UTILL::new_handler__.load(std::memory_order_acquire);
+}
+
+} // namespace mstl
+
+namespace mstl::new_UTILL {
+
+// Aligned slab backend.
+// Over aligned allocations (think 64 bytes aligned SIMD buffers) are served
+// from spans. A span is a 64KiB region aligned to 64KiB, and the header of
+// the span sits at the very beginning of it:
+//
+//   span:  [ header | block | block | block | ... ]
+//          ^ 64KiB aligned
+//
+// Because spans are aligned to their own size, masking any pointer inside a
+// span gives the header back, so unsized delete knows where the block came
+// from without any lookup table.
+//
+// Small spans are cut into blocks of one size class. Size classes are
+// multiples of a cache line up to a page, so a block of size class C is
+// aligned to every power of two that divides C. That's how one slab can
+// serve both 64 and 128 aligned requests.
+//
+// Anything bigger than a page, or aligned to more than a page, gets its own
+// large span. For alignment bigger than the span size the header is placed
+// one span before the payload, so the masking trick still works.
+
+constexpr size_t span_size__ = 64 * 1024;
+constexpr size_t line_size__ = 64;
+constexpr size_t page_size__ = 4096;
+constexpr size_t class_count__ = page_size__ / line_size__;
+
+enum class span_kind__ : uint32_t { slab, large };
+
+struct span_header__ {
+  span_kind__ kind;
+  uint32_t size_class; // index, only for slab spans.
+  void *raw;           // what to hand back to the system, only for large.
+};
+
+struct free_block__ {
+  free_block__ *next;
+};
+
+struct size_class__ {
+  std::mutex lock;
+  free_block__ *head = nullptr;
+};
+
+inline size_class__ size_classes__[class_count__];
+
+constexpr size_t align_up__(size_t n, size_t align) noexcept {
+  return (n + align - 1) & ~(align - 1);
+}
+
+constexpr size_t max__(size_t a, size_t b) noexcept { return a < b ? b : a; }
+
+// index of the size class for (size, align), or class_count__ if the
+// request needs a large span.
+constexpr size_t class_index__(size_t size, size_t align) noexcept {
+  if (align > page_size__ || size > page_size__) {
+    return class_count__;
+  }
+  size_t block = align_up__(max__(size, 1), max__(align, line_size__));
+  return block > page_size__ ? class_count__ : block / line_size__ - 1;
+}
+
+inline span_header__ *span_of__(void *p) noexcept {
+  auto v = reinterpret_cast<uintptr_t>(p) - 1;
+  return reinterpret_cast<span_header__ *>(v & ~(span_size__ - 1));
+}
+
+// carve a fresh span into blocks. The first block is reserved for the
+// header. Called with the class lock held.
+inline bool refill__(size_t idx) noexcept {
+  size_t block = (idx + 1) * line_size__;
+  char *span = static_cast<char *>(aligned_alloc(span_size__, span_size__));
+  if (span == nullptr) {
+    return false;
+  }
+  auto *h = reinterpret_cast<span_header__ *>(span);
+  h->kind = span_kind__::slab;
+  h->size_class = static_cast<uint32_t>(idx);
+  h->raw = span;
+
+  size_class__ &c = size_classes__[idx];
+  for (size_t off = span_size__ / block * block - block; off >= block;
+       off -= block) {
+    auto *b = reinterpret_cast<free_block__ *>(span + off);
+    b->next = c.head;
+    c.head = b;
+  }
+  return true;
+}
+
+inline void *slab_allocate__(size_t idx) noexcept {
+  size_class__ &c = size_classes__[idx];
+  std::lock_guard<std::mutex> g(c.lock);
+  if (c.head == nullptr && !refill__(idx)) {
+    return nullptr;
+  }
+  free_block__ *b = c.head;
+  c.head = b->next;
+  return b;
+}
+
+inline void slab_deallocate__(void *p, size_t idx) noexcept {
+  size_class__ &c = size_classes__[idx];
+  auto *b = static_cast<free_block__ *>(p);
+  std::lock_guard<std::mutex> g(c.lock);
+  b->next = c.head;
+  c.head = b;
+}
+
+inline void *large_allocate__(size_t size, size_t align) noexcept {
+  size_t span_align = max__(align, span_size__);
+  size_t offset = max__(align, line_size__);
+  size_t total = align_up__(offset + size, span_align);
+  if (total < size) {
+    return nullptr; // overflow
+  }
+
+  char *raw = static_cast<char *>(aligned_alloc(span_align, total));
+  if (raw == nullptr) {
+    return nullptr;
+  }
+  char *p = raw + offset;
+  span_header__ *h = span_of__(p);
+  h->kind = span_kind__::large;
+  h->size_class = 0;
+  h->raw = raw;
+  return p;
+}
+
+inline void *aligned_allocate__(size_t size, size_t align) noexcept {
+  size_t idx = class_index__(size, align);
+  return idx < class_count__ ? slab_allocate__(idx)
+                             : large_allocate__(size, align);
+}
+
+inline void aligned_deallocate__(void *p) noexcept {
+  span_header__ *h = span_of__(p);
+  if (h->kind == span_kind__::slab) {
+    slab_deallocate__(p, h->size_class);
+  } else {
+    free(h->raw);
+  }
+}
+
+// the new handler loop. When allocation fails, the handler gets a chance to
+// free some memory, then we try again. No handler means give up.
+template <typename Alloc> void *allocate_loop__(Alloc alloc) {
+  for (;;) {
+    if (void *p = alloc()) {
+      return p;
+    }
+    new_handler handler = mstl::get_new_handler();
+    if (handler == nullptr) {
+      throw mstl::bad_alloc();
+    }
+    handler();
+  }
+}
+
+} // namespace mstl::new_UTILL
+
+namespace mstl {
+
+// Default aligned requests just use malloc, which is already good at
+// small, max_align_t aligned objects. Only over aligned requests go
+// to the slab backend.
+inline void *operator_new(size_t size) {
+  return new_UTILL::allocate_loop__(
+      [size] { return malloc(size == 0 ? 1 : size); });
+}
+
+// align must be a power of two.
+inline void *operator_new(size_t size, align_val_t align) {
+  auto a = static_cast<size_t>(align);
+  if (a <= alignof(max_align_t)) {
+    return mstl::operator_new(size);
+  }
+  return new_UTILL::allocate_loop__(
+      [size, a] { return new_UTILL::aligned_allocate__(size, a); });
+}
+
+// nothrow versions still run the handler loop, they just return nullptr
+// instead of throwing at the end.
+inline void *operator_new(size_t size, const nothrow_t &) noexcept {
+  try {
+    return mstl::operator_new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+inline void *operator_new(size_t size, align_val_t align,
+                          const nothrow_t &) noexcept {
+  try {
+    return mstl::operator_new(size, align);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+inline void operator_delete(void *p) noexcept { free(p); }
+
+inline void operator_delete(void *p, size_t) noexcept { free(p); }
+
+inline void operator_delete(void *p, align_val_t align) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+  if (static_cast<size_t>(align) <= alignof(max_align_t)) {
+    free(p);
+    return;
+  }
+  new_UTILL::aligned_deallocate__(p);
+}
+
+// with the size we can tell which size class the block belongs to without
+// touching the span header, which saves a cache miss.
+inline void operator_delete(void *p, size_t size, align_val_t align) noexcept {
+  auto a = static_cast<size_t>(align);
+  if (p == nullptr) {
+    return;
+  }
+  if (a <= alignof(max_align_t)) {
+    free(p);
+    return;
+  }
+  size_t idx = new_UTILL::class_index__(size, a);
+  if (idx < new_UTILL::class_count__) {
+    new_UTILL::slab_deallocate__(p, idx);
+  } else {
+    new_UTILL::aligned_deallocate__(p);
+  }
+}
+
+inline void operator_delete(void *p, const nothrow_t &) noexcept {
+  mstl::operator_delete(p);
+}
+
+inline void operator_delete(void *p, align_val_t align,
+                            const nothrow_t &) noexcept {
+  mstl::operator_delete(p, align);
+}
 
 } // namespace mstl
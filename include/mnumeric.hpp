@@ -1,4 +1,7 @@
 #pragma once
+#include "miterator.hpp"
+#include "msimd.hpp"
+#include "mtype_traits.hpp"
 #include "utility.hpp"
 namespace mstl {
 
@@ -17,8 +20,18 @@ constexpr void iota(ForwardIt first, ForwardIt last, T value) {
 // you can just pass a reverse iterator.
 // Because in c++ everything is egerly evaluated, there is no
 // difference between foldl and foldr other the order.
+//
+// note: over a contiguous array of int or float it's a SIMD sum, which
+// adds floats in a different order (see msimd.hpp).
 template <typename InputIter, typename T>
 constexpr T accumulate(InputIter first, InputIter last, T init) {
+  if constexpr (simd_UTILL::is_reducible__<T, InputIter>::value) {
+    if (!mstl::is_constant_evaluated() &&
+        last - first >= ptrdiff_t(simd_UTILL::min_size__)) {
+      return simd_UTILL::sum__(mstl::addressof(*first), size_t(last - first),
+                               init);
+    }
+  }
   for (; first != last; ++first) {
     init = mstl::move(init) + *first;
   }
@@ -38,6 +51,14 @@ constexpr T accumulate(InputIter first, InputIter last, T init,
 // of vectors.
 template <typename Iter1, typename Iter2, typename T>
 constexpr T inner_product(Iter1 first1, Iter1 last1, Iter2 first2, T init) {
+  if constexpr (simd_UTILL::is_reducible__<T, Iter1, Iter2>::value) {
+    if (!mstl::is_constant_evaluated() &&
+        last1 - first1 >= ptrdiff_t(simd_UTILL::min_size__)) {
+      return simd_UTILL::dot__(mstl::addressof(*first1),
+                               mstl::addressof(*first2),
+                               size_t(last1 - first1), init);
+    }
+  }
   while (first1 != last1) {
     init = mstl::move(init) + *first1 * *first2;
     ++first1;
@@ -0,0 +1,355 @@
+#pragma once
+#include "mcpu.hpp"
+#include "miterator.hpp"
+#include "mtype_traits.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// SIMD kernels behind accumulate and inner_product (mnumeric.hpp) and
+// count and find (malgorithm.hpp), for contiguous arrays of integers,
+// float and double.
+//
+// Each kernel is written once with GCC vector types and compiled at three
+// widths: 16 bytes (SSE2, the x86-64 baseline), 32 (AVX2) and 64
+// (AVX-512). The widest one the cpu supports is picked the first time a
+// kernel runs (see mcpu.hpp) and kept in a function pointer.
+//
+// Sums and dot products keep four vector accumulators, so the adds don't
+// wait on each other. For integers the order doesn't matter: lanes are
+// unsigned and wrap, the same bits the scalar loop ends up with. For
+// floats it does, the total is added up in a different order than the
+// left fold and can round differently. Define MSTL_STRICT_FP to keep float
+// and double accumulate and inner_product on the scalar loop. count and
+// find compare, they're exact either way.
+namespace mstl::simd_UTILL {
+
+#ifdef MSTL_STRICT_FP
+constexpr bool strict_fp__ = true;
+#else
+constexpr bool strict_fp__ = false;
+#endif
+
+// below this many elements the plain loop wins.
+constexpr size_t min_size__ = 32;
+
+template <size_t N> struct uint_lane__ { using type = void; };
+template <> struct uint_lane__<1> { using type = uint8_t; };
+template <> struct uint_lane__<2> { using type = uint16_t; };
+template <> struct uint_lane__<4> { using type = uint32_t; };
+template <> struct uint_lane__<8> { using type = uint64_t; };
+
+// what a kernel computes T in, void if it can't: integers as unsigned of
+// the same size, so sums wrap instead of overflowing.
+template <typename T, typename = void> struct lane_of__ { using type = void; };
+template <typename T>
+struct lane_of__<T, mstl::enable_if_t<mstl::is_integral<T>::value &&
+                                      !mstl::is_same<T, bool>::value>> {
+  using type = typename uint_lane__<sizeof(T)>::type;
+};
+template <> struct lane_of__<float> { using type = float; };
+template <> struct lane_of__<double> { using type = double; };
+
+template <typename T>
+struct is_lane__
+    : mstl::integral_constant<
+          bool, !mstl::is_same<typename lane_of__<T>::type, void>::value> {};
+
+// the element type of a contiguous Iter, const dropped, void otherwise.
+template <typename Iter, typename = void> struct contiguous_element__ {
+  using type = void;
+};
+template <typename Iter>
+struct contiguous_element__<
+    Iter, mstl::enable_if_t<mstl::is_contiguous_iterator<Iter>::value>> {
+  using type = typename mstl::remove_const<typename mstl::remove_reference<
+      decltype(*mstl::declval<Iter &>())>::type>::type;
+};
+
+// folding Iters into a T with + (and *) can go through the kernels: the
+// elements are T, and T doesn't mind the order.
+template <typename T>
+struct is_reorderable__
+    : mstl::integral_constant<
+          bool, is_lane__<T>::value &&
+                    (mstl::is_integral<T>::value || !strict_fp__)> {};
+
+template <typename T, typename... Iters>
+struct is_reducible__
+    : mstl::integral_constant<
+          bool,
+          is_reorderable__<T>::value &&
+              (mstl::is_same<typename contiguous_element__<Iters>::type,
+                             T>::value &&
+               ...)> {};
+
+// looking for a T in Iters can: comparing the element to the value
+// converted to the element type gives the same answer as comparing it to
+// the value. Not for an integer element and a floating value, many big
+// integers round to the same double.
+template <typename Iter, typename T>
+struct is_searchable__ {
+  using element__ = typename contiguous_element__<Iter>::type;
+  static constexpr bool value =
+      is_lane__<element__>::value && mstl::is_arithmetic<T>::value &&
+      !(mstl::is_integral<element__>::value &&
+        mstl::is_floating_point<T>::value);
+};
+
+/*
+ * kernels, Op::run<W> works on W byte vectors
+ */
+template <typename L, typename V>
+__attribute__((always_inline)) inline void
+load__(V &v, const unsigned char *p, size_t i) noexcept {
+  memcpy(&v, p + i * sizeof(L), sizeof(V));
+}
+
+template <typename L>
+__attribute__((always_inline)) inline L load1__(const unsigned char *p,
+                                                size_t i) noexcept {
+  L x;
+  memcpy(&x, p + i * sizeof(L), sizeof(L));
+  return x;
+}
+
+template <typename M>
+__attribute__((always_inline)) inline bool any__(const M &m) noexcept {
+  uint64_t w[sizeof(M) / 8];
+  memcpy(w, &m, sizeof(M));
+  uint64_t r = 0;
+  for (size_t j = 0; j < sizeof(M) / 8; ++j) {
+    r |= w[j];
+  }
+  return r != 0;
+}
+
+template <typename L> struct sum_op__ {
+  template <size_t W>
+  __attribute__((always_inline)) static L run(const unsigned char *p,
+                                              size_t n) noexcept {
+    typedef L V __attribute__((vector_size(W)));
+    constexpr size_t lanes = W / sizeof(L);
+    V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+    size_t i = 0;
+    for (; i + 4 * lanes <= n; i += 4 * lanes) {
+      V x0, x1, x2, x3;
+      load__<L>(x0, p, i);
+      load__<L>(x1, p, i + lanes);
+      load__<L>(x2, p, i + 2 * lanes);
+      load__<L>(x3, p, i + 3 * lanes);
+      a0 += x0;
+      a1 += x1;
+      a2 += x2;
+      a3 += x3;
+    }
+    for (; i + lanes <= n; i += lanes) {
+      V x;
+      load__<L>(x, p, i);
+      a0 += x;
+    }
+    a0 = (a0 + a1) + (a2 + a3);
+    L r = 0;
+    for (size_t j = 0; j < lanes; ++j) {
+      r += a0[j];
+    }
+    for (; i < n; ++i) {
+      r += load1__<L>(p, i);
+    }
+    return r;
+  }
+};
+
+template <typename L> struct dot_op__ {
+  template <size_t W>
+  __attribute__((always_inline)) static L
+  run(const unsigned char *a, const unsigned char *b, size_t n) noexcept {
+    typedef L V __attribute__((vector_size(W)));
+    constexpr size_t lanes = W / sizeof(L);
+    V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+    size_t i = 0;
+    for (; i + 4 * lanes <= n; i += 4 * lanes) {
+      V x0, x1, x2, x3, y0, y1, y2, y3;
+      load__<L>(x0, a, i);
+      load__<L>(x1, a, i + lanes);
+      load__<L>(x2, a, i + 2 * lanes);
+      load__<L>(x3, a, i + 3 * lanes);
+      load__<L>(y0, b, i);
+      load__<L>(y1, b, i + lanes);
+      load__<L>(y2, b, i + 2 * lanes);
+      load__<L>(y3, b, i + 3 * lanes);
+      a0 += x0 * y0;
+      a1 += x1 * y1;
+      a2 += x2 * y2;
+      a3 += x3 * y3;
+    }
+    for (; i + lanes <= n; i += lanes) {
+      V x, y;
+      load__<L>(x, a, i);
+      load__<L>(y, b, i);
+      a0 += x * y;
+    }
+    a0 = (a0 + a1) + (a2 + a3);
+    L r = 0;
+    for (size_t j = 0; j < lanes; ++j) {
+      r += a0[j];
+    }
+    for (; i < n; ++i) {
+      r += L(load1__<L>(a, i) * load1__<L>(b, i));
+    }
+    return r;
+  }
+};
+
+template <typename L> struct count_op__ {
+  template <size_t W>
+  __attribute__((always_inline)) static size_t
+  run(const unsigned char *p, size_t n, L v) noexcept {
+    using U = typename uint_lane__<sizeof(L)>::type;
+    typedef L V __attribute__((vector_size(W)));
+    typedef U UV __attribute__((vector_size(W)));
+    constexpr size_t lanes = W / sizeof(L);
+    // x == vv has lanes of -1 where equal, taking it off an unsigned counter
+    // adds one. A lane counts to its max before it's added into the total.
+    constexpr size_t max_rounds =
+        sizeof(L) < 4 ? (size_t(1) << (8 * sizeof(L))) - 1 : size_t(1) << 30;
+    V vv = V{} + v;
+    size_t total = 0;
+    size_t i = 0;
+    while (i + lanes <= n) {
+      size_t rounds = (n - i) / lanes;
+      rounds = rounds < max_rounds ? rounds : max_rounds;
+      UV c = {};
+      for (size_t r = 0; r < rounds; ++r, i += lanes) {
+        V x;
+        load__<L>(x, p, i);
+        c -= (UV)(x == vv);
+      }
+      for (size_t j = 0; j < lanes; ++j) {
+        total += size_t(c[j]);
+      }
+    }
+    for (; i < n; ++i) {
+      total += load1__<L>(p, i) == v;
+    }
+    return total;
+  }
+};
+
+// index of the first v, n if there is none.
+template <typename L> struct find_op__ {
+  template <size_t W>
+  __attribute__((always_inline)) static size_t
+  run(const unsigned char *p, size_t n, L v) noexcept {
+    typedef L V __attribute__((vector_size(W)));
+    constexpr size_t lanes = W / sizeof(L);
+    V vv = V{} + v;
+    size_t i = 0;
+    // find the vector with the hit, then the element in it.
+    for (; i + 4 * lanes <= n; i += 4 * lanes) {
+      V x0, x1, x2, x3;
+      load__<L>(x0, p, i);
+      load__<L>(x1, p, i + lanes);
+      load__<L>(x2, p, i + 2 * lanes);
+      load__<L>(x3, p, i + 3 * lanes);
+      if (any__(x0 == vv) || any__(x1 == vv) || any__(x2 == vv) ||
+          any__(x3 == vv)) {
+        break;
+      }
+    }
+    for (; i + lanes <= n; i += lanes) {
+      V x;
+      load__<L>(x, p, i);
+      if (any__(x == vv)) {
+        break;
+      }
+    }
+    for (; i < n; ++i) {
+      if (load1__<L>(p, i) == v) {
+        return i;
+      }
+    }
+    return n;
+  }
+};
+
+/*
+ * dispatch
+ */
+template <typename Op, typename... Args>
+auto run_base__(Args... args) noexcept {
+  return Op::template run<16>(args...);
+}
+
+#ifdef MSTL_X86_DISPATCH__
+template <typename Op, typename... Args>
+__attribute__((target("avx2"))) auto run_avx2__(Args... args) noexcept {
+  return Op::template run<32>(args...);
+}
+
+template <typename Op, typename... Args>
+__attribute__((target("avx512f,avx512bw"))) auto
+run_avx512__(Args... args) noexcept {
+  return Op::template run<64>(args...);
+}
+#endif
+
+template <typename Op, typename... Args> auto run__(Args... args) noexcept {
+  using fn__ = decltype(&run_base__<Op, Args...>);
+  static const fn__ fn = []() -> fn__ {
+#ifdef MSTL_X86_DISPATCH__
+    const cpu_UTILL::features__ &f = cpu_UTILL::cpu_features__();
+    if (f.avx512f && f.avx512bw) {
+      return &run_avx512__<Op, Args...>;
+    }
+    if (f.avx2) {
+      return &run_avx2__<Op, Args...>;
+    }
+#endif
+    return &run_base__<Op, Args...>;
+  }();
+  return fn(args...);
+}
+
+template <typename T> const unsigned char *bytes__(const T *p) noexcept {
+  return reinterpret_cast<const unsigned char *>(p);
+}
+
+/*
+ * entry points, T is a lane type
+ */
+
+// init + p[0] + ... + p[n - 1].
+template <typename T> T sum__(const T *p, size_t n, T init) noexcept {
+  using L = typename lane_of__<T>::type;
+  L s = run__<sum_op__<L>>(bytes__(p), n);
+  if constexpr (mstl::is_integral<T>::value) {
+    return T(L(L(init) + s));
+  } else {
+    return init + s;
+  }
+}
+
+// init + a[0] * b[0] + ... + a[n - 1] * b[n - 1].
+template <typename T>
+T dot__(const T *a, const T *b, size_t n, T init) noexcept {
+  using L = typename lane_of__<T>::type;
+  L s = run__<dot_op__<L>>(bytes__(a), bytes__(b), n);
+  if constexpr (mstl::is_integral<T>::value) {
+    return T(L(L(init) + s));
+  } else {
+    return init + s;
+  }
+}
+
+template <typename T> size_t count__(const T *p, size_t n, T v) noexcept {
+  using L = typename lane_of__<T>::type;
+  return run__<count_op__<L>>(bytes__(p), n, L(v));
+}
+
+template <typename T> size_t find__(const T *p, size_t n, T v) noexcept {
+  using L = typename lane_of__<T>::type;
+  return run__<find_op__<L>>(bytes__(p), n, L(v));
+}
+
+} // namespace mstl::simd_UTILL
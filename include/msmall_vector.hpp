@@ -0,0 +1,580 @@
+#pragma once
+#include "malgorithm.hpp"
+#include "mexception.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "mvector.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+namespace mstl {
+
+// Vector with room for N elements inside the object itself. Up to N
+// elements it's just an array with a size, no allocation at all, and the
+// elements sit in the same cache lines as whatever holds the small_vector.
+// Past N it spills to the heap and behaves like a vector.
+//
+//   [ begin_ | end_ | cap_ | inline storage for N T ]
+//     |                      ^
+//     +-- points here until the first spill
+//
+// The interface is vector's, which also covers mstl::array's (data, fill,
+// at, front, back, the iterators), so code written against an array can
+// take a small_vector instead.
+//
+// note: a small_vector points into itself, so it is NOT trivially
+// relocatable, and moving one that hasn't spilled moves its elements one
+// by one.
+template <typename T, size_t N, typename Alloc = mstl::allocator<T>>
+class small_vector {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+
+public:
+  using value_type = T;
+  using allocator_type = Alloc;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = mstl::reverse_iterator<iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::pointer, T *>::value,
+                "small_vector needs an allocator with raw pointers");
+
+  static constexpr size_type inline_capacity = N;
+
+private:
+  static constexpr bool relocatable__ =
+      mstl::is_trivially_relocatable<T>::value;
+
+  T *begin_;
+  T *end_;
+  memory_UTIL::compressed_pair__<T *, Alloc> cap_;
+  alignas(T) unsigned char inline_[N == 0 ? 1 : N * sizeof(T)];
+
+public:
+  small_vector() noexcept(noexcept(Alloc())) : small_vector(Alloc()) {}
+
+  explicit small_vector(const Alloc &a) noexcept
+      : begin_(inline_data__()), end_(begin_), cap_(begin_ + N, a) {}
+
+  explicit small_vector(size_type n, const Alloc &a = Alloc())
+      : small_vector(a) {
+    init__([&] { resize(n); });
+  }
+
+  small_vector(size_type n, const T &value, const Alloc &a = Alloc())
+      : small_vector(a) {
+    init__([&] { assign(n, value); });
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  small_vector(InputIt first, InputIt last, const Alloc &a = Alloc())
+      : small_vector(a) {
+    init__([&] { append__(first, last); });
+  }
+
+  small_vector(std::initializer_list<T> il, const Alloc &a = Alloc())
+      : small_vector(il.begin(), il.end(), a) {}
+
+  small_vector(const small_vector &other)
+      : small_vector(alloc_traits__::select_on_container_copy_construction(
+            other.alloc__())) {
+    init__([&] { append__(other.begin_, other.end_); });
+  }
+
+  small_vector(small_vector &&other) noexcept(
+      mstl::is_nothrow_move_constructible<T>::value)
+      : small_vector(other.alloc__()) {
+    take__(other);
+  }
+
+  ~small_vector() {
+    clear();
+    release__();
+  }
+
+  small_vector &operator=(const small_vector &other) {
+    if (this != &other) {
+      if constexpr (alloc_traits__::propagate_on_container_copy_assignment::
+                        value) {
+        if (alloc__() != other.alloc__()) {
+          clear();
+          release__();
+        }
+        alloc__() = other.alloc__();
+      }
+      assign(other.begin_, other.end_);
+    }
+    return *this;
+  }
+
+  small_vector &operator=(small_vector &&other) noexcept(
+      mstl::is_nothrow_move_constructible<T>::value) {
+    if (this != &other) {
+      clear();
+      if constexpr (alloc_traits__::propagate_on_container_move_assignment::
+                        value) {
+        release__();
+        alloc__() = mstl::move(other.alloc__());
+      }
+      take__(other);
+    }
+    return *this;
+  }
+
+  small_vector &operator=(std::initializer_list<T> il) {
+    assign(il.begin(), il.end());
+    return *this;
+  }
+
+  void assign(size_type n, const T &value) {
+    T tmp(value);
+    clear();
+    reserve(n);
+    end_ = fill__(end_, n, tmp);
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    clear();
+    append__(first, last);
+  }
+
+  void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+  allocator_type get_allocator() const noexcept { return alloc__(); }
+
+  // true once the elements live on the heap. Shrinking back under N
+  // doesn't move them back, only shrink_to_fit does.
+  bool spilled() const noexcept { return begin_ != inline_data__(); }
+
+  // element access
+
+  reference operator[](size_type n) noexcept { return begin_[n]; }
+  const_reference operator[](size_type n) const noexcept { return begin_[n]; }
+
+  reference at(size_type n) {
+    if (n >= size()) {
+      throw mstl::exception();
+    }
+    return begin_[n];
+  }
+
+  const_reference at(size_type n) const {
+    if (n >= size()) {
+      throw mstl::exception();
+    }
+    return begin_[n];
+  }
+
+  reference front() noexcept { return *begin_; }
+  const_reference front() const noexcept { return *begin_; }
+  reference back() noexcept { return *(end_ - 1); }
+  const_reference back() const noexcept { return *(end_ - 1); }
+
+  T *data() noexcept { return begin_; }
+  const T *data() const noexcept { return begin_; }
+
+  // same as array::fill, every element becomes u.
+  void fill(const T &u) { mstl::fill_n(begin_, size(), u); }
+
+  // iterators
+
+  iterator begin() noexcept { return begin_; }
+  const_iterator begin() const noexcept { return begin_; }
+  iterator end() noexcept { return end_; }
+  const_iterator end() const noexcept { return end_; }
+
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+  const_reverse_iterator crend() const noexcept { return rend(); }
+
+  // capacity
+
+  bool empty() const noexcept { return begin_ == end_; }
+  size_type size() const noexcept { return size_type(end_ - begin_); }
+  size_type capacity() const noexcept {
+    return size_type(cap_.first() - begin_);
+  }
+
+  size_type max_size() const noexcept {
+    size_type m = alloc_traits__::max_size(alloc__());
+    size_type d = size_type(PTRDIFF_MAX) / sizeof(T);
+    return m < d ? m : d;
+  }
+
+  void reserve(size_type n) {
+    if (n > capacity()) {
+      move_to__(n);
+    }
+  }
+
+  // moves back inline if it fits.
+  void shrink_to_fit() {
+    if (!spilled() || size() == capacity()) {
+      return;
+    }
+    if (size() <= N) {
+      T *heap = begin_;
+      size_type cap = capacity();
+      T *dst = inline_data__();
+      transfer__(heap, end_, dst);
+      release_sources__(heap, end_);
+      begin_ = dst;
+      end_ = dst + (end_ - heap);
+      cap_.first() = dst + N;
+      alloc_traits__::deallocate(alloc__(), heap, cap);
+    } else {
+      move_to__(size());
+    }
+  }
+
+  // modifiers
+
+  void clear() noexcept { erase_at_end__(begin_); }
+
+  template <typename... Args> reference emplace_back(Args &&...args) {
+    if (end_ != cap_.first()) {
+      alloc_traits__::construct(alloc__(), end_,
+                                mstl::forward<Args>(args)...);
+      ++end_;
+    } else {
+      grow_emplace_back__(mstl::forward<Args>(args)...);
+    }
+    return back();
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(mstl::move(value)); }
+
+  void pop_back() noexcept { erase_at_end__(end_ - 1); }
+
+  // Insertions append at the end and rotate the new elements into place.
+  // With a handful of elements that's as fast as shuffling the tail, and
+  // it needs no special cases.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args &&...args) {
+    size_type off = size_type(pos - begin_);
+    emplace_back(mstl::forward<Args>(args)...);
+    return rotate_in__(off, size() - 1);
+  }
+
+  iterator insert(const_iterator pos, const T &value) {
+    return emplace(pos, value);
+  }
+
+  iterator insert(const_iterator pos, T &&value) {
+    return emplace(pos, mstl::move(value));
+  }
+
+  iterator insert(const_iterator pos, size_type n, const T &value) {
+    size_type off = size_type(pos - begin_);
+    size_type old = size();
+    T tmp(value);
+    grow_to__(old + n);
+    end_ = fill__(end_, n, tmp);
+    return rotate_in__(off, old);
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    size_type off = size_type(pos - begin_);
+    size_type old = size();
+    append__(first, last);
+    return rotate_in__(off, old);
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> il) {
+    return insert(pos, il.begin(), il.end());
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    T *f = const_cast<T *>(first);
+    T *l = const_cast<T *>(last);
+    if (f != l) {
+      erase_at_end__(mstl::move(l, end_, f));
+    }
+    return f;
+  }
+
+  void resize(size_type n) {
+    if (n <= size()) {
+      erase_at_end__(begin_ + n);
+      return;
+    }
+    grow_to__(n);
+    while (end_ != begin_ + n) {
+      emplace_back();
+    }
+  }
+
+  void resize(size_type n, const T &value) {
+    if (n <= size()) {
+      erase_at_end__(begin_ + n);
+      return;
+    }
+    T tmp(value);
+    grow_to__(n);
+    end_ = fill__(end_, n - size(), tmp);
+  }
+
+  void swap(small_vector &other) {
+    if (this == &other) {
+      return;
+    }
+    if constexpr (alloc_traits__::propagate_on_container_swap::value) {
+      mstl::swap(alloc__(), other.alloc__());
+    }
+    if (spilled() && other.spilled()) {
+      mstl::swap(begin_, other.begin_);
+      mstl::swap(end_, other.end_);
+      mstl::swap(cap_.first(), other.cap_.first());
+      return;
+    }
+    small_vector tmp(mstl::move(*this));
+    *this = mstl::move(other);
+    other = mstl::move(tmp);
+  }
+
+private:
+  T *inline_data__() noexcept { return reinterpret_cast<T *>(inline_); }
+  const T *inline_data__() const noexcept {
+    return reinterpret_cast<const T *>(inline_);
+  }
+
+  Alloc &alloc__() noexcept { return cap_.second(); }
+  const Alloc &alloc__() const noexcept { return cap_.second(); }
+
+  // the destructor doesn't run if a constructor throws.
+  template <typename Fn> void init__(Fn &&fn) {
+    try {
+      fn();
+    } catch (...) {
+      clear();
+      release__();
+      throw;
+    }
+  }
+
+  // give the heap block back and point at the inline storage again.
+  void release__() noexcept {
+    if (spilled()) {
+      alloc_traits__::deallocate(alloc__(), begin_, capacity());
+      begin_ = end_ = inline_data__();
+      cap_.first() = begin_ + N;
+    }
+  }
+
+  void erase_at_end__(T *pos) noexcept {
+    for (T *p = pos; p != end_; ++p) {
+      alloc_traits__::destroy(alloc__(), p);
+    }
+    end_ = pos;
+  }
+
+  template <typename InputIt> void append__(InputIt first, InputIt last) {
+    if constexpr (vector_UTILL::is_forward_iterator__<InputIt>::value) {
+      grow_to__(size() + static_cast<size_type>(mstl::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  // construct n copies at dst, capacity is already there.
+  T *fill__(T *dst, size_type n, const T &value) {
+    T *cur = dst;
+    try {
+      for (; n > 0; --n, ++cur) {
+        alloc_traits__::construct(alloc__(), cur, value);
+      }
+    } catch (...) {
+      for (; dst != cur; ++dst) {
+        alloc_traits__::destroy(alloc__(), dst);
+      }
+      throw;
+    }
+    return cur;
+  }
+
+  // [begin_ + old, end_) were just appended, move them to begin_ + off.
+  T *rotate_in__(size_type off, size_type old) {
+    mstl::rotate(begin_ + off, begin_ + old, end_);
+    return begin_ + off;
+  }
+
+  // Steal other's heap block if we can, otherwise move its elements over.
+  // We're empty when this is called. other ends up empty and inline.
+  void take__(small_vector &other) {
+    if (other.spilled() && alloc__() == other.alloc__()) {
+      release__();
+      begin_ = other.begin_;
+      end_ = other.end_;
+      cap_.first() = other.cap_.first();
+      other.begin_ = other.end_ = other.inline_data__();
+      other.cap_.first() = other.begin_ + N;
+      return;
+    }
+    reserve(other.size());
+    end_ = mstl::uninitialized_move(other.begin_, other.end_, end_);
+    other.clear();
+  }
+
+  // Same relocation as vector: build the new objects first, then end the
+  // old ones, a memcpy for trivially relocatable types.
+  T *transfer__(T *first, T *last, T *dst) {
+    if constexpr (relocatable__) {
+      size_type n = size_type(last - first);
+      if (n) {
+        memcpy(static_cast<void *>(dst), static_cast<const void *>(first),
+               n * sizeof(T));
+      }
+      return dst + n;
+    } else if constexpr (mstl::is_nothrow_move_constructible<T>::value ||
+                         !mstl::is_copy_constructible<T>::value) {
+      return mstl::uninitialized_move(first, last, dst);
+    } else {
+      return mstl::uninitialized_copy(first, last, dst);
+    }
+  }
+
+  void release_sources__(T *first, T *last) noexcept {
+    if constexpr (!relocatable__) {
+      mstl::destroy(first, last);
+    }
+  }
+
+  // move everything to a heap block of n.
+  void move_to__(size_type n) {
+    if (n > max_size()) {
+      throw mstl::bad_array_new_length();
+    }
+    T *buf = alloc_traits__::allocate(alloc__(), n);
+    try {
+      transfer__(begin_, end_, buf);
+    } catch (...) {
+      alloc_traits__::deallocate(alloc__(), buf, n);
+      throw;
+    }
+    adopt__(buf, size(), n);
+  }
+
+  void adopt__(T *buf, size_type size, size_type cap) noexcept {
+    release_sources__(begin_, end_);
+    if (spilled()) {
+      alloc_traits__::deallocate(alloc__(), begin_, capacity());
+    }
+    begin_ = buf;
+    end_ = buf + size;
+    cap_.first() = buf + cap;
+  }
+
+  size_type next_capacity__(size_type needed) const {
+    size_type m = max_size();
+    if (needed > m) {
+      throw mstl::bad_array_new_length();
+    }
+    size_type cap = capacity();
+    return cap >= m / 2 ? m : (cap * 2 < needed ? needed : cap * 2);
+  }
+
+  // room for needed elements, growing geometrically like emplace_back.
+  // reserve() is exact, this is for the appends that only know how much
+  // they add this time.
+  void grow_to__(size_type needed) {
+    if (needed > capacity()) {
+      move_to__(next_capacity__(needed));
+    }
+  }
+
+  template <typename... Args> void grow_emplace_back__(Args &&...args) {
+    size_type n = size();
+    size_type cap = next_capacity__(n + 1);
+    T *buf = alloc_traits__::allocate(alloc__(), cap);
+    // args might point into the old storage, build the new element first.
+    try {
+      alloc_traits__::construct(alloc__(), buf + n,
+                                mstl::forward<Args>(args)...);
+    } catch (...) {
+      alloc_traits__::deallocate(alloc__(), buf, cap);
+      throw;
+    }
+    try {
+      transfer__(begin_, end_, buf);
+    } catch (...) {
+      alloc_traits__::destroy(alloc__(), buf + n);
+      alloc_traits__::deallocate(alloc__(), buf, cap);
+      throw;
+    }
+    adopt__(buf, n + 1, cap);
+  }
+};
+
+template <typename T, size_t N, typename A>
+bool operator==(const small_vector<T, N, A> &x,
+                const small_vector<T, N, A> &y) {
+  return x.size() == y.size() && mstl::equal(x.begin(), x.end(), y.begin());
+}
+
+template <typename T, size_t N, typename A>
+bool operator!=(const small_vector<T, N, A> &x,
+                const small_vector<T, N, A> &y) {
+  return !(x == y);
+}
+
+template <typename T, size_t N, typename A>
+bool operator<(const small_vector<T, N, A> &x,
+               const small_vector<T, N, A> &y) {
+  return mstl::lexicographical_compare(x.begin(), x.end(), y.begin(),
+                                       y.end());
+}
+
+template <typename T, size_t N, typename A>
+bool operator>(const small_vector<T, N, A> &x,
+               const small_vector<T, N, A> &y) {
+  return y < x;
+}
+
+template <typename T, size_t N, typename A>
+bool operator<=(const small_vector<T, N, A> &x,
+                const small_vector<T, N, A> &y) {
+  return !(y < x);
+}
+
+template <typename T, size_t N, typename A>
+bool operator>=(const small_vector<T, N, A> &x,
+                const small_vector<T, N, A> &y) {
+  return !(x < y);
+}
+
+template <typename T, size_t N, typename A>
+void swap(small_vector<T, N, A> &x, small_vector<T, N, A> &y) {
+  x.swap(y);
+}
+
+} // namespace mstl
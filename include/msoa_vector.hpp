@@ -0,0 +1,790 @@
+#pragma once
+#include "malgorithm.hpp"
+#include "mexception.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mmetaprelude.hpp"
+#include "mspan.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Structure of arrays.
+//
+//   soa_vector<List<int, double, char>>
+//
+// stores every field in an array of its own instead of storing one array
+// of structs:
+//
+//   [ int int int ... | double double double ... | char char char ... ]
+//
+// A loop that reads two fields of every row only touches those two
+// columns, so each cache line it pulls in is full of values it uses, and
+// a loop over a plain array is one the compiler can vectorize. All columns
+// share one allocation, and each starts on a 64 byte boundary.
+//
+// Columns are reached with column<I>() (a span) or data<I>(). Rows are
+// reached with operator[] and the iterators, which hand out proxies with
+// get<I>().
+//
+// note: the allocator only provides the memory, and the fields are built
+// with construct_at.
+namespace mstl::soa_vector_UTILL {
+
+constexpr size_t column_align__ = 64;
+
+struct alignas(column_align__) line__ {
+  unsigned char bytes[column_align__];
+};
+
+constexpr size_t round_up__(size_t n) noexcept {
+  return (n + column_align__ - 1) / column_align__ * column_align__;
+}
+
+// the I-th type of a List.
+template <size_t I, typename XS> struct at__;
+template <typename T, typename... Ts> struct at__<0, List<T, Ts...>> {
+  using type = T;
+};
+template <size_t I, typename T, typename... Ts>
+struct at__<I, List<T, Ts...>> : at__<I - 1, List<Ts...>> {};
+
+// the index of T in Ts..., or sizeof...(Ts) unless it's there exactly once.
+template <typename T, typename... Ts> constexpr size_t index_of__() noexcept {
+  constexpr bool same[] = {mstl::is_same<T, Ts>::value...};
+  size_t found = sizeof...(Ts), count = 0;
+  for (size_t i = 0; i < sizeof...(Ts); ++i) {
+    if (same[i]) {
+      found = i;
+      ++count;
+    }
+  }
+  return count == 1 ? found : sizeof...(Ts);
+}
+
+} // namespace mstl::soa_vector_UTILL
+
+namespace mstl {
+
+template <typename Fields, typename Alloc = mstl::allocator<unsigned char>>
+class soa_vector;
+
+template <typename... Fields, typename Alloc>
+class soa_vector<List<Fields...>, Alloc> {
+  static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+  static_assert(((alignof(Fields) <= soa_vector_UTILL::column_align__) && ...),
+                "soa_vector fields can't be aligned to more than 64");
+
+  using line__ = soa_vector_UTILL::line__;
+  using line_alloc__ = typename mstl::allocator_traits<
+      Alloc>::template rebind_alloc<line__>;
+  using line_traits__ = mstl::allocator_traits<line_alloc__>;
+  using indices__ = mstl::index_sequence_for<Fields...>;
+
+  static constexpr size_t columns__ = sizeof...(Fields);
+
+public:
+  using fields = List<Fields...>;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using allocator_type = Alloc;
+
+  template <size_t I>
+  using field_type = typename soa_vector_UTILL::at__<I, fields>::type;
+
+  template <bool Const> class row__;
+  template <bool Const> class iterator__;
+
+  using reference = row__<false>;
+  using const_reference = row__<true>;
+  using iterator = iterator__<false>;
+  using const_iterator = iterator__<true>;
+
+private:
+  // the start of every column. Column 0 is at the start of the block.
+  struct block__ {
+    void *cols[columns__];
+  };
+
+  block__ block_ = {};
+  size_type size_ = 0;
+  memory_UTIL::compressed_pair__<size_type, line_alloc__> cap_;
+
+public:
+  soa_vector() noexcept(noexcept(line_alloc__()))
+      : cap_(0, line_alloc__()) {}
+  explicit soa_vector(const Alloc &a) : cap_(0, line_alloc__(a)) {}
+
+  explicit soa_vector(size_type n, const Alloc &a = Alloc())
+      : cap_(0, line_alloc__(a)) {
+    resize(n);
+  }
+
+  soa_vector(const soa_vector &other)
+      : cap_(0, line_traits__::select_on_container_copy_construction(
+                    other.alloc__())) {
+    assign_from__<false>(other);
+  }
+
+  soa_vector(soa_vector &&other) noexcept
+      : block_(other.block_), size_(other.size_),
+        cap_(other.capacity(), mstl::move(other.alloc__())) {
+    other.forget__();
+  }
+
+  ~soa_vector() { release__(); }
+
+  soa_vector &operator=(const soa_vector &other) {
+    if (this != &other) {
+      // build the copy aside, a throwing field leaves *this as it was.
+      constexpr bool pocca =
+          line_traits__::propagate_on_container_copy_assignment::value;
+      soa_vector tmp(pocca ? other.alloc__() : alloc__(), 0);
+      tmp.template assign_from__<false>(other);
+      swap_all__(tmp);
+    }
+    return *this;
+  }
+
+  soa_vector &operator=(soa_vector &&other) noexcept(
+      line_traits__::propagate_on_container_move_assignment::value ||
+      line_traits__::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if (line_traits__::propagate_on_container_move_assignment::value ||
+        alloc__() == other.alloc__()) {
+      soa_vector tmp(mstl::move(other));
+      swap_all__(tmp);
+    } else {
+      // can't take memory from a different allocator, move the fields.
+      soa_vector tmp(alloc__(), 0);
+      tmp.template assign_from__<true>(other);
+      swap_all__(tmp);
+    }
+    return *this;
+  }
+
+  allocator_type get_allocator() const { return allocator_type(alloc__()); }
+
+  /*
+   * capacity
+   */
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  size_type capacity() const noexcept { return cap_.first(); }
+
+  size_type max_size() const noexcept {
+    constexpr size_type row = (sizeof(Fields) + ...);
+    constexpr size_type pad = columns__ * soa_vector_UTILL::column_align__;
+    return (size_type(PTRDIFF_MAX) - pad) / row;
+  }
+
+  void reserve(size_type n) {
+    if (n > max_size()) {
+      throw mstl::bad_array_new_length();
+    }
+    if (n > capacity()) {
+      reallocate__(n);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (size_ == 0) {
+      release__();
+      forget__();
+    } else if (size_ < capacity()) {
+      reallocate__(size_);
+    }
+  }
+
+  /*
+   * columns
+   */
+  template <size_t I> field_type<I> *data() noexcept {
+    return col__<I>(block_);
+  }
+  template <size_t I> const field_type<I> *data() const noexcept {
+    return col__<I>(block_);
+  }
+
+  template <size_t I> mstl::span<field_type<I>> column() noexcept {
+    return {data<I>(), size_};
+  }
+  template <size_t I> mstl::span<const field_type<I>> column() const noexcept {
+    return {data<I>(), size_};
+  }
+
+  // by type, for a field type that appears once.
+  template <typename T> mstl::span<T> column() noexcept {
+    return column<type_index__<T>()>();
+  }
+  template <typename T> mstl::span<const T> column() const noexcept {
+    return column<type_index__<T>()>();
+  }
+
+  /*
+   * rows
+   */
+  reference operator[](size_type i) noexcept { return reference(this, i); }
+  const_reference operator[](size_type i) const noexcept {
+    return const_reference(this, i);
+  }
+
+  reference at(size_type i) {
+    if (i >= size_) {
+      throw mstl::exception();
+    }
+    return (*this)[i];
+  }
+  const_reference at(size_type i) const {
+    if (i >= size_) {
+      throw mstl::exception();
+    }
+    return (*this)[i];
+  }
+
+  reference front() noexcept { return (*this)[0]; }
+  const_reference front() const noexcept { return (*this)[0]; }
+  reference back() noexcept { return (*this)[size_ - 1]; }
+  const_reference back() const noexcept { return (*this)[size_ - 1]; }
+
+  iterator begin() noexcept { return iterator(this, 0); }
+  iterator end() noexcept { return iterator(this, size_); }
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+  const_iterator end() const noexcept { return const_iterator(this, size_); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  /*
+   * modifiers
+   */
+
+  // one argument per field, in order.
+  template <typename... Args> reference emplace_back(Args &&...args) {
+    static_assert(sizeof...(Args) == columns__,
+                  "emplace_back takes one argument per field");
+    if (size_ == capacity()) {
+      grow_emplace_back__(mstl::forward<Args>(args)...);
+    } else {
+      construct_row__(block_, size_, indices__{}, mstl::forward<Args>(args)...);
+    }
+    ++size_;
+    return back();
+  }
+
+  void push_back(const Fields &...values) { emplace_back(values...); }
+  void push_back(Fields &&...values) { emplace_back(mstl::move(values)...); }
+
+  void pop_back() noexcept {
+    --size_;
+    destroy_rows__(block_, size_, size_ + 1);
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    size_type i = first.index(), j = last.index();
+    if (i != j) {
+      for_columns__([&](auto c) {
+        constexpr size_t I = decltype(c)::value;
+        field_type<I> *col = col__<I>(block_);
+        mstl::move(col + j, col + size_, col + i);
+      });
+      destroy_rows__(block_, size_ - (j - i), size_);
+      size_ -= j - i;
+    }
+    return iterator(this, i);
+  }
+
+  void resize(size_type n) {
+    if (n <= size_) {
+      destroy_rows__(block_, n, size_);
+      size_ = n;
+      return;
+    }
+    if (n > capacity()) {
+      reallocate__(recommend__(n));
+    }
+    all_or_nothing__(
+        [&](auto c) {
+          constexpr size_t I = decltype(c)::value;
+          field_type<I> *col = col__<I>(block_);
+          mstl::uninitialized_value_construct(col + size_, col + n);
+        },
+        [&](auto c) {
+          constexpr size_t I = decltype(c)::value;
+          field_type<I> *col = col__<I>(block_);
+          mstl::destroy(col + size_, col + n);
+        });
+    size_ = n;
+  }
+
+  void clear() noexcept {
+    destroy_rows__(block_, 0, size_);
+    size_ = 0;
+  }
+
+  void swap(soa_vector &other) noexcept {
+    if constexpr (line_traits__::propagate_on_container_swap::value) {
+      swap_all__(other);
+    } else {
+      swap_storage__(other);
+    }
+  }
+
+  friend bool operator==(const soa_vector &x, const soa_vector &y) {
+    if (x.size_ != y.size_) {
+      return false;
+    }
+    bool equal = true;
+    for_columns__([&](auto c) {
+      constexpr size_t I = decltype(c)::value;
+      const field_type<I> *a = col__<I>(x.block_), *b = col__<I>(y.block_);
+      for (size_type i = 0; equal && i < x.size_; ++i) {
+        equal = a[i] == b[i];
+      }
+    });
+    return equal;
+  }
+  friend bool operator!=(const soa_vector &x, const soa_vector &y) {
+    return !(x == y);
+  }
+
+  // A row: a position and the vector it's in. Reading a field reads that
+  // column, nothing is copied out. Assigning one row to another assigns
+  // field by field.
+  template <bool Const> class row__ {
+    using owner__ =
+        typename mstl::conditional<Const, const soa_vector, soa_vector>::type;
+
+    owner__ *v_;
+    size_type i_;
+
+  public:
+    row__(owner__ *v, size_type i) noexcept : v_(v), i_(i) {}
+
+    template <bool C, typename = mstl::enable_if_t<Const && !C>>
+    row__(const row__<C> &other) noexcept
+        : v_(other.vec__()), i_(other.index()) {}
+
+    row__(const row__ &) = default;
+
+    size_type index() const noexcept { return i_; }
+    owner__ *vec__() const noexcept { return v_; }
+
+    template <size_t I> auto &get() const noexcept {
+      return v_->template data<I>()[i_];
+    }
+    template <typename T> auto &get() const noexcept {
+      return get<type_index__<T>()>();
+    }
+
+    const row__ &operator=(const row__ &other) const {
+      return assign__(other);
+    }
+    template <bool C> const row__ &operator=(const row__<C> &other) const {
+      return assign__(other);
+    }
+
+    friend void swap(const row__ &a, const row__ &b) {
+      static_assert(!Const, "can't swap const rows");
+      a.swap__(b, indices__{});
+    }
+
+  private:
+    template <bool C> const row__ &assign__(const row__<C> &other) const {
+      static_assert(!Const, "can't assign to a const row");
+      assign__(other, indices__{});
+      return *this;
+    }
+    template <bool C, size_t... Is>
+    void assign__(const row__<C> &other, mstl::index_sequence<Is...>) const {
+      ((get<Is>() = other.template get<Is>()), ...);
+    }
+    template <size_t... Is>
+    void swap__(const row__ &other, mstl::index_sequence<Is...>) const {
+      (mstl::swap(get<Is>(), other.template get<Is>()), ...);
+    }
+  };
+
+  template <bool Const> class iterator__ {
+    using owner__ =
+        typename mstl::conditional<Const, const soa_vector, soa_vector>::type;
+
+    owner__ *v_ = nullptr;
+    ptrdiff_t i_ = 0;
+
+  public:
+    using iterator_category = mstl::random_access_iterator_tag;
+    using value_type = row__<Const>;
+    using difference_type = ptrdiff_t;
+    using reference = row__<Const>;
+
+    // operator-> needs something to point at.
+    struct pointer {
+      reference row;
+      const reference *operator->() const noexcept { return &row; }
+    };
+
+    iterator__() = default;
+    iterator__(owner__ *v, size_type i) noexcept
+        : v_(v), i_(difference_type(i)) {}
+
+    template <bool C, typename = mstl::enable_if_t<Const && !C>>
+    iterator__(const iterator__<C> &other) noexcept
+        : v_(other.vec__()), i_(difference_type(other.index())) {}
+
+    size_type index() const noexcept { return size_type(i_); }
+    owner__ *vec__() const noexcept { return v_; }
+
+    reference operator*() const noexcept { return reference(v_, index()); }
+    pointer operator->() const noexcept { return pointer{**this}; }
+    reference operator[](difference_type n) const noexcept {
+      return reference(v_, size_type(i_ + n));
+    }
+
+    iterator__ &operator++() noexcept {
+      ++i_;
+      return *this;
+    }
+    iterator__ operator++(int) noexcept {
+      iterator__ tmp = *this;
+      ++i_;
+      return tmp;
+    }
+    iterator__ &operator--() noexcept {
+      --i_;
+      return *this;
+    }
+    iterator__ operator--(int) noexcept {
+      iterator__ tmp = *this;
+      --i_;
+      return tmp;
+    }
+    iterator__ &operator+=(difference_type n) noexcept {
+      i_ += n;
+      return *this;
+    }
+    iterator__ &operator-=(difference_type n) noexcept {
+      i_ -= n;
+      return *this;
+    }
+
+    friend iterator__ operator+(iterator__ it, difference_type n) noexcept {
+      return it += n;
+    }
+    friend iterator__ operator+(difference_type n, iterator__ it) noexcept {
+      return it += n;
+    }
+    friend iterator__ operator-(iterator__ it, difference_type n) noexcept {
+      return it -= n;
+    }
+    friend difference_type operator-(const iterator__ &x,
+                                     const iterator__ &y) noexcept {
+      return x.i_ - y.i_;
+    }
+
+    friend bool operator==(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ == y.i_;
+    }
+    friend bool operator!=(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ != y.i_;
+    }
+    friend bool operator<(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ < y.i_;
+    }
+    friend bool operator>(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ > y.i_;
+    }
+    friend bool operator<=(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ <= y.i_;
+    }
+    friend bool operator>=(const iterator__ &x, const iterator__ &y) noexcept {
+      return x.i_ >= y.i_;
+    }
+  };
+
+private:
+  soa_vector(const line_alloc__ &a, int) : cap_(0, a) {}
+
+  line_alloc__ &alloc__() noexcept { return cap_.second(); }
+  const line_alloc__ &alloc__() const noexcept { return cap_.second(); }
+
+  template <typename T> static constexpr size_t type_index__() noexcept {
+    constexpr size_t i = soa_vector_UTILL::index_of__<T, Fields...>();
+    static_assert(i < columns__, "the field type must appear exactly once");
+    return i;
+  }
+
+  template <size_t I>
+  static field_type<I> *col__(const block__ &b) noexcept {
+    return static_cast<field_type<I> *>(b.cols[I]);
+  }
+
+  template <typename F, size_t... Is>
+  static void for_columns__(F &f, mstl::index_sequence<Is...>) {
+    (f(mstl::integral_constant<size_t, Is>{}), ...);
+  }
+
+  // f(integral_constant<size_t, I>) for every column, in order.
+  template <typename F> static void for_columns__(F &&f) {
+    for_columns__(f, indices__{});
+  }
+
+  // build(column) for every column. If one throws, undo(column) runs for
+  // the columns built before it.
+  template <typename Build, typename Undo>
+  static void all_or_nothing__(Build &&build, Undo &&undo) {
+    size_t done = 0;
+    try {
+      for_columns__([&](auto c) {
+        build(c);
+        ++done;
+      });
+    } catch (...) {
+      for_columns__([&](auto c) {
+        if (decltype(c)::value < done) {
+          undo(c);
+        }
+      });
+      throw;
+    }
+  }
+
+  /*
+   * storage
+   */
+
+  // the column offsets in a block of cap rows, returns its size in lines.
+  static size_type layout__(size_type cap,
+                            size_type (&offsets)[columns__]) noexcept {
+    constexpr size_type sizes[] = {sizeof(Fields)...};
+    size_type bytes = 0;
+    for (size_type i = 0; i < columns__; ++i) {
+      offsets[i] = bytes;
+      bytes = soa_vector_UTILL::round_up__(bytes + cap * sizes[i]);
+    }
+    return bytes / soa_vector_UTILL::column_align__;
+  }
+
+  block__ allocate__(size_type cap) {
+    size_type offsets[columns__];
+    size_type lines = layout__(cap, offsets);
+    auto *base = reinterpret_cast<unsigned char *>(
+        line_traits__::allocate(alloc__(), lines));
+    block__ b;
+    for (size_type i = 0; i < columns__; ++i) {
+      b.cols[i] = base + offsets[i];
+    }
+    return b;
+  }
+
+  void deallocate__(const block__ &b, size_type cap) noexcept {
+    if (cap != 0) {
+      size_type offsets[columns__];
+      line_traits__::deallocate(alloc__(), static_cast<line__ *>(b.cols[0]),
+                                layout__(cap, offsets));
+    }
+  }
+
+  void release__() noexcept {
+    destroy_rows__(block_, 0, size_);
+    deallocate__(block_, capacity());
+  }
+
+  void forget__() noexcept {
+    block_ = block__{};
+    size_ = 0;
+    cap_.first() = 0;
+  }
+
+  size_type recommend__(size_type needed) const {
+    size_type m = max_size();
+    if (needed > m) {
+      throw mstl::bad_array_new_length();
+    }
+    size_type cap = capacity();
+    if (cap >= m / 2) {
+      return m;
+    }
+    size_type n = cap < 8 ? 8 : 2 * cap;
+    return n < needed ? needed : n;
+  }
+
+  static void destroy_rows__(const block__ &b, size_type first,
+                             size_type last) noexcept {
+    for_columns__([&](auto c) {
+      constexpr size_t I = decltype(c)::value;
+      mstl::destroy(col__<I>(b) + first, col__<I>(b) + last);
+    });
+  }
+
+  template <typename... Args, size_t... Is>
+  static void construct_row__(const block__ &b, size_type i,
+                              mstl::index_sequence<Is...>, Args &&...args) {
+    size_t done = 0;
+    try {
+      ((mstl::construct_at(col__<Is>(b) + i, mstl::forward<Args>(args)),
+        ++done),
+       ...);
+    } catch (...) {
+      ((Is < done ? mstl::destroy_at(col__<Is>(b) + i) : void()), ...);
+      throw;
+    }
+  }
+
+  // Relocation, as in vector: transfer__ builds the rows in the new block
+  // and leaves the old ones valid, release_sources__ ends them once every
+  // column made it. Trivially relocatable columns are a memcpy and the old
+  // copies are just forgotten.
+  //
+  // The columns that can throw go first, copied, so a throw there leaves
+  // every source row untouched. The nothrow moves only start once they
+  // all made it. (A column that can't be copied and may throw on move is
+  // moved in the first pass anyway, and loses the strong guarantee, as in
+  // vector.)
+  template <size_t I> static constexpr bool relocatable__() noexcept {
+    return mstl::is_trivially_relocatable<field_type<I>>::value;
+  }
+
+  template <size_t I> static constexpr bool nothrow_transfer__() noexcept {
+    return relocatable__<I>() ||
+           mstl::is_nothrow_move_constructible<field_type<I>>::value;
+  }
+
+  void transfer__(const block__ &fresh) {
+    all_or_nothing__(
+        [&](auto c) {
+          constexpr size_t I = decltype(c)::value;
+          if constexpr (!nothrow_transfer__<I>()) {
+            using T = field_type<I>;
+            T *first = col__<I>(block_), *dst = col__<I>(fresh);
+            if constexpr (mstl::is_copy_constructible<T>::value) {
+              mstl::uninitialized_copy(first, first + size_, dst);
+            } else {
+              mstl::uninitialized_move(first, first + size_, dst);
+            }
+          }
+        },
+        [&](auto c) {
+          constexpr size_t I = decltype(c)::value;
+          if constexpr (!nothrow_transfer__<I>()) {
+            mstl::destroy(col__<I>(fresh), col__<I>(fresh) + size_);
+          }
+        });
+    for_columns__([&](auto c) {
+      constexpr size_t I = decltype(c)::value;
+      using T = field_type<I>;
+      T *first = col__<I>(block_), *dst = col__<I>(fresh);
+      if constexpr (relocatable__<I>()) {
+        if (size_ != 0) {
+          memcpy(static_cast<void *>(dst), static_cast<const void *>(first),
+                 size_ * sizeof(T));
+        }
+      } else if constexpr (nothrow_transfer__<I>()) {
+        mstl::uninitialized_move(first, first + size_, dst);
+      }
+    });
+  }
+
+  void release_sources__() noexcept {
+    for_columns__([&](auto c) {
+      constexpr size_t I = decltype(c)::value;
+      if constexpr (!relocatable__<I>()) {
+        mstl::destroy(col__<I>(block_), col__<I>(block_) + size_);
+      }
+    });
+  }
+
+  // the rows have been transferred into fresh, drop the old block.
+  void replace_storage__(const block__ &fresh, size_type new_cap) noexcept {
+    release_sources__();
+    deallocate__(block_, capacity());
+    block_ = fresh;
+    cap_.first() = new_cap;
+  }
+
+  void reallocate__(size_type new_cap) {
+    block__ fresh = allocate__(new_cap);
+    try {
+      transfer__(fresh);
+    } catch (...) {
+      deallocate__(fresh, new_cap);
+      throw;
+    }
+    replace_storage__(fresh, new_cap);
+  }
+
+  template <typename... Args> void grow_emplace_back__(Args &&...args) {
+    size_type new_cap = recommend__(size_ + 1);
+    block__ fresh = allocate__(new_cap);
+    // build the new row first, args may point into the old block.
+    try {
+      construct_row__(fresh, size_, indices__{}, mstl::forward<Args>(args)...);
+    } catch (...) {
+      deallocate__(fresh, new_cap);
+      throw;
+    }
+    try {
+      transfer__(fresh);
+    } catch (...) {
+      destroy_rows__(fresh, size_, size_ + 1);
+      deallocate__(fresh, new_cap);
+      throw;
+    }
+    replace_storage__(fresh, new_cap);
+  }
+
+  // copy (or move) the rows of other into *this, which is empty.
+  template <bool Move, typename V> void assign_from__(V &other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    size_type n = other.size_;
+    block__ fresh = allocate__(n);
+    try {
+      all_or_nothing__(
+          [&](auto c) {
+            constexpr size_t I = decltype(c)::value;
+            auto *src = col__<I>(other.block_);
+            if constexpr (Move) {
+              mstl::uninitialized_move(src, src + n, col__<I>(fresh));
+            } else {
+              mstl::uninitialized_copy(src, src + n, col__<I>(fresh));
+            }
+          },
+          [&](auto c) {
+            constexpr size_t I = decltype(c)::value;
+            mstl::destroy(col__<I>(fresh), col__<I>(fresh) + n);
+          });
+    } catch (...) {
+      deallocate__(fresh, n);
+      throw;
+    }
+    block_ = fresh;
+    size_ = n;
+    cap_.first() = n;
+  }
+
+  void swap_storage__(soa_vector &other) noexcept {
+    block__ b = block_;
+    block_ = other.block_;
+    other.block_ = b;
+    size_type s = size_;
+    size_ = other.size_;
+    other.size_ = s;
+    s = cap_.first();
+    cap_.first() = other.cap_.first();
+    other.cap_.first() = s;
+  }
+
+  void swap_all__(soa_vector &other) noexcept {
+    swap_storage__(other);
+    mstl::swap(alloc__(), other.alloc__());
+  }
+};
+
+} // namespace mstl
@@ -0,0 +1,71 @@
+#pragma once
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+
+namespace mstl {
+
+// A view of n contiguous objects, a pointer and a size. It owns nothing,
+// so it's only good while the storage it points into is.
+//
+// note: only the dynamic extent, there is no span<T, N>.
+template <typename T> class span {
+  T *data_ = nullptr;
+  size_t size_ = 0;
+
+public:
+  using element_type = T;
+  using value_type = typename mstl::remove_cv<T>::type;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using iterator = T *;
+
+  static constexpr size_t npos = size_t(-1);
+
+  constexpr span() noexcept = default;
+  constexpr span(T *data, size_t n) noexcept : data_(data), size_(n) {}
+  constexpr span(T *first, T *last) noexcept
+      : data_(first), size_(size_t(last - first)) {}
+
+  template <size_t N>
+  constexpr span(T (&arr)[N]) noexcept : data_(arr), size_(N) {}
+
+  // span<const T> from span<T>.
+  template <typename U, typename = mstl::enable_if_t<
+                            mstl::is_convertible<U (*)[], T (*)[]>::value>>
+  constexpr span(const span<U> &other) noexcept
+      : data_(other.data()), size_(other.size()) {}
+
+  // anything with data() and size(), vector, small_vector, string ...
+  template <typename C,
+            typename = mstl::enable_if_t<mstl::is_convertible<
+                decltype(mstl::declval<C &>().data()), T *>::value>,
+            typename = decltype(mstl::declval<C &>().size())>
+  constexpr span(C &c) noexcept : data_(c.data()), size_(size_t(c.size())) {}
+
+  constexpr T *data() const noexcept { return data_; }
+  constexpr size_t size() const noexcept { return size_; }
+  constexpr size_t size_bytes() const noexcept { return size_ * sizeof(T); }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+
+  constexpr T &operator[](size_t i) const noexcept { return data_[i]; }
+  constexpr T &front() const noexcept { return data_[0]; }
+  constexpr T &back() const noexcept { return data_[size_ - 1]; }
+
+  constexpr T *begin() const noexcept { return data_; }
+  constexpr T *end() const noexcept { return data_ + size_; }
+
+  constexpr span first(size_t n) const noexcept { return span(data_, n); }
+  constexpr span last(size_t n) const noexcept {
+    return span(data_ + size_ - n, n);
+  }
+  constexpr span subspan(size_t offset, size_t n = npos) const noexcept {
+    return span(data_ + offset, n == npos ? size_ - offset : n);
+  }
+};
+
+} // namespace mstl
@@ -0,0 +1,380 @@
+#pragma once
+#include "marray.hpp"
+#include "mexception.hpp"
+#include "mfunctional.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Immutable map built entirely at compile time.
+//
+//   constexpr mstl::static_map fields{
+//       mstl::array<mstl::pair<std::string_view, int>, 3>{
+//           {{"id", 0}, {"name", 1}, {"size", 2}}}};
+//   static_assert(fields.at("name") == 1);
+//
+// The constructor finds a minimal perfect hash for the keys (hash and
+// displace): every key hashes into a bucket, every bucket gets a small
+// displacement picked so that its keys land in distinct slots, and the
+// elements are stored in slot order. There are exactly N slots, no empty
+// ones. A lookup is then
+//
+//   h = hash(key), d = disp[bucket(h)], slot = mix(h ^ d)
+//   keys[slot] == key ? found : not found
+//
+// one pass over the key, two loads and one comparison, and nothing at
+// run time before the first lookup. Buckets with a single key don't need
+// a displacement at all, they store their slot directly and take the
+// last free slots.
+//
+// Everything happens in the constant evaluator, so a map with a few
+// thousand keys is a noticeable but one-off compile time cost. Duplicate
+// keys make the constructor throw, which is a compile error for a
+// constexpr map.
+namespace mstl::static_map_UTILL {
+
+using functional_UTILL::k0__;
+using functional_UTILL::k1__;
+using functional_UTILL::k2__;
+using functional_UTILL::mul_fold__;
+
+// a string literal or a const char *, looked up as a string_view.
+template <typename T>
+struct is_c_string__
+    : mstl::integral_constant<
+          bool, mstl::is_same<typename mstl::decay<T>::type, char *>::value ||
+                    mstl::is_same<typename mstl::decay<T>::type,
+                                  const char *>::value> {};
+
+template <typename T> constexpr decltype(auto) as_key__(const T &x) noexcept {
+  if constexpr (is_c_string__<T>::value) {
+    return std::string_view(x);
+  } else {
+    return (x);
+  }
+}
+
+// Seeded hash that works in constant expressions: integers, enums and
+// anything with data() and size() over chars (std::string_view,
+// std::string...), and string literals. mstl::hash can't be used here, it
+// memcpys.
+struct hash__ {
+  using is_transparent = void;
+
+  template <typename T>
+  constexpr uint64_t operator()(const T &x, uint64_t seed) const noexcept {
+    if constexpr (is_c_string__<T>::value) {
+      return (*this)(std::string_view(x), seed);
+    } else if constexpr (mstl::is_integral<T>::value ||
+                         mstl::is_enum<T>::value) {
+      return mul_fold__(static_cast<uint64_t>(x) ^ seed, k1__);
+    } else {
+      static_assert(functional_UTILL::is_contiguous_bytes__<T>::value &&
+                        sizeof(*x.data()) == 1,
+                    "static_map keys must be integers or strings");
+      auto p = x.data();
+      size_t n = x.size();
+      uint64_t h = seed ^ mul_fold__(n ^ k0__, k2__);
+      // assembled byte by byte to stay constexpr, compilers turn each
+      // word back into one load.
+      for (; n >= 8; p += 8, n -= 8) {
+        h = mul_fold__(h ^ word__(p, 8), k1__);
+      }
+      return mul_fold__(h ^ word__(p, n), k1__);
+    }
+  }
+
+private:
+  template <typename C>
+  static constexpr uint64_t word__(const C *p, size_t n) noexcept {
+    uint64_t w = 0;
+    for (size_t i = 0; i < n; ++i) {
+      w |= uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return w;
+  }
+};
+
+// x * n / 2^64, maps a hash into [0, n) without a division.
+constexpr size_t reduce__(uint64_t x, size_t n) noexcept {
+#ifdef __SIZEOF_INT128__
+  return size_t((static_cast<__uint128_t>(x) * n) >> 64);
+#else
+  return size_t(x % n);
+#endif
+}
+
+constexpr size_t slot__(uint64_t h, uint32_t d, size_t n) noexcept {
+  return reduce__(mul_fold__(h ^ d, k2__), n);
+}
+
+// high bit of a displacement: the rest is the slot itself.
+constexpr uint32_t direct__ = uint32_t(1) << 31;
+
+// how many displacements to try for one bucket before giving up on the
+// seed. With N buckets for N keys it is almost never reached.
+constexpr uint32_t max_disp__ = 1 << 16;
+
+template <size_t N> struct layout__ {
+  uint64_t seed;
+  mstl::array<uint32_t, N> disp;
+  mstl::array<size_t, N> perm; // slot -> index of the element
+};
+
+// Try one seed. False if some bucket can't be placed, then the caller
+// tries the next seed.
+template <size_t N, typename Items, typename Hash, typename Eq>
+constexpr bool place__(const Items &items, const Hash &hash, const Eq &eq,
+                       layout__<N> &l) {
+  mstl::array<uint64_t, N> h{};
+  for (size_t i = 0; i < N; ++i) {
+    h[i] = hash(items[i].first, l.seed);
+  }
+
+  // counting sort the elements by bucket, start[b] .. start[b + 1].
+  mstl::array<size_t, N + 1> start{};
+  for (size_t i = 0; i < N; ++i) {
+    ++start[reduce__(h[i], N) + 1];
+  }
+  for (size_t b = 0; b < N; ++b) {
+    start[b + 1] += start[b];
+  }
+  mstl::array<size_t, N> next{};
+  mstl::array<size_t, N> order{};
+  for (size_t b = 0; b < N; ++b) {
+    next[b] = start[b];
+  }
+  for (size_t i = 0; i < N; ++i) {
+    order[next[reduce__(h[i], N)]++] = i;
+  }
+
+  // and the buckets by size, biggest first: they are the hardest to place
+  // so they go while the table is still empty.
+  mstl::array<size_t, N + 2> by_size{};
+  for (size_t b = 0; b < N; ++b) {
+    ++by_size[N - (start[b + 1] - start[b]) + 1];
+  }
+  for (size_t s = 0; s <= N; ++s) {
+    by_size[s + 1] += by_size[s];
+  }
+  mstl::array<size_t, N> buckets{};
+  for (size_t b = 0; b < N; ++b) {
+    buckets[by_size[N - (start[b + 1] - start[b])]++] = b;
+  }
+
+  mstl::array<bool, N> taken{};
+  mstl::array<size_t, N> slots{};
+  size_t free = 0;
+  for (size_t k = 0; k < N; ++k) {
+    size_t b = buckets[k];
+    size_t first = start[b], last = start[b + 1];
+    if (last - first == 0) {
+      break;
+    }
+    if (last - first == 1) {
+      while (taken[free]) {
+        ++free;
+      }
+      taken[free] = true;
+      l.disp[b] = direct__ | uint32_t(free);
+      l.perm[free] = order[first];
+      continue;
+    }
+
+    // equal hashes never separate, whatever the displacement.
+    for (size_t i = first; i < last; ++i) {
+      for (size_t j = i + 1; j < last; ++j) {
+        if (h[order[i]] == h[order[j]]) {
+          if (eq(items[order[i]].first, items[order[j]].first)) {
+            throw mstl::exception(); // duplicate key
+          }
+          return false;
+        }
+      }
+    }
+
+    uint32_t d = 0;
+    for (bool placed = false; !placed;) {
+      if (++d == max_disp__) {
+        return false;
+      }
+      placed = true;
+      for (size_t i = first; i < last && placed; ++i) {
+        size_t s = slot__(h[order[i]], d, N);
+        placed = !taken[s];
+        for (size_t j = first; j < i && placed; ++j) {
+          placed = slots[j] != s;
+        }
+        slots[i] = s;
+      }
+    }
+    l.disp[b] = d;
+    for (size_t i = first; i < last; ++i) {
+      taken[slots[i]] = true;
+      l.perm[slots[i]] = order[i];
+    }
+  }
+  return true;
+}
+
+template <size_t N, typename Items, typename Hash, typename Eq>
+constexpr layout__<N> build__(const Items &items, const Hash &hash,
+                              const Eq &eq) {
+  for (uint64_t attempt = 0; attempt < 64; ++attempt) {
+    layout__<N> l{};
+    l.seed = mul_fold__(attempt ^ k0__, k1__);
+    if (place__(items, hash, eq, l)) {
+      return l;
+    }
+  }
+  throw mstl::exception(); // a broken hash, every seed collides.
+}
+
+} // namespace mstl::static_map_UTILL
+
+namespace mstl {
+
+// Compile time perfect hash map, see the top of the file.
+// Hash is called as hash(key, seed) and must be constexpr, Eq must be
+// constexpr too. With the defaults, lookups take anything comparable with
+// the key, e.g. a std::string for a std::string_view keyed map.
+template <typename K, typename V, size_t N,
+          typename Hash = static_map_UTILL::hash__,
+          typename Eq = mstl::equal_to<>>
+class static_map {
+  static_assert(N > 0, "static_map needs at least one element");
+  static_assert(N < static_map_UTILL::direct__, "static_map is too big");
+
+  static constexpr bool transparent__ =
+      functional_UTILL::is_transparent__<Hash>::value &&
+      functional_UTILL::is_transparent__<Eq>::value;
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = mstl::pair<K, V>;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = Eq;
+  using const_reference = const value_type &;
+  using const_iterator = const value_type *;
+  using iterator = const_iterator;
+
+  template <typename Q>
+  using key_arg = typename functional_UTILL::key_arg__<
+      transparent__>::template type<Q, key_type>;
+
+private:
+  uint64_t seed_;
+  mstl::array<uint32_t, N> disp_;
+  mstl::array<value_type, N> items_; // in slot order
+  memory_UTIL::compressed_pair__<Hash, Eq> fns_;
+
+  template <size_t... I>
+  constexpr static_map(const mstl::array<value_type, N> &items,
+                       const static_map_UTILL::layout__<N> &l,
+                       const Hash &hash, const Eq &eq,
+                       mstl::index_sequence<I...>)
+      : seed_(l.seed), disp_(l.disp), items_{{items[l.perm[I]]...}},
+        fns_(hash, eq) {}
+
+public:
+  constexpr explicit static_map(const mstl::array<value_type, N> &items,
+                                const Hash &hash = Hash(),
+                                const Eq &eq = Eq())
+      : static_map(items, static_map_UTILL::build__<N>(items, hash, eq),
+                   hash, eq, mstl::make_index_sequence<N>()) {}
+
+  /*
+   * iterators, in no particular order
+   */
+  constexpr const_iterator begin() const noexcept { return items_.begin(); }
+  constexpr const_iterator end() const noexcept { return items_.end(); }
+  constexpr const_iterator cbegin() const noexcept { return begin(); }
+  constexpr const_iterator cend() const noexcept { return end(); }
+
+  constexpr bool empty() const noexcept { return false; }
+  constexpr size_type size() const noexcept { return N; }
+  constexpr size_type max_size() const noexcept { return N; }
+
+  constexpr hasher hash_function() const { return fns_.first(); }
+  constexpr key_equal key_eq() const { return fns_.second(); }
+
+  /*
+   * lookup
+   */
+  template <typename Q = K>
+  constexpr const_iterator find(const key_arg<Q> &key) const {
+    const auto &k = static_map_UTILL::as_key__(key);
+    const value_type *e = &items_[slot__(k)];
+    return fns_.second()(e->first, k) ? e : end();
+  }
+
+  template <typename Q = K>
+  constexpr bool contains(const key_arg<Q> &key) const {
+    const auto &k = static_map_UTILL::as_key__(key);
+    return fns_.second()(items_[slot__(k)].first, k);
+  }
+
+  template <typename Q = K>
+  constexpr size_type count(const key_arg<Q> &key) const {
+    return contains<Q>(key) ? 1 : 0;
+  }
+
+  template <typename Q = K>
+  constexpr const V &at(const key_arg<Q> &key) const {
+    const auto &k = static_map_UTILL::as_key__(key);
+    const value_type &e = items_[slot__(k)];
+    if (!fns_.second()(e.first, k)) {
+      throw mstl::exception();
+    }
+    return e.second;
+  }
+
+  // the value, or fallback when the key isn't there.
+  template <typename Q = K>
+  constexpr const V &get_or(const key_arg<Q> &key,
+                            const V &fallback) const {
+    const auto &k = static_map_UTILL::as_key__(key);
+    const value_type &e = items_[slot__(k)];
+    return fns_.second()(e.first, k) ? e.second : fallback;
+  }
+
+private:
+  // the table is full, so every key, present or not, lands on some slot.
+  // The select between the two kinds of buckets compiles to a cmov.
+  template <typename Q> constexpr size_t slot__(const Q &key) const {
+    using namespace static_map_UTILL;
+    uint64_t h = fns_.first()(key, seed_);
+    uint32_t d = disp_[reduce__(h, N)];
+    size_t direct = d & ~direct__;
+    size_t hashed = static_map_UTILL::slot__(h, d, N);
+    return (d & direct__) ? direct : hashed;
+  }
+};
+
+template <typename K, typename V, size_t N>
+static_map(const mstl::array<mstl::pair<K, V>, N> &) -> static_map<K, V, N>;
+
+template <typename K, typename V, size_t N>
+constexpr static_map<K, V, N>
+make_static_map(const mstl::array<mstl::pair<K, V>, N> &items) {
+  return static_map<K, V, N>(items);
+}
+
+} // namespace mstl
+
+namespace mstl::static_map_UTILL {
+
+// the example at the top, so it keeps compiling.
+inline constexpr mstl::static_map example__{
+    mstl::array<mstl::pair<std::string_view, int>, 3>{
+        {{"id", 0}, {"name", 1}, {"size", 2}}}};
+static_assert(example__.at("name") == 1);
+static_assert(example__.contains("size") && !example__.contains("nope"));
+
+} // namespace mstl::static_map_UTILL
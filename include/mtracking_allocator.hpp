@@ -0,0 +1,348 @@
+#pragma once
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <typeinfo>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+// Allocation telemetry.
+// Answer "which container is churning the allocator" in production without
+// attaching a heap profiler. There are two ways in:
+//   1. wrap an allocator: tracking_allocator<Alloc, Tag>. Counted under
+//      (value_type, Tag).
+//   2. build with MSTL_TRACK_ALLOCATIONS, then allocator_traits counts every
+//      allocation under (value_type, untagged).
+//
+// A site is one (type, tag) pair. Every thread gets its own counter block
+// for each site it touches, and only the owner thread writes to it with
+// relaxed load/store, so counting costs a few plain adds. Readers sum the
+// blocks when they take a snapshot.
+//
+// Live bytes are exact in a snapshot. The peak needs a global view, so each
+// thread folds its local delta (and the highest it got since the last fold)
+// into the site every 64KiB. The peak is accurate up to 64KiB per thread.
+//
+// note: sites and counter blocks are never freed, so the numbers of threads
+// that already exited are still there.
+namespace mstl {
+
+constexpr size_t allocation_histogram_buckets = 32;
+
+struct allocation_stats {
+  const char *type_name;
+  const char *tag;
+  uint64_t allocations;
+  uint64_t deallocations;
+  uint64_t bytes_allocated;
+  uint64_t bytes_freed;
+  uint64_t live_bytes;
+  uint64_t peak_live_bytes;
+  // bucket i counts allocations of [2^i, 2^(i+1)) bytes.
+  uint64_t histogram[allocation_histogram_buckets];
+};
+
+} // namespace mstl
+
+namespace mstl::tracking_UTILL {
+
+struct untagged {
+  static constexpr const char *name = "";
+};
+
+constexpr int64_t flush_threshold__ = 64 * 1024;
+
+struct thread_block__ {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> deallocations{0};
+  std::atomic<uint64_t> bytes_allocated{0};
+  std::atomic<uint64_t> bytes_freed{0};
+  std::atomic<uint64_t> histogram[allocation_histogram_buckets]{};
+  // bytes not yet folded into the site, and the max it reached.
+  std::atomic<int64_t> pending{0};
+  std::atomic<int64_t> max_pending{0};
+  thread_block__ *next = nullptr;
+};
+
+// single writer, so no read-modify-write needed.
+template <typename T> inline void bump__(std::atomic<T> &c, T n) noexcept {
+  c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline size_t bucket__(size_t bytes) noexcept {
+#if defined(__GNUC__)
+  size_t b = 63 - __builtin_clzll(static_cast<unsigned long long>(bytes | 1));
+#else
+  size_t b = 0;
+  for (size_t n = bytes; n > 1; n >>= 1) {
+    ++b;
+  }
+#endif
+  return b < allocation_histogram_buckets ? b
+                                          : allocation_histogram_buckets - 1;
+}
+
+template <typename T, typename = void>
+struct has_name__ : mstl::false_type {};
+template <typename T>
+struct has_name__<T, mstl::void_t<decltype(T::name)>> : mstl::true_type {};
+
+inline const char *demangle__(const char *name) noexcept {
+#if defined(__GNUG__)
+  int status = 0;
+  char *s = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  return status == 0 ? s : name;
+#else
+  return name;
+#endif
+}
+
+template <typename Tag> const char *tag_name__() noexcept {
+  if constexpr (has_name__<Tag>::value) {
+    return Tag::name;
+  } else {
+    return demangle__(typeid(Tag).name());
+  }
+}
+
+struct site__ {
+  const char *type_name;
+  const char *tag;
+  std::atomic<thread_block__ *> blocks{nullptr};
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> peak{0};
+  site__ *next = nullptr;
+
+  site__(const char *type_name, const char *tag)
+      : type_name(type_name), tag(tag) {}
+
+  thread_block__ *new_block() {
+    auto *b = new thread_block__;
+    b->next = blocks.load(std::memory_order_relaxed);
+    while (!blocks.compare_exchange_weak(b->next, b, std::memory_order_release,
+                                         std::memory_order_relaxed))
+      ;
+    return b;
+  }
+
+  void flush(thread_block__ &b) noexcept {
+    int64_t pending = b.pending.load(std::memory_order_relaxed);
+    int64_t before = live.fetch_add(pending, std::memory_order_relaxed);
+    int64_t high = before + b.max_pending.load(std::memory_order_relaxed);
+    b.pending.store(0, std::memory_order_relaxed);
+    b.max_pending.store(0, std::memory_order_relaxed);
+
+    int64_t p = peak.load(std::memory_order_relaxed);
+    while (high > p && !peak.compare_exchange_weak(p, high,
+                                                   std::memory_order_relaxed))
+      ;
+  }
+
+  allocation_stats snapshot() const noexcept {
+    allocation_stats s{};
+    s.type_name = type_name;
+    s.tag = tag;
+    int64_t unflushed_high = 0;
+    for (thread_block__ *b = blocks.load(std::memory_order_acquire); b;
+         b = b->next) {
+      s.allocations += b->allocations.load(std::memory_order_relaxed);
+      s.deallocations += b->deallocations.load(std::memory_order_relaxed);
+      s.bytes_allocated += b->bytes_allocated.load(std::memory_order_relaxed);
+      s.bytes_freed += b->bytes_freed.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < allocation_histogram_buckets; ++i) {
+        s.histogram[i] += b->histogram[i].load(std::memory_order_relaxed);
+      }
+      unflushed_high += b->max_pending.load(std::memory_order_relaxed);
+    }
+    s.live_bytes = s.bytes_allocated - s.bytes_freed;
+
+    int64_t high = live.load(std::memory_order_relaxed) + unflushed_high;
+    int64_t p = peak.load(std::memory_order_relaxed);
+    p = p < high ? high : p;
+    s.peak_live_bytes = static_cast<uint64_t>(p < 0 ? 0 : p);
+    if (s.peak_live_bytes < s.live_bytes) {
+      s.peak_live_bytes = s.live_bytes;
+    }
+    return s;
+  }
+};
+
+struct registry__ {
+  std::atomic<site__ *> head{nullptr};
+
+  static registry__ &instance() noexcept {
+    static registry__ r;
+    return r;
+  }
+
+  void add(site__ *s) noexcept {
+    s->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(s->next, s, std::memory_order_release,
+                                       std::memory_order_relaxed))
+      ;
+  }
+};
+
+template <typename T, typename Tag> struct site_for__ {
+  static site__ &site() noexcept {
+    static site__ *s = [] {
+      auto *s = new site__(demangle__(typeid(T).name()), tag_name__<Tag>());
+      registry__::instance().add(s);
+      return s;
+    }();
+    return *s;
+  }
+
+  static thread_block__ &local() noexcept {
+    static thread_local thread_block__ *b = site().new_block();
+    return *b;
+  }
+};
+
+template <typename T, typename Tag>
+void hook_allocate__(size_t bytes) noexcept {
+  thread_block__ &b = site_for__<T, Tag>::local();
+  bump__<uint64_t>(b.allocations, 1);
+  bump__<uint64_t>(b.bytes_allocated, bytes);
+  bump__<uint64_t>(b.histogram[bucket__(bytes)], 1);
+
+  int64_t pending = b.pending.load(std::memory_order_relaxed) +
+                    static_cast<int64_t>(bytes);
+  b.pending.store(pending, std::memory_order_relaxed);
+  if (pending > b.max_pending.load(std::memory_order_relaxed)) {
+    b.max_pending.store(pending, std::memory_order_relaxed);
+  }
+  if (pending >= flush_threshold__) {
+    site_for__<T, Tag>::site().flush(b);
+  }
+}
+
+template <typename T, typename Tag>
+void hook_deallocate__(size_t bytes) noexcept {
+  thread_block__ &b = site_for__<T, Tag>::local();
+  bump__<uint64_t>(b.deallocations, 1);
+  bump__<uint64_t>(b.bytes_freed, bytes);
+
+  int64_t pending = b.pending.load(std::memory_order_relaxed) -
+                    static_cast<int64_t>(bytes);
+  b.pending.store(pending, std::memory_order_relaxed);
+  if (pending <= -flush_threshold__) {
+    site_for__<T, Tag>::site().flush(b);
+  }
+}
+
+} // namespace mstl::tracking_UTILL
+
+namespace mstl {
+
+// Allocator adaptor that counts everything going through Alloc.
+// Tag names the call site. Any type works, a static `name` member is used
+// for display if it has one:
+//   struct ingest_tag { static constexpr const char *name = "ingest"; };
+//   std::vector<int, tracking_allocator<allocator<int>, ingest_tag>> v;
+template <typename Alloc, typename Tag = tracking_UTILL::untagged>
+class tracking_allocator : private memory_UTIL::compressed_elem__<Alloc, 0> {
+  using base__ = memory_UTIL::compressed_elem__<Alloc, 0>;
+  using traits__ = mstl::allocator_traits<Alloc>;
+
+public:
+  using value_type = typename traits__::value_type;
+  using pointer = typename traits__::pointer;
+  using const_pointer = typename traits__::const_pointer;
+  using void_pointer = typename traits__::void_pointer;
+  using const_void_pointer = typename traits__::const_void_pointer;
+  using size_type = typename traits__::size_type;
+  using difference_type = typename traits__::difference_type;
+  using propagate_on_container_copy_assignment =
+      typename traits__::propagate_on_container_copy_assignment;
+  using propagate_on_container_move_assignment =
+      typename traits__::propagate_on_container_move_assignment;
+  using propagate_on_container_swap =
+      typename traits__::propagate_on_container_swap;
+  using is_always_equal = typename traits__::is_always_equal;
+
+  template <typename U> struct rebind {
+    using other =
+        tracking_allocator<typename traits__::template rebind_alloc<U>, Tag>;
+  };
+
+  tracking_allocator() = default;
+  explicit tracking_allocator(const Alloc &a) : base__(a) {}
+
+  template <typename A>
+  tracking_allocator(const tracking_allocator<A, Tag> &other)
+      : base__(Alloc(other.underlying())) {}
+
+  // call the underlying allocator directly, going through its traits would
+  // count the allocation a second time under MSTL_TRACK_ALLOCATIONS. Only
+  // counted once it succeeded.
+  pointer allocate(size_type n) {
+    pointer p = underlying().allocate(n);
+    tracking_UTILL::hook_allocate__<value_type, Tag>(n * sizeof(value_type));
+    return p;
+  }
+
+  void deallocate(pointer p, size_type n) {
+    tracking_UTILL::hook_deallocate__<value_type, Tag>(n *
+                                                       sizeof(value_type));
+    underlying().deallocate(p, n);
+  }
+
+  tracking_allocator select_on_container_copy_construction() const {
+    return tracking_allocator(
+        traits__::select_on_container_copy_construction(underlying()));
+  }
+
+  Alloc &underlying() noexcept { return base__::get(); }
+  const Alloc &underlying() const noexcept { return base__::get(); }
+};
+
+template <typename A1, typename A2, typename Tag>
+bool operator==(const tracking_allocator<A1, Tag> &a,
+                const tracking_allocator<A2, Tag> &b) noexcept {
+  return a.underlying() == b.underlying();
+}
+
+template <typename A1, typename A2, typename Tag>
+bool operator!=(const tracking_allocator<A1, Tag> &a,
+                const tracking_allocator<A2, Tag> &b) noexcept {
+  return !(a == b);
+}
+
+// stats for one (type, tag).
+template <typename T, typename Tag = tracking_UTILL::untagged>
+allocation_stats allocation_stats_for() noexcept {
+  return tracking_UTILL::site_for__<T, Tag>::site().snapshot();
+}
+
+// call fn(const allocation_stats &) for every site seen so far.
+template <typename Fn> void for_each_allocation_site(Fn fn) {
+  auto &registry = tracking_UTILL::registry__::instance();
+  for (auto *s = registry.head.load(std::memory_order_acquire); s;
+       s = s->next) {
+    fn(s->snapshot());
+  }
+}
+
+inline void dump_allocation_stats(FILE *out = stderr) {
+  fprintf(out, "%-40s %-12s %12s %12s %14s %14s\n", "type", "tag", "allocs",
+          "frees", "live bytes", "peak bytes");
+  mstl::for_each_allocation_site([out](const allocation_stats &s) {
+    fprintf(out, "%-40s %-12s %12llu %12llu %14llu %14llu\n", s.type_name,
+            s.tag, static_cast<unsigned long long>(s.allocations),
+            static_cast<unsigned long long>(s.deallocations),
+            static_cast<unsigned long long>(s.live_bytes),
+            static_cast<unsigned long long>(s.peak_live_bytes));
+  });
+}
+
+} // namespace mstl
+
+namespace mstl::tracking_UTILL {
+template <typename Alloc, typename Tag>
+struct is_tracking_allocator__<mstl::tracking_allocator<Alloc, Tag>>
+    : mstl::true_type {};
+} // namespace mstl::tracking_UTILL
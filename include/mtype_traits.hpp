@@ -42,6 +42,9 @@ namespace mstl {
 template <bool B, typename T = void> struct enable_if {};
 template <typename T> struct enable_if<true, T> { using type = T; };
 
+template <bool B, typename T = void>
+using enable_if_t = typename enable_if<B, T>::type;
+
 } // namespace mstl
 
 namespace mstl {
@@ -124,6 +127,29 @@ namespace mstl {
 // I don't bother with those.
 template <typename T> struct is_enum : std::is_enum<T> {};
 template <typename T> struct is_union : std::is_union<T> {};
+template <typename T> struct is_empty : std::is_empty<T> {};
+template <typename T> struct make_unsigned : std::make_unsigned<T> {};
+template <typename T> struct underlying_type : std::underlying_type<T> {};
+template <typename T> struct is_signed : std::is_signed<T> {};
+template <typename T> struct is_final : std::is_final<T> {};
+template <typename From, typename To>
+struct is_convertible : std::is_convertible<From, To> {};
+template <typename T>
+struct is_trivially_copyable : std::is_trivially_copyable<T> {};
+template <typename T>
+struct is_trivially_destructible : std::is_trivially_destructible<T> {};
+template <typename T>
+struct is_trivially_default_constructible
+    : std::is_trivially_default_constructible<T> {};
+template <typename T>
+struct is_copy_constructible : std::is_copy_constructible<T> {};
+template <typename T>
+struct is_nothrow_move_constructible
+    : std::is_nothrow_move_constructible<T> {};
+template <typename T, typename... Args>
+struct is_nothrow_constructible : std::is_nothrow_constructible<T, Args...> {};
+template <typename T>
+struct is_nothrow_move_assignable : std::is_nothrow_move_assignable<T> {};
 
 } /* namespace mstl */
 
@@ -144,26 +170,25 @@ template <typename T>
 struct is_null_pointer
     : mstl::is_same<typename mstl::remove_cv<T>::type, std::nullptr_t> {};
 
+template <typename T> struct is_integral_ : mstl::false_type {};
+template <> struct is_integral_<bool> : mstl::true_type {};
+template <> struct is_integral_<char> : mstl::true_type {};
+template <> struct is_integral_<signed char> : mstl::true_type {};
+template <> struct is_integral_<unsigned char> : mstl::true_type {};
+template <> struct is_integral_<wchar_t> : mstl::true_type {};
+template <> struct is_integral_<char16_t> : mstl::true_type {};
+template <> struct is_integral_<char32_t> : mstl::true_type {};
+template <> struct is_integral_<short> : mstl::true_type {};
+template <> struct is_integral_<unsigned short> : mstl::true_type {};
+template <> struct is_integral_<int> : mstl::true_type {};
+template <> struct is_integral_<unsigned int> : mstl::true_type {};
+template <> struct is_integral_<long> : mstl::true_type {};
+template <> struct is_integral_<unsigned long> : mstl::true_type {};
+template <> struct is_integral_<long long> : mstl::true_type {};
+template <> struct is_integral_<unsigned long long> : mstl::true_type {};
+
 template <typename T>
-struct is_integral
-    : mstl::integral_constant<
-          bool, mstl::is_same<typename mstl::remove_cv<T>::type, int>::value ||
-                    mstl::is_same<typename mstl::remove_cv<short>::type,
-                                  short>::value ||
-                    mstl::is_same<typename mstl::remove_cv<bool>::type,
-                                  bool>::value ||
-                    mstl::is_same<typename mstl::remove_cv<char>::type,
-                                  char>::value ||
-                    mstl::is_same<typename mstl::remove_cv<char16_t>::type,
-                                  char16_t>::value ||
-                    mstl::is_same<typename mstl::remove_cv<char32_t>::type,
-                                  char32_t>::value ||
-                    mstl::is_same<typename mstl::remove_cv<wchar_t>::type,
-                                  wchar_t>::value ||
-                    mstl::is_same<typename mstl::remove_cv<long>::type,
-                                  long>::value ||
-                    mstl::is_same<typename mstl::remove_cv<long long>::type,
-                                  long long>::value> {};
+struct is_integral : is_integral_<typename mstl::remove_cv<T>::type> {};
 
 template <typename T>
 struct is_floating_point
@@ -330,3 +355,35 @@ public:
 };
 
 } // namespace mstl
+
+namespace mstl {
+
+// A type is trivially relocatable if moving an object to a new address and
+// ending the life of the old one is the same as copying its bytes over.
+// Containers use it to grow with memcpy (or realloc) instead of a move and
+// a destroy per element.
+//
+// Every trivially copyable type is. Most other types are too: anything that
+// owns a pointer to the heap (unique_ptr, shared_ptr, vector) doesn't care
+// where it lives. What breaks it is an object that points into itself, like
+// a small string whose data pointer points at its own inline buffer, or an
+// object registered somewhere by address.
+// The compiler can't tell, so it's opt in:
+//
+//   template <> struct mstl::is_trivially_relocatable<my_type>
+//       : mstl::true_type {};
+template <typename T>
+struct is_trivially_relocatable : mstl::is_trivially_copyable<T> {};
+
+} // namespace mstl
+
+namespace mstl {
+
+// true while the compiler evaluates a constant expression. constexpr
+// algorithms check it before they take a memmove or memchr fast path,
+// neither of which works at compile time.
+constexpr bool is_constant_evaluated() noexcept {
+  return __builtin_is_constant_evaluated();
+}
+
+} // namespace mstl
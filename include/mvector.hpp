@@ -0,0 +1,900 @@
+#pragma once
+#include "malgorithm.hpp"
+#include "mexception.hpp"
+#include "miterator.hpp"
+#include "mmemory.hpp"
+#include "mtype_traits.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+namespace mstl {
+
+// Growth policy of vector. When a push_back runs out of room the new
+// capacity is capacity * Num / Den, or what's needed if that's more.
+//
+// 2 is the classic choice and gives the fewest reallocations. Anything
+// below the golden ratio (3/2 say) has a nice property: after a few
+// growths the blocks freed earlier add up to more than the next request,
+// so the allocator can reuse them instead of asking for fresh memory.
+template <size_t Num, size_t Den> struct growth_factor {
+  static_assert(Den > 0 && Num > Den, "growth factor must be bigger than 1");
+
+  static constexpr size_t next_capacity(size_t capacity,
+                                        size_t needed) noexcept {
+    size_t grown = capacity + capacity / Den * (Num - Den) +
+                   capacity % Den * (Num - Den) / Den;
+    return grown < needed ? needed : grown;
+  }
+};
+
+} // namespace mstl
+
+namespace mstl::vector_UTILL {
+
+template <typename Iter, typename = void>
+struct is_forward_iterator__ : mstl::false_type {};
+template <typename Iter>
+struct is_forward_iterator__<
+    Iter, mstl::void_t<
+              typename mstl::iterator_traits<Iter>::iterator_category>>
+    : mstl::is_convertible<
+          typename mstl::iterator_traits<Iter>::iterator_category,
+          mstl::forward_iterator_tag> {};
+
+// the (first, last) constructor must not steal vector(n, value) with ints.
+template <typename Iter>
+using enable_if_iterator__ =
+    mstl::enable_if_t<!mstl::is_integral<Iter>::value>;
+
+} // namespace mstl::vector_UTILL
+
+namespace mstl {
+
+// Dynamic array.
+// The layout is three pointers, the allocator lives with the capacity
+// pointer so a stateless one takes no space:
+//
+//   [ elements ... | raw storage ... ]
+//   ^ begin_       ^ end_            ^ cap_
+//
+// Growing is where vector spends its time. For trivially relocatable types
+// (see mtype_traits.hpp) the old elements are moved with one memcpy, or
+// the block is handed to the allocator's reallocate, which for the default
+// allocator is realloc and can often grow in place. Everything else is
+// moved one by one, or copied if the move might throw, so a failed growth
+// leaves the vector untouched.
+template <typename T, typename Alloc = mstl::allocator<T>,
+          typename Growth = mstl::growth_factor<2, 1>>
+class vector {
+  using alloc_traits__ = mstl::allocator_traits<Alloc>;
+
+public:
+  using value_type = T;
+  using allocator_type = Alloc;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = mstl::reverse_iterator<iterator>;
+  using const_reverse_iterator = mstl::reverse_iterator<const_iterator>;
+
+  static_assert(mstl::is_same<typename alloc_traits__::pointer, T *>::value,
+                "vector needs an allocator with raw pointers");
+
+private:
+  static constexpr bool relocatable__ =
+      mstl::is_trivially_relocatable<T>::value;
+
+  // Allocators that don't customize construct and destroy let the bulk
+  // operations use the uninitialized algorithms and their memcpy paths.
+  static constexpr bool plain__ =
+      !allocator_traits_UTILL::has_construct__<Alloc, T, T &&>::value &&
+      !allocator_traits_UTILL::has_construct__<Alloc, T, const T &>::value &&
+      !allocator_traits_UTILL::has_destroy__<Alloc, T>::value;
+
+  T *begin_ = nullptr;
+  T *end_ = nullptr;
+  memory_UTIL::compressed_pair__<T *, Alloc> cap_;
+
+public:
+  vector() noexcept(noexcept(Alloc())) : cap_(nullptr, Alloc()) {}
+  explicit vector(const Alloc &a) noexcept : cap_(nullptr, a) {}
+
+  explicit vector(size_type n, const Alloc &a = Alloc()) : cap_(nullptr, a) {
+    init__(n, [&](T *dst) { return value_construct__(dst, n); });
+  }
+
+  vector(size_type n, const T &value, const Alloc &a = Alloc())
+      : cap_(nullptr, a) {
+    init__(n, [&](T *dst) { return fill_construct__(dst, n, value); });
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  vector(InputIt first, InputIt last, const Alloc &a = Alloc())
+      : cap_(nullptr, a) {
+    if constexpr (vector_UTILL::is_forward_iterator__<InputIt>::value) {
+      auto n = static_cast<size_type>(mstl::distance(first, last));
+      init__(n, [&](T *dst) { return copy_construct__(first, last, dst); });
+    } else {
+      try {
+        for (; first != last; ++first) {
+          emplace_back(*first);
+        }
+      } catch (...) {
+        release__();
+        throw;
+      }
+    }
+  }
+
+  vector(std::initializer_list<T> il, const Alloc &a = Alloc())
+      : vector(il.begin(), il.end(), a) {}
+
+  vector(const vector &other)
+      : cap_(nullptr, alloc_traits__::select_on_container_copy_construction(
+                          other.alloc__())) {
+    copy_from__(other);
+  }
+
+  vector(const vector &other, const Alloc &a) : cap_(nullptr, a) {
+    copy_from__(other);
+  }
+
+  vector(vector &&other) noexcept
+      : begin_(other.begin_), end_(other.end_),
+        cap_(other.cap_.first(), mstl::move(other.alloc__())) {
+    other.begin_ = other.end_ = other.cap_.first() = nullptr;
+  }
+
+  // with a different allocator we can only steal if the allocators agree.
+  vector(vector &&other, const Alloc &a) : cap_(nullptr, a) {
+    if (alloc__() == other.alloc__()) {
+      steal__(other);
+    } else {
+      init__(other.size(), [&](T *dst) {
+        return move_construct__(other.begin_, other.end_, dst);
+      });
+    }
+  }
+
+  ~vector() { release__(); }
+
+  vector &operator=(const vector &other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (alloc_traits__::propagate_on_container_copy_assignment::
+                      value) {
+      if (alloc__() != other.alloc__()) {
+        release__();
+      }
+      alloc__() = other.alloc__();
+    }
+    assign(other.begin_, other.end_);
+    return *this;
+  }
+
+  vector &operator=(vector &&other) noexcept(
+      alloc_traits__::propagate_on_container_move_assignment::value ||
+      alloc_traits__::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (alloc_traits__::propagate_on_container_move_assignment::
+                      value) {
+      release__();
+      alloc__() = mstl::move(other.alloc__());
+      steal__(other);
+    } else {
+      if (alloc__() == other.alloc__()) {
+        release__();
+        steal__(other);
+      } else {
+        // can't take memory from a different allocator, move the elements.
+        assign_move__(other);
+      }
+    }
+    return *this;
+  }
+
+  vector &operator=(std::initializer_list<T> il) {
+    assign(il.begin(), il.end());
+    return *this;
+  }
+
+  void assign(size_type n, const T &value) {
+    if (n > capacity()) {
+      vector tmp(n, value, alloc__());
+      swap_storage__(tmp);
+      return;
+    }
+    size_type s = size();
+    mstl::fill_n(begin_, n < s ? n : s, value);
+    if (n > s) {
+      end_ = fill_construct__(end_, n - s, value);
+    } else {
+      erase_at_end__(begin_ + n);
+    }
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    if constexpr (vector_UTILL::is_forward_iterator__<InputIt>::value) {
+      auto n = static_cast<size_type>(mstl::distance(first, last));
+      if (n > capacity()) {
+        vector tmp(first, last, alloc__());
+        swap_storage__(tmp);
+        return;
+      }
+      T *cur = begin_;
+      for (; cur != end_ && first != last; ++cur, ++first) {
+        *cur = *first;
+      }
+      if (first != last) {
+        end_ = copy_construct__(first, last, end_);
+      } else {
+        erase_at_end__(cur);
+      }
+    } else {
+      clear();
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    }
+  }
+
+  void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+  allocator_type get_allocator() const noexcept { return alloc__(); }
+
+  // element access
+
+  reference operator[](size_type n) noexcept { return begin_[n]; }
+  const_reference operator[](size_type n) const noexcept { return begin_[n]; }
+
+  reference at(size_type n) {
+    if (n >= size()) {
+      throw mstl::exception();
+    }
+    return begin_[n];
+  }
+
+  const_reference at(size_type n) const {
+    if (n >= size()) {
+      throw mstl::exception();
+    }
+    return begin_[n];
+  }
+
+  reference front() noexcept { return *begin_; }
+  const_reference front() const noexcept { return *begin_; }
+  reference back() noexcept { return *(end_ - 1); }
+  const_reference back() const noexcept { return *(end_ - 1); }
+
+  T *data() noexcept { return begin_; }
+  const T *data() const noexcept { return begin_; }
+
+  // iterators
+
+  iterator begin() noexcept { return begin_; }
+  const_iterator begin() const noexcept { return begin_; }
+  iterator end() noexcept { return end_; }
+  const_iterator end() const noexcept { return end_; }
+
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+  const_reverse_iterator crend() const noexcept { return rend(); }
+
+  // capacity
+
+  bool empty() const noexcept { return begin_ == end_; }
+  size_type size() const noexcept { return size_type(end_ - begin_); }
+  size_type capacity() const noexcept {
+    return size_type(cap_.first() - begin_);
+  }
+
+  size_type max_size() const noexcept {
+    size_type m = alloc_traits__::max_size(alloc__());
+    size_type d = size_type(PTRDIFF_MAX) / sizeof(T);
+    return m < d ? m : d;
+  }
+
+  // reserve goes through the growth policy, so a loop that reserves a
+  // little more every round is still amortized O(1) per element.
+  void reserve(size_type n) {
+    if (n > capacity()) {
+      reallocate__(recommend__(n));
+    }
+  }
+
+  // exactly n, for when the final size is known up front.
+  void reserve_exact(size_type n) {
+    if (n > max_size()) {
+      throw mstl::bad_array_new_length();
+    }
+    if (n > capacity()) {
+      reallocate__(n);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (capacity() == size()) {
+      return;
+    }
+    if (empty()) {
+      release__();
+      return;
+    }
+    reallocate__(size());
+  }
+
+  // modifiers
+
+  void clear() noexcept { erase_at_end__(begin_); }
+
+  iterator insert(const_iterator pos, const T &value) {
+    return emplace(pos, value);
+  }
+
+  iterator insert(const_iterator pos, T &&value) {
+    return emplace(pos, mstl::move(value));
+  }
+
+  iterator insert(const_iterator pos, size_type n, const T &value) {
+    T *p = const_cast<T *>(pos);
+    if (n == 0) {
+      return p;
+    }
+    // value might live in this vector, take a copy before moving things.
+    T tmp(value);
+    return insert_n__(p, n, [&](T *dst, size_type k) {
+      return fill_construct__(dst, k, tmp);
+    }, [&](T *dst, size_type k) { mstl::fill_n(dst, k, tmp); });
+  }
+
+  template <typename InputIt,
+            typename = vector_UTILL::enable_if_iterator__<InputIt>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    T *p = const_cast<T *>(pos);
+    if constexpr (vector_UTILL::is_forward_iterator__<InputIt>::value) {
+      auto n = static_cast<size_type>(mstl::distance(first, last));
+      if (n == 0) {
+        return p;
+      }
+      // the tail that is assigned over is always a prefix of the range, the
+      // rest is constructed. The split depends on where the gap lands.
+      return insert_n__(p, n, [&](T *dst, size_type k) {
+        InputIt mid = first;
+        for (size_type i = 0; i < n - k; ++i) {
+          ++mid;
+        }
+        return copy_construct__(mid, last, dst);
+      }, [&](T *dst, size_type k) {
+        InputIt it = first;
+        for (size_type i = 0; i < k; ++i, ++it, ++dst) {
+          *dst = *it;
+        }
+      });
+    } else {
+      // single pass range, buffer it first and move from the buffer.
+      vector tmp(first, last, alloc__());
+      size_type n = tmp.size();
+      if (n == 0) {
+        return p;
+      }
+      return insert_n__(p, n, [&](T *dst, size_type k) {
+        return move_construct__(tmp.end_ - k, tmp.end_, dst);
+      }, [&](T *dst, size_type k) {
+        mstl::move(tmp.begin_, tmp.begin_ + k, dst);
+      });
+    }
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> il) {
+    return insert(pos, il.begin(), il.end());
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args &&...args) {
+    T *p = const_cast<T *>(pos);
+    if (p == end_) {
+      emplace_back(mstl::forward<Args>(args)...);
+      return end_ - 1;
+    }
+    T tmp(mstl::forward<Args>(args)...);
+    return insert_n__(p, 1, [&](T *dst, size_type k) {
+      if (k) {
+        construct__(dst++, mstl::move(tmp));
+      }
+      return dst;
+    }, [&](T *dst, size_type k) {
+      if (k) {
+        *dst = mstl::move(tmp);
+      }
+    });
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    T *f = const_cast<T *>(first);
+    T *l = const_cast<T *>(last);
+    if (f == l) {
+      return f;
+    }
+    if constexpr (relocatable__) {
+      // the gap is destroyed, then the tail slides down bytewise.
+      destroy_range__(f, l);
+      size_type tail = size_type(end_ - l);
+      if (tail) {
+        memmove(static_cast<void *>(f), static_cast<const void *>(l),
+                tail * sizeof(T));
+      }
+      end_ = f + tail;
+    } else {
+      erase_at_end__(mstl::move(l, end_, f));
+    }
+    return f;
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(mstl::move(value)); }
+
+  template <typename... Args> reference emplace_back(Args &&...args) {
+    if (end_ != cap_.first()) {
+      construct__(end_, mstl::forward<Args>(args)...);
+      ++end_;
+    } else {
+      grow_emplace_back__(mstl::forward<Args>(args)...);
+    }
+    return back();
+  }
+
+  void pop_back() noexcept { erase_at_end__(end_ - 1); }
+
+  void resize(size_type n) {
+    resize__(n, [this](T *dst, size_type k) {
+      return value_construct__(dst, k);
+    });
+  }
+
+  void resize(size_type n, const T &value) {
+    if (n > size() && n > capacity()) {
+      // growing invalidates value if it's one of ours.
+      T tmp(value);
+      resize__(n, [&](T *dst, size_type k) {
+        return fill_construct__(dst, k, tmp);
+      });
+    } else {
+      resize__(n, [&](T *dst, size_type k) {
+        return fill_construct__(dst, k, value);
+      });
+    }
+  }
+
+  // like resize, but new elements are default initialized instead of value
+  // initialized, so for trivial types they are left as garbage instead of
+  // being zeroed. Handy when the next thing is to overwrite them anyway,
+  // e.g reading a file into a vector<char>.
+  void resize_default_init(size_type n) {
+    resize__(n, [this](T *dst, size_type k) {
+      return default_construct__(dst, k);
+    });
+  }
+
+  void swap(vector &other) noexcept {
+    if constexpr (alloc_traits__::propagate_on_container_swap::value) {
+      mstl::swap(alloc__(), other.alloc__());
+    }
+    swap_storage__(other);
+  }
+
+private:
+  Alloc &alloc__() noexcept { return cap_.second(); }
+  const Alloc &alloc__() const noexcept { return cap_.second(); }
+
+  size_type recommend__(size_type needed) const {
+    size_type m = max_size();
+    if (needed > m) {
+      throw mstl::bad_array_new_length();
+    }
+    size_type cap = capacity();
+    if (cap >= m / 2) {
+      return m;
+    }
+    size_type n = Growth::next_capacity(cap, needed);
+    return n > m || n < needed ? m : n;
+  }
+
+  // only on an empty vector without storage.
+  void allocate__(size_type n) {
+    if (n > max_size()) {
+      throw mstl::bad_array_new_length();
+    }
+    begin_ = end_ = alloc_traits__::allocate(alloc__(), n);
+    cap_.first() = begin_ + n;
+  }
+
+  void release__() noexcept {
+    if (begin_ != nullptr) {
+      destroy_range__(begin_, end_);
+      alloc_traits__::deallocate(alloc__(), begin_, capacity());
+      begin_ = end_ = cap_.first() = nullptr;
+    }
+  }
+
+  void steal__(vector &other) noexcept {
+    begin_ = other.begin_;
+    end_ = other.end_;
+    cap_.first() = other.cap_.first();
+    other.begin_ = other.end_ = other.cap_.first() = nullptr;
+  }
+
+  void swap_storage__(vector &other) noexcept {
+    mstl::swap(begin_, other.begin_);
+    mstl::swap(end_, other.end_);
+    mstl::swap(cap_.first(), other.cap_.first());
+  }
+
+  // constructors: allocate n and build the elements with make(begin). If
+  // that throws the destructor won't run, so the block is freed here.
+  template <typename Make> void init__(size_type n, Make &&make) {
+    if (n == 0) {
+      return;
+    }
+    allocate__(n);
+    try {
+      end_ = make(begin_);
+    } catch (...) {
+      release__();
+      throw;
+    }
+  }
+
+  void copy_from__(const vector &other) {
+    init__(other.size(), [&](T *dst) {
+      return copy_construct__(other.begin_, other.end_, dst);
+    });
+  }
+
+  void assign_move__(vector &other) {
+    size_type n = other.size();
+    if (n > capacity()) {
+      vector tmp(mstl::move(other), alloc__());
+      swap_storage__(tmp);
+      return;
+    }
+    size_type s = size();
+    mstl::move(other.begin_, other.begin_ + (n < s ? n : s), begin_);
+    if (n > s) {
+      end_ = move_construct__(other.begin_ + s, other.end_, end_);
+    } else {
+      erase_at_end__(begin_ + n);
+    }
+  }
+
+  void erase_at_end__(T *pos) noexcept {
+    destroy_range__(pos, end_);
+    end_ = pos;
+  }
+
+  // element construction, through the allocator if it cares.
+
+  template <typename... Args> void construct__(T *p, Args &&...args) {
+    alloc_traits__::construct(alloc__(), p, mstl::forward<Args>(args)...);
+  }
+
+  void destroy_range__(T *first, T *last) noexcept {
+    if constexpr (plain__) {
+      mstl::destroy(first, last);
+    } else {
+      for (; first != last; ++first) {
+        alloc_traits__::destroy(alloc__(), first);
+      }
+    }
+  }
+
+  // construct [dst, dst + n) with make(p), rolling back on exception.
+  template <typename Make>
+  T *construct_each__(T *dst, size_type n, Make &&make) {
+    T *cur = dst;
+    try {
+      for (; n > 0; --n, ++cur) {
+        make(cur);
+      }
+    } catch (...) {
+      destroy_range__(dst, cur);
+      throw;
+    }
+    return cur;
+  }
+
+  template <typename It> T *copy_construct__(It first, It last, T *dst) {
+    if constexpr (plain__) {
+      return mstl::uninitialized_copy(first, last, dst);
+    } else {
+      T *cur = dst;
+      try {
+        for (; first != last; ++first, ++cur) {
+          construct__(cur, *first);
+        }
+      } catch (...) {
+        destroy_range__(dst, cur);
+        throw;
+      }
+      return cur;
+    }
+  }
+
+  T *move_construct__(T *first, T *last, T *dst) {
+    if constexpr (plain__) {
+      return mstl::uninitialized_move(first, last, dst);
+    } else {
+      return construct_each__(dst, size_type(last - first), [&](T *p) {
+        construct__(p, mstl::move(*first++));
+      });
+    }
+  }
+
+  T *fill_construct__(T *dst, size_type n, const T &value) {
+    if constexpr (plain__) {
+      return mstl::uninitialized_fill_n(dst, n, value);
+    } else {
+      return construct_each__(dst, n, [&](T *p) { construct__(p, value); });
+    }
+  }
+
+  T *value_construct__(T *dst, size_type n) {
+    if constexpr (plain__) {
+      return mstl::uninitialized_value_construct_n(dst, n);
+    } else {
+      return construct_each__(dst, n, [&](T *p) { construct__(p); });
+    }
+  }
+
+  // allocators can only value initialize, so only the plain case can skip
+  // the zeroing.
+  T *default_construct__(T *dst, size_type n) {
+    if constexpr (plain__) {
+      return mstl::uninitialized_default_construct_n(dst, n);
+    } else {
+      return value_construct__(dst, n);
+    }
+  }
+
+  // Relocation. Moving [first, last) into raw storage at dst happens in two
+  // steps so a throwing copy can't lose elements:
+  //   transfer__ builds the new objects, the sources stay valid.
+  //   release_sources__ ends the old ones afterwards.
+  // For trivially relocatable types transfer is a memcpy and the sources
+  // are just forgotten.
+
+  T *transfer__(T *first, T *last, T *dst) {
+    if constexpr (relocatable__) {
+      size_type n = size_type(last - first);
+      if (n) {
+        memcpy(static_cast<void *>(dst), static_cast<const void *>(first),
+               n * sizeof(T));
+      }
+      return dst + n;
+    } else if constexpr (mstl::is_nothrow_move_constructible<T>::value ||
+                         !mstl::is_copy_constructible<T>::value) {
+      return move_construct__(first, last, dst);
+    } else {
+      return copy_construct__(first, last, dst);
+    }
+  }
+
+  void release_sources__(T *first, T *last) noexcept {
+    if constexpr (!relocatable__) {
+      destroy_range__(first, last);
+    }
+  }
+
+  // move everything into a block of new_cap, new_cap >= size().
+  void reallocate__(size_type new_cap) {
+    size_type n = size();
+    if constexpr (relocatable__) {
+      if (begin_ != nullptr &&
+          allocator_traits_UTILL::has_reallocate__<Alloc>::value) {
+        begin_ = alloc_traits__::reallocate(alloc__(), begin_, capacity(),
+                                            new_cap);
+        end_ = begin_ + n;
+        cap_.first() = begin_ + new_cap;
+        return;
+      }
+    }
+    T *buf = alloc_traits__::allocate(alloc__(), new_cap);
+    try {
+      transfer__(begin_, end_, buf);
+    } catch (...) {
+      alloc_traits__::deallocate(alloc__(), buf, new_cap);
+      throw;
+    }
+    replace_storage__(buf, n, new_cap);
+  }
+
+  // the old elements have been transferred into buf, drop the old block.
+  void replace_storage__(T *buf, size_type n, size_type new_cap) noexcept {
+    if (begin_ != nullptr) {
+      release_sources__(begin_, end_);
+      alloc_traits__::deallocate(alloc__(), begin_, capacity());
+    }
+    begin_ = buf;
+    end_ = buf + n;
+    cap_.first() = buf + new_cap;
+  }
+
+  template <typename... Args> void grow_emplace_back__(Args &&...args) {
+    size_type n = size();
+    size_type new_cap = recommend__(n + 1);
+    if constexpr (relocatable__ &&
+                  allocator_traits_UTILL::has_reallocate__<Alloc>::value) {
+      // realloc frees the old block, and args might point into it.
+      T tmp(mstl::forward<Args>(args)...);
+      reallocate__(new_cap);
+      construct__(end_, mstl::move(tmp));
+      ++end_;
+    } else {
+      // build the new element first, args are still valid here.
+      T *buf = alloc_traits__::allocate(alloc__(), new_cap);
+      try {
+        construct__(buf + n, mstl::forward<Args>(args)...);
+      } catch (...) {
+        alloc_traits__::deallocate(alloc__(), buf, new_cap);
+        throw;
+      }
+      try {
+        transfer__(begin_, end_, buf);
+      } catch (...) {
+        destroy_range__(buf + n, buf + n + 1);
+        alloc_traits__::deallocate(alloc__(), buf, new_cap);
+        throw;
+      }
+      replace_storage__(buf, n + 1, new_cap);
+    }
+  }
+
+  // Open a gap of n at p and fill it.
+  //   construct(dst, k): construct the last k elements of the inserted
+  //                      range at dst, return the end.
+  //   assign(dst, k):    assign the first k elements over live objects.
+  // The callbacks must not refer to elements of this vector.
+  template <typename Construct, typename Assign>
+  T *insert_n__(T *p, size_type n, Construct &&construct, Assign &&assign) {
+    size_type off = size_type(p - begin_);
+
+    if (size_type(cap_.first() - end_) < n) {
+      size_type new_cap = recommend__(size() + n);
+      T *buf = alloc_traits__::allocate(alloc__(), new_cap);
+      T *gap = buf + off;
+      try {
+        construct(gap, n);
+      } catch (...) {
+        alloc_traits__::deallocate(alloc__(), buf, new_cap);
+        throw;
+      }
+      T *prefix_end = buf;
+      try {
+        prefix_end = transfer__(begin_, p, buf);
+        transfer__(p, end_, gap + n);
+      } catch (...) {
+        destroy_range__(buf, prefix_end);
+        destroy_range__(gap, gap + n);
+        alloc_traits__::deallocate(alloc__(), buf, new_cap);
+        throw;
+      }
+      replace_storage__(buf, size() + n, new_cap);
+      return begin_ + off;
+    }
+
+    size_type tail = size_type(end_ - p);
+    if constexpr (relocatable__) {
+      // slide the tail up bytewise and build the new elements in the hole.
+      if (tail) {
+        memmove(static_cast<void *>(p + n), static_cast<const void *>(p),
+                tail * sizeof(T));
+      }
+      try {
+        construct(p, n);
+      } catch (...) {
+        if (tail) {
+          memmove(static_cast<void *>(p), static_cast<const void *>(p + n),
+                  tail * sizeof(T));
+        }
+        throw;
+      }
+      end_ += n;
+    } else if (n < tail) {
+      // the last n of the tail move into raw storage, the rest shifts
+      // over live objects and the gap is assigned.
+      T *old_end = end_;
+      end_ = move_construct__(end_ - n, end_, end_);
+      mstl::move_backward(p, old_end - n, old_end);
+      assign(p, n);
+    } else {
+      // the inserted range runs past the old end. Construct its last
+      // n - tail elements there, move the tail after them, then assign.
+      T *old_end = end_;
+      end_ = construct(end_, n - tail);
+      end_ = move_construct__(p, old_end, end_);
+      assign(p, tail);
+    }
+    return p;
+  }
+
+  template <typename Make> void resize__(size_type n, Make &&make) {
+    size_type s = size();
+    if (n <= s) {
+      erase_at_end__(begin_ + n);
+      return;
+    }
+    if (n > capacity()) {
+      reallocate__(recommend__(n));
+    }
+    end_ = make(end_, n - s);
+  }
+};
+
+template <typename T, typename A, typename G>
+bool operator==(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return x.size() == y.size() && mstl::equal(x.begin(), x.end(), y.begin());
+}
+
+template <typename T, typename A, typename G>
+bool operator!=(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return !(x == y);
+}
+
+template <typename T, typename A, typename G>
+bool operator<(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return mstl::lexicographical_compare(x.begin(), x.end(), y.begin(),
+                                       y.end());
+}
+
+template <typename T, typename A, typename G>
+bool operator>(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return y < x;
+}
+
+template <typename T, typename A, typename G>
+bool operator<=(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return !(y < x);
+}
+
+template <typename T, typename A, typename G>
+bool operator>=(const vector<T, A, G> &x, const vector<T, A, G> &y) {
+  return !(x < y);
+}
+
+template <typename T, typename A, typename G>
+void swap(vector<T, A, G> &x, vector<T, A, G> &y) noexcept {
+  x.swap(y);
+}
+
+// a vector only points at its heap block, so it can be moved bytewise as
+// long as its allocator can.
+template <typename T, typename A, typename G>
+struct is_trivially_relocatable<vector<T, A, G>>
+    : mstl::is_trivially_relocatable<A> {};
+
+} // namespace mstl
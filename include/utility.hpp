@@ -29,3 +29,134 @@ template <typename T>
 typename mstl::add_rvalue_reference<T>::type declval() noexcept;
 
 } // namespace mstl
+
+namespace mstl {
+
+// the plain product of two types. Containers with keys use it as their
+// value_type, pair<const Key, Value>.
+template <typename T1, typename T2> struct pair {
+  using first_type = T1;
+  using second_type = T2;
+
+  T1 first;
+  T2 second;
+
+  constexpr pair() : first(), second() {}
+  constexpr pair(const T1 &a, const T2 &b) : first(a), second(b) {}
+
+  template <typename U1, typename U2>
+  constexpr pair(U1 &&a, U2 &&b)
+      : first(mstl::forward<U1>(a)), second(mstl::forward<U2>(b)) {}
+
+  template <typename U1, typename U2>
+  constexpr pair(const pair<U1, U2> &p) : first(p.first), second(p.second) {}
+
+  template <typename U1, typename U2>
+  constexpr pair(pair<U1, U2> &&p)
+      : first(mstl::forward<U1>(p.first)), second(mstl::forward<U2>(p.second)) {
+  }
+
+  pair(const pair &) = default;
+  pair(pair &&) = default;
+  pair &operator=(const pair &) = default;
+  pair &operator=(pair &&) = default;
+};
+
+template <typename T1, typename T2>
+constexpr bool operator==(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return x.first == y.first && x.second == y.second;
+}
+
+template <typename T1, typename T2>
+constexpr bool operator!=(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return !(x == y);
+}
+
+// compare first, and second only if first is a tie.
+template <typename T1, typename T2>
+constexpr bool operator<(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return x.first < y.first || (!(y.first < x.first) && x.second < y.second);
+}
+
+template <typename T1, typename T2>
+constexpr bool operator>(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return y < x;
+}
+
+template <typename T1, typename T2>
+constexpr bool operator<=(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return !(y < x);
+}
+
+template <typename T1, typename T2>
+constexpr bool operator>=(const pair<T1, T2> &x, const pair<T1, T2> &y) {
+  return !(x < y);
+}
+
+template <typename T1, typename T2>
+constexpr pair<typename mstl::decay<T1>::type, typename mstl::decay<T2>::type>
+make_pair(T1 &&a, T2 &&b) {
+  return pair<typename mstl::decay<T1>::type, typename mstl::decay<T2>::type>(
+      mstl::forward<T1>(a), mstl::forward<T2>(b));
+}
+
+// compile time sequence of integers, mostly to unpack arrays and tuples
+// into parameter packs: f(a[I]...) for I in make_index_sequence<N>.
+template <typename T, T... I> struct integer_sequence {
+  using value_type = T;
+  static constexpr size_t size() noexcept { return sizeof...(I); }
+};
+
+template <size_t... I> using index_sequence = integer_sequence<size_t, I...>;
+
+} // namespace mstl
+
+namespace mstl::utility_UTILL {
+
+// halve and concatenate, so the instantiation depth is log N instead of N.
+template <typename S1, typename S2> struct concat_sequence__;
+template <typename T, T... I, T... J>
+struct concat_sequence__<integer_sequence<T, I...>, integer_sequence<T, J...>> {
+  using type = integer_sequence<T, I..., (T(sizeof...(I)) + J)...>;
+};
+
+template <typename T, size_t N>
+struct make_sequence__
+    : concat_sequence__<typename make_sequence__<T, N / 2>::type,
+                        typename make_sequence__<T, N - N / 2>::type> {};
+template <typename T> struct make_sequence__<T, 0> {
+  using type = integer_sequence<T>;
+};
+template <typename T> struct make_sequence__<T, 1> {
+  using type = integer_sequence<T, 0>;
+};
+
+} // namespace mstl::utility_UTILL
+
+namespace mstl {
+
+template <typename T, T N>
+using make_integer_sequence =
+    typename utility_UTILL::make_sequence__<T, size_t(N)>::type;
+
+template <size_t N>
+using make_index_sequence = make_integer_sequence<size_t, N>;
+
+template <typename... T>
+using index_sequence_for = make_index_sequence<sizeof...(T)>;
+
+// tag for constructors taking a range that is already sorted and has no
+// duplicates. They trust it and skip the comparisons.
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+template <typename T1, typename T2>
+struct is_trivially_relocatable<pair<T1, T2>>
+    : mstl::integral_constant<bool,
+                              mstl::is_trivially_relocatable<T1>::value &&
+                                  mstl::is_trivially_relocatable<T2>::value> {
+};
+
+} // namespace mstl